@@ -828,6 +828,23 @@ line15:
 extern int
 slurm_load_jobs (time_t update_time, job_info_msg_t **resp,
 		 uint16_t show_flags)
+{
+	return slurm_load_jobs_filter(update_time, resp, show_flags, NULL);
+}
+
+/*
+ * slurm_load_jobs_filter - issue RPC to get job configuration information
+ *	for jobs matching a filter if changed since update_time
+ * IN update_time - time of current configuration data
+ * IN job_info_msg_pptr - place to store a job configuration pointer
+ * IN show_flags -  job filtering option: 0, SHOW_ALL or SHOW_DETAIL
+ * IN filter - jobs to report, NULL to report all jobs
+ * RET 0 or -1 on error
+ * NOTE: free the response using slurm_free_job_info_msg
+ */
+extern int
+slurm_load_jobs_filter (time_t update_time, job_info_msg_t **resp,
+			uint16_t show_flags, job_info_filter_t *filter)
 {
 	int rc;
 	slurm_msg_t resp_msg;
@@ -839,6 +856,152 @@ slurm_load_jobs (time_t update_time, job_info_msg_t **resp,
 
 	req.last_update  = update_time;
 	req.show_flags = show_flags;
+	req.filter = filter;
+	req.delta = 0;
+	req_msg.msg_type = REQUEST_JOB_INFO;
+	req_msg.data     = &req;
+
+	if (slurm_send_recv_controller_msg(&req_msg, &resp_msg) < 0)
+		return SLURM_ERROR;
+
+	switch (resp_msg.msg_type) {
+	case RESPONSE_JOB_INFO:
+		*resp = (job_info_msg_t *)resp_msg.data;
+		break;
+	case RESPONSE_SLURM_RC:
+		rc = ((return_code_msg_t *) resp_msg.data)->return_code;
+		slurm_free_return_code_msg(resp_msg.data);
+		if (rc)
+			slurm_seterrno_ret(rc);
+		break;
+	default:
+		slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+		break;
+	}
+
+	return SLURM_PROTOCOL_SUCCESS ;
+}
+
+typedef struct job_delta_order {
+	uint32_t job_id;
+	uint32_t inx;
+} job_delta_order_t;
+
+static int _delta_order_cmp(const void *x, const void *y)
+{
+	const job_delta_order_t *rec1 = (const job_delta_order_t *) x;
+	const job_delta_order_t *rec2 = (const job_delta_order_t *) y;
+
+	if (rec1->job_id < rec2->job_id)
+		return -1;
+	if (rec1->job_id > rec2->job_id)
+		return 1;
+	return 0;
+}
+
+static int _job_id_cmp(const void *x, const void *y)
+{
+	uint32_t id1 = *(const uint32_t *) x;
+	uint32_t id2 = *(const uint32_t *) y;
+
+	if (id1 < id2)
+		return -1;
+	if (id1 > id2)
+		return 1;
+	return 0;
+}
+
+/* Apply a delta to a previous job information message, consuming both.
+ * Changed records replace the old ones in place, new jobs are appended. */
+static job_info_msg_t *_merge_job_delta(job_info_msg_t *old,
+					job_info_delta_msg_t *delta)
+{
+	job_info_msg_t *changed = delta->job_info, *new;
+	job_delta_order_t *order, key, *match;
+	bool *used;
+	uint32_t i, cnt = 0;
+
+	order = xmalloc(sizeof(job_delta_order_t) *
+			(changed->record_count + 1));
+	used = xmalloc(sizeof(bool) * (changed->record_count + 1));
+	for (i = 0; i < changed->record_count; i++) {
+		order[i].job_id = changed->job_array[i].job_id;
+		order[i].inx = i;
+	}
+	qsort(order, changed->record_count, sizeof(job_delta_order_t),
+	      _delta_order_cmp);
+	qsort(delta->removed_ids, delta->removed_cnt, sizeof(uint32_t),
+	      _job_id_cmp);
+
+	new = xmalloc(sizeof(job_info_msg_t));
+	new->last_update = changed->last_update;
+	new->job_array = xmalloc(sizeof(job_info_t) *
+				 (old->record_count + changed->record_count +
+				  1));
+	for (i = 0; i < old->record_count; i++) {
+		key.job_id = old->job_array[i].job_id;
+		match = bsearch(&key, order, changed->record_count,
+				sizeof(job_delta_order_t), _delta_order_cmp);
+		if (match && !used[match->inx]) {
+			slurm_free_job_info_members(&old->job_array[i]);
+			new->job_array[cnt++] = changed->job_array[match->inx];
+			used[match->inx] = true;
+		} else if (match ||
+			   bsearch(&key.job_id, delta->removed_ids,
+				   delta->removed_cnt, sizeof(uint32_t),
+				   _job_id_cmp)) {
+			slurm_free_job_info_members(&old->job_array[i]);
+		} else
+			new->job_array[cnt++] = old->job_array[i];
+	}
+	for (i = 0; i < changed->record_count; i++) {
+		if (!used[i])
+			new->job_array[cnt++] = changed->job_array[i];
+	}
+	new->record_count = cnt;
+
+	xfree(order);
+	xfree(used);
+	xfree(old->job_array);
+	xfree(old);
+	xfree(changed->job_array);
+	changed->record_count = 0;
+	slurm_free_job_info_delta_msg(delta);
+
+	return new;
+}
+
+/*
+ * slurm_load_jobs_delta - issue RPC to get all job configuration
+ *	information if changed since a previous response
+ * IN old_job_info_ptr - previous response from slurm_load_jobs() or
+ *	slurm_load_jobs_delta() with the same show_flags, NULL if none
+ * IN job_info_msg_pptr - place to store a job configuration pointer
+ * IN show_flags -  job filtering option: 0, SHOW_ALL or SHOW_DETAIL
+ * RET 0 or -1 on error
+ * NOTE: on success old_job_info_ptr is consumed and must not be used again,
+ *	on error (including SLURM_NO_CHANGE_IN_DATA) it is left unchanged
+ * NOTE: free the response using slurm_free_job_info_msg
+ */
+extern int
+slurm_load_jobs_delta (job_info_msg_t *old_job_info_ptr,
+		       job_info_msg_t **resp, uint16_t show_flags)
+{
+	int rc;
+	slurm_msg_t resp_msg;
+	slurm_msg_t req_msg;
+	job_info_request_msg_t req;
+
+	slurm_msg_t_init(&req_msg);
+	slurm_msg_t_init(&resp_msg);
+
+	if (old_job_info_ptr)
+		req.last_update = old_job_info_ptr->last_update;
+	else
+		req.last_update = (time_t) 0;
+	req.show_flags = show_flags;
+	req.filter = NULL;
+	req.delta = (old_job_info_ptr != NULL);
 	req_msg.msg_type = REQUEST_JOB_INFO;
 	req_msg.data     = &req;
 
@@ -848,6 +1011,16 @@ slurm_load_jobs (time_t update_time, job_info_msg_t **resp,
 	switch (resp_msg.msg_type) {
 	case RESPONSE_JOB_INFO:
 		*resp = (job_info_msg_t *)resp_msg.data;
+		slurm_free_job_info_msg(old_job_info_ptr);
+		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		if (old_job_info_ptr == NULL) {
+			slurm_free_job_info_delta_msg(resp_msg.data);
+			slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+		}
+		*resp = _merge_job_delta(old_job_info_ptr,
+					 (job_info_delta_msg_t *)
+					 resp_msg.data);
 		break;
 	case RESPONSE_SLURM_RC:
 		rc = ((return_code_msg_t *) resp_msg.data)->return_code;
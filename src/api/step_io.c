@@ -65,6 +65,10 @@
 
 #define MAX_RETRIES 3
 #define STDIO_MAX_FREE_BUF 1024
+/* Output buffers hold MAX_FRAME_LEN, allow STDIO_MIN_FREE_BUF plus
+ * STDIO_FREE_BUF_PER_NODE for each node, at most STDIO_MAX_FREE_BUF */
+#define STDIO_MIN_FREE_BUF 32
+#define STDIO_FREE_BUF_PER_NODE 4
 
 struct io_buf {
 	int ref_count;
@@ -73,7 +77,7 @@ struct io_buf {
 	io_hdr_t header;
 };
 
-static struct io_buf *_alloc_io_buf(void);
+static struct io_buf *_alloc_io_buf(uint32_t len);
 #if 0
 static void     _free_io_buf(struct io_buf *buf);
 #endif
@@ -338,6 +342,21 @@ _server_read(eio_obj_t *obj, List objs)
 			s->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
+		if (s->header.length > MAX_FRAME_LEN) {
+			error("Message length of %u from node %d exceeds "
+			      "maximum of %u", s->header.length, s->node_id,
+			      MAX_FRAME_LEN);
+			if (s->cio->sls)
+				step_launch_notify_io_failure(s->cio->sls,
+							      s->node_id);
+			close(obj->fd);
+			obj->fd = -1;
+			s->in_eof = true;
+			s->out_eof = true;
+			list_enqueue(s->cio->free_outgoing, s->in_msg);
+			s->in_msg = NULL;
+			return SLURM_SUCCESS;
+		}
 		s->in_remaining = s->header.length;
 		s->in_msg->length = s->header.length;
 		s->in_msg->header = s->header;
@@ -944,7 +963,7 @@ _wid(int n)
 }
 
 static struct io_buf *
-_alloc_io_buf(void)
+_alloc_io_buf(uint32_t len)
 {
 	struct io_buf *buf;
 
@@ -955,7 +974,7 @@ _alloc_io_buf(void)
 	buf->length = 0;
 	/* The following "+ 1" is just temporary so I can stick a \0 at
 	   the end and do a printf of the data pointer */
-	buf->data = xmalloc(MAX_MSG_LEN + io_hdr_packed_size() + 1);
+	buf->data = xmalloc(len + io_hdr_packed_size() + 1);
 	if (!buf->data) {
 		xfree(buf);
 		return NULL;
@@ -1026,7 +1045,7 @@ _incoming_buf_free(client_io_t *cio)
 	if (list_count(cio->free_incoming) > 0) {
 		return true;
 	} else if (cio->incoming_count < STDIO_MAX_FREE_BUF) {
-		buf = _alloc_io_buf();
+		buf = _alloc_io_buf(MAX_MSG_LEN);
 		if (buf != NULL) {
 			list_enqueue(cio->free_incoming, buf);
 			cio->incoming_count++;
@@ -1043,8 +1062,10 @@ _outgoing_buf_free(client_io_t *cio)
 
 	if (list_count(cio->free_outgoing) > 0) {
 		return true;
-	} else if (cio->outgoing_count < STDIO_MAX_FREE_BUF) {
-		buf = _alloc_io_buf();
+	} else if (cio->outgoing_count <
+		   MIN(STDIO_MAX_FREE_BUF, STDIO_MIN_FREE_BUF +
+		       STDIO_FREE_BUF_PER_NODE * cio->num_nodes)) {
+		buf = _alloc_io_buf(MAX_FRAME_LEN);
 		if (buf != NULL) {
 			list_enqueue(cio->free_outgoing, buf);
 			cio->outgoing_count++;
@@ -1133,13 +1154,11 @@ client_io_handler_create(slurm_step_io_fds_t fds,
 	cio->free_incoming = list_create(NULL); /* FIXME! Needs destructor */
 	cio->incoming_count = 0;
 	for (i = 0; i < STDIO_MAX_FREE_BUF; i++) {
-		list_enqueue(cio->free_incoming, _alloc_io_buf());
+		list_enqueue(cio->free_incoming, _alloc_io_buf(MAX_MSG_LEN));
 	}
+	/* Output buffers are large, allocate them as needed */
 	cio->free_outgoing = list_create(NULL); /* FIXME! Needs destructor */
 	cio->outgoing_count = 0;
-	for (i = 0; i < STDIO_MAX_FREE_BUF; i++) {
-		list_enqueue(cio->free_outgoing, _alloc_io_buf());
-	}
 	cio->sls = NULL;
 
 	return cio;
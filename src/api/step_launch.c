@@ -64,6 +64,7 @@
 #include "slurm/slurm.h"
 
 #include "src/common/hostlist.h"
+#include "src/common/io_hdr.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/xmalloc.h"
@@ -288,6 +289,7 @@ int slurm_step_launch (slurm_step_ctx_t *ctx,
 			rc = SLURM_ERROR;
 			goto fail1;
 		}
+		launch.io_frame_len = MAX_FRAME_LEN;
 		launch.num_io_port = ctx->launch_state->io.normal->num_listen;
 		launch.io_port = xmalloc(sizeof(uint16_t)*launch.num_io_port);
 		for (i = 0; i < launch.num_io_port; i++) {
@@ -39,9 +39,11 @@
 #include "assoc_mgr.h"
 
 #include <sys/types.h>
+#include <ctype.h>
 #include <pwd.h>
 #include <fcntl.h>
 
+#include "src/common/macros.h"
 #include "src/common/uid.h"
 #include "src/common/xstring.h"
 #include "src/common/slurm_priority.h"
@@ -70,11 +72,474 @@ void (*update_resvs) () = NULL;
 static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
 
+/* Hash indexes over the assoc_mgr lists.  Each list has its indexes
+ * rebuilt whenever the list is replaced and kept current by the
+ * assoc_mgr_update_*() functions, always under the list's write lock.
+ * Entries are appended to their chain, so records sharing a key are
+ * found in list order, as a scan of the list would find them. */
+typedef struct assoc_mgr_hash_ent {
+	uint32_t key;
+	void *rec;
+	struct assoc_mgr_hash_ent *next;
+} assoc_mgr_hash_ent_t;
+
+typedef struct {
+	assoc_mgr_hash_ent_t **bucket;
+	uint32_t size;			/* bucket count, a power of 2 */
+	uint32_t count;			/* entry count */
+} assoc_mgr_hash_t;
+
+#define ASSOC_MGR_HASH_MIN	64
+
+static assoc_mgr_hash_t assoc_id_hash;	/* by id */
+static assoc_mgr_hash_t assoc_key_hash;	/* by uid and account */
+static assoc_mgr_hash_t qos_id_hash;	/* by id */
+static assoc_mgr_hash_t qos_name_hash;	/* by name */
+static assoc_mgr_hash_t user_uid_hash;	/* by uid */
+static assoc_mgr_hash_t user_name_hash;	/* by name */
+static assoc_mgr_hash_t wckey_id_hash;	/* by id */
+static assoc_mgr_hash_t wckey_key_hash;	/* by uid and name */
+
+/* list_find() function to position an iterator on a record */
+static int _list_find_ptr(void *x, void *key)
+{
+	return (x == key);
+}
+
+/* Case insensitive, names are compared with strcasecmp() */
+static uint32_t _hash_str(const char *str)
+{
+	uint32_t hash = 5381;
+
+	if (str) {
+		while (*str)
+			hash = (hash * 33) + tolower((int) *str++);
+	}
+	return hash;
+}
+
+static uint32_t _hash_uid_str(uint32_t uid, const char *str)
+{
+	return (uid * 0x9e3779b1) ^ _hash_str(str);
+}
+
+static assoc_mgr_hash_ent_t **_hash_bucket(assoc_mgr_hash_t *hash,
+					   uint32_t key)
+{
+	/* Spread sequential ids and weak string hashes alike */
+	key *= 0x9e3779b1;
+	return &hash->bucket[(key >> 16) & (hash->size - 1)];
+}
+
+static void _hash_clear(assoc_mgr_hash_t *hash)
+{
+	assoc_mgr_hash_ent_t *ent, *next;
+	uint32_t i;
+
+	for (i = 0; i < hash->size; i++) {
+		for (ent = hash->bucket[i]; ent; ent = next) {
+			next = ent->next;
+			xfree(ent);
+		}
+	}
+	xfree(hash->bucket);
+	hash->size = 0;
+	hash->count = 0;
+}
+
+/* Append at the tail of its chain, keeping entries in list order */
+static void _hash_append(assoc_mgr_hash_t *hash, assoc_mgr_hash_ent_t *ent)
+{
+	assoc_mgr_hash_ent_t **tail = _hash_bucket(hash, ent->key);
+
+	while (*tail)
+		tail = &(*tail)->next;
+	ent->next = NULL;
+	*tail = ent;
+}
+
+static void _hash_add(assoc_mgr_hash_t *hash, uint32_t key, void *rec)
+{
+	assoc_mgr_hash_ent_t *ent, *next, **old_bucket;
+	uint32_t i, old_size;
+
+	if (hash->count >= hash->size) {
+		/* Old chains are walked in order, so growing keeps
+		 * records sharing a key in list order */
+		old_bucket = hash->bucket;
+		old_size = hash->size;
+		hash->size = MAX(old_size * 2, ASSOC_MGR_HASH_MIN);
+		hash->bucket = xmalloc(sizeof(assoc_mgr_hash_ent_t *) *
+				       hash->size);
+		for (i = 0; i < old_size; i++) {
+			for (ent = old_bucket[i]; ent; ent = next) {
+				next = ent->next;
+				_hash_append(hash, ent);
+			}
+		}
+		xfree(old_bucket);
+	}
+
+	ent = xmalloc(sizeof(assoc_mgr_hash_ent_t));
+	ent->key = key;
+	ent->rec = rec;
+	_hash_append(hash, ent);
+	hash->count++;
+}
+
+static void _hash_remove(assoc_mgr_hash_t *hash, uint32_t key, void *rec)
+{
+	assoc_mgr_hash_ent_t *ent, **prev;
+
+	if (!hash->size)
+		return;
+	for (prev = _hash_bucket(hash, key); (ent = *prev);
+	     prev = &ent->next) {
+		if (ent->rec == rec) {
+			*prev = ent->next;
+			xfree(ent);
+			hash->count--;
+			return;
+		}
+	}
+}
+
+/* First entry of key's chain, callers skip entries with other keys */
+static assoc_mgr_hash_ent_t *_hash_first(assoc_mgr_hash_t *hash,
+					 uint32_t key)
+{
+	if (!hash->size)
+		return NULL;
+	return *_hash_bucket(hash, key);
+}
+
+static void _assoc_hash_add(slurmdb_association_rec_t *assoc)
+{
+	_hash_add(&assoc_id_hash, assoc->id, assoc);
+	_hash_add(&assoc_key_hash, _hash_uid_str(assoc->uid, assoc->acct),
+		  assoc);
+}
+
+static void _assoc_hash_remove(slurmdb_association_rec_t *assoc)
+{
+	_hash_remove(&assoc_id_hash, assoc->id, assoc);
+	_hash_remove(&assoc_key_hash, _hash_uid_str(assoc->uid, assoc->acct),
+		     assoc);
+}
+
+/* Call after association uids change */
+static void _assoc_key_hash_rebuild(void)
+{
+	slurmdb_association_rec_t *assoc;
+	ListIterator itr;
+
+	_hash_clear(&assoc_key_hash);
+	if (!assoc_mgr_association_list)
+		return;
+	itr = list_iterator_create(assoc_mgr_association_list);
+	while ((assoc = list_next(itr))) {
+		_hash_add(&assoc_key_hash,
+			  _hash_uid_str(assoc->uid, assoc->acct), assoc);
+	}
+	list_iterator_destroy(itr);
+}
+
+/* Call after assoc_mgr_association_list is replaced */
+static void _assoc_hash_rebuild(void)
+{
+	slurmdb_association_rec_t *assoc;
+	ListIterator itr;
+
+	_hash_clear(&assoc_id_hash);
+	if (assoc_mgr_association_list) {
+		itr = list_iterator_create(assoc_mgr_association_list);
+		while ((assoc = list_next(itr)))
+			_hash_add(&assoc_id_hash, assoc->id, assoc);
+		list_iterator_destroy(itr);
+	}
+	_assoc_key_hash_rebuild();
+}
+
+static slurmdb_association_rec_t *_find_assoc_id(uint32_t id)
+{
+	assoc_mgr_hash_ent_t *ent;
+
+	for (ent = _hash_first(&assoc_id_hash, id); ent; ent = ent->next) {
+		if (((slurmdb_association_rec_t *) ent->rec)->id == id)
+			return ent->rec;
+	}
+	return NULL;
+}
+
+/* Find the association of a uid, account and partition, as
+ * assoc_mgr_fill_in_assoc() defines a match.  A partition specific
+ * request falls back to the association without a partition. */
+static slurmdb_association_rec_t *_find_assoc_key(
+	slurmdb_association_rec_t *assoc)
+{
+	assoc_mgr_hash_ent_t *ent;
+	slurmdb_association_rec_t *found_assoc, *ret_assoc = NULL;
+	uint32_t key = _hash_uid_str(assoc->uid, assoc->acct);
+
+	for (ent = _hash_first(&assoc_key_hash, key); ent; ent = ent->next) {
+		found_assoc = ent->rec;
+		if ((ent->key != key) || (assoc->uid != found_assoc->uid))
+			continue;
+
+		if (found_assoc->acct
+		    && strcasecmp(assoc->acct, found_assoc->acct)) {
+			debug4("not the right account %s != %s",
+			       assoc->acct, found_assoc->acct);
+			continue;
+		}
+
+		/* only check for on the slurmdbd */
+		if (!assoc_mgr_cluster_name && found_assoc->cluster
+		    && strcasecmp(assoc->cluster, found_assoc->cluster)) {
+			debug4("not the right cluster");
+			continue;
+		}
+
+		if (assoc->partition) {
+			if (!found_assoc->partition) {
+				ret_assoc = found_assoc;
+				debug3("found association for no partition");
+				continue;
+			} else if (strcasecmp(assoc->partition,
+					      found_assoc->partition)) {
+				debug4("not the right partition");
+				continue;
+			}
+		} else if (found_assoc->partition) {
+			debug4("partition specific association "
+			       "looking for one without.");
+			continue;
+		}
+		return found_assoc;
+	}
+	return ret_assoc;
+}
+
+static void _qos_hash_add(slurmdb_qos_rec_t *qos)
+{
+	_hash_add(&qos_id_hash, qos->id, qos);
+	_hash_add(&qos_name_hash, _hash_str(qos->name), qos);
+}
+
+static void _qos_hash_remove(slurmdb_qos_rec_t *qos)
+{
+	_hash_remove(&qos_id_hash, qos->id, qos);
+	_hash_remove(&qos_name_hash, _hash_str(qos->name), qos);
+}
+
+/* Call after assoc_mgr_qos_list is replaced */
+static void _qos_hash_rebuild(void)
+{
+	slurmdb_qos_rec_t *qos;
+	ListIterator itr;
+
+	_hash_clear(&qos_id_hash);
+	_hash_clear(&qos_name_hash);
+	if (!assoc_mgr_qos_list)
+		return;
+	itr = list_iterator_create(assoc_mgr_qos_list);
+	while ((qos = list_next(itr)))
+		_qos_hash_add(qos);
+	list_iterator_destroy(itr);
+}
+
+static slurmdb_qos_rec_t *_find_qos(uint32_t id, char *name)
+{
+	assoc_mgr_hash_ent_t *ent;
+	slurmdb_qos_rec_t *qos;
+	uint32_t key;
+
+	for (ent = _hash_first(&qos_id_hash, id); ent; ent = ent->next) {
+		if (((slurmdb_qos_rec_t *) ent->rec)->id == id)
+			return ent->rec;
+	}
+	if (!name)
+		return NULL;
+	key = _hash_str(name);
+	for (ent = _hash_first(&qos_name_hash, key); ent; ent = ent->next) {
+		qos = ent->rec;
+		if ((ent->key == key) && qos->name
+		    && !strcasecmp(name, qos->name))
+			return qos;
+	}
+	return NULL;
+}
+
+static void _user_hash_add(slurmdb_user_rec_t *user)
+{
+	_hash_add(&user_uid_hash, user->uid, user);
+	_hash_add(&user_name_hash, _hash_str(user->name), user);
+}
+
+static void _user_hash_remove(slurmdb_user_rec_t *user)
+{
+	_hash_remove(&user_uid_hash, user->uid, user);
+	_hash_remove(&user_name_hash, _hash_str(user->name), user);
+}
+
+/* Call after assoc_mgr_user_list is replaced or a name or uid changes */
+static void _user_hash_rebuild(void)
+{
+	slurmdb_user_rec_t *user;
+	ListIterator itr;
+
+	_hash_clear(&user_uid_hash);
+	_hash_clear(&user_name_hash);
+	if (!assoc_mgr_user_list)
+		return;
+	itr = list_iterator_create(assoc_mgr_user_list);
+	while ((user = list_next(itr)))
+		_user_hash_add(user);
+	list_iterator_destroy(itr);
+}
+
+/* Find a user by uid, or by name if uid is NO_VAL */
+static slurmdb_user_rec_t *_find_user(uint32_t uid, char *name)
+{
+	assoc_mgr_hash_ent_t *ent;
+	slurmdb_user_rec_t *user;
+	uint32_t key;
+
+	if (uid != NO_VAL) {
+		for (ent = _hash_first(&user_uid_hash, uid); ent;
+		     ent = ent->next) {
+			if (((slurmdb_user_rec_t *) ent->rec)->uid == uid)
+				return ent->rec;
+		}
+		return NULL;
+	}
+	if (!name)
+		return NULL;
+	key = _hash_str(name);
+	for (ent = _hash_first(&user_name_hash, key); ent; ent = ent->next) {
+		user = ent->rec;
+		if ((ent->key == key) && user->name
+		    && !strcasecmp(name, user->name))
+			return user;
+	}
+	return NULL;
+}
+
+static void _wckey_hash_add(slurmdb_wckey_rec_t *wckey)
+{
+	_hash_add(&wckey_id_hash, wckey->id, wckey);
+	_hash_add(&wckey_key_hash, _hash_uid_str(wckey->uid, wckey->name),
+		  wckey);
+}
+
+static void _wckey_hash_remove(slurmdb_wckey_rec_t *wckey)
+{
+	_hash_remove(&wckey_id_hash, wckey->id, wckey);
+	_hash_remove(&wckey_key_hash, _hash_uid_str(wckey->uid, wckey->name),
+		     wckey);
+}
+
+/* Call after assoc_mgr_wckey_list is replaced or a uid changes */
+static void _wckey_hash_rebuild(void)
+{
+	slurmdb_wckey_rec_t *wckey;
+	ListIterator itr;
+
+	_hash_clear(&wckey_id_hash);
+	_hash_clear(&wckey_key_hash);
+	if (!assoc_mgr_wckey_list)
+		return;
+	itr = list_iterator_create(assoc_mgr_wckey_list);
+	while ((wckey = list_next(itr)))
+		_wckey_hash_add(wckey);
+	list_iterator_destroy(itr);
+}
+
+static slurmdb_wckey_rec_t *_find_wckey_id(uint32_t id)
+{
+	assoc_mgr_hash_ent_t *ent;
+
+	for (ent = _hash_first(&wckey_id_hash, id); ent; ent = ent->next) {
+		if (((slurmdb_wckey_rec_t *) ent->rec)->id == id)
+			return ent->rec;
+	}
+	return NULL;
+}
+
+/* Return true if found_wckey matches a request without a wckey id, as
+ * assoc_mgr_fill_in_wckey() defines a match */
+static bool _wckey_match(slurmdb_wckey_rec_t *wckey,
+			 slurmdb_wckey_rec_t *found_wckey)
+{
+	if (wckey->uid != NO_VAL) {
+		if (wckey->uid != found_wckey->uid) {
+			debug4("not the right user %u != %u",
+			       wckey->uid, found_wckey->uid);
+			return false;
+		}
+	} else if (wckey->user && strcasecmp(wckey->user, found_wckey->user))
+		return false;
+
+	if (wckey->name
+	    && (!found_wckey->name
+		|| strcasecmp(wckey->name, found_wckey->name))) {
+		debug4("not the right name %s != %s",
+		       wckey->name, found_wckey->name);
+		return false;
+	}
+
+	/* only check for on the slurmdbd */
+	if (!assoc_mgr_cluster_name) {
+		if (!wckey->cluster) {
+			error("No cluster name was given "
+			      "to check against, "
+			      "we need one to get a wckey.");
+			return false;
+		}
+
+		if (found_wckey->cluster
+		    && strcasecmp(wckey->cluster, found_wckey->cluster)) {
+			debug4("not the right cluster");
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Find the wckey of a user and wckey name.  Requests giving only the
+ * user name are not indexed and scan the list. */
+static slurmdb_wckey_rec_t *_find_wckey_key(slurmdb_wckey_rec_t *wckey)
+{
+	assoc_mgr_hash_ent_t *ent;
+	slurmdb_wckey_rec_t *found_wckey = NULL;
+	ListIterator itr;
+	uint32_t key;
+
+	if ((wckey->uid != NO_VAL) && wckey->name) {
+		key = _hash_uid_str(wckey->uid, wckey->name);
+		for (ent = _hash_first(&wckey_key_hash, key); ent;
+		     ent = ent->next) {
+			if ((ent->key == key) && _wckey_match(wckey, ent->rec))
+				return ent->rec;
+		}
+		return NULL;
+	}
+
+	itr = list_iterator_create(assoc_mgr_wckey_list);
+	while ((found_wckey = list_next(itr))) {
+		if (_wckey_match(wckey, found_wckey))
+			break;
+	}
+	list_iterator_destroy(itr);
+	return found_wckey;
+}
+
 /* you should check for assoc == NULL before this function */
 static void _normalize_assoc_shares(slurmdb_association_rec_t *assoc)
 {
 	slurmdb_association_rec_t *assoc2 = assoc;
 
+	assoc->usage->fs_factor = (double)NO_VAL;
 	if ((assoc->shares_raw == SLURMDB_FS_USE_PARENT)
 	    && assoc->usage->parent_assoc_ptr) {
 		assoc->usage->shares_norm =
@@ -379,18 +844,24 @@ static int _set_assoc_parent_and_user(slurmdb_association_rec_t *assoc,
 			assoc->usage->parent_assoc_ptr = last_acct_parent;
 		} else {
 			slurmdb_association_rec_t *assoc2 = NULL;
-			ListIterator itr = list_iterator_create(assoc_list);
-			while ((assoc2 = list_next(itr))) {
-				if (assoc2->id == assoc->parent_id) {
-					assoc->usage->parent_assoc_ptr = assoc2;
-					if (assoc->user)
-						last_parent = assoc2;
-					else
-						last_acct_parent = assoc2;
-					break;
+			if (assoc_list == assoc_mgr_association_list)
+				assoc2 = _find_assoc_id(assoc->parent_id);
+			else {
+				ListIterator itr =
+					list_iterator_create(assoc_list);
+				while ((assoc2 = list_next(itr))) {
+					if (assoc2->id == assoc->parent_id)
+						break;
 				}
+				list_iterator_destroy(itr);
+			}
+			if (assoc2) {
+				assoc->usage->parent_assoc_ptr = assoc2;
+				if (assoc->user)
+					last_parent = assoc2;
+				else
+					last_acct_parent = assoc2;
 			}
-			list_iterator_destroy(itr);
 		}
 		if (assoc->usage->parent_assoc_ptr && setup_children) {
 			if (!assoc->usage->parent_assoc_ptr->usage)
@@ -492,6 +963,10 @@ static int _post_association_list(List assoc_list)
 	if (!assoc_list)
 		return SLURM_ERROR;
 
+	/* parents are found by id, uids are set along the way */
+	if (assoc_list == assoc_mgr_association_list)
+		_assoc_hash_rebuild();
+
 	itr = list_iterator_create(assoc_list);
 
 	//START_TIMER;
@@ -499,6 +974,8 @@ static int _post_association_list(List assoc_list)
 		_set_assoc_parent_and_user(assoc, assoc_list, reset);
 		reset = 0;
 	}
+	if (assoc_list == assoc_mgr_association_list)
+		_assoc_key_hash_rebuild();
 
 	if (setup_children) {
 		slurmdb_association_rec_t *assoc2 = NULL;
@@ -659,6 +1136,7 @@ static int _get_assoc_mgr_association_list(void *db_conn, int enforce)
 		   isn't anything there */
 		assoc_mgr_association_list =
 			list_create(slurmdb_destroy_association_rec);
+		_assoc_hash_rebuild();
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS) {
 			error("_get_assoc_mgr_association_list: "
@@ -688,6 +1166,7 @@ static int _get_assoc_mgr_qos_list(void *db_conn, int enforce)
 	if (assoc_mgr_qos_list)
 		list_destroy(assoc_mgr_qos_list);
 	assoc_mgr_qos_list = acct_storage_g_get_qos(db_conn, uid, NULL);
+	_qos_hash_rebuild();
 
 	if (!assoc_mgr_qos_list) {
 		assoc_mgr_unlock(&locks);
@@ -721,6 +1200,7 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 	assoc_mgr_user_list = acct_storage_g_get_users(db_conn, uid, &user_q);
 
 	if (!assoc_mgr_user_list) {
+		_user_hash_rebuild();
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS) {
 			error("_get_assoc_mgr_user_list: "
@@ -732,6 +1212,7 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 	}
 
 	_post_user_list(assoc_mgr_user_list);
+	_user_hash_rebuild();
 
 	assoc_mgr_unlock(&locks);
 	return SLURM_SUCCESS;
@@ -772,6 +1253,7 @@ static int _get_assoc_mgr_wckey_list(void *db_conn, int enforce)
 		/* create list so we don't keep calling this if there
 		   isn't anything there */
 		assoc_mgr_wckey_list = list_create(slurmdb_destroy_wckey_rec);
+		_wckey_hash_rebuild();
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_WCKEYS) {
 			error("_get_assoc_mgr_wckey_list: "
@@ -785,6 +1267,7 @@ static int _get_assoc_mgr_wckey_list(void *db_conn, int enforce)
 	}
 
 	_post_wckey_list(assoc_mgr_wckey_list);
+	_wckey_hash_rebuild();
 
 	assoc_mgr_unlock(&locks);
 
@@ -797,7 +1280,6 @@ static int _refresh_assoc_mgr_association_list(void *db_conn, int enforce)
 	List current_assocs = NULL;
 	uid_t uid = getuid();
 	ListIterator curr_itr = NULL;
-	ListIterator assoc_mgr_itr = NULL;
 	slurmdb_association_rec_t *curr_assoc = NULL, *assoc = NULL;
 	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK,
 				   READ_LOCK, NO_LOCK, NO_LOCK };
@@ -842,17 +1324,13 @@ static int _refresh_assoc_mgr_association_list(void *db_conn, int enforce)
 	}
 
 	curr_itr = list_iterator_create(current_assocs);
-	assoc_mgr_itr = list_iterator_create(assoc_mgr_association_list);
 
 	/* add used limits We only look for the user associations to
 	 * do the parents since a parent may have moved */
 	while ((curr_assoc = list_next(curr_itr))) {
 		if (!curr_assoc->user)
 			continue;
-		while ((assoc = list_next(assoc_mgr_itr))) {
-			if (assoc->id == curr_assoc->id)
-				break;
-		}
+		assoc = _find_assoc_id(curr_assoc->id);
 
 		while (assoc) {
 			_addto_used_info(assoc, curr_assoc);
@@ -860,11 +1338,9 @@ static int _refresh_assoc_mgr_association_list(void *db_conn, int enforce)
 			   different than the one we are updating from */
 			assoc = assoc->usage->parent_assoc_ptr;
 		}
-		list_iterator_reset(assoc_mgr_itr);
 	}
 
 	list_iterator_destroy(curr_itr);
-	list_iterator_destroy(assoc_mgr_itr);
 
 	assoc_mgr_unlock(&locks);
 
@@ -899,6 +1375,7 @@ static int _refresh_assoc_mgr_qos_list(void *db_conn, int enforce)
 		list_destroy(assoc_mgr_qos_list);
 
 	assoc_mgr_qos_list = current_qos;
+	_qos_hash_rebuild();
 
 	assoc_mgr_unlock(&locks);
 
@@ -934,6 +1411,7 @@ static int _refresh_assoc_mgr_user_list(void *db_conn, int enforce)
 		list_destroy(assoc_mgr_user_list);
 
 	assoc_mgr_user_list = current_users;
+	_user_hash_rebuild();
 
 	assoc_mgr_unlock(&locks);
 
@@ -979,6 +1457,7 @@ static int _refresh_assoc_wckey_list(void *db_conn, int enforce)
 		list_destroy(assoc_mgr_wckey_list);
 
 	assoc_mgr_wckey_list = current_wckeys;
+	_wckey_hash_rebuild();
 	assoc_mgr_unlock(&locks);
 
 	return SLURM_SUCCESS;
@@ -1147,6 +1626,10 @@ extern int assoc_mgr_fini(char *state_save_location)
 	assoc_mgr_qos_list = NULL;
 	assoc_mgr_user_list = NULL;
 	assoc_mgr_wckey_list = NULL;
+	_assoc_hash_rebuild();
+	_qos_hash_rebuild();
+	_user_hash_rebuild();
+	_wckey_hash_rebuild();
 
 	return SLURM_SUCCESS;
 }
@@ -1202,6 +1685,7 @@ extern assoc_mgr_association_usage_t *create_assoc_mgr_association_usage()
 	assoc_mgr_association_usage_t *usage =
 		xmalloc(sizeof(assoc_mgr_association_usage_t));
 
+	usage->fs_factor = (double)NO_VAL;
 	usage->level_shares = NO_VAL;
 	usage->shares_norm = (double)NO_VAL;
 	usage->usage_efctv = 0;
@@ -1302,8 +1786,6 @@ extern int assoc_mgr_fill_in_assoc(void *db_conn,
 				   int enforce,
 				   slurmdb_association_rec_t **assoc_pptr)
 {
-	ListIterator itr = NULL;
-	slurmdb_association_rec_t * found_assoc = NULL;
 	slurmdb_association_rec_t * ret_assoc = NULL;
 	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK };
@@ -1373,62 +1855,10 @@ extern int assoc_mgr_fill_in_assoc(void *db_conn,
 /* 	     assoc->user, assoc->uid, assoc->acct, */
 /* 	     assoc->cluster, assoc->partition); */
 	assoc_mgr_lock(&locks);
-	itr = list_iterator_create(assoc_mgr_association_list);
-	while ((found_assoc = list_next(itr))) {
-		if (assoc->id) {
-			if (assoc->id == found_assoc->id) {
-				ret_assoc = found_assoc;
-				break;
-			}
-			continue;
-		} else {
-			if (assoc->uid == NO_VAL
-			    && found_assoc->uid != NO_VAL) {
-				debug3("we are looking for a "
-				       "nonuser association");
-				continue;
-			} else if (assoc->uid != found_assoc->uid) {
-				debug4("not the right user %u != %u",
-				       assoc->uid, found_assoc->uid);
-				continue;
-			}
-
-			if (found_assoc->acct
-			    && strcasecmp(assoc->acct, found_assoc->acct)) {
-				debug4("not the right account %s != %s",
-				       assoc->acct, found_assoc->acct);
-				continue;
-			}
-
-			/* only check for on the slurmdbd */
-			if (!assoc_mgr_cluster_name && found_assoc->cluster
-			    && strcasecmp(assoc->cluster,
-					  found_assoc->cluster)) {
-				debug4("not the right cluster");
-				continue;
-			}
-
-			if (assoc->partition) {
-				if (!found_assoc->partition) {
-					ret_assoc = found_assoc;
-					debug3("found association "
-					       "for no partition");
-					continue;
-				} else if (strcasecmp(assoc->partition,
-						      found_assoc->partition)) {
-					debug4("not the right partition");
-					continue;
-				}
-			} else if (found_assoc->partition) {
-				debug4("partition specific association "
-				       "looking for one without.");
-				continue;
-			}
-		}
-		ret_assoc = found_assoc;
-		break;
-	}
-	list_iterator_destroy(itr);
+	if (assoc->id)
+		ret_assoc = _find_assoc_id(assoc->id);
+	else
+		ret_assoc = _find_assoc_key(assoc);
 
 	if (!ret_assoc) {
 		assoc_mgr_unlock(&locks);
@@ -1527,7 +1957,6 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 				  int enforce,
 				  slurmdb_user_rec_t **user_pptr)
 {
-	ListIterator itr = NULL;
 	slurmdb_user_rec_t * found_user = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK,
 				   NO_LOCK, READ_LOCK, NO_LOCK };
@@ -1543,16 +1972,7 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 		return SLURM_SUCCESS;
 
 	assoc_mgr_lock(&locks);
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (user->uid != NO_VAL) {
-			if (user->uid == found_user->uid)
-				break;
-		} else if (user->name
-			   && !strcasecmp(user->name, found_user->name))
-			break;
-	}
-	list_iterator_destroy(itr);
+	found_user = _find_user(user->uid, user->name);
 
 	if (!found_user) {
 		assoc_mgr_unlock(&locks);
@@ -1595,7 +2015,6 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 				 int enforce,
 				 slurmdb_qos_rec_t **qos_pptr)
 {
-	ListIterator itr = NULL;
 	slurmdb_qos_rec_t * found_qos = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK,
 				   READ_LOCK, NO_LOCK, NO_LOCK };
@@ -1611,14 +2030,7 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 		return SLURM_SUCCESS;
 
 	assoc_mgr_lock(&locks);
-	itr = list_iterator_create(assoc_mgr_qos_list);
-	while ((found_qos = list_next(itr))) {
-		if (qos->id == found_qos->id)
-			break;
-		else if (qos->name && !strcasecmp(qos->name, found_qos->name))
-			break;
-	}
-	list_iterator_destroy(itr);
+	found_qos = _find_qos(qos->id, qos->name);
 
 	if (!found_qos) {
 		assoc_mgr_unlock(&locks);
@@ -1696,8 +2108,6 @@ extern int assoc_mgr_fill_in_wckey(void *db_conn, slurmdb_wckey_rec_t *wckey,
 				   int enforce,
 				   slurmdb_wckey_rec_t **wckey_pptr)
 {
-	ListIterator itr = NULL;
-	slurmdb_wckey_rec_t * found_wckey = NULL;
 	slurmdb_wckey_rec_t * ret_wckey = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK,
 				   NO_LOCK, NO_LOCK, READ_LOCK };
@@ -1778,55 +2188,10 @@ extern int assoc_mgr_fill_in_wckey(void *db_conn, slurmdb_wckey_rec_t *wckey,
 /* 	     wckey->user, wckey->uid, wckey->name, */
 /* 	     wckey->cluster); */
 	assoc_mgr_lock(&locks);
-	itr = list_iterator_create(assoc_mgr_wckey_list);
-	while ((found_wckey = list_next(itr))) {
-		if (wckey->id) {
-			if (wckey->id == found_wckey->id) {
-				ret_wckey = found_wckey;
-				break;
-			}
-			continue;
-		} else {
-			if (wckey->uid != NO_VAL) {
-				if (wckey->uid != found_wckey->uid) {
-					debug4("not the right user %u != %u",
-					       wckey->uid, found_wckey->uid);
-					continue;
-				}
-			} else if (wckey->user && strcasecmp(wckey->user,
-							     found_wckey->user))
-				continue;
-
-			if (wckey->name
-			    && (!found_wckey->name
-				|| strcasecmp(wckey->name,
-					      found_wckey->name))) {
-				debug4("not the right name %s != %s",
-				       wckey->name, found_wckey->name);
-				continue;
-			}
-
-			/* only check for on the slurmdbd */
-			if (!assoc_mgr_cluster_name) {
-				if (!wckey->cluster) {
-					error("No cluster name was given "
-					      "to check against, "
-					      "we need one to get a wckey.");
-					continue;
-				}
-
-				if (found_wckey->cluster
-				    && strcasecmp(wckey->cluster,
-						  found_wckey->cluster)) {
-					debug4("not the right cluster");
-					continue;
-				}
-			}
-		}
-		ret_wckey = found_wckey;
-		break;
-	}
-	list_iterator_destroy(itr);
+	if (wckey->id)
+		ret_wckey = _find_wckey_id(wckey->id);
+	else
+		ret_wckey = _find_wckey_key(wckey);
 
 	if (!ret_wckey) {
 		assoc_mgr_unlock(&locks);
@@ -2197,14 +2562,11 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 			object->cluster = xstrdup("test");
 		}
 
-		list_iterator_reset(itr);
-		while ((rec = list_next(itr))) {
-			if (object->id) {
-				if (object->id == rec->id) {
-					break;
-				}
-				continue;
-			} else {
+		if (object->id)
+			rec = _find_assoc_id(object->id);
+		else {
+			list_iterator_reset(itr);
+			while ((rec = list_next(itr))) {
 				if (!object->user && rec->user) {
 					debug4("we are looking for a "
 					       "nonuser association");
@@ -2405,6 +2767,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 			if (object->is_def != 1)
 				object->is_def = 0;
 			list_append(assoc_mgr_association_list, object);
+			_assoc_hash_add(object);
 			object = NULL;
 			parents_changed = 1; /* set since we need to
 						set the parent
@@ -2421,6 +2784,9 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 			run_update_resvs = 1; /* needed for updating
 						 reservations */
 
+			_assoc_hash_remove(rec);
+			list_iterator_reset(itr);
+			list_find(itr, _list_find_ptr, rec);
 			if (setup_children)
 				parents_changed = 1; /* set since we need to
 							set the shares
@@ -2458,6 +2824,8 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 	 */
 	if (parents_changed) {
 		int reset = 1;
+		/* uids are reset below */
+		_hash_clear(&assoc_key_hash);
 		slurmdb_sort_hierarchical_assoc_list(
 			assoc_mgr_association_list);
 
@@ -2521,6 +2889,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 				_addto_used_info(object, rec);
 			}
 		}
+		_assoc_key_hash_rebuild();
 		if (setup_children) {
 			/* Now normalize the static shares */
 			list_iterator_reset(itr);
@@ -2589,14 +2958,11 @@ extern int assoc_mgr_update_wckeys(slurmdb_update_object_t *update)
 			continue;
 		}
 
-		list_iterator_reset(itr);
-		while ((rec = list_next(itr))) {
-			if (object->id) {
-				if (object->id == rec->id) {
-					break;
-				}
-				continue;
-			} else {
+		if (object->id)
+			rec = _find_wckey_id(object->id);
+		else {
+			list_iterator_reset(itr);
+			while ((rec = list_next(itr))) {
 				if (object->uid != rec->uid) {
 					debug4("not the right user");
 					continue;
@@ -2657,6 +3023,7 @@ extern int assoc_mgr_update_wckeys(slurmdb_update_object_t *update)
 			else
 				object->is_def = 0;
 			list_append(assoc_mgr_wckey_list, object);
+			_wckey_hash_add(object);
 			object = NULL;
 			break;
 		case SLURMDB_REMOVE_WCKEY:
@@ -2664,7 +3031,10 @@ extern int assoc_mgr_update_wckeys(slurmdb_update_object_t *update)
 				//rc = SLURM_ERROR;
 				break;
 			}
-			list_delete_item(itr);
+			_wckey_hash_remove(rec);
+			list_iterator_reset(itr);
+			if (list_find(itr, _list_find_ptr, rec))
+				list_delete_item(itr);
 			break;
 		default:
 			break;
@@ -2685,6 +3055,7 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 
 	ListIterator itr = NULL;
 	int rc = SLURM_SUCCESS;
+	bool renamed = false;
 	uid_t pw_uid;
 	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK,
 				   NO_LOCK, WRITE_LOCK, WRITE_LOCK };
@@ -2695,16 +3066,10 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 	assoc_mgr_lock(&locks);
 	itr = list_iterator_create(assoc_mgr_user_list);
 	while ((object = list_pop(update->objects))) {
-		list_iterator_reset(itr);
-		while ((rec = list_next(itr))) {
-			char *name;
-			if (object->old_name)
-				name = object->old_name;
-			else
-				name = object->name;
-			if (!strcasecmp(name, rec->name))
-				break;
-		}
+		if (object->old_name)
+			rec = _find_user(NO_VAL, object->old_name);
+		else
+			rec = _find_user(NO_VAL, object->name);
 
 		//info("%d user %s", update->type, object->name);
 		switch(update->type) {
@@ -2726,6 +3091,7 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 				rec->name = object->name;
 				object->name = NULL;
 				rc = _change_user_name(rec);
+				renamed = true;
 			}
 
 			if (object->default_acct) {
@@ -2756,6 +3122,7 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 			} else
 				object->uid = pw_uid;
 			list_append(assoc_mgr_user_list, object);
+			_user_hash_add(object);
 			object = NULL;
 			break;
 		case SLURMDB_REMOVE_USER:
@@ -2763,7 +3130,10 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 				//rc = SLURM_ERROR;
 				break;
 			}
-			list_delete_item(itr);
+			_user_hash_remove(rec);
+			list_iterator_reset(itr);
+			if (list_find(itr, _list_find_ptr, rec))
+				list_delete_item(itr);
 			break;
 		case SLURMDB_ADD_COORD:
 			/* same as SLURMDB_REMOVE_COORD */
@@ -2788,6 +3158,13 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 		}
 
 		slurmdb_destroy_user_rec(object);
+		if (renamed) {
+			/* names and uids changed in all three lists */
+			_user_hash_rebuild();
+			_assoc_key_hash_rebuild();
+			_wckey_hash_rebuild();
+			renamed = false;
+		}
 	}
 	list_iterator_destroy(itr);
 	assoc_mgr_unlock(&locks);
@@ -2818,12 +3195,7 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update)
 	itr = list_iterator_create(assoc_mgr_qos_list);
 	while ((object = list_pop(update->objects))) {
 		bool update_jobs = false;
-		list_iterator_reset(itr);
-		while ((rec = list_next(itr))) {
-			if (object->id == rec->id) {
-				break;
-			}
-		}
+		rec = _find_qos(object->id, NULL);
 
 		//info("%d qos %s", update->type, object->name);
 		switch(update->type) {
@@ -2836,6 +3208,7 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update)
 			if (!object->usage)
 				object->usage = create_assoc_mgr_qos_usage();
 			list_append(assoc_mgr_qos_list, object);
+			_qos_hash_add(object);
 /* 			char *tmp = get_qos_complete_str_bitstr( */
 /* 				assoc_mgr_qos_list, */
 /* 				object->preempt_bitstr); */
@@ -2983,6 +3356,10 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update)
 			if (rec->priority == g_qos_max_priority)
 				redo_priority = 2;
 
+			_qos_hash_remove(rec);
+			list_iterator_reset(itr);
+			list_find(itr, _list_find_ptr, rec);
+
 			if (remove_qos_notify) {
 				/* since there are some deadlock
 				   issues while inside our lock here
@@ -3087,7 +3464,6 @@ extern int assoc_mgr_validate_assoc_id(void *db_conn,
 				       uint32_t assoc_id,
 				       int enforce)
 {
-	ListIterator itr = NULL;
 	slurmdb_association_rec_t * found_assoc = NULL;
 	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK };
@@ -3103,12 +3479,7 @@ extern int assoc_mgr_validate_assoc_id(void *db_conn,
 		return SLURM_SUCCESS;
 
 	assoc_mgr_lock(&locks);
-	itr = list_iterator_create(assoc_mgr_association_list);
-	while ((found_assoc = list_next(itr))) {
-		if (assoc_id == found_assoc->id)
-			break;
-	}
-	list_iterator_destroy(itr);
+	found_assoc = _find_assoc_id(assoc_id);
 	assoc_mgr_unlock(&locks);
 
 	if (found_assoc || !(enforce & ACCOUNTING_ENFORCE_ASSOCS))
@@ -3459,7 +3830,6 @@ extern int load_assoc_usage(char *state_save_location)
 	char *data = NULL, *state_file;
 	Buf buffer;
 	time_t buf_time;
-	ListIterator itr = NULL;
 	assoc_mgr_lock_t locks = { WRITE_LOCK, READ_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK };
 
@@ -3515,7 +3885,6 @@ extern int load_assoc_usage(char *state_save_location)
 
 	safe_unpack_time(&buf_time, buffer);
 
-	itr = list_iterator_create(assoc_mgr_association_list);
 	while (remaining_buf(buffer) > 0) {
 		uint32_t assoc_id = 0;
 		uint32_t grp_used_wall = 0;
@@ -3525,9 +3894,7 @@ extern int load_assoc_usage(char *state_save_location)
 		safe_unpack32(&assoc_id, buffer);
 		safe_unpack64(&usage_raw, buffer);
 		safe_unpack32(&grp_used_wall, buffer);
-		while ((assoc = list_next(itr)))
-			if (assoc->id == assoc_id)
-				break;
+		assoc = _find_assoc_id(assoc_id);
 
 		/* We want to do this all the way up to and including
 		   root.  This way we can keep track of how much usage
@@ -3540,9 +3907,7 @@ extern int load_assoc_usage(char *state_save_location)
 
 			assoc = assoc->usage->parent_assoc_ptr;
 		}
-		list_iterator_reset(itr);
 	}
-	list_iterator_destroy(itr);
 	assoc_mgr_unlock(&locks);
 
 	free_buf(buffer);
@@ -3551,8 +3916,6 @@ extern int load_assoc_usage(char *state_save_location)
 unpack_error:
 	if (buffer)
 		free_buf(buffer);
-	if (itr)
-		list_iterator_destroy(itr);
 	assoc_mgr_unlock(&locks);
 	return SLURM_ERROR;
 }
@@ -3566,7 +3929,6 @@ extern int load_qos_usage(char *state_save_location)
 	char *data = NULL, *state_file;
 	Buf buffer;
 	time_t buf_time;
-	ListIterator itr = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, READ_LOCK,
 				   WRITE_LOCK, NO_LOCK, NO_LOCK };
 
@@ -3622,7 +3984,6 @@ extern int load_qos_usage(char *state_save_location)
 
 	safe_unpack_time(&buf_time, buffer);
 
-	itr = list_iterator_create(assoc_mgr_qos_list);
 	while (remaining_buf(buffer) > 0) {
 		uint32_t qos_id = 0;
 		uint32_t grp_used_wall = 0;
@@ -3632,17 +3993,12 @@ extern int load_qos_usage(char *state_save_location)
 		safe_unpack32(&qos_id, buffer);
 		safe_unpack64(&usage_raw, buffer);
 		safe_unpack32(&grp_used_wall, buffer);
-		while ((qos = list_next(itr)))
-			if (qos->id == qos_id)
-				break;
+		qos = _find_qos(qos_id, NULL);
 		if (qos) {
 			qos->usage->grp_used_wall += grp_used_wall;
 			qos->usage->usage_raw += (long double)usage_raw;
 		}
-
-		list_iterator_reset(itr);
 	}
-	list_iterator_destroy(itr);
 	assoc_mgr_unlock(&locks);
 
 	free_buf(buffer);
@@ -3651,8 +4007,6 @@ extern int load_qos_usage(char *state_save_location)
 unpack_error:
 	if (buffer)
 		free_buf(buffer);
-	if (itr)
-		list_iterator_destroy(itr);
 	assoc_mgr_unlock(&locks);
 	return SLURM_ERROR;
 }
@@ -3755,6 +4109,7 @@ extern int load_assoc_mgr_state(char *state_save_location)
 				list_destroy(assoc_mgr_user_list);
 			assoc_mgr_user_list = msg->my_list;
 			_post_user_list(assoc_mgr_user_list);
+			_user_hash_rebuild();
 			debug("Recovered %u users",
 			      list_count(assoc_mgr_user_list));
 			msg->my_list = NULL;
@@ -3773,6 +4128,7 @@ extern int load_assoc_mgr_state(char *state_save_location)
 				list_destroy(assoc_mgr_qos_list);
 			assoc_mgr_qos_list = msg->my_list;
 			_post_qos_list(assoc_mgr_qos_list);
+			_qos_hash_rebuild();
 			debug("Recovered %u qos",
 			      list_count(assoc_mgr_qos_list));
 			msg->my_list = NULL;
@@ -3790,6 +4146,7 @@ extern int load_assoc_mgr_state(char *state_save_location)
 			if (assoc_mgr_wckey_list)
 				list_destroy(assoc_mgr_wckey_list);
 			assoc_mgr_wckey_list = msg->my_list;
+			_wckey_hash_rebuild();
 			debug("Recovered %u wckeys",
 			      list_count(assoc_mgr_wckey_list));
 			msg->my_list = NULL;
@@ -3907,6 +4264,9 @@ extern int assoc_mgr_set_missing_uids()
 		}
 		list_iterator_destroy(itr);
 	}
+	_assoc_key_hash_rebuild();
+	_user_hash_rebuild();
+	_wckey_hash_rebuild();
 	assoc_mgr_unlock(&locks);
 
 	return SLURM_SUCCESS;
@@ -114,6 +114,10 @@ struct assoc_mgr_association_usage {
 						      * set in slurmctld
 						      * (DON'T PACK) */
 
+	double fs_factor;	/* fairshare factor cached by the priority
+				 * plugin, NO_VAL when usage_efctv or
+				 * shares_norm change (DON'T PACK) */
+
 	double shares_norm;     /* normalized shares (DON'T PACK) */
 
 	long double usage_efctv;/* effective, normalized usage (DON'T PACK) */
@@ -94,6 +94,288 @@ strong_alias(bit_nffs,		slurm_bit_nffs);
 strong_alias(bit_copybits,	slurm_bit_copybits);
 strong_alias(bit_get_bit_num,	slurm_bit_get_bit_num);
 strong_alias(bit_get_pos_num,	slurm_bit_get_pos_num);
+strong_alias(bit_and_not,	slurm_bit_and_not);
+strong_alias(bit_and_not_count,	slurm_bit_and_not_count);
+
+/*
+ * Word kernels.  Words are handled as unsigned values so that shifts and
+ * bit scans are well defined.  Bit positions within a word follow
+ * _bit_mask(), so the scans below swap direction on big endian machines.
+ */
+#ifdef USE_64BIT_BITSTR
+typedef uint64_t bitstr_word_t;
+#else
+typedef uint32_t bitstr_word_t;
+#endif
+
+#define BITSTR_WORD_BITS	((bitoff_t) (sizeof(bitstr_t) * 8))
+#define BITSTR_WORD_ONES	((bitstr_word_t) ~0)
+
+#if defined(__GNUC__) && (__GNUC__ >= 4)
+#  define HAVE_BIT_BUILTINS 1
+#  define BIT_INLINE	static inline __attribute__((always_inline))
+#else
+#  define BIT_INLINE	static inline
+#endif
+
+/* Use a hardware population count when the running CPU has one, the
+ * default x86_64 target does not assume it */
+#if defined(HAVE_BIT_BUILTINS) && defined(__x86_64__) && \
+    ((__GNUC__ > 4) || (__GNUC_MINOR__ >= 8))
+#  define HAVE_BIT_CPU_DISPATCH 1
+#endif
+
+#if !defined(USE_64BIT_BITSTR)
+/*
+ * Returns the hamming weight (i.e. the number of bits set) in a word.
+ * NOTE: This routine borrowed from Linux 2.4.9 <linux/bitops.h>.
+ */
+static uint32_t
+hweight(uint32_t w)
+{
+	uint32_t res;
+
+	res = (w   & 0x55555555) + ((w >> 1)    & 0x55555555);
+	res = (res & 0x33333333) + ((res >> 2)  & 0x33333333);
+	res = (res & 0x0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F);
+	res = (res & 0x00FF00FF) + ((res >> 8)  & 0x00FF00FF);
+	res = (res & 0x0000FFFF) + ((res >> 16) & 0x0000FFFF);
+
+	return res;
+}
+#else
+/*
+ * A 64 bit version crafted from 32-bit one borrowed above.
+ */
+static uint64_t
+hweight(uint64_t w)
+{
+	uint64_t res;
+
+	res = (w   & 0x5555555555555555) + ((w >> 1)    & 0x5555555555555555);
+	res = (res & 0x3333333333333333) + ((res >> 2)  & 0x3333333333333333);
+	res = (res & 0x0F0F0F0F0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F0F0F0F0F);
+	res = (res & 0x00FF00FF00FF00FF) + ((res >> 8)  & 0x00FF00FF00FF00FF);
+	res = (res & 0x0000FFFF0000FFFF) + ((res >> 16) & 0x0000FFFF0000FFFF);
+	res = (res & 0x00000000FFFFFFFF) + ((res >> 32) & 0x00000000FFFFFFFF);
+
+	return res;
+}
+#endif /* !USE_64BIT_BITSTR */
+
+/* Number of bits set in a 64 bit value */
+BIT_INLINE int _popcount64(uint64_t w)
+{
+#ifdef HAVE_BIT_BUILTINS
+	return __builtin_popcountll(w);
+#elif defined(USE_64BIT_BITSTR)
+	return (int) hweight(w);
+#else
+	return (int) (hweight((uint32_t) w) + hweight((uint32_t) (w >> 32)));
+#endif
+}
+
+/* Number of bits set in a word */
+BIT_INLINE int _word_popcount(bitstr_word_t w)
+{
+#ifdef HAVE_BIT_BUILTINS
+#  ifdef USE_64BIT_BITSTR
+	return __builtin_popcountll(w);
+#  else
+	return __builtin_popcount(w);
+#  endif
+#else
+	return (int) hweight(w);
+#endif
+}
+
+/* Trailing and leading zero counts of a non-zero word */
+BIT_INLINE int _word_ctz(bitstr_word_t w)
+{
+#ifdef HAVE_BIT_BUILTINS
+#  ifdef USE_64BIT_BITSTR
+	return __builtin_ctzll(w);
+#  else
+	return __builtin_ctz(w);
+#  endif
+#else
+	int n = 0;
+
+	while (!(w & 1)) {
+		w >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+BIT_INLINE int _word_clz(bitstr_word_t w)
+{
+#ifdef HAVE_BIT_BUILTINS
+#  ifdef USE_64BIT_BITSTR
+	return __builtin_clzll(w);
+#  else
+	return __builtin_clz(w);
+#  endif
+#else
+	int n = 0;
+
+	while (!(w & ((bitstr_word_t) 1 << BITSTR_MAXPOS))) {
+		w <<= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/* Offset within its word of the first set bit of a non-zero word */
+BIT_INLINE int _word_first(bitstr_word_t w)
+{
+#ifdef SLURM_BIGENDIAN
+	return _word_clz(w);
+#else
+	return _word_ctz(w);
+#endif
+}
+
+/* Offset within its word of the last set bit of a non-zero word */
+BIT_INLINE int _word_last(bitstr_word_t w)
+{
+#ifdef SLURM_BIGENDIAN
+	return BITSTR_MAXPOS - _word_ctz(w);
+#else
+	return BITSTR_MAXPOS - _word_clz(w);
+#endif
+}
+
+/* Mask of the first n bit positions of a word, 0 < n <= BITSTR_WORD_BITS */
+BIT_INLINE bitstr_word_t _word_head_mask(bitoff_t n)
+{
+	if (n >= BITSTR_WORD_BITS)
+		return BITSTR_WORD_ONES;
+#ifdef SLURM_BIGENDIAN
+	return ~(BITSTR_WORD_ONES >> n);
+#else
+	return ((bitstr_word_t) 1 << n) - 1;
+#endif
+}
+
+/* Words holding only valid bits, and valid bits in the word after them */
+#define _bitstr_full_words(b)	(_bitstr_bits(b) >> BITSTR_SHIFT)
+#define _bitstr_tail_bits(b)	(_bitstr_bits(b) & BITSTR_MAXPOS)
+
+/* Operations of _count_words(), all count bits set in the result */
+enum {
+	BIT_COUNT_B1,		/* b1 */
+	BIT_COUNT_AND,		/* b1 & b2 */
+	BIT_COUNT_AND_NOT	/* b1 & ~b2 */
+};
+
+/*
+ * Count the bits set in op(w1, w2) over nwords words.  Words are loaded
+ * 64 bits at a time regardless of the bitstr_t word size, memcpy() keeps
+ * that legal for bitmaps declared on the stack with 32 bit alignment.
+ * Inlined into each of the kernels below so that the population count
+ * is compiled for that kernel's target.
+ */
+BIT_INLINE int
+_count_words_body(const bitstr_t *w1, const bitstr_t *w2,
+		  size_t nwords, int op)
+{
+	size_t i, nbytes = nwords * sizeof(bitstr_t);
+	uint64_t v1, v2;
+	bitstr_word_t x1, x2;
+	int count = 0;
+
+	switch (op) {
+	case BIT_COUNT_B1:
+		for (i = 0; i + 8 <= nbytes; i += 8) {
+			memcpy(&v1, (char *) w1 + i, 8);
+			count += _popcount64(v1);
+		}
+		break;
+	case BIT_COUNT_AND:
+		for (i = 0; i + 8 <= nbytes; i += 8) {
+			memcpy(&v1, (char *) w1 + i, 8);
+			memcpy(&v2, (char *) w2 + i, 8);
+			count += _popcount64(v1 & v2);
+		}
+		break;
+	default:
+		for (i = 0; i + 8 <= nbytes; i += 8) {
+			memcpy(&v1, (char *) w1 + i, 8);
+			memcpy(&v2, (char *) w2 + i, 8);
+			count += _popcount64(v1 & ~v2);
+		}
+		break;
+	}
+	for ( ; i < nbytes; i += sizeof(bitstr_t)) {	/* odd 32 bit word */
+		memcpy(&x1, (char *) w1 + i, sizeof(bitstr_t));
+		if (op != BIT_COUNT_B1) {
+			memcpy(&x2, (char *) w2 + i, sizeof(bitstr_t));
+			x1 &= (op == BIT_COUNT_AND) ? x2 : ~x2;
+		}
+		count += _word_popcount(x1);
+	}
+	return count;
+}
+
+static int
+_count_words_generic(const bitstr_t *w1, const bitstr_t *w2,
+		     size_t nwords, int op)
+{
+	return _count_words_body(w1, w2, nwords, op);
+}
+
+#ifdef HAVE_BIT_CPU_DISPATCH
+static int __attribute__((target("popcnt")))
+_count_words_popcnt(const bitstr_t *w1, const bitstr_t *w2,
+		    size_t nwords, int op)
+{
+	return _count_words_body(w1, w2, nwords, op);
+}
+#endif
+
+static int _count_words_select(const bitstr_t *w1, const bitstr_t *w2,
+			       size_t nwords, int op);
+static int (*_count_words)(const bitstr_t *w1, const bitstr_t *w2,
+			   size_t nwords, int op) = _count_words_select;
+
+/* Pick the counting kernel for this CPU on first use */
+static int
+_count_words_select(const bitstr_t *w1, const bitstr_t *w2,
+		    size_t nwords, int op)
+{
+#ifdef HAVE_BIT_CPU_DISPATCH
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("popcnt"))
+		_count_words = _count_words_popcnt;
+	else
+#endif
+		_count_words = _count_words_generic;
+	return _count_words(w1, w2, nwords, op);
+}
+
+/* Count the valid bits set in op(b1, b2), b2 is unused for BIT_COUNT_B1 */
+static int
+_bit_count(bitstr_t *b1, bitstr_t *b2, int op)
+{
+	bitoff_t words = _bitstr_full_words(b1), tail = _bitstr_tail_bits(b1);
+	bitstr_word_t w;
+	int count;
+
+	count = _count_words(b1 + BITSTR_OVERHEAD,
+			     b2 ? b2 + BITSTR_OVERHEAD : NULL, words, op);
+	if (tail) {
+		w = b1[BITSTR_OVERHEAD + words];
+		if (op == BIT_COUNT_AND)
+			w &= b2[BITSTR_OVERHEAD + words];
+		else if (op == BIT_COUNT_AND_NOT)
+			w &= ~b2[BITSTR_OVERHEAD + words];
+		count += _word_popcount(w & _word_head_mask(tail));
+	}
+	return count;
+}
 
 /*
  * Allocate a bitstring.
@@ -257,26 +539,61 @@ bit_nclear(bitstr_t *b, bitoff_t start, bitoff_t stop)
 bitoff_t
 bit_ffc(bitstr_t *b)
 {
-	bitoff_t bit = 0, value = -1;
+	bitoff_t word, words, bit;
+	bitstr_word_t w;
 
 	_assert_bitstr_valid(b);
 
-	while (bit < _bitstr_bits(b) && value == -1) {
-		int word = _bit_word(bit);
-
-		if (b[word] == BITSTR_MAXPOS) {
-			bit += sizeof(bitstr_t)*8;
+	words = _bitstr_words(_bitstr_bits(b));
+	for (word = BITSTR_OVERHEAD; word < words; word++) {
+		w = ~(bitstr_word_t) b[word];
+		if (w == 0)
 			continue;
-		}
-		while (bit < _bitstr_bits(b) && _bit_word(bit) == word) {
-			if (!bit_test(b, bit)) {
-				value = bit;
-				break;
+		bit = ((word - BITSTR_OVERHEAD) << BITSTR_SHIFT) +
+		      _word_first(w);
+		return (bit < _bitstr_bits(b)) ? bit : -1;
+	}
+	return -1;
+}
+
+/* Find the first n contiguous bits of b equal to set.  Whole words which
+ * either break or extend the run are stepped over, others are tested one
+ * bit at a time. */
+static bitoff_t
+_bit_nff(bitstr_t *b, int n, int set)
+{
+	bitoff_t bit, nbits = _bitstr_bits(b);
+	bitstr_word_t w, fill = set ? BITSTR_WORD_ONES : 0;
+	int cnt = 0;
+
+	for (bit = 0; bit < nbits; ) {
+		if (((bit & BITSTR_MAXPOS) == 0) &&
+		    ((bit + BITSTR_WORD_BITS) <= nbits)) {
+			w = b[_bit_word(bit)];
+			if (w == fill) {
+				if ((cnt + BITSTR_WORD_BITS) >= n)
+					return bit - cnt;
+				cnt += BITSTR_WORD_BITS;
+				bit += BITSTR_WORD_BITS;
+				continue;
 			}
-			bit++;
+			if (w == ~fill) {
+				cnt = 0;
+				bit += BITSTR_WORD_BITS;
+				continue;
+			}
+		}
+		if (bit_test(b, bit) != set) {	/* fail */
+			cnt = 0;
+		} else {
+			cnt++;
+			if (cnt >= n)
+				return bit - (cnt - 1);
 		}
+		bit++;
 	}
-	return value;
+
+	return -1;
 }
 
 /* Find the first n contiguous bits clear in b.
@@ -287,26 +604,10 @@ bit_ffc(bitstr_t *b)
 bitoff_t
 bit_nffc(bitstr_t *b, int n)
 {
-	bitoff_t value = -1;
-	bitoff_t bit;
-	int cnt = 0;
-
 	_assert_bitstr_valid(b);
 	assert(n > 0 && n < _bitstr_bits(b));
 
-	for (bit = 0; bit < _bitstr_bits(b); bit++) {
-		if (bit_test(b, bit)) {		/* fail */
-			cnt = 0;
-		} else {
-			cnt++;
-			if (cnt >= n) {
-				value = bit - (cnt - 1);
-				break;
-			}
-		}
-	}
-
-	return value;
+	return _bit_nff(b, n, 0);
 }
 
 /* Find n contiguous bits clear in b starting at some offset.
@@ -366,26 +667,10 @@ bit_noc(bitstr_t *b, int n, int seed)
 bitoff_t
 bit_nffs(bitstr_t *b, int n)
 {
-	bitoff_t value = -1;
-	bitoff_t bit;
-	int cnt = 0;
-
 	_assert_bitstr_valid(b);
 	assert(n > 0 && n <= _bitstr_bits(b));
 
-	for (bit = 0; bit <= _bitstr_bits(b) - n; bit++) {
-		if (!bit_test(b, bit)) {	/* fail */
-			cnt = 0;
-		} else {
-			cnt++;
-			if (cnt >= n) {
-				value = bit - (cnt - 1);
-				break;
-			}
-		}
-	}
-
-	return value;
+	return _bit_nff(b, n, 1);
 }
 
 /*
@@ -396,26 +681,21 @@ bit_nffs(bitstr_t *b, int n)
 bitoff_t
 bit_ffs(bitstr_t *b)
 {
-	bitoff_t bit = 0, value = -1;
+	bitoff_t word, words, bit;
+	bitstr_word_t w;
 
 	_assert_bitstr_valid(b);
 
-	while (bit < _bitstr_bits(b) && value == -1) {
-		int word = _bit_word(bit);
-
-		if (b[word] == 0) {
-			bit += sizeof(bitstr_t)*8;
+	words = _bitstr_words(_bitstr_bits(b));
+	for (word = BITSTR_OVERHEAD; word < words; word++) {
+		w = b[word];
+		if (w == 0)
 			continue;
-		}
-		while (bit < _bitstr_bits(b) && _bit_word(bit) == word) {
-			if (bit_test(b, bit)) {
-				value = bit;
-				break;
-			}
-			bit++;
-		}
+		bit = ((word - BITSTR_OVERHEAD) << BITSTR_SHIFT) +
+		      _word_first(w);
+		return (bit < _bitstr_bits(b)) ? bit : -1;
 	}
-	return value;
+	return -1;
 }
 
 /*
@@ -426,39 +706,24 @@ bit_ffs(bitstr_t *b)
 bitoff_t
 bit_fls(bitstr_t *b)
 {
-	bitoff_t bit, value = -1;
-	int word;
+	bitoff_t word;
+	bitstr_word_t w;
 
 	_assert_bitstr_valid(b);
 
 	if (_bitstr_bits(b) == 0)	/* empty bitstring */
 		return -1;
 
-	bit = _bitstr_bits(b) - 1;	/* zero origin */
-
-	while (bit >= 0 && 		/* test partitial words */
-		(_bit_word(bit) == _bit_word(bit + 1))) {
-		if (bit_test(b, bit)) {
-			value = bit;
-			break;
-		}
-		bit--;
+	word = _bit_word(_bitstr_bits(b) - 1);
+	w = b[word];
+	if (_bitstr_tail_bits(b))	/* ignore bits past the end */
+		w &= _word_head_mask(_bitstr_tail_bits(b));
+	while (w == 0) {
+		if (--word < BITSTR_OVERHEAD)
+			return -1;
+		w = b[word];
 	}
-	while (bit >= 0 && value == -1) {	/* test whole words */
-		word = _bit_word(bit);
-		if (b[word] == 0) {
-			bit -= sizeof(bitstr_t) * 8;
-			continue;
-		}
-		while (bit >= 0) {
-			if (bit_test(b, bit)) {
-				value = bit;
-				break;
-			}
-			bit--;
-		}
-	}
-	return value;
+	return ((word - BITSTR_OVERHEAD) << BITSTR_SHIFT) + _word_last(w);
 }
 
 /*
@@ -486,17 +751,21 @@ bit_fill_gaps(bitstr_t *b) {
  */
 int
 bit_super_set(bitstr_t *b1, bitstr_t *b2)  {
-	bitoff_t bit;
+	bitoff_t word, words;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8) {
-		if (b1[_bit_word(bit)] != (b1[_bit_word(bit)] &
-		                           b2[_bit_word(bit)]))
+	words = BITSTR_OVERHEAD + _bitstr_full_words(b1);
+	for (word = BITSTR_OVERHEAD; word < words; word++) {
+		if (b1[word] & ~b2[word])
 			return 0;
 	}
+	if (_bitstr_tail_bits(b1) &&	/* ignore bits past the end */
+	    ((bitstr_word_t) (b1[word] & ~b2[word]) &
+	     _word_head_mask(_bitstr_tail_bits(b1))))
+		return 0;
 
 	return 1;
 }
@@ -507,7 +776,7 @@ bit_super_set(bitstr_t *b1, bitstr_t *b2)  {
 extern int
 bit_equal(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	bitoff_t word, words;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
@@ -515,10 +784,15 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
 	if (_bitstr_bits(b1) != _bitstr_bits(b2))
 		return 0;
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8) {
-		if (b1[_bit_word(bit)] != b2[_bit_word(bit)])
+	words = BITSTR_OVERHEAD + _bitstr_full_words(b1);
+	for (word = BITSTR_OVERHEAD; word < words; word++) {
+		if (b1[word] != b2[word])
 			return 0;
 	}
+	if (_bitstr_tail_bits(b1) &&	/* ignore bits past the end */
+	    ((bitstr_word_t) (b1[word] ^ b2[word]) &
+	     _word_head_mask(_bitstr_tail_bits(b1))))
+		return 0;
 
 	return 1;
 }
@@ -532,14 +806,33 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
  */
 void
 bit_and(bitstr_t *b1, bitstr_t *b2) {
-	bitoff_t bit;
+	bitoff_t word, words;
+
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	words = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < words; word++)
+		b1[word] &= b2[word];
+}
+
+/*
+ * b1 &= ~b2, without building the complement of b2
+ *   b1 (IN/OUT)	first string
+ *   b2 (IN)		second bitstring
+ */
+void
+bit_and_not(bitstr_t *b1, bitstr_t *b2) {
+	bitoff_t word, words;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] &= b2[_bit_word(bit)];
+	words = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < words; word++)
+		b1[word] &= ~b2[word];
 }
 
 /*
@@ -548,12 +841,13 @@ bit_and(bitstr_t *b1, bitstr_t *b2) {
  */
 void
 bit_not(bitstr_t *b) {
-	bitoff_t bit;
+	bitoff_t word, words;
 
 	_assert_bitstr_valid(b);
 
-	for (bit = 0; bit < _bitstr_bits(b); bit += sizeof(bitstr_t)*8)
-		b[_bit_word(bit)] = ~b[_bit_word(bit)];
+	words = _bitstr_words(_bitstr_bits(b));
+	for (word = BITSTR_OVERHEAD; word < words; word++)
+		b[word] = ~b[word];
 }
 
 /*
@@ -563,14 +857,15 @@ bit_not(bitstr_t *b) {
  */
 void
 bit_or(bitstr_t *b1, bitstr_t *b2) {
-	bitoff_t bit;
+	bitoff_t word, words;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] |= b2[_bit_word(bit)];
+	words = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < words; word++)
+		b1[word] |= b2[word];
 }
 
 
@@ -609,44 +904,6 @@ bit_copybits(bitstr_t *dest, bitstr_t *src)
 	memcpy(&dest[BITSTR_OVERHEAD], &src[BITSTR_OVERHEAD], len);
 }
 
-#if !defined(USE_64BIT_BITSTR)
-/*
- * Returns the hamming weight (i.e. the number of bits set) in a word.
- * NOTE: This routine borrowed from Linux 2.4.9 <linux/bitops.h>.
- */
-static uint32_t
-hweight(uint32_t w)
-{
-	uint32_t res;
-
-	res = (w   & 0x55555555) + ((w >> 1)    & 0x55555555);
-	res = (res & 0x33333333) + ((res >> 2)  & 0x33333333);
-	res = (res & 0x0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F);
-	res = (res & 0x00FF00FF) + ((res >> 8)  & 0x00FF00FF);
-	res = (res & 0x0000FFFF) + ((res >> 16) & 0x0000FFFF);
-
-	return res;
-}
-#else
-/*
- * A 64 bit version crafted from 32-bit one borrowed above.
- */
-static uint64_t
-hweight(uint64_t w)
-{
-	uint64_t res;
-
-	res = (w   & 0x5555555555555555) + ((w >> 1)    & 0x5555555555555555);
-	res = (res & 0x3333333333333333) + ((res >> 2)  & 0x3333333333333333);
-	res = (res & 0x0F0F0F0F0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F0F0F0F0F);
-	res = (res & 0x00FF00FF00FF00FF) + ((res >> 8)  & 0x00FF00FF00FF00FF);
-	res = (res & 0x0000FFFF0000FFFF) + ((res >> 16) & 0x0000FFFF0000FFFF);
-	res = (res & 0x00000000FFFFFFFF) + ((res >> 32) & 0x00000000FFFFFFFF);
-
-	return res;
-}
-#endif /* !USE_64BIT_BITSTR */
-
 /*
  * Count the number of bits set in bitstring.
  *   b (IN)		bitstring to check
@@ -655,24 +912,9 @@ hweight(uint64_t w)
 int
 bit_set_count(bitstr_t *b)
 {
-	int count = 0;
-	bitoff_t bit, bit_cnt;
-	int word_size = sizeof(bitstr_t) * 8;
-
 	_assert_bitstr_valid(b);
 
-	bit_cnt = _bitstr_bits(b);
-	for (bit = 0; bit < bit_cnt; bit += word_size) {
-		if ((bit + word_size - 1) >= bit_cnt)
-			break;
-		count += hweight(b[_bit_word(bit)]);
-	}
-	for ( ; bit < bit_cnt; bit++) {
-		if (bit_test(b, bit))
-			count++;
-	}
-
-	return count;
+	return _bit_count(b, NULL, BIT_COUNT_B1);
 }
 
 /*
@@ -681,26 +923,25 @@ bit_set_count(bitstr_t *b)
 extern int
 bit_overlap(bitstr_t *b1, bitstr_t *b2)
 {
-	int count = 0;
-	bitoff_t bit, bit_cnt;
-	int word_size = sizeof(bitstr_t) * 8;
-
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	bit_cnt = _bitstr_bits(b1);
-	for (bit = 0; bit < bit_cnt; bit += word_size) {
-		if ((bit + word_size - 1) >= bit_cnt)
-			break;
-		count += hweight(b1[_bit_word(bit)] & b2[_bit_word(bit)]);
-	}
-	for ( ; bit < bit_cnt; bit++) {
-		if (bit_test(b1, bit) && bit_test(b2, bit))
-			count++;
-	}
+	return _bit_count(b1, b2, BIT_COUNT_AND);
+}
 
-	return count;
+/*
+ * return number of bits set in b1 that are not set in b2, the count of
+ * bits which bit_and_not() would leave set in b1
+ */
+extern int
+bit_and_not_count(bitstr_t *b1, bitstr_t *b2)
+{
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	return _bit_count(b1, b2, BIT_COUNT_AND_NOT);
 }
 
 /*
@@ -42,6 +42,11 @@
 #include <sys/poll.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdlib.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#  include <sys/epoll.h>
+#endif
 
 #include "src/common/xmalloc.h"
 #include "src/common/xassert.h"
@@ -51,6 +56,28 @@
 #include "src/common/eio.h"
 #include "src/common/slurm_protocol_api.h"
 
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * epoll registration of one fd. Objects stay on the obj_list until the
+ * handle is destroyed and reset obj->fd to -1 when they close it, so an
+ * entry is reused while the same object asks for events on the same fd.
+ * "gen" is carried in each event so that events from a registration
+ * left behind by a closed fd (one still open in another process) are
+ * recognized and the epoll set rebuilt.
+ */
+typedef struct eio_reg {
+	eio_obj_t *obj;		/* object last asking for events on fd  */
+	uint32_t   events;	/* EPOLLIN/EPOLLOUT registered, 0 if none */
+	uint32_t   gen;		/* generation of obj's registration     */
+	uint32_t   pass;	/* mainloop pass which last saw obj     */
+	bool       dirty;	/* registered for an earlier obj        */
+	bool       nopoll;	/* fd can't be polled (regular file)    */
+	short      revents;	/* poll() result faked for this pass    */
+} eio_reg_t;
+
+#define EIO_WAKEUP_KEY	((uint64_t) -1)
+#endif
+
 /*
  * outside threads can stick new objects on the new_objs List and
  * the eio thread will move them to the main obj_list the next time
@@ -64,6 +91,21 @@ struct eio_handle_components {
 	int  fds[2];
 	List obj_list;
 	List new_objs;
+#ifdef HAVE_SYS_EPOLL_H
+	int  epfd;			/* epoll set, -1 to use poll()   */
+	eio_reg_t *reg;			/* registrations indexed by fd   */
+	int  reg_size;
+	int  reg_cnt;			/* fds registered in epfd        */
+	int  reg_seen;			/* of those, wanted in this pass */
+	uint32_t pass;
+	uint32_t gen;
+	int *fake;			/* fds given faked poll() events */
+	int  fake_cnt;
+	int  fake_size;
+	struct epoll_event *events;
+	int  events_size;
+	bool rebuild;			/* stale event seen, rebuild set */
+#endif
 };
 
 
@@ -76,11 +118,21 @@ static void         _poll_dispatch(struct pollfd *, unsigned int, eio_obj_t **,
 		                   List objList);
 static void         _poll_handle_event(short revents, eio_obj_t *obj,
 		                       List objList);
+static int          _poll_mainloop(eio_handle_t *eio);
+
+#ifdef HAVE_SYS_EPOLL_H
+static int          _epoll_init(eio_handle_t *eio);
+static void         _epoll_fini(eio_handle_t *eio);
+static int          _epoll_mainloop(eio_handle_t *eio);
+#endif
 
 eio_handle_t *eio_handle_create(void)
 {
 	eio_handle_t *eio = xmalloc(sizeof(*eio));
 
+#ifdef HAVE_SYS_EPOLL_H
+	eio->epfd = -1;
+#endif
 	if (pipe(eio->fds) < 0) {
 		error ("eio_create: pipe: %m");
 		eio_handle_destroy(eio);
@@ -96,6 +148,10 @@ eio_handle_t *eio_handle_create(void)
 	eio->obj_list = list_create(eio_obj_destroy);
 	eio->new_objs = list_create(eio_obj_destroy);
 
+#ifdef HAVE_SYS_EPOLL_H
+	if (getenv("SLURM_EIO_POLL") == NULL)
+		_epoll_init(eio);
+#endif
 	return eio;
 }
 
@@ -105,6 +161,9 @@ void eio_handle_destroy(eio_handle_t *eio)
 	xassert(eio->magic == EIO_MAGIC);
 	close(eio->fds[0]);
 	close(eio->fds[1]);
+#ifdef HAVE_SYS_EPOLL_H
+	_epoll_fini(eio);
+#endif
 	if (eio->obj_list)
 		list_destroy(eio->obj_list);
 
@@ -241,6 +300,23 @@ static int _eio_wakeup_handler(eio_handle_t *eio)
 }
 
 int eio_handle_mainloop(eio_handle_t *eio)
+{
+	xassert (eio != NULL);
+	xassert (eio->magic == EIO_MAGIC);
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (eio->epfd >= 0) {
+		int rc = _epoll_mainloop(eio);
+		if (rc <= 0)
+			return rc;
+		/* epoll can't serve these objects, carry on with poll() */
+		_epoll_fini(eio);
+	}
+#endif
+	return _poll_mainloop(eio);
+}
+
+static int _poll_mainloop(eio_handle_t *eio)
 {
 	int            retval  = 0;
 	struct pollfd *pollfds = NULL;
@@ -248,9 +324,6 @@ int eio_handle_mainloop(eio_handle_t *eio)
 	unsigned int   maxnfds = 0, nfds = 0;
 	unsigned int   n       = 0;
 
-	xassert (eio != NULL);
-	xassert (eio->magic == EIO_MAGIC);
-
 	for (;;) {
 
 		/* Alloc memory for pfds and map if needed */
@@ -435,6 +508,327 @@ _poll_handle_event(short revents, eio_obj_t *obj, List objList)
 	}
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * epoll(7) backend. Objects are registered once and their interest is
+ * changed only when readable()/writable() change their answer, and only
+ * objects with events pending are dispatched. readable() and writable()
+ * are still called for every object on each pass, since they are where
+ * objects notice state changed by other objects' handlers.
+ */
+static int
+_epoll_init(eio_handle_t *eio)
+{
+	struct epoll_event ev;
+
+	if ((eio->epfd = epoll_create(64)) < 0) {
+		debug("eio: epoll_create: %m, using poll()");
+		return -1;
+	}
+	fd_set_close_on_exec(eio->epfd);
+
+	ev.events   = EPOLLIN;
+	ev.data.u64 = EIO_WAKEUP_KEY;
+	if (epoll_ctl(eio->epfd, EPOLL_CTL_ADD, eio->fds[0], &ev) < 0) {
+		error("eio: epoll_ctl: %m, using poll()");
+		close(eio->epfd);
+		eio->epfd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+static void
+_epoll_fini(eio_handle_t *eio)
+{
+	if (eio->epfd >= 0)
+		close(eio->epfd);
+	eio->epfd = -1;
+	xfree(eio->reg);
+	eio->reg_size = 0;
+	eio->reg_cnt = 0;
+	xfree(eio->fake);
+	eio->fake_size = 0;
+	eio->fake_cnt = 0;
+	xfree(eio->events);
+	eio->events_size = 0;
+}
+
+static uint64_t
+_epoll_key(int fd, uint32_t gen)
+{
+	return (((uint64_t) gen) << 32) | ((uint32_t) fd);
+}
+
+static short
+_epoll_to_poll(uint32_t events)
+{
+	short revents = 0;
+
+	if (events & EPOLLIN)
+		revents |= POLLIN;
+	if (events & EPOLLOUT)
+		revents |= POLLOUT;
+	if (events & EPOLLERR)
+		revents |= POLLERR;
+	if (events & EPOLLHUP)
+		revents |= POLLHUP;
+	return revents;
+}
+
+/* Dispatch revents to the object on fd this pass without epoll_wait() */
+static void
+_epoll_fake(eio_handle_t *eio, int fd, short revents)
+{
+	if (eio->fake_cnt >= eio->fake_size) {
+		eio->fake_size = eio->fake_size ? (eio->fake_size * 2) : 16;
+		xrealloc(eio->fake, eio->fake_size * sizeof(int));
+	}
+	eio->fake[eio->fake_cnt++] = fd;
+	eio->reg[fd].revents = revents;
+}
+
+static void
+_epoll_del(eio_handle_t *eio, int fd)
+{
+	struct epoll_event ev;	/* kernels before 2.6.9 want non-NULL */
+
+	/* Fails if the fd was closed, which already removed it */
+	(void) epoll_ctl(eio->epfd, EPOLL_CTL_DEL, fd, &ev);
+	eio->reg[fd].events = 0;
+	eio->reg[fd].dirty = false;
+	eio->reg_cnt--;
+}
+
+/*
+ * Register "events" of "obj" on its fd, unless already registered.
+ * Returns -1 if the epoll set can't hold the objects.
+ */
+static int
+_epoll_want(eio_handle_t *eio, eio_obj_t *obj, uint32_t events)
+{
+	int fd = obj->fd;
+	eio_reg_t *r;
+	struct epoll_event ev;
+
+	if (fd >= eio->reg_size) {
+		int size = eio->reg_size * 2;
+		if (size <= fd)
+			size = fd + 1;
+		xrealloc(eio->reg, size * sizeof(eio_reg_t));
+		eio->reg_size = size;
+	}
+	r = &eio->reg[fd];
+	if (r->pass == eio->pass) {
+		debug("eio: fd %d is shared by two objects", fd);
+		return -1;
+	}
+	r->pass = eio->pass;
+	if (r->obj != obj) {
+		r->obj    = obj;
+		r->gen    = ++eio->gen;
+		r->nopoll = false;
+		if (r->events)
+			r->dirty = true;
+	}
+
+	if (r->nopoll) {
+		_epoll_fake(eio, fd, _epoll_to_poll(events));
+		return 0;
+	}
+	if (r->events && (r->events == events) && !r->dirty) {
+		eio->reg_seen++;
+		return 0;
+	}
+
+	ev.events   = events;
+	ev.data.u64 = _epoll_key(fd, r->gen);
+	if (r->events) {
+		if (epoll_ctl(eio->epfd, EPOLL_CTL_MOD, fd, &ev) == 0) {
+			r->events = events;
+			r->dirty = false;
+			eio->reg_seen++;
+			return 0;
+		}
+		/* fd was closed, and maybe reopened, since registered */
+		r->events = 0;
+		r->dirty = false;
+		eio->reg_cnt--;
+		if (errno == EBADF) {
+			_epoll_fake(eio, fd, POLLNVAL);
+			return 0;
+		}
+		if (errno != ENOENT) {
+			error("eio: epoll_ctl(%d): %m", fd);
+			return -1;
+		}
+	}
+
+	if (epoll_ctl(eio->epfd, EPOLL_CTL_ADD, fd, &ev) == 0) {
+		r->events = events;
+		eio->reg_cnt++;
+		eio->reg_seen++;
+		return 0;
+	}
+	switch (errno) {
+	case EPERM:	/* regular file, always ready as with poll() */
+		r->nopoll = true;
+		_epoll_fake(eio, fd, _epoll_to_poll(events));
+		return 0;
+	case EBADF:
+		_epoll_fake(eio, fd, POLLNVAL);
+		return 0;
+	default:
+		error("eio: epoll_ctl(%d): %m", fd);
+		return -1;
+	}
+}
+
+/*
+ * Bring the epoll set up to date with the objects' readable() and
+ * writable() answers. Returns the number of objects wanting events,
+ * or -1 if the epoll set can't hold them.
+ */
+static int
+_epoll_setup(eio_handle_t *eio)
+{
+	ListIterator  i     = list_iterator_create(eio->obj_list);
+	eio_obj_t    *obj   = NULL;
+	int           nobjs = 0, rc = 0, fd;
+	uint32_t      events;
+
+	eio->pass++;
+	eio->reg_seen = 0;
+	eio->fake_cnt = 0;
+	while ((obj = list_next(i))) {
+		events = 0;
+		if (_is_writable(obj))
+			events |= EPOLLOUT;
+		if (_is_readable(obj))
+			events |= EPOLLIN;
+		if (events == 0)
+			continue;
+		nobjs++;
+		if ((obj->fd >= 0) && (_epoll_want(eio, obj, events) < 0)) {
+			rc = -1;
+			break;
+		}
+	}
+	list_iterator_destroy(i);
+	if (rc < 0)
+		return rc;
+
+	/* Drop fds no longer wanted by any object */
+	if (eio->reg_cnt > eio->reg_seen) {
+		for (fd = 0; fd < eio->reg_size; fd++) {
+			if (eio->reg[fd].events &&
+			    (eio->reg[fd].pass != eio->pass))
+				_epoll_del(eio, fd);
+		}
+	}
+	return nobjs;
+}
+
+/*
+ * An event came from a registration left behind by a closed fd which
+ * is still open elsewhere (e.g. in a forked child). It can't be removed
+ * through that fd any more, so start over with a new epoll set.
+ */
+static int
+_epoll_rebuild(eio_handle_t *eio)
+{
+	struct epoll_event ev;
+	eio_reg_t *r;
+	int fd;
+
+	debug2("eio: rebuilding epoll set after event on a closed fd");
+	eio->rebuild = false;
+	close(eio->epfd);
+	if (_epoll_init(eio) < 0)
+		return -1;
+
+	eio->reg_cnt = 0;
+	for (fd = 0; fd < eio->reg_size; fd++) {
+		r = &eio->reg[fd];
+		if (!r->events)
+			continue;
+		r->dirty    = false;
+		ev.events   = r->events;
+		ev.data.u64 = _epoll_key(fd, r->gen);
+		if (epoll_ctl(eio->epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+			r->events = 0;
+		else
+			eio->reg_cnt++;
+	}
+	return 0;
+}
+
+/*
+ * Returns 0 when no object wants events, -1 on error, or 1 if the
+ * objects must be served by poll() instead.
+ */
+static int
+_epoll_mainloop(eio_handle_t *eio)
+{
+	struct epoll_event *ev;
+	eio_reg_t *r;
+	int        i, n, fd, nobjs;
+
+	for (;;) {
+		debug4("eio: handling events for %d objects",
+		       list_count(eio->obj_list));
+		if ((nobjs = _epoll_setup(eio)) < 0)
+			return 1;
+		if (nobjs == 0)
+			return 0;
+
+		if (eio->events_size < (eio->reg_cnt + 1)) {
+			eio->events_size = eio->reg_cnt + 1;
+			xrealloc(eio->events, eio->events_size *
+					      sizeof(struct epoll_event));
+		}
+		n = epoll_wait(eio->epfd, eio->events, eio->events_size,
+			       eio->fake_cnt ? 0 : -1);
+		if (n < 0) {
+			if (errno != EINTR) {
+				error("epoll_wait: %m");
+				return -1;
+			}
+			n = 0;
+		}
+
+		for (i = 0; i < n; i++) {
+			if (eio->events[i].data.u64 == EIO_WAKEUP_KEY) {
+				_eio_wakeup_handler(eio);
+				break;
+			}
+		}
+
+		for (i = 0; i < n; i++) {
+			ev = &eio->events[i];
+			if (ev->data.u64 == EIO_WAKEUP_KEY)
+				continue;
+			fd = (int) (ev->data.u64 & 0xffffffff);
+			if ((fd >= eio->reg_size) || !eio->reg[fd].events ||
+			    (eio->reg[fd].gen != (ev->data.u64 >> 32))) {
+				eio->rebuild = true;
+				continue;
+			}
+			_poll_handle_event(_epoll_to_poll(ev->events),
+					   eio->reg[fd].obj, eio->obj_list);
+		}
+
+		for (i = 0; i < eio->fake_cnt; i++) {
+			r = &eio->reg[eio->fake[i]];
+			_poll_handle_event(r->revents, r->obj, eio->obj_list);
+		}
+
+		if (eio->rebuild && (_epoll_rebuild(eio) < 0))
+			return 1;
+	}
+}
+#endif
+
 static struct io_operations *
 _ops_copy(struct io_operations *ops)
 {
@@ -95,6 +95,9 @@ void eio_new_obj(eio_handle_t *eio, eio_obj_t *obj);
  * readable() or writable().
  *
  * returns -1 on error.
+ *
+ * Where available, epoll(7) is used and fds stay registered between
+ * passes; set SLURM_EIO_POLL in the environment to use poll(2) instead.
  */
 int eio_handle_mainloop(eio_handle_t *eio);
 
@@ -141,15 +141,8 @@ void *_forward_thread(void *arg)
 		pack_header(&fwd_msg->header, buffer);
 
 		/* add forward data to buffer */
-		if (remaining_buf(buffer) < fwd_msg->buf_len) {
-			buffer->size += (fwd_msg->buf_len + BUF_SIZE);
-			xrealloc(buffer->head, buffer->size);
-		}
-		if (fwd_msg->buf_len) {
-			memcpy(&buffer->head[buffer->processed],
-			       fwd_msg->buf, fwd_msg->buf_len);
-			buffer->processed += fwd_msg->buf_len;
-		}
+		if (fwd_msg->buf_len)
+			packmem_array(fwd_msg->buf, fwd_msg->buf_len, buffer);
 
 		/*
 		 * forward message
@@ -90,6 +90,16 @@ io_hdr_packed_size()
 	return sizeof(uint32_t) + 3*sizeof(uint16_t);
 }
 
+uint32_t
+io_frame_len(uint32_t io_frame_len)
+{
+	if (io_frame_len < MAX_MSG_LEN)
+		return MAX_MSG_LEN;
+	if (io_frame_len > MAX_FRAME_LEN)
+		return MAX_FRAME_LEN;
+	return io_frame_len;
+}
+
 /*
  * Only return when the all of the bytes have been read, or an unignorable
  * error has occurred.
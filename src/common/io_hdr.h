@@ -58,6 +58,10 @@
 #include "src/common/xmalloc.h"
 
 #define MAX_MSG_LEN 1024
+/* Largest stdout/stderr message body exchanged with a client which
+ * advertises io_frame_len at launch or reattach. Stdin messages and
+ * older clients still use MAX_MSG_LEN. */
+#define MAX_FRAME_LEN (64 * 1024)
 #define SLURM_IO_KEY_SIZE 8
 
 #define SLURM_IO_STDIN 0
@@ -90,6 +94,12 @@ void io_hdr_pack(io_hdr_t *hdr, Buf buffer);
 int io_hdr_unpack(io_hdr_t *hdr, Buf buffer);
 int io_hdr_read_fd(int fd, io_hdr_t *hdr);
 
+/*
+ * Return the stdout/stderr message body size to use with a client which
+ * advertised "io_frame_len" (0 if it did not).
+ */
+uint32_t io_frame_len(uint32_t io_frame_len);
+
 /*
  * Validate io init msg
  */
@@ -190,6 +190,7 @@ typedef struct listNode * ListNode;
 
 static void * list_node_create (List l, ListNode *pp, void *x);
 static void * list_node_destroy (List l, ListNode *pp);
+static ListNode list_node_merge (ListNode a, ListNode b, ListCmpF f);
 static List list_alloc (void);
 static void list_free (List l);
 static ListNode list_node_alloc (void);
@@ -530,35 +531,43 @@ list_flush (List l)
 void
 list_sort (List l, ListCmpF f)
 {
-/*  Note: Time complexity O(n^2).
+/*  Note: Time complexity O(n log n).
+ *  Bottom-up merge sort: bin[n] holds a sorted chain of 2^n nodes, which
+ *    is merged with the next chain of the same length as nodes are taken
+ *    from the head of the list.  Earlier nodes are always merged ahead of
+ *    later nodes with an equal key, so the sort is stable.
  */
-    ListNode *pp, *ppPrev, *ppPos, pTmp;
+    ListNode bin[64], chain, p, *pp;
     ListIterator i;
+    int n, fill = 0;
 
     assert(l != NULL);
     assert(f != NULL);
     list_mutex_lock(&l->mutex);
     assert(l->magic == LIST_MAGIC);
     if (l->count > 1) {
-	ppPrev = &l->head;
-	pp = &(*ppPrev)->next;
-	while (*pp) {
-	    if (f((*pp)->data, (*ppPrev)->data) < 0) {
-		ppPos = &l->head;
-		while (f((*pp)->data, (*ppPos)->data) >= 0)
-		    ppPos = &(*ppPos)->next;
-		pTmp = (*pp)->next;
-		(*pp)->next = *ppPos;
-		*ppPos = *pp;
-		*pp = pTmp;
-		if (ppPrev == ppPos)
-		    ppPrev = &(*ppPrev)->next;
-	    }
-	    else {
-		ppPrev = pp;
-		pp = &(*pp)->next;
+	p = l->head;
+	while (p) {
+	    chain = p;
+	    p = p->next;
+	    chain->next = NULL;
+	    for (n = 0; (n < fill) && bin[n]; n++) {
+		chain = list_node_merge(bin[n], chain, f);
+		bin[n] = NULL;
 	    }
+	    if (n == fill)
+		fill++;
+	    bin[n] = chain;
+	}
+	chain = NULL;
+	for (n = 0; n < fill; n++) {
+	    if (bin[n])
+		chain = chain ? list_node_merge(bin[n], chain, f) : bin[n];
 	}
+	l->head = chain;
+	pp = &l->head;
+	while (*pp)
+	    pp = &(*pp)->next;
 	l->tail = pp;
 
 	for (i=l->iNext; i; i=i->iNext) {
@@ -899,6 +908,30 @@ list_node_destroy (List l, ListNode *pp)
 }
 
 
+static ListNode
+list_node_merge (ListNode a, ListNode b, ListCmpF f)
+{
+/*  Merges the sorted chains [a] and [b] into one sorted chain.
+ *  Nodes of [a] precede nodes of [b] that compare equal.
+ */
+    ListNode head = NULL, *pp = &head;
+
+    while (a && b) {
+	if (f(b->data, a->data) < 0) {
+	    *pp = b;
+	    b = b->next;
+	}
+	else {
+	    *pp = a;
+	    a = a->next;
+	}
+	pp = &(*pp)->next;
+    }
+    *pp = a ? a : b;
+    return(head);
+}
+
+
 static List
 list_alloc (void)
 {
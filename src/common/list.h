@@ -243,6 +243,8 @@ void * list_pop_bottom (List l, ListCmpF f);
 /*
  *  Pops the lowest priority data item from the stack [l].
  *  Returns the data's ptr, or NULL if the stack is empty.
+ *  Note: Each call scans the whole list; to take many items in priority
+ *    order, call list_sort() once and then list_pop().
  */
 
 void * list_peek (List l);
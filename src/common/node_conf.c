@@ -80,6 +80,7 @@
 /* Global variables */
 List config_list  = NULL;	/* list of config_record entries */
 List feature_list = NULL;	/* list of features_record entries */
+uint32_t feature_list_gen = 1;	/* feature_list record generation */
 List front_end_list = NULL;	/* list of slurm_conf_frontend_t entries */
 time_t last_node_update = (time_t) 0;	/* time of last update */
 struct node_record *node_record_table_ptr = NULL;	/* node records */
@@ -127,6 +128,7 @@ static void _add_config_feature(char *feature, bitstr_t *node_bitmap)
 		feature_ptr->name = xstrdup(feature);
 		feature_ptr->node_bitmap = bit_copy(node_bitmap);
 		list_append(feature_list, feature_ptr);
+		feature_list_gen++;
 	}
 }
 
@@ -258,6 +260,7 @@ static int _delete_config_record (void)
 	last_node_update = time (NULL);
 	(void) list_delete_all (config_list,    &_list_find_config,  NULL);
 	(void) list_delete_all (feature_list,   &_list_find_feature, NULL);
+	feature_list_gen++;
 	(void) list_delete_all (front_end_list, &list_find_frontend, NULL);
 	return SLURM_SUCCESS;
 }
@@ -812,6 +815,7 @@ extern void node_fini2 (void)
 		config_list = NULL;
 		list_destroy(feature_list);
 		feature_list = NULL;
+		feature_list_gen++;
 		list_destroy(front_end_list);
 		front_end_list = NULL;
 	}
@@ -89,6 +89,8 @@ struct features_record {
 	bitstr_t *node_bitmap;	/* bitmap of nodes with this feature */
 };
 extern List feature_list;	/* list of features_record entries */
+extern uint32_t feature_list_gen; /* changed when features_record entries
+				 * are added to or removed from feature_list */
 
 struct node_record {
 	uint32_t magic;			/* magic cookie for data integrity */
@@ -98,6 +98,31 @@ strong_alias(unpackstr_array,	slurm_unpackstr_array);
 strong_alias(packmem_array,	slurm_packmem_array);
 strong_alias(unpackmem_array,	slurm_unpackmem_array);
 
+/* Make room to pack size_val more bytes. A buffer that must grow at
+ * least doubles in size, so packing N bytes costs O(N) in copies made
+ * by xrealloc() rather than O(N^2/BUF_SIZE).
+ * RET SLURM_SUCCESS or SLURM_ERROR if MAX_BUF_SIZE would be exceeded */
+static int _buf_reserve(Buf buffer, uint32_t size_val, const char *caller)
+{
+	uint32_t new_size;
+
+	if (remaining_buf(buffer) >= size_val)
+		return SLURM_SUCCESS;
+	if (size_val > (MAX_BUF_SIZE - buffer->processed)) {
+		error("%s: buffer size too large", caller);
+		return SLURM_ERROR;
+	}
+
+	if (buffer->size > (MAX_BUF_SIZE / 2))
+		new_size = MAX_BUF_SIZE;
+	else
+		new_size = MAX((buffer->size * 2), BUF_SIZE);
+	new_size = MAX(new_size, (buffer->processed + size_val));
+	buffer->size = new_size;
+	xrealloc(buffer->head, buffer->size);
+	return SLURM_SUCCESS;
+}
+
 /* Basic buffer management routines */
 /* create_buf - create a buffer with the supplied contents, contents must
  * be xalloc'ed */
@@ -125,19 +150,15 @@ void free_buf(Buf my_buf)
 {
 	assert(my_buf->magic == BUF_MAGIC);
 	xfree(my_buf->head);
+	xfree(my_buf->refs);
 	xfree(my_buf);
 }
 
-/* Grow a buffer by the specified amount */
+/* Grow a buffer so that at least the specified amount can be packed
+ * without further reallocation */
 void grow_buf (Buf buffer, int size)
 {
-	if (buffer->size > (MAX_BUF_SIZE - size)) {
-		error("grow_buf: buffer size too large");
-		return;
-	}
-
-	buffer->size += size;
-	xrealloc(buffer->head, buffer->size);
+	(void) _buf_reserve(buffer, size, "grow_buf");
 }
 
 /* init_buf - create an empty buffer of the given size */
@@ -166,11 +187,127 @@ void *xfer_buf_data(Buf my_buf)
 	void *data_ptr;
 
 	assert(my_buf->magic == BUF_MAGIC);
+	buf_flatten(my_buf);
 	data_ptr = (void *) my_buf->head;
 	xfree(my_buf);
 	return data_ptr;
 }
 
+/* init_chained_buf - create an empty buffer of the given size, into which
+ * pack_buf_ref() may place references to data rather than copies */
+Buf init_chained_buf(int size)
+{
+	Buf my_buf = init_buf(size);
+
+	if (my_buf)
+		my_buf->chained = 1;
+	return my_buf;
+}
+
+/* pack_buf_ref - store the memory contents into the buffer as
+ * packmem_array() does. A chained buffer records large data by
+ * reference instead, the caller must keep it unchanged until the
+ * buffer has been sent or flattened. */
+void pack_buf_ref(char *valp, uint32_t size_val, Buf buffer)
+{
+	struct buf_ref *ref;
+
+	assert(buffer->magic == BUF_MAGIC);
+	if (!buffer->chained || (size_val < BUF_SIZE) ||
+	    (buffer->ref_cnt == 0xffff)) {
+		packmem_array(valp, size_val, buffer);
+		return;
+	}
+	if (size_val > (MAX_BUF_SIZE - buf_length(buffer))) {
+		error("pack_buf_ref: buffer size too large");
+		return;
+	}
+
+	xrealloc(buffer->refs, sizeof(struct buf_ref) * (buffer->ref_cnt + 1));
+	ref = &buffer->refs[buffer->ref_cnt++];
+	ref->offset = buffer->processed;
+	ref->data   = valp;
+	ref->len    = size_val;
+}
+
+/* buf_length - return the number of bytes packed into a buffer, including
+ * any data referenced by a chained buffer */
+uint32_t buf_length(Buf buffer)
+{
+	uint32_t len = buffer->processed;
+	int i;
+
+	for (i = 0; i < buffer->ref_cnt; i++)
+		len += buffer->refs[i].len;
+	return len;
+}
+
+/* buf_flatten - copy any data referenced by a chained buffer into its
+ * head, leaving buf_length() bytes of contiguous packed data */
+void buf_flatten(Buf buffer)
+{
+	char *head;
+	uint32_t size, head_off = 0, new_off = 0, len;
+	int i;
+
+	assert(buffer->magic == BUF_MAGIC);
+	if (buffer->ref_cnt == 0)
+		return;
+
+	size = buf_length(buffer);
+	head = xmalloc(size);
+	for (i = 0; i < buffer->ref_cnt; i++) {
+		assert(buffer->refs[i].offset >= head_off);
+		len = buffer->refs[i].offset - head_off;
+		memcpy(head + new_off, buffer->head + head_off, len);
+		head_off += len;
+		new_off  += len;
+		memcpy(head + new_off, buffer->refs[i].data,
+		       buffer->refs[i].len);
+		new_off  += buffer->refs[i].len;
+	}
+	memcpy(head + new_off, buffer->head + head_off,
+	       buffer->processed - head_off);
+
+	xfree(buffer->head);
+	xfree(buffer->refs);
+	buffer->ref_cnt   = 0;
+	buffer->head      = head;
+	buffer->size      = size;
+	buffer->processed = size;
+}
+
+/* buf_iovec - describe a buffer's packed data, in order, without copying
+ * it. Set iov_cnt to the number of entries in the returned array, which
+ * must be released with xfree() */
+struct iovec *buf_iovec(Buf buffer, int *iov_cnt)
+{
+	struct iovec *iov;
+	uint32_t head_off = 0;
+	int i, cnt = 0;
+
+	assert(buffer->magic == BUF_MAGIC);
+	iov = xmalloc(sizeof(struct iovec) * (buffer->ref_cnt * 2 + 1));
+	for (i = 0; i < buffer->ref_cnt; i++) {
+		if (buffer->refs[i].offset > head_off) {
+			iov[cnt].iov_base = buffer->head + head_off;
+			iov[cnt].iov_len  = buffer->refs[i].offset - head_off;
+			head_off = buffer->refs[i].offset;
+			cnt++;
+		}
+		iov[cnt].iov_base = buffer->refs[i].data;
+		iov[cnt].iov_len  = buffer->refs[i].len;
+		cnt++;
+	}
+	if (buffer->processed > head_off) {
+		iov[cnt].iov_base = buffer->head + head_off;
+		iov[cnt].iov_len  = buffer->processed - head_off;
+		cnt++;
+	}
+	*iov_cnt = cnt;
+	return iov;
+}
+
 /*
  * Given a time_t in host byte order, promote it to int64_t, convert to
  * network byte order, store in buffer and adjust buffer acc'd'ngly
@@ -179,14 +316,8 @@ void pack_time(time_t val, Buf buffer)
 {
 	int64_t n64 = HTON_int64((int64_t) val);
 
-	if (remaining_buf(buffer) < sizeof(n64)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
-			error("pack_time: buffer size too large");
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
-	}
+	if (_buf_reserve(buffer, sizeof(n64), "pack_time"))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &n64, sizeof(n64));
 	buffer->processed += sizeof(n64);
@@ -223,14 +354,8 @@ void 	packdouble(double val, Buf buffer)
 	  * more than 15 decimals will mess things up, but this corrects it. */
 	uval.d =  (val * FLOAT_MULT);
 	nl =  HTON_uint64(uval.u);
-	if (remaining_buf(buffer) < sizeof(nl)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
-			error("packdouble: buffer size too large");
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
-	}
+	if (_buf_reserve(buffer, sizeof(nl), "packdouble"))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
 	buffer->processed += sizeof(nl);
@@ -269,14 +394,8 @@ void pack64(uint64_t val, Buf buffer)
 {
 	uint64_t nl =  HTON_uint64(val);
 
-	if (remaining_buf(buffer) < sizeof(nl)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
-			error("pack64: buffer size too large");
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
-	}
+	if (_buf_reserve(buffer, sizeof(nl), "pack64"))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
 	buffer->processed += sizeof(nl);
@@ -306,14 +425,8 @@ void pack32(uint32_t val, Buf buffer)
 {
 	uint32_t nl = htonl(val);
 
-	if (remaining_buf(buffer) < sizeof(nl)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
-			error("pack32: buffer size too large");
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
-	}
+	if (_buf_reserve(buffer, sizeof(nl), "pack32"))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
 	buffer->processed += sizeof(nl);
@@ -401,14 +514,8 @@ void pack16(uint16_t val, Buf buffer)
 {
 	uint16_t ns = htons(val);
 
-	if (remaining_buf(buffer) < sizeof(ns)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
-			error("pack16: buffer size too large");
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
-	}
+	if (_buf_reserve(buffer, sizeof(ns), "pack16"))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
 	buffer->processed += sizeof(ns);
@@ -437,14 +544,8 @@ int unpack16(uint16_t * valp, Buf buffer)
  */
 void pack8(uint8_t val, Buf buffer)
 {
-	if (remaining_buf(buffer) < sizeof(uint8_t)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
-			error("pack8: buffer size too large");
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
-	}
+	if (_buf_reserve(buffer, sizeof(uint8_t), "pack8"))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &val, sizeof(uint8_t));
 	buffer->processed += sizeof(uint8_t);
@@ -473,14 +574,8 @@ void packmem(char *valp, uint32_t size_val, Buf buffer)
 {
 	uint32_t ns = htonl(size_val);
 
-	if (remaining_buf(buffer) < (sizeof(ns) + size_val)) {
-		if (buffer->size > (MAX_BUF_SIZE -  size_val - BUF_SIZE)) {
-			error("packmem: buffer size too large");
-			return;
-		}
-		buffer->size += (size_val + BUF_SIZE);
-		xrealloc(buffer->head, buffer->size);
-	}
+	if (_buf_reserve(buffer, sizeof(ns) + size_val, "packmem"))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
 	buffer->processed += sizeof(ns);
@@ -632,14 +727,8 @@ void packstr_array(char **valp, uint32_t size_val, Buf buffer)
 	int i;
 	uint32_t ns = htonl(size_val);
 
-	if (remaining_buf(buffer) < sizeof(ns)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
-			error("packstr_array: buffer size too large");
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
-	}
+	if (_buf_reserve(buffer, sizeof(ns), "packstr_array"))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
 	buffer->processed += sizeof(ns);
@@ -692,14 +781,8 @@ int unpackstr_array(char ***valp, uint32_t * size_valp, Buf buffer)
  */
 void packmem_array(char *valp, uint32_t size_val, Buf buffer)
 {
-	if (remaining_buf(buffer) < size_val) {
-		if (buffer->size > (MAX_BUF_SIZE - size_val - BUF_SIZE)) {
-			error("packmem_array: buffer size too large");
-			return;
-		}
-		buffer->size += (size_val + BUF_SIZE);
-		xrealloc(buffer->head, buffer->size);
-	}
+	if (_buf_reserve(buffer, size_val, "packmem_array"))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], valp, size_val);
 	buffer->processed += size_val;
@@ -57,17 +57,29 @@
 #include <assert.h>
 #include <time.h>
 #include <string.h>
+#include <sys/uio.h>
 
 #define BUF_MAGIC 0x42554545
 #define BUF_SIZE (16 * 1024)
 #define MAX_BUF_SIZE ((uint32_t) 0xffff0000)	/* avoid going over 32-bits */
 #define FLOAT_MULT 1000000
 
+/* Data referenced, rather than copied, by a chained buffer. It logically
+ * follows the first "offset" bytes of the buffer's head. */
+struct buf_ref {
+	uint32_t offset;
+	char *data;
+	uint32_t len;
+};
+
 struct slurm_buf {
 	uint32_t magic;
 	char *head;
 	uint32_t size;
 	uint32_t processed;
+	uint16_t chained;	/* pack_buf_ref() may reference data */
+	uint16_t ref_cnt;	/* entries in refs */
+	struct buf_ref *refs;	/* referenced data, in offset order */
 };
 
 typedef struct slurm_buf * Buf;
@@ -84,6 +96,15 @@ Buf	init_buf(int size);
 void    grow_buf (Buf my_buf, int size);
 void	*xfer_buf_data(Buf my_buf);
 
+/* Chained buffers: pack_buf_ref() records large data by reference, so
+ * the buffer must be sent with buf_iovec() (or made contiguous with
+ * buf_flatten()) while the referenced data is still valid. */
+Buf	init_chained_buf(int size);
+void	pack_buf_ref(char *valp, uint32_t size_val, Buf buffer);
+uint32_t buf_length(Buf buffer);
+void	buf_flatten(Buf buffer);
+struct iovec *buf_iovec(Buf buffer, int *iov_cnt);
+
 void	pack_time(time_t val, Buf buffer);
 int	unpack_time(time_t *valp, Buf buffer);
 
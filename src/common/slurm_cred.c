@@ -80,6 +80,8 @@ typedef struct sbcast_cred sbcast_cred_t;		/* opaque data type */
 
 #define MAX_TIME 0x7fffffff
 #define SBCAST_CACHE_SIZE 64
+#define CRED_SIG_CACHE_SIZE 64
+#define STATE_HASH_MIN 64
 
 /*
  * slurm job credential state
@@ -104,6 +106,32 @@ typedef struct {
 	time_t   revoked;       /* Time at which credentials were revoked   */
 } job_state_t;
 
+/*
+ * Hash table of job or credential states kept by the verifier
+ */
+typedef struct state_hash_ent {
+	uint32_t key;
+	void *rec;
+	struct state_hash_ent *next;
+} state_hash_ent_t;
+
+typedef struct {
+	state_hash_ent_t **bucket;
+	uint32_t size;		/* bucket count, a power of two		*/
+	uint32_t count;		/* records in the table			*/
+	time_t   next_expire;	/* no record expires before this time	*/
+} state_hash_t;
+
+/*
+ * Recently verified credential signature
+ */
+typedef struct {
+	time_t   expiration;	/* zero if the entry is unused		*/
+	uint32_t key;		/* hash of data				*/
+	char    *data;		/* packed credential then signature	*/
+	uint32_t data_len;
+} cred_sig_cache_t;
+
 
 /*
  * Completion of slurm credential context
@@ -139,8 +167,9 @@ struct slurm_cred_context {
 #endif
 	enum ctx_type  type;       /* type of context (creator or verifier) */
 	void          *key;        /* private or public key                 */
-	List           job_list;   /* List of used jobids (for verifier)    */
-	List           state_list; /* List of cred states (for verifier)    */
+	state_hash_t  *job_hash;   /* Table of used jobids (for verifier)   */
+	state_hash_t  *state_hash; /* Table of cred states (for verifier)   */
+	cred_sig_cache_t *sig_cache; /* Verified signatures (for verifier)  */
 
 	int          expiry_window;/* expiration window for cached creds    */
 
@@ -241,10 +270,19 @@ static job_state_t  * _job_state_create(uint32_t jobid);
 static void           _cred_state_destroy(cred_state_t *cs);
 static void           _job_state_destroy(job_state_t   *js);
 
+static state_hash_t * _state_hash_create(void);
+static void           _state_hash_destroy(state_hash_t *h, ListDelF del);
+static void           _state_hash_add(state_hash_t *h, uint32_t key, void *rec);
+static void           _state_hash_expire_at(state_hash_t *h, time_t t);
+static uint32_t       _cred_state_key(uint32_t jobid, uint32_t stepid,
+				      time_t ctime);
+
 static job_state_t  * _find_job_state(slurm_cred_ctx_t ctx, uint32_t jobid);
 static job_state_t  * _insert_job_state(slurm_cred_ctx_t ctx,  uint32_t jobid);
 static int            _find_cred_state(cred_state_t *c, slurm_cred_t *cred);
 
+static void _sig_cache_clear(slurm_cred_ctx_t ctx);
+
 static void _insert_cred_state(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
 static void _clear_expired_job_states(slurm_cred_ctx_t ctx);
 static void _clear_expired_credential_states(slurm_cred_ctx_t ctx);
@@ -529,10 +567,16 @@ slurm_cred_ctx_destroy(slurm_cred_ctx_t ctx)
 		(*(g_crypto_context->ops.crypto_destroy_key))(ctx->exkey);
 	if (ctx->key)
 		(*(g_crypto_context->ops.crypto_destroy_key))(ctx->key);
-	if (ctx->job_list)
-		list_destroy(ctx->job_list);
-	if (ctx->state_list)
-		list_destroy(ctx->state_list);
+	if (ctx->job_hash)
+		_state_hash_destroy(ctx->job_hash,
+				    (ListDelF) _job_state_destroy);
+	if (ctx->state_hash)
+		_state_hash_destroy(ctx->state_hash,
+				    (ListDelF) _cred_state_destroy);
+	if (ctx->sig_cache) {
+		_sig_cache_clear(ctx);
+		xfree(ctx->sig_cache);
+	}
 
 	xassert(ctx->magic = ~CRED_CTX_MAGIC);
 
@@ -1046,8 +1090,25 @@ slurm_cred_rewind(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 	xassert(ctx->type  == SLURM_CRED_VERIFIER);
 
-	rc = list_delete_all(ctx->state_list,
-			     (ListFindF) _find_cred_state, cred);
+	{
+		state_hash_t *h = ctx->state_hash;
+		uint32_t key = _cred_state_key(cred->jobid, cred->stepid,
+					       cred->ctime);
+		state_hash_ent_t **pp, *ent;
+
+		pp = &h->bucket[key & (h->size - 1)];
+		while ((ent = *pp)) {
+			if ((ent->key == key) &&
+			    _find_cred_state(ent->rec, cred)) {
+				*pp = ent->next;
+				_cred_state_destroy(ent->rec);
+				xfree(ent);
+				h->count--;
+				rc++;
+			} else
+				pp = &ent->next;
+		}
+	}
 
 	slurm_mutex_unlock(&ctx->mutex);
 
@@ -1088,6 +1149,7 @@ slurm_cred_revoke(slurm_cred_ctx_t ctx, uint32_t jobid, time_t time,
 	}
 
 	j->revoked = time;
+	_state_hash_expire_at(ctx->job_hash, j->expiration);
 
 	slurm_mutex_unlock(&ctx->mutex);
 	return SLURM_SUCCESS;
@@ -1123,6 +1185,8 @@ slurm_cred_begin_expiration(slurm_cred_ctx_t ctx, uint32_t jobid)
 	}
 
 	j->expiration  = time(NULL) + ctx->expiry_window;
+	if (j->revoked)
+		_state_hash_expire_at(ctx->job_hash, j->expiration);
 
 	debug2 ("set revoke expiration for jobid %u to %s",
 		j->jobid, timestr (&j->expiration, buf, 64) );
@@ -1456,7 +1520,7 @@ slurm_cred_ctx_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 
 	/*
 	 * Unpack job state list and cred state list from buffer
-	 * appening them onto ctx->state_list and ctx->job_list.
+	 * adding them to ctx->state_hash and ctx->job_hash.
 	 */
 	_job_state_unpack(ctx, buffer);
 	_cred_state_unpack(ctx, buffer);
@@ -1514,8 +1578,10 @@ _verifier_ctx_init(slurm_cred_ctx_t ctx)
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 	xassert(ctx->type == SLURM_CRED_VERIFIER);
 
-	ctx->job_list   = list_create((ListDelF) _job_state_destroy);
-	ctx->state_list = list_create((ListDelF) _cred_state_destroy);
+	ctx->job_hash   = _state_hash_create();
+	ctx->state_hash = _state_hash_create();
+	ctx->sig_cache  = xmalloc(sizeof(cred_sig_cache_t) *
+				  CRED_SIG_CACHE_SIZE);
 
 	return;
 }
@@ -1569,6 +1635,7 @@ _ctx_update_public_key(slurm_cred_ctx_t ctx, const char *path)
 
 	ctx->exkey = ctx->key;
 	ctx->key   = pk;
+	_sig_cache_clear(ctx);
 
 	/*
 	 * exkey expires in expiry_window seconds plus one minute.
@@ -1667,16 +1734,105 @@ _slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 	return SLURM_SUCCESS;
 }
 
+/* FNV-1a hash of a packed credential and its signature */
+static uint32_t _sig_cache_key(char *data, uint32_t len, char *sig,
+			       uint32_t siglen)
+{
+	uint32_t key = 2166136261U;
+	int i;
+
+	for (i = 0; i < len; i++)
+		key = (key ^ (unsigned char) data[i]) * 16777619U;
+	for (i = 0; i < siglen; i++)
+		key = (key ^ (unsigned char) sig[i]) * 16777619U;
+	return key;
+}
+
+static void _sig_cache_clear(slurm_cred_ctx_t ctx)
+{
+	int i;
+
+	for (i = 0; i < CRED_SIG_CACHE_SIZE; i++) {
+		xfree(ctx->sig_cache[i].data);
+		ctx->sig_cache[i].expiration = (time_t) 0;
+	}
+}
+
+/* Return the cache entry holding this exact credential and signature
+ * which was verified earlier and has not yet expired, or NULL */
+static cred_sig_cache_t *_sig_cache_find(slurm_cred_ctx_t ctx, uint32_t key,
+					 Buf buffer, slurm_cred_t *cred,
+					 time_t now)
+{
+	cred_sig_cache_t *ent;
+	uint32_t len = get_buf_offset(buffer);
+	int i;
+
+	for (i = 0; i < CRED_SIG_CACHE_SIZE; i++) {
+		ent = &ctx->sig_cache[i];
+		if ((ent->key == key) && (now <= ent->expiration) &&
+		    (ent->data_len == (len + cred->siglen)) &&
+		    !memcmp(ent->data, get_buf_data(buffer), len) &&
+		    !memcmp(ent->data + len, cred->signature, cred->siglen))
+			return ent;
+	}
+	return NULL;
+}
+
+/* Record a verified signature, replacing an expired entry or else the
+ * one which expires first */
+static void _sig_cache_add(slurm_cred_ctx_t ctx, uint32_t key, Buf buffer,
+			   slurm_cred_t *cred, time_t now)
+{
+	cred_sig_cache_t *ent, *oldest = NULL;
+	uint32_t len = get_buf_offset(buffer);
+	int i;
+
+	for (i = 0; i < CRED_SIG_CACHE_SIZE; i++) {
+		ent = &ctx->sig_cache[i];
+		if (now > ent->expiration) {
+			oldest = ent;
+			break;
+		}
+		if (!oldest || (ent->expiration < oldest->expiration))
+			oldest = ent;
+	}
+
+	ent = oldest;
+	xfree(ent->data);
+	ent->key = key;
+	ent->expiration = cred->ctime + ctx->expiry_window;
+	ent->data_len = len + cred->siglen;
+	ent->data = xmalloc(ent->data_len);
+	memcpy(ent->data, get_buf_data(buffer), len);
+	memcpy(ent->data + len, cred->signature, cred->siglen);
+}
+
+/* NOTE: A credential which has been verified once is not passed to the
+ *	crypto plugin again while it remains in the cache. Munge would
+ *	reject the second decode of a credential as a replay, for example
+ *	when a failed launch is rewound and retried. */
 static int
 _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
 	Buf            buffer;
 	int            rc;
+	uint32_t       key;
+	time_t         now = time(NULL);
 
 	debug("Checking credential with %u bytes of sig data", cred->siglen);
 	buffer = init_buf(4096);
 	_pack_cred(cred, buffer);
 
+	key = _sig_cache_key(get_buf_data(buffer), get_buf_offset(buffer),
+			     cred->signature, cred->siglen);
+	if (_sig_cache_find(ctx, key, buffer, cred, now)) {
+		debug2("Credential signature for job %u.%u found in cache",
+		       cred->jobid, cred->stepid);
+		free_buf(buffer);
+		return SLURM_SUCCESS;
+	}
+
 	rc = (*(g_crypto_context->ops.crypto_verify_sign))(ctx->key,
 							get_buf_data(buffer),
 							get_buf_offset(buffer),
@@ -1689,6 +1845,8 @@ _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 							cred->signature,
 							cred->siglen);
 	}
+	if (rc == 0)
+		_sig_cache_add(ctx, key, buffer, cred, now);
 	free_buf(buffer);
 
 	if (rc) {
@@ -1748,22 +1906,21 @@ _pack_cred(slurm_cred_t *cred, Buf buffer)
 static bool
 _credential_replayed(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
-	ListIterator  i = NULL;
-	cred_state_t *s = NULL;
+	state_hash_t     *h = ctx->state_hash;
+	state_hash_ent_t *ent;
+	cred_state_t     *s = NULL;
+	uint32_t          key;
 
 	_clear_expired_credential_states(ctx);
 
-	i = list_iterator_create(ctx->state_list);
-
-	while ((s = list_next(i))) {
-		if ((s->jobid  == cred->jobid)  &&
-		    (s->stepid == cred->stepid) &&
-		    (s->ctime  == cred->ctime))
+	key = _cred_state_key(cred->jobid, cred->stepid, cred->ctime);
+	for (ent = h->bucket[key & (h->size - 1)]; ent; ent = ent->next) {
+		if ((ent->key == key) && _find_cred_state(ent->rec, cred)) {
+			s = ent->rec;
 			break;
+		}
 	}
 
-	list_iterator_destroy(i);
-
 	/*
 	 * If we found a match, this credential is being replayed.
 	 */
@@ -1813,6 +1970,7 @@ slurm_cred_handle_reissue(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 		 * _clear_expired_job_states() remove this
 		 * job credential from the cred context. */
 		j->expiration = 0;
+		_state_hash_expire_at(ctx->job_hash, j->expiration);
 		_clear_expired_job_states(ctx);
 	}
 }
@@ -1854,19 +2012,99 @@ _credential_revoked(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 }
 
 
+static state_hash_t *
+_state_hash_create(void)
+{
+	state_hash_t *h = xmalloc(sizeof(state_hash_t));
+
+	h->size = STATE_HASH_MIN;
+	h->bucket = xmalloc(sizeof(state_hash_ent_t *) * h->size);
+	h->next_expire = (time_t) MAX_TIME;
+	return h;
+}
+
+static void
+_state_hash_destroy(state_hash_t *h, ListDelF del)
+{
+	state_hash_ent_t *ent, *next;
+	int i;
+
+	for (i = 0; i < h->size; i++) {
+		for (ent = h->bucket[i]; ent; ent = next) {
+			next = ent->next;
+			(*del)(ent->rec);
+			xfree(ent);
+		}
+	}
+	xfree(h->bucket);
+	xfree(h);
+}
+
+/* Add a record to the end of its chain, so lookups find the oldest
+ * record with a key first. The table doubles to keep chains short. */
+static void
+_state_hash_add(state_hash_t *h, uint32_t key, void *rec)
+{
+	state_hash_ent_t *ent, **pp;
+
+	if (h->count >= h->size) {
+		state_hash_ent_t **old_bucket = h->bucket;
+		uint32_t i, old_size = h->size;
+
+		h->size *= 2;
+		h->bucket = xmalloc(sizeof(state_hash_ent_t *) * h->size);
+		for (i = 0; i < old_size; i++) {
+			while ((ent = old_bucket[i])) {
+				old_bucket[i] = ent->next;
+				ent->next = NULL;
+				pp = &h->bucket[ent->key & (h->size - 1)];
+				while (*pp)
+					pp = &(*pp)->next;
+				*pp = ent;
+			}
+		}
+		xfree(old_bucket);
+	}
+
+	ent = xmalloc(sizeof(state_hash_ent_t));
+	ent->key = key;
+	ent->rec = rec;
+	pp = &h->bucket[key & (h->size - 1)];
+	while (*pp)
+		pp = &(*pp)->next;
+	*pp = ent;
+	h->count++;
+}
+
+/* Note that some record in the table expires at time t */
+static void
+_state_hash_expire_at(state_hash_t *h, time_t t)
+{
+	if (t < h->next_expire)
+		h->next_expire = t;
+}
+
+static uint32_t
+_cred_state_key(uint32_t jobid, uint32_t stepid, time_t ctime)
+{
+	uint32_t key = jobid;
+
+	key = (key * 31) + stepid;
+	key = (key * 31) + (uint32_t) ctime;
+	return key ^ (key >> 16);
+}
+
 static job_state_t *
 _find_job_state(slurm_cred_ctx_t ctx, uint32_t jobid)
 {
-	ListIterator  i = NULL;
-	job_state_t  *j = NULL;
+	state_hash_t     *h = ctx->job_hash;
+	state_hash_ent_t *ent;
 
-	i = list_iterator_create(ctx->job_list);
-	while ((j = list_next(i))) {
-		if (j->jobid == jobid)
-			break;
+	for (ent = h->bucket[jobid & (h->size - 1)]; ent; ent = ent->next) {
+		if (ent->key == jobid)
+			return ent->rec;
 	}
-	list_iterator_destroy(i);
-	return j;
+	return NULL;
 }
 
 static int
@@ -1880,7 +2118,7 @@ static job_state_t *
 _insert_job_state(slurm_cred_ctx_t ctx, uint32_t jobid)
 {
 	job_state_t *j = _job_state_create(jobid);
-	list_append(ctx->job_list, j);
+	_state_hash_add(ctx->job_hash, jobid, j);
 	return j;
 }
 
@@ -1911,33 +2149,46 @@ _clear_expired_job_states(slurm_cred_ctx_t ctx)
 {
 	char          t1[64], t2[64], t3[64];
 	time_t        now = time(NULL);
-	ListIterator  i   = NULL;
+	state_hash_t *h   = ctx->job_hash;
+	state_hash_ent_t **pp, *ent;
 	job_state_t  *j   = NULL;
+	int           i;
 
-	i = list_iterator_create(ctx->job_list);
-
-	while ((j = list_next(i))) {
-		if (j->revoked) {
-			strcpy(t2, " revoked:");
-			timestr(&j->revoked, (t2+9), (64-9));
-		} else {
-			t2[0] = '\0';
-		}
-		if (j->expiration) {
-			strcpy(t3, " expires:");
-			timestr(&j->revoked, (t3+9), (64-9));
-		} else {
-			t3[0] = '\0';
-		}
-		debug3("state for jobid %u: ctime:%s%s%s",
-		       j->jobid, timestr(&j->ctime, t1, 64), t2, t3);
-
-		if (j->revoked && (now > j->expiration)) {
-			list_delete_item(i);
+	/* Only revoked job states expire */
+	if (now <= h->next_expire)
+		return;
+	h->next_expire = (time_t) MAX_TIME;
+
+	for (i = 0; i < h->size; i++) {
+		for (pp = &h->bucket[i]; (ent = *pp); ) {
+			j = ent->rec;
+			if (j->revoked) {
+				strcpy(t2, " revoked:");
+				timestr(&j->revoked, (t2+9), (64-9));
+			} else {
+				t2[0] = '\0';
+			}
+			if (j->expiration) {
+				strcpy(t3, " expires:");
+				timestr(&j->revoked, (t3+9), (64-9));
+			} else {
+				t3[0] = '\0';
+			}
+			debug3("state for jobid %u: ctime:%s%s%s",
+			       j->jobid, timestr(&j->ctime, t1, 64), t2, t3);
+
+			if (j->revoked && (now > j->expiration)) {
+				*pp = ent->next;
+				_job_state_destroy(j);
+				xfree(ent);
+				h->count--;
+				continue;
+			}
+			if (j->revoked)
+				_state_hash_expire_at(h, j->expiration);
+			pp = &ent->next;
 		}
 	}
-
-	list_iterator_destroy(i);
 }
 
 
@@ -1945,17 +2196,29 @@ static void
 _clear_expired_credential_states(slurm_cred_ctx_t ctx)
 {
 	time_t        now = time(NULL);
-	ListIterator  i   = NULL;
+	state_hash_t *h   = ctx->state_hash;
+	state_hash_ent_t **pp, *ent;
 	cred_state_t *s   = NULL;
+	int           i;
 
-	i = list_iterator_create(ctx->state_list);
-
-	while ((s = list_next(i))) {
-		if (now > s->expiration)
-			list_delete_item(i);
+	if (now <= h->next_expire)
+		return;
+	h->next_expire = (time_t) MAX_TIME;
+
+	for (i = 0; i < h->size; i++) {
+		for (pp = &h->bucket[i]; (ent = *pp); ) {
+			s = ent->rec;
+			if (now > s->expiration) {
+				*pp = ent->next;
+				_cred_state_destroy(s);
+				xfree(ent);
+				h->count--;
+				continue;
+			}
+			_state_hash_expire_at(h, s->expiration);
+			pp = &ent->next;
+		}
 	}
-
-	list_iterator_destroy(i);
 }
 
 
@@ -1963,7 +2226,9 @@ static void
 _insert_cred_state(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
 	cred_state_t *s = _cred_state_create(ctx, cred);
-	list_append(ctx->state_list, s);
+	_state_hash_add(ctx->state_hash,
+			_cred_state_key(s->jobid, s->stepid, s->ctime), s);
+	_state_hash_expire_at(ctx->state_hash, s->expiration);
 }
 
 
@@ -2067,15 +2332,15 @@ unpack_error:
 static void
 _cred_state_pack(slurm_cred_ctx_t ctx, Buf buffer)
 {
-	ListIterator  i = NULL;
-	cred_state_t *s = NULL;
+	state_hash_ent_t *ent;
+	int i;
 
-	pack32(list_count(ctx->state_list), buffer);
+	pack32(ctx->state_hash->count, buffer);
 
-	i = list_iterator_create(ctx->state_list);
-	while ((s = list_next(i)))
-		_cred_state_pack_one(s, buffer);
-	list_iterator_destroy(i);
+	for (i = 0; i < ctx->state_hash->size; i++) {
+		for (ent = ctx->state_hash->bucket[i]; ent; ent = ent->next)
+			_cred_state_pack_one(ent->rec, buffer);
+	}
 }
 
 
@@ -2093,8 +2358,14 @@ _cred_state_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 		if (!(s = _cred_state_unpack_one(buffer)))
 			goto unpack_error;
 
-		if (now < s->expiration)
-			list_append(ctx->state_list, s);
+		if (now < s->expiration) {
+			_state_hash_add(ctx->state_hash,
+					_cred_state_key(s->jobid, s->stepid,
+							s->ctime), s);
+			_state_hash_expire_at(ctx->state_hash,
+					      s->expiration);
+		} else
+			_cred_state_destroy(s);
 	}
 
 	return;
@@ -2108,16 +2379,15 @@ unpack_error:
 static void
 _job_state_pack(slurm_cred_ctx_t ctx, Buf buffer)
 {
-	ListIterator  i = NULL;
-	job_state_t  *j = NULL;
-
-	pack32((uint32_t) list_count(ctx->job_list), buffer);
+	state_hash_ent_t *ent;
+	int i;
 
+	pack32(ctx->job_hash->count, buffer);
 
-	i = list_iterator_create(ctx->job_list);
-	while ((j = list_next(i)))
-		_job_state_pack_one(j, buffer);
-	list_iterator_destroy(i);
+	for (i = 0; i < ctx->job_hash->size; i++) {
+		for (ent = ctx->job_hash->bucket[i]; ent; ent = ent->next)
+			_job_state_pack_one(ent->rec, buffer);
+	}
 }
 
 
@@ -2135,11 +2405,15 @@ _job_state_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 		if (!(j = _job_state_unpack_one(buffer)))
 			goto unpack_error;
 
-		if (!j->revoked || (j->revoked && (now < j->expiration)))
-			list_append(ctx->job_list, j);
-		else {
+		if (!j->revoked || (j->revoked && (now < j->expiration))) {
+			_state_hash_add(ctx->job_hash, j->jobid, j);
+			if (j->revoked)
+				_state_hash_expire_at(ctx->job_hash,
+						      j->expiration);
+		} else {
 			debug3 ("not appending expired job %u state",
 				j->jobid);
+			_job_state_destroy(j);
 		}
 	}
 
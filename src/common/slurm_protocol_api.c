@@ -2632,9 +2632,9 @@ _pack_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer)
 {
 	unsigned int tmplen, msglen;
 
-	tmplen = get_buf_offset(buffer);
+	tmplen = buf_length(buffer);
 	pack_msg(msg, buffer);
-	msglen = get_buf_offset(buffer) - tmplen;
+	msglen = buf_length(buffer) - tmplen;
 
 	/* update header with correct cred and msg lengths */
 	update_header(hdr, msglen);
@@ -2650,10 +2650,9 @@ _pack_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer)
  *  Send a slurm message over an open file descriptor `fd'
  *    Returns the size of the message sent in bytes, or -1 on failure.
  */
-int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
+static Buf _pack_node_msg(slurm_msg_t * msg, Buf buffer)
 {
 	header_t header;
-	Buf      buffer;
 	int      rc;
 	void *   auth_cred;
 	uint16_t auth_flags = SLURM_PROTOCOL_NO_FLAGS;
@@ -2669,7 +2668,9 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 	if (auth_cred == NULL) {
 		error("authentication: %s",
 		      g_slurm_auth_errstr(g_slurm_auth_errno(NULL)) );
-		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		free_buf(buffer);
+		slurm_seterrno(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		return NULL;
 	}
 
 	if (msg->forward.init != FORWARD_INIT) {
@@ -2683,7 +2684,6 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 	/*
 	 * Pack header into buffer for transmission
 	 */
-	buffer = init_buf(BUF_SIZE);
 	pack_header(&header, buffer);
 
 	/*
@@ -2695,7 +2695,8 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 		error("authentication: %s",
 		      g_slurm_auth_errstr(g_slurm_auth_errno(auth_cred)));
 		free_buf(buffer);
-		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		slurm_seterrno(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		return NULL;
 	}
 
 	/*
@@ -2703,15 +2704,39 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 	 */
 	_pack_msg(msg, &header, buffer);
 
+	return buffer;
+}
+
+Buf slurm_pack_node_msg(slurm_msg_t * msg)
+{
+	return _pack_node_msg(msg, init_buf(BUF_SIZE));
+}
+
+int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
+{
+	Buf      buffer;
+	struct iovec *iov;
+	int      iov_cnt, rc;
+
+	/* Large message data (e.g. a cached node or job information
+	 * response) is gathered from where it is by the send rather
+	 * than copied into the buffer */
+	buffer = _pack_node_msg(msg, init_chained_buf(BUF_SIZE));
+	if (buffer == NULL)
+		return SLURM_ERROR;
+
 #if	_DEBUG
+	buf_flatten(buffer);
 	_print_data (get_buf_data(buffer),get_buf_offset(buffer));
 #endif
 	/*
 	 * Send message
 	 */
-	rc = _slurm_msg_sendto( fd, get_buf_data(buffer),
-				get_buf_offset(buffer),
-				SLURM_PROTOCOL_NO_SEND_RECV_FLAGS );
+	iov = buf_iovec(buffer, &iov_cnt);
+	rc = _slurm_msg_sendv_timeout(fd, iov, iov_cnt,
+				      SLURM_PROTOCOL_NO_SEND_RECV_FLAGS,
+				      (slurm_get_msg_timeout() * 1000));
+	xfree(iov);
 
 	if ((rc < 0) && (errno == ENOTCONN)) {
 		debug3("slurm_msg_sendto: peer has disappeared for msg_type=%u",
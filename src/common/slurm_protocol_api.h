@@ -714,6 +714,16 @@ int slurm_receive_msg_and_forward(slurm_fd_t fd, slurm_addr_t *orig_addr,
  * send message functions
 \**********************************************************************/
 
+/* packs a message to an arbitrary node, with its header and authentication
+ * credential, exactly as slurm_send_node_msg() would send it. The caller
+ * sends get_buf_offset() bytes preceded by their length in network order.
+ *
+ * IN msg		- a slurm msg struct to be packed
+ * RET Buf		- packed message, free with free_buf(), or NULL on
+ *			  authentication error (errno set)
+ */
+Buf slurm_pack_node_msg(slurm_msg_t *msg);
+
 /* sends a message to an arbitrary node
  *
  * IN open_fd		- file descriptor to send msg on
@@ -327,7 +327,22 @@ extern void slurm_free_job_step_kill_msg(job_step_kill_msg_t * msg)
 
 extern void slurm_free_job_info_request_msg(job_info_request_msg_t *msg)
 {
-	xfree(msg);
+	if (msg) {
+		slurm_free_job_info_filter(msg->filter);
+		xfree(msg);
+	}
+}
+
+extern void slurm_free_job_info_filter(job_info_filter_t *filter)
+{
+	if (filter) {
+		xfree(filter->accounts);
+		xfree(filter->job_ids);
+		xfree(filter->name);
+		xfree(filter->partitions);
+		xfree(filter->user_ids);
+		xfree(filter);
+	}
 }
 
 extern void slurm_free_job_step_info_request_msg(job_step_info_request_msg_t *msg)
@@ -1807,6 +1822,19 @@ extern void slurm_free_job_info_msg(job_info_msg_t * job_buffer_ptr)
 	}
 }
 
+/*
+ * slurm_free_job_info_delta_msg - free a job information delta message
+ * IN msg - pointer to job information delta message
+ */
+extern void slurm_free_job_info_delta_msg(job_info_delta_msg_t *msg)
+{
+	if (msg) {
+		slurm_free_job_info_msg(msg->job_info);
+		xfree(msg->removed_ids);
+		xfree(msg);
+	}
+}
+
 static void _free_all_job_info(job_info_msg_t *msg)
 {
 	int i;
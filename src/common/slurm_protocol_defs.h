@@ -215,6 +215,7 @@ typedef enum {
 	RESPONSE_FRONT_END_INFO,
 	REQUEST_SPANK_ENVIRONMENT,
 	RESPONCE_SPANK_ENVIRONMENT,
+	RESPONSE_JOB_INFO_DELTA,
 
 	REQUEST_UPDATE_JOB = 3001,
 	REQUEST_UPDATE_NODE,
@@ -485,8 +486,18 @@ typedef struct job_step_id_msg {
 typedef struct job_info_request_msg {
 	time_t last_update;
 	uint16_t show_flags;
+	job_info_filter_t *filter;	/* optional, NULL reports all jobs */
+	uint16_t delta;		/* if set, RESPONSE_JOB_INFO_DELTA may be
+				 * sent for unfiltered requests */
 } job_info_request_msg_t;
 
+/* Changes to job information since the request's last_update */
+typedef struct job_info_delta_msg {
+	job_info_msg_t *job_info;	/* new or changed job records */
+	uint32_t removed_cnt;
+	uint32_t *removed_ids;		/* IDs of jobs no longer reported */
+} job_info_delta_msg_t;
+
 typedef struct job_step_info_request_msg {
 	time_t last_update;
 	uint32_t job_id;
@@ -669,6 +680,8 @@ typedef struct launch_tasks_request_msg {
 	uint8_t   labelio;  /* prefix output lines with the task number */
 	uint16_t  num_io_port;
 	uint16_t  *io_port;  /* array of available client IO listen ports */
+	uint32_t  io_frame_len; /* largest stdout/err message body the
+				 * client accepts, 0 for MAX_MSG_LEN */
 	/**********  END  "normal" IO only options **********/
 
 	char     *task_prolog;
@@ -741,6 +754,8 @@ typedef struct reattach_tasks_request_msg {
 	uint16_t    *resp_port; /* array of available response ports */
 	uint16_t     num_io_port;
 	uint16_t    *io_port;   /* array of available client IO ports */
+	uint32_t     io_frame_len; /* largest stdout/err message body the
+				    * client accepts, 0 for MAX_MSG_LEN */
 	slurm_cred_t *cred;      /* used only a weak authentication mechanism
 				   for the slurmstepd to use when connecting
 				   back to the client */
@@ -851,6 +866,9 @@ typedef struct kvs_get_msg {
 	char * hostname;	/* hostname to be sent the kvs data */
 } kvs_get_msg_t;
 
+#define FILE_BCAST_APPEND ((uint64_t) -1)	/* block_offset from peers
+						 * which send blocks in order */
+
 typedef struct file_bcast_msg {
 	char *fname;		/* name of the destination file */
 	uint16_t block_no;	/* block number of this data */
@@ -863,6 +881,8 @@ typedef struct file_bcast_msg {
 	time_t mtime;		/* last modification time for dest file */
 	sbcast_cred_t *cred;	/* credential for the RPC */
 	uint32_t block_len;	/* length of this data block */
+	uint64_t block_offset;	/* offset of this block in the file or
+				 * FILE_BCAST_APPEND */
 	char *block;		/* data for this block */
 } file_bcast_msg_t;
 
@@ -970,6 +990,8 @@ extern void slurm_free_last_update_msg(last_update_msg_t * msg);
 extern void slurm_free_return_code_msg(return_code_msg_t * msg);
 extern void slurm_free_job_alloc_info_msg(job_alloc_info_msg_t * msg);
 extern void slurm_free_job_info_request_msg(job_info_request_msg_t *msg);
+extern void slurm_free_job_info_filter(job_info_filter_t *filter);
+extern void slurm_free_job_info_delta_msg(job_info_delta_msg_t *msg);
 extern void slurm_free_job_step_info_request_msg(
 		job_step_info_request_msg_t *msg);
 extern void slurm_free_front_end_info_request_msg(
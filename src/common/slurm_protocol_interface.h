@@ -69,6 +69,7 @@
 
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdarg.h>
@@ -165,6 +166,11 @@ ssize_t _slurm_msg_sendto ( slurm_fd_t open_fd, char *buffer ,
  * IN timeout - maximum time to wait for a message in milliseconds */
 ssize_t _slurm_msg_sendto_timeout ( slurm_fd_t open_fd, char *buffer,
 				    size_t size, uint32_t flags, int timeout );
+/* _slurm_msg_sendv_timeout is identical to _slurm_msg_sendto_timeout
+ * except that the message is gathered from the iov_cnt entries of iov,
+ * which may be modified */
+ssize_t _slurm_msg_sendv_timeout ( slurm_fd_t open_fd, struct iovec *iov,
+				   int iov_cnt, uint32_t flags, int timeout );
 
 /* _slurm_accept_msg_conn
  * In the bsd implmentation maps directly to a accept call
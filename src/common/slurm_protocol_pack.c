@@ -67,7 +67,12 @@
 #include "src/common/job_options.h"
 #include "src/common/slurmdbd_defs.h"
 
+/* Flags in the 2.3 job_info_request_msg_t */
+#define JOB_INFO_REQ_FILTER	0x01	/* job_info_filter_t follows */
+#define JOB_INFO_REQ_DELTA	0x02	/* RESPONSE_JOB_INFO_DELTA accepted */
+
 #define _pack_job_info_msg(msg,buf)		_pack_buffer_msg(msg,buf)
+#define _pack_job_info_delta_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_job_step_info_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_block_info_resp_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_front_end_info_msg(msg,buf)	_pack_buffer_msg(msg,buf)
@@ -397,6 +402,8 @@ static int _unpack_job_desc_msg(job_desc_msg_t ** job_desc_buffer_ptr,
 				uint16_t protocol_version);
 static int _unpack_job_info_msg(job_info_msg_t ** msg, Buf buffer,
 				uint16_t protocol_version);
+static int _unpack_job_info_delta_msg(job_info_delta_msg_t ** msg,
+				      Buf buffer, uint16_t protocol_version);
 
 static void _pack_last_update_msg(last_update_msg_t * msg, Buf buffer,
 				  uint16_t protocol_version);
@@ -712,6 +719,9 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 	case RESPONSE_JOB_INFO:
 		_pack_job_info_msg((slurm_msg_t *) msg, buffer);
 		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		_pack_job_info_delta_msg((slurm_msg_t *) msg, buffer);
+		break;
 	case RESPONSE_PARTITION_INFO:
 		_pack_partition_info_msg((slurm_msg_t *) msg, buffer);
 		break;
@@ -1213,6 +1223,11 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 					  buffer,
 					  msg->protocol_version);
 		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		rc = _unpack_job_info_delta_msg(
+			(job_info_delta_msg_t **) &(msg->data), buffer,
+			msg->protocol_version);
+		break;
 	case RESPONSE_PARTITION_INFO:
 		rc = _unpack_partition_info_msg((partition_info_msg_t **) &
 						(msg->data), buffer,
@@ -3887,7 +3902,7 @@ static void
 _pack_buffer_msg(slurm_msg_t * msg, Buf buffer)
 {
 	xassert(msg != NULL);
-	packmem_array(msg->data, msg->data_size, buffer);
+	pack_buf_ref(msg->data, msg->data_size, buffer);
 }
 
 static int
@@ -3922,6 +3937,28 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* A delta is a job information message followed by removed job IDs */
+static int
+_unpack_job_info_delta_msg(job_info_delta_msg_t ** msg, Buf buffer,
+			   uint16_t protocol_version)
+{
+	job_info_delta_msg_t *delta;
+
+	xassert(msg != NULL);
+	delta = xmalloc(sizeof(job_info_delta_msg_t));
+	*msg = delta;
+
+	if (_unpack_job_info_msg(&delta->job_info, buffer, protocol_version))
+		goto unpack_error;
+	safe_unpack32_array(&delta->removed_ids, &delta->removed_cnt, buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_info_delta_msg(delta);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 /* _unpack_job_info_members
  * unpacks a set of slurm job info for one job
  * OUT job - pointer to the job info buffer
@@ -6642,6 +6679,8 @@ _pack_reattach_tasks_request_msg(reattach_tasks_request_msg_t * msg,
 	pack16((uint16_t)msg->num_io_port, buffer);
 	for(i = 0; i < msg->num_io_port; i++)
 		pack16((uint16_t)msg->io_port[i], buffer);
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION)
+		pack32(msg->io_frame_len, buffer);
 
 	slurm_cred_pack(msg->cred, buffer);
 }
@@ -6672,6 +6711,8 @@ _unpack_reattach_tasks_request_msg(reattach_tasks_request_msg_t ** msg_ptr,
 		for (i = 0; i < msg->num_io_port; i++)
 			safe_unpack16(&msg->io_port[i], buffer);
 	}
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION)
+		safe_unpack32(&msg->io_frame_len, buffer);
 
 	if (!(msg->cred = slurm_cred_unpack(buffer, protocol_version)))
 		goto unpack_error;
@@ -6870,6 +6911,8 @@ _pack_launch_tasks_request_msg(launch_tasks_request_msg_t * msg, Buf buffer,
 			pack16(msg->num_io_port, buffer);
 			for(i = 0; i < msg->num_io_port; i++)
 				pack16(msg->io_port[i], buffer);
+			if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION)
+				pack32(msg->io_frame_len, buffer);
 		}
 		packstr(msg->task_prolog, buffer);
 		packstr(msg->task_epilog, buffer);
@@ -7022,6 +7065,8 @@ _unpack_launch_tasks_request_msg(launch_tasks_request_msg_t **
 					safe_unpack16(&msg->io_port[i],
 						      buffer);
 			}
+			if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION)
+				safe_unpack32(&msg->io_frame_len, buffer);
 		}
 		safe_unpackstr_xmalloc(&msg->task_prolog, &uint32_tmp, buffer);
 		safe_unpackstr_xmalloc(&msg->task_epilog, &uint32_tmp, buffer);
@@ -7562,8 +7607,27 @@ static void
 _pack_job_info_request_msg(job_info_request_msg_t * msg, Buf buffer,
 			   uint16_t protocol_version)
 {
+	job_info_filter_t *filter = msg->filter;
+
 	pack_time(msg->last_update, buffer);
 	pack16((uint16_t)msg->show_flags, buffer);
+
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION) {
+		uint8_t req_flags = 0;
+		if (filter)
+			req_flags |= JOB_INFO_REQ_FILTER;
+		if (msg->delta)
+			req_flags |= JOB_INFO_REQ_DELTA;
+		pack8(req_flags, buffer);
+		if (filter == NULL)
+			return;
+		packstr(filter->accounts, buffer);
+		pack32_array(filter->job_ids, filter->job_id_cnt, buffer);
+		packstr(filter->name, buffer);
+		packstr(filter->partitions, buffer);
+		pack32(filter->state_mask, buffer);
+		pack32_array(filter->user_ids, filter->user_id_cnt, buffer);
+	}
 }
 
 static int
@@ -7572,12 +7636,34 @@ _unpack_job_info_request_msg(job_info_request_msg_t** msg,
 			     uint16_t protocol_version)
 {
 	job_info_request_msg_t*job_info;
+	job_info_filter_t *filter;
+	uint8_t req_flags = 0;
+	uint32_t uint32_tmp;
 
-	job_info = xmalloc(sizeof(job_step_info_request_msg_t));
+	job_info = xmalloc(sizeof(job_info_request_msg_t));
 	*msg = job_info;
 
 	safe_unpack_time(&job_info->last_update, buffer);
 	safe_unpack16(&job_info->show_flags, buffer);
+
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION)
+		safe_unpack8(&req_flags, buffer);
+	if (req_flags & JOB_INFO_REQ_DELTA)
+		job_info->delta = 1;
+	if (req_flags & JOB_INFO_REQ_FILTER) {
+		filter = xmalloc(sizeof(job_info_filter_t));
+		job_info->filter = filter;
+		safe_unpackstr_xmalloc(&filter->accounts, &uint32_tmp,
+				       buffer);
+		safe_unpack32_array(&filter->job_ids, &filter->job_id_cnt,
+				    buffer);
+		safe_unpackstr_xmalloc(&filter->name, &uint32_tmp, buffer);
+		safe_unpackstr_xmalloc(&filter->partitions, &uint32_tmp,
+				       buffer);
+		safe_unpack32(&filter->state_mask, buffer);
+		safe_unpack32_array(&filter->user_ids, &filter->user_id_cnt,
+				    buffer);
+	}
 	return SLURM_SUCCESS;
 
 unpack_error:
@@ -8994,6 +9080,8 @@ static void _pack_file_bcast(file_bcast_msg_t * msg , Buf buffer,
 
 	packstr ( msg->fname, buffer );
 	pack32 ( msg->block_len, buffer );
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION)
+		pack64 ( msg->block_offset, buffer );
 	packmem ( msg->block, msg->block_len, buffer );
 	pack_sbcast_cred( msg->cred, buffer );
 }
@@ -9022,6 +9110,10 @@ static int _unpack_file_bcast(file_bcast_msg_t ** msg_ptr , Buf buffer,
 
 	safe_unpackstr_xmalloc ( & msg->fname, &uint32_tmp, buffer );
 	safe_unpack32 ( & msg->block_len, buffer );
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION)
+		safe_unpack64 ( & msg->block_offset, buffer );
+	else
+		msg->block_offset = FILE_BCAST_APPEND;
 	safe_unpackmem_xmalloc ( & msg->block, &uint32_tmp , buffer ) ;
 	if ( uint32_tmp != msg->block_len )
 		goto unpack_error;
@@ -58,6 +58,7 @@
 #include <stdlib.h>
 #include <arpa/inet.h>
 #include <sys/param.h>
+#include <sys/uio.h>
 #include <stdlib.h>
 
 #if HAVE_SYS_SOCKET_H
@@ -90,10 +91,22 @@
  */
 #define MAX_MSG_SIZE     (128*1024*1024)
 
+/* Most iovec entries passed to one sendmsg() call */
+#ifndef IOV_MAX
+#  ifdef UIO_MAXIOV
+#    define IOV_MAX UIO_MAXIOV
+#  else
+#    define IOV_MAX 16
+#  endif
+#endif
+
 /****************************************************************
  * MIDDLE LAYER MSG FUNCTIONS
  ****************************************************************/
 
+static int _send_iov_timeout(slurm_fd_t fd, struct iovec *iov, int iov_cnt,
+			     uint32_t flags, int timeout);
+
 /*
  * Return time in msec since "start time"
  */
@@ -238,19 +251,73 @@ ssize_t _slurm_msg_sendto_timeout(slurm_fd_t fd, char *buffer, size_t size,
 	return len;
 }
 
+ssize_t _slurm_msg_sendv_timeout(slurm_fd_t fd, struct iovec *iov,
+				 int iov_cnt, uint32_t flags, int timeout)
+{
+	struct iovec *msg_iov;
+	size_t size = 0;
+	uint32_t usize;
+	int i, len;
+	SigFunc *ohandler;
+
+	/*
+	 *  Ignore SIGPIPE so that send can return a error code if the
+	 *    other side closes the socket
+	 */
+	ohandler = xsignal(SIGPIPE, SIG_IGN);
+
+	/* Send the length prefix and message with as few calls as possible */
+	msg_iov = xmalloc(sizeof(struct iovec) * (iov_cnt + 1));
+	for (i = 0; i < iov_cnt; i++) {
+		size += iov[i].iov_len;
+		msg_iov[i + 1] = iov[i];
+	}
+	usize = htonl(size);
+	msg_iov[0].iov_base = &usize;
+	msg_iov[0].iov_len  = sizeof(usize);
+
+	len = _send_iov_timeout(fd, msg_iov, iov_cnt + 1, flags, timeout);
+	if (len >= 0)
+		len -= sizeof(usize);
+	xfree(msg_iov);
+
+	xsignal(SIGPIPE, ohandler);
+	return len;
+}
+
 /* Send slurm message with timeout
  * RET message size (as specified in argument) or SLURM_ERROR on error */
 int _slurm_send_timeout(slurm_fd_t fd, char *buf, size_t size,
 			uint32_t flags, int timeout)
 {
-	int rc;
+	struct iovec iov;
+
+	iov.iov_base = buf;
+	iov.iov_len  = size;
+	return _send_iov_timeout(fd, &iov, 1, flags, timeout);
+}
+
+/* Send the iov_cnt entries of iov with timeout, iov is modified
+ * RET total size of the entries or SLURM_ERROR on error */
+static int _send_iov_timeout(slurm_fd_t fd, struct iovec *iov, int iov_cnt,
+			     uint32_t flags, int timeout)
+{
+	int rc, i;
 	int sent = 0;
+	size_t size = 0;
 	int fd_flags;
 	struct pollfd ufds;
+	struct msghdr msg;
 	struct timeval tstart;
 	int timeleft = timeout;
 	char temp[2];
 
+	for (i = 0; i < iov_cnt; i++)
+		size += iov[i].iov_len;
+	memset(&msg, 0, sizeof(struct msghdr));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iov_cnt;
+
 	ufds.fd     = fd;
 	ufds.events = POLLOUT;
 
@@ -307,7 +374,9 @@ int _slurm_send_timeout(slurm_fd_t fd, char *buf, size_t size,
 			      ufds.revents);
 		}
 
-		rc = _slurm_send(fd, &buf[sent], (size - sent), flags);
+		if (msg.msg_iovlen > IOV_MAX)
+			msg.msg_iovlen = IOV_MAX;
+		rc = sendmsg(fd, &msg, flags);
 		if (rc < 0) {
  			if (errno == EINTR)
 				continue;
@@ -331,6 +400,19 @@ int _slurm_send_timeout(slurm_fd_t fd, char *buf, size_t size,
 		}
 
 		sent += rc;
+		/* Skip past what was sent, resuming within a partial entry */
+		while ((rc > 0) && (iov_cnt > 0)) {
+			if (rc < iov->iov_len) {
+				iov->iov_base = (char *) iov->iov_base + rc;
+				iov->iov_len -= rc;
+				break;
+			}
+			rc -= iov->iov_len;
+			iov++;
+			iov_cnt--;
+		}
+		msg.msg_iov = iov;
+		msg.msg_iovlen = iov_cnt;
 	}
 
     done:
@@ -90,6 +90,8 @@
 #define	bit_realloc		slurm_bit_realloc
 #define	bit_size		slurm_bit_size
 #define	bit_and			slurm_bit_and
+#define	bit_and_not		slurm_bit_and_not
+#define	bit_and_not_count	slurm_bit_and_not_count
 #define	bit_not			slurm_bit_not
 #define	bit_or			slurm_bit_or
 #define	bit_set_count		slurm_bit_set_count
@@ -43,7 +43,10 @@
 #  define _GNU_SOURCE
 #endif
 
+#include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <sys/poll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -55,6 +58,7 @@
 #include <inttypes.h>
 #include <signal.h>
 
+#include "src/common/fd.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 #include "src/common/macros.h"
@@ -67,6 +71,138 @@
 #include "src/common/read_config.h"
 #include "src/common/stepd_api.h"
 
+/*
+ * Registry of the live slurmstepds of one directory and nodename, kept by
+ * the slurmd (see stepd_registry_init) so that stepd_available() need not
+ * scan the spool directory. Each entry holds the read end of a pipe whose
+ * write end the slurmstepd keeps open until it exits, so exited steps can
+ * be found with a single poll(). Steps found by the startup scan have no
+ * pipe and are dropped when a connect to them fails.
+ */
+typedef struct step_reg {
+	uint32_t jobid;
+	uint32_t stepid;
+	int fd;
+} step_reg_t;
+
+static pthread_mutex_t step_reg_lock = PTHREAD_MUTEX_INITIALIZER;
+static List step_reg_list = NULL;
+static char *step_reg_dir = NULL;
+static char *step_reg_node = NULL;
+
+static void _free_step_loc_t(step_loc_t *loc);
+static List _scan_available(const char *directory, const char *nodename);
+
+static void
+_step_reg_free(void *x)
+{
+	step_reg_t *reg = (step_reg_t *) x;
+
+	if (reg->fd >= 0)
+		close(reg->fd);
+	xfree(reg);
+}
+
+static int
+_step_reg_match(void *x, void *key)
+{
+	step_reg_t *reg = (step_reg_t *) x;
+	step_reg_t *want = (step_reg_t *) key;
+
+	return ((reg->jobid == want->jobid) && (reg->stepid == want->stepid));
+}
+
+/* Return true if the registry is tracking directory and nodename.
+ * Call with step_reg_lock held. */
+static bool
+_step_reg_active(const char *directory, const char *nodename)
+{
+	return (step_reg_list && directory && nodename &&
+		!strcmp(directory, step_reg_dir) &&
+		!strcmp(nodename, step_reg_node));
+}
+
+/*
+ * A connect to a registered step failed with errno "err". A missing socket
+ * means the step is gone. A refused connection only drops steps which have
+ * no liveness pipe, since a slurmstepd closes its socket shortly before
+ * it exits.
+ */
+static void
+_step_reg_connect_failed(const char *directory, const char *nodename,
+			 uint32_t jobid, uint32_t stepid, int err)
+{
+	ListIterator iter;
+	step_reg_t *reg;
+
+	if ((err != ENOENT) && (err != ECONNREFUSED))
+		return;
+
+	slurm_mutex_lock(&step_reg_lock);
+	if (_step_reg_active(directory, nodename)) {
+		iter = list_iterator_create(step_reg_list);
+		while ((reg = list_next(iter))) {
+			if ((reg->jobid != jobid) || (reg->stepid != stepid))
+				continue;
+			if ((err == ENOENT) || (reg->fd < 0)) {
+				debug3("dropping step %u.%u from registry",
+				       jobid, stepid);
+				list_delete_item(iter);
+			}
+			break;
+		}
+		list_iterator_destroy(iter);
+	}
+	slurm_mutex_unlock(&step_reg_lock);
+}
+
+/* Drop exited steps, then return a List of step_loc_t for the rest.
+ * Call with step_reg_lock held. */
+static List
+_step_reg_available(void)
+{
+	List l;
+	ListIterator iter;
+	step_reg_t *reg;
+	step_loc_t *loc;
+	struct pollfd *pfds;
+	int nfds = 0, i = 0;
+
+	pfds = xmalloc(sizeof(struct pollfd) * (list_count(step_reg_list) + 1));
+	iter = list_iterator_create(step_reg_list);
+	while ((reg = list_next(iter))) {
+		if (reg->fd < 0)
+			continue;
+		pfds[nfds].fd = reg->fd;
+		pfds[nfds].events = POLLIN;
+		nfds++;
+	}
+	if (nfds && (poll(pfds, nfds, 0) < 0)) {
+		error("stepd registry poll: %m");
+		nfds = 0;
+	}
+
+	l = list_create((ListDelF) _free_step_loc_t);
+	list_iterator_reset(iter);
+	while ((reg = list_next(iter))) {
+		if ((reg->fd >= 0) && (i < nfds) && pfds[i++].revents) {
+			debug3("slurmstepd for step %u.%u has exited",
+			       reg->jobid, reg->stepid);
+			list_delete_item(iter);
+			continue;
+		}
+		loc = xmalloc(sizeof(step_loc_t));
+		loc->directory = xstrdup(step_reg_dir);
+		loc->nodename = xstrdup(step_reg_node);
+		loc->jobid = reg->jobid;
+		loc->stepid = reg->stepid;
+		list_append(l, (void *)loc);
+	}
+	list_iterator_destroy(iter);
+	xfree(pfds);
+	return l;
+}
+
 static bool
 _slurm_authorized_user()
 {
@@ -147,11 +283,15 @@ _step_connect(const char *directory, const char *nodename,
 	len = strlen(addr.sun_path)+1 + sizeof(addr.sun_family);
 
 	if (connect(fd, (struct sockaddr *) &addr, len) < 0) {
+		int err = errno;
+
 		if (errno == ECONNREFUSED) {
 			_handle_stray_socket(name);
 		} else {
 			debug("_step_connect: connect: %m");
 		}
+		_step_reg_connect_failed(directory, nodename,
+					 jobid, stepid, err);
 		xfree(name);
 		close(fd);
 		return -1;
@@ -443,18 +583,23 @@ rwfail:
  */
 int
 stepd_attach(int fd, slurm_addr_t *ioaddr, slurm_addr_t *respaddr,
-	     void *job_cred_sig, reattach_tasks_response_msg_t *resp)
+	     void *job_cred_sig, uint32_t io_frame_len,
+	     reattach_tasks_response_msg_t *resp)
 {
-	int req = REQUEST_ATTACH;
+	int req = io_frame_len ? REQUEST_ATTACH_FRAMED : REQUEST_ATTACH;
 	int rc = SLURM_SUCCESS;
+	bool replied = false;
 
 	safe_write(fd, &req, sizeof(int));
 	safe_write(fd, ioaddr, sizeof(slurm_addr_t));
 	safe_write(fd, respaddr, sizeof(slurm_addr_t));
 	safe_write(fd, job_cred_sig, SLURM_IO_KEY_SIZE);
+	if (io_frame_len)
+		safe_write(fd, &io_frame_len, sizeof(uint32_t));
 
 	/* Receive the return code */
 	safe_read(fd, &rc, sizeof(int));
+	replied = true;
 
 	if (rc == SLURM_SUCCESS) {
 		/* Receive response info */
@@ -482,6 +627,9 @@ stepd_attach(int fd, slurm_addr_t *ioaddr, slurm_addr_t *respaddr,
 
 	return rc;
 rwfail:
+	/* An older slurmstepd closes the connection on REQUEST_ATTACH_FRAMED */
+	if (io_frame_len && !replied)
+		return SLURM_PROTOCOL_VERSION_ERROR;
 	return SLURM_ERROR;
 }
 
@@ -555,10 +703,6 @@ List
 stepd_available(const char *directory, const char *nodename)
 {
 	List l;
-	DIR *dp;
-	struct dirent *ent;
-	regex_t re;
-	struct stat stat_buf;
 
 	if (nodename == NULL) {
 		if (!(nodename = _guess_nodename()))
@@ -573,6 +717,27 @@ stepd_available(const char *directory, const char *nodename)
 		slurm_conf_unlock();
 	}
 
+	slurm_mutex_lock(&step_reg_lock);
+	if (_step_reg_active(directory, nodename)) {
+		l = _step_reg_available();
+		slurm_mutex_unlock(&step_reg_lock);
+		return l;
+	}
+	slurm_mutex_unlock(&step_reg_lock);
+
+	return _scan_available(directory, nodename);
+}
+
+/* Scan "directory" for the sockets of slurmstepds of "nodename" */
+static List
+_scan_available(const char *directory, const char *nodename)
+{
+	List l;
+	DIR *dp;
+	struct dirent *ent;
+	regex_t re;
+	struct stat stat_buf;
+
 	l = list_create((ListDelF) _free_step_loc_t);
 	if(_sockname_regex_init(&re, nodename) == -1)
 		goto done;
@@ -614,6 +779,85 @@ done:
 	return l;
 }
 
+/*
+ * Start tracking the slurmstepds of "directory" and "nodename" in memory,
+ * beginning with those found by one scan of "directory". Afterwards
+ * stepd_available() answers from the registry for that directory and
+ * nodename, so every slurmstepd started must be passed to
+ * stepd_registry_add(). Used by the slurmd.
+ */
+extern void
+stepd_registry_init(const char *directory, const char *nodename)
+{
+	List l;
+	step_loc_t *loc;
+	step_reg_t *reg;
+
+	slurm_mutex_lock(&step_reg_lock);
+	if (step_reg_list) {
+		slurm_mutex_unlock(&step_reg_lock);
+		return;
+	}
+	step_reg_list = list_create(_step_reg_free);
+	step_reg_dir = xstrdup(directory);
+	step_reg_node = xstrdup(nodename);
+
+	l = _scan_available(directory, nodename);
+	while ((loc = list_pop(l))) {
+		reg = xmalloc(sizeof(step_reg_t));
+		reg->jobid = loc->jobid;
+		reg->stepid = loc->stepid;
+		reg->fd = -1;
+		list_append(step_reg_list, reg);
+		_free_step_loc_t(loc);
+	}
+	list_destroy(l);
+	debug2("stepd registry started with %d steps",
+	       list_count(step_reg_list));
+	slurm_mutex_unlock(&step_reg_lock);
+}
+
+/*
+ * Record a newly started slurmstepd. "fd" is the read end of a pipe the
+ * slurmstepd holds open until it exits, or -1. The registry takes
+ * ownership of fd.
+ */
+extern void
+stepd_registry_add(uint32_t jobid, uint32_t stepid, int fd)
+{
+	step_reg_t *reg;
+
+	slurm_mutex_lock(&step_reg_lock);
+	if (step_reg_list == NULL) {
+		slurm_mutex_unlock(&step_reg_lock);
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+	reg = xmalloc(sizeof(step_reg_t));
+	reg->jobid = jobid;
+	reg->stepid = stepid;
+	reg->fd = fd;
+	if (fd >= 0)
+		fd_set_close_on_exec(fd);
+	list_delete_all(step_reg_list, _step_reg_match, reg);
+	list_append(step_reg_list, reg);
+	slurm_mutex_unlock(&step_reg_lock);
+}
+
+extern void
+stepd_registry_fini(void)
+{
+	slurm_mutex_lock(&step_reg_lock);
+	if (step_reg_list) {
+		list_destroy(step_reg_list);
+		step_reg_list = NULL;
+	}
+	xfree(step_reg_dir);
+	xfree(step_reg_node);
+	slurm_mutex_unlock(&step_reg_lock);
+}
+
 /*
  * Send the termination signal to all of the unix domain socket files
  * for a given directory and nodename, and then unlink the files.
@@ -74,6 +74,8 @@ typedef enum {
 	REQUEST_STEP_LIST_PIDS,
 	REQUEST_STEP_RECONFIGURE,
 	REQUEST_STEP_STAT,
+	REQUEST_ATTACH_FRAMED,	/* REQUEST_ATTACH plus io_frame_len, must
+				 * follow all requests older stepds know */
 } step_msg_t;
 
 typedef enum {
@@ -169,12 +171,18 @@ int stepd_signal_container(int fd, int signal);
  * On success returns SLURM_SUCCESS and fills in resp->local_pids,
  * resp->gtids, resp->ntasks, and resp->executable.
  *
+ * A non-zero io_frame_len is sent with REQUEST_ATTACH_FRAMED. A slurmstepd
+ * predating that request closes the connection without a reply and
+ * SLURM_PROTOCOL_VERSION_ERROR is returned; reconnect and retry with an
+ * io_frame_len of zero to attach with REQUEST_ATTACH and 1KB frames.
+ *
  * FIXME - The pid/gtid info returned in the "resp" parameter should
  *         probably be moved into a more generic stepd_api call so that
  *         this header does not need to include slurm_protocol_defs.h.
  */
 int stepd_attach(int fd, slurm_addr_t *ioaddr, slurm_addr_t *respaddr,
-		 void *job_cred_sig, reattach_tasks_response_msg_t *resp);
+		 void *job_cred_sig, uint32_t io_frame_len,
+		 reattach_tasks_response_msg_t *resp);
 
 /*
  * Scan for available running slurm step daemons by checking
@@ -189,6 +197,17 @@ int stepd_attach(int fd, slurm_addr_t *ioaddr, slurm_addr_t *respaddr,
  */
 List stepd_available(const char *directory, const char *nodename);
 
+/*
+ * Keep the slurmstepds of "directory" and "nodename" in an in-memory
+ * registry, so stepd_available() no longer scans the directory for them.
+ * Each slurmstepd started afterwards must be added with
+ * stepd_registry_add(), where "fd" is the read end of a pipe which the
+ * slurmstepd holds open until it exits (or -1). Used by the slurmd.
+ */
+extern void stepd_registry_init(const char *directory, const char *nodename);
+extern void stepd_registry_add(uint32_t jobid, uint32_t stepid, int fd);
+extern void stepd_registry_fini(void);
+
 /*
  * Return true if the process with process ID "pid" is found in
  * the proctrack container of the slurmstepd "step".
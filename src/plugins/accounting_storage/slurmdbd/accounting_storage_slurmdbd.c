@@ -292,8 +292,10 @@ static void *_set_db_inx_thread(void *no_data)
 				itr = list_iterator_create(got_msg->my_list);
 				while ((id_ptr = list_next(itr))) {
 					if ((job_ptr = find_job_record(
-						     id_ptr->job_id)))
+						     id_ptr->job_id))) {
 						job_ptr->db_index = id_ptr->id;
+						job_record_changed(job_ptr);
+					}
 				}
 				list_iterator_destroy(itr);
 				unlock_slurmctld(job_write_lock);
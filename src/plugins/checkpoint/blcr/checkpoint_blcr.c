@@ -70,6 +70,7 @@
 #include "src/common/xmalloc.h"
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/acct_policy.h"
+#include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmd/slurmstepd/slurmstepd_job.h"
@@ -585,8 +586,10 @@ static void _requeue_when_finished(uint32_t job_id)
 		job_ptr = find_job_record(job_id);
 		if (IS_JOB_FINISHED(job_ptr)) {
 			job_ptr->job_state = JOB_PENDING;
+			pend_queue_add(job_ptr);
 			job_ptr->details->submit_time = time(NULL);
 			job_ptr->restart_cnt++;
+			job_record_changed(job_ptr);
 			/* Since the job completion logger
 			 * removes the submit we need to add it again. */
 			acct_policy_add_job_submit(job_ptr);
@@ -41,6 +41,8 @@
 
 #include <fcntl.h>
 #include <signal.h>
+#include <stdlib.h>
+#include <sys/resource.h>
 #include "src/common/slurm_xlator.h"
 #include "src/common/jobacct_common.h"
 #include "src/common/slurm_protocol_api.h"
@@ -112,6 +114,19 @@ typedef struct prec {	/* process record */
 	int	vsize;	/* virtual size */
 } prec_t;
 
+/* /proc/<pid>/stat file of a process in the step's container, kept open
+ * between polls so it can be read again with pread() */
+typedef struct stat_file {
+	pid_t	pid;
+	int	fd;	/* -1 if not held open */
+	bool	lwp;	/* thread of another process, not accounted */
+} stat_file_t;
+
+/* Most /proc/<pid>/stat files held open, others are opened each poll.
+ * Also limited to a quarter of RLIMIT_NOFILE, leaving the rest to the
+ * step's stdio and other connections */
+#define STAT_FILE_MAX_OPEN 512
+
 static int freq = 0;
 static DIR  *slash_proc = NULL;
 static pthread_mutex_t reading_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -120,61 +135,212 @@ static bool jobacct_suspended = 0;
 static List task_list = NULL;
 static uint64_t cont_id = (uint64_t)NO_VAL;
 static bool pgid_plugin = false;
+static stat_file_t *stat_files = NULL;	/* sorted by pid */
+static int stat_file_cnt = 0, stat_file_open = 0;
+static int stat_file_max_open = STAT_FILE_MAX_OPEN;
+static int page_kb = 0;
 
 /* Finally, pre-define all local routines. */
 
 static void _acct_kill_step(void);
-static void _destroy_prec(void *object);
 static int  _is_a_lwp(uint32_t pid);
-static void _get_offspring_data(List prec_list, prec_t *ancestor, pid_t pid);
+static void _get_offspring_data(prec_t *precs, int nprecs, prec_t *totals);
 static void _get_process_data(void);
-static int  _get_process_data_line(int in, prec_t *prec);
+static int  _get_process_data_line(char *sbuf, prec_t *prec);
 static void *_watch_tasks(void *arg);
 
+static int _cmp_prec_pid(const void *x, const void *y)
+{
+	const prec_t *prec1 = x, *prec2 = y;
+
+	if (prec1->pid < prec2->pid)
+		return -1;
+	if (prec1->pid > prec2->pid)
+		return 1;
+	return 0;
+}
+
+static prec_t *_find_prec(prec_t *precs, int nprecs, pid_t pid)
+{
+	prec_t key;
+
+	key.pid = pid;
+	return bsearch(&key, precs, nprecs, sizeof(prec_t), _cmp_prec_pid);
+}
+
 /*
- * _get_offspring_data() -- collect memory usage data for the offspring
- *
- * For each process that lists <pid> as its parent, add its memory
- * usage data to the ancestor's <prec> record. Recurse to gather data
- * for *all* subsequent generations.
+ * _get_offspring_data() -- collect usage data for every process's offspring
  *
- * IN:	prec_list       list of prec's
- *      ancestor	The entry in precTable[] to which the data
- * 			should be added. Even as we recurse, this will
- * 			always be the prec for the base of the family
- * 			tree.
- * 	pid		The process for which we are currently looking
- * 			for offspring.
+ * Each process's own usage is added to its entry in <totals> and to the
+ * entries of all of its ancestors, found by following parent pids.
  *
- * OUT:	none.
+ * IN:	precs		process records, sorted by pid
+ *	nprecs		number of process records
+ * OUT:	totals		parallel to precs, the usage of each process plus
+ *			that of *all* subsequent generations
  *
  * RETVAL:	none.
  *
  * THREADSAFE! Only one thread ever gets here.
  */
-static void
-_get_offspring_data(List prec_list, prec_t *ancestor, pid_t pid) {
-
-	ListIterator itr;
-	prec_t *prec = NULL;
-
-	itr = list_iterator_create(prec_list);
-	while((prec = list_next(itr))) {
-		if (prec->ppid == pid) {
+static void _get_offspring_data(prec_t *precs, int nprecs, prec_t *totals)
+{
+	prec_t *prec, *ancestor, *total;
+	int i, depth;
+
+	memcpy(totals, precs, sizeof(prec_t) * nprecs);
+	for (i = 0; i < nprecs; i++) {
+		prec = &precs[i];
+		ancestor = prec;
+		/* depth limit protects against a parent loop from pid reuse
+		 * while the records were read */
+		for (depth = 0; depth < nprecs; depth++) {
+			if ((ancestor->ppid == ancestor->pid) ||
+			    !(ancestor = _find_prec(precs, nprecs,
+						    ancestor->ppid)))
+				break;
 #if _DEBUG
 			info("pid:%u ppid:%u rss:%d KB",
 			     prec->pid, prec->ppid, prec->rss);
 #endif
-			_get_offspring_data(prec_list, ancestor, prec->pid);
-			ancestor->usec += prec->usec;
-			ancestor->ssec += prec->ssec;
-			ancestor->pages += prec->pages;
-			ancestor->rss += prec->rss;
-			ancestor->vsize += prec->vsize;
+			total = &totals[ancestor - precs];
+			total->usec  += prec->usec;
+			total->ssec  += prec->ssec;
+			total->pages += prec->pages;
+			total->rss   += prec->rss;
+			total->vsize += prec->vsize;
 		}
 	}
-	list_iterator_destroy(itr);
-	return;
+}
+
+static int _cmp_pid(const void *x, const void *y)
+{
+	pid_t pid1 = *(const pid_t *) x, pid2 = *(const pid_t *) y;
+
+	if (pid1 < pid2)
+		return -1;
+	if (pid1 > pid2)
+		return 1;
+	return 0;
+}
+
+/* Open a /proc file to be closed on exec() of user tasks */
+static int _proc_file_open(char *file_name)
+{
+	int fd;
+
+#ifdef O_CLOEXEC
+	fd = open(file_name, O_RDONLY | O_CLOEXEC);
+#else
+	/*
+	 * NOTE: If we fork() slurmstepd after the open() below and before
+	 * the fcntl(), then the user task may have this extra file open,
+	 * which can cause problems for checkpoint/restart, but this should
+	 * be a very rare problem in practice.
+	 */
+	if ((fd = open(file_name, O_RDONLY)) != -1)
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+	return fd;
+}
+
+static void _stat_file_open(stat_file_t *stat_file)
+{
+	char proc_stat_file[256];	/* Allow ~20x extra length */
+
+	stat_file->fd = -1;
+	if (stat_file_open >= stat_file_max_open)
+		return;
+	snprintf(proc_stat_file, 256, "/proc/%d/stat", stat_file->pid);
+	if ((stat_file->fd = _proc_file_open(proc_stat_file)) == -1)
+		return;  /* Assume the process went away */
+	stat_file_open++;
+}
+
+static void _stat_file_close(stat_file_t *stat_file)
+{
+	if (stat_file->fd == -1)
+		return;
+	close(stat_file->fd);
+	stat_file->fd = -1;
+	stat_file_open--;
+}
+
+/* Read /proc/<pid>/stat into sbuf, from the file held open if possible.
+ * RET bytes read, zero if the process went away */
+static int _stat_file_read(stat_file_t *stat_file, char *sbuf, int size)
+{
+	char proc_stat_file[256];	/* Allow ~20x extra length */
+	int fd, num_read = 0, retry;
+
+	for (retry = 0; retry < 2; retry++) {
+		if (stat_file->fd != -1) {
+			num_read = pread(stat_file->fd, sbuf, size, 0);
+			if (num_read > 0)
+				return num_read;
+			/* Exited, or the pid is now another process */
+			_stat_file_close(stat_file);
+			_stat_file_open(stat_file);
+			continue;
+		}
+		snprintf(proc_stat_file, 256, "/proc/%d/stat", stat_file->pid);
+		if ((fd = _proc_file_open(proc_stat_file)) == -1)
+			return 0;
+		num_read = read(fd, sbuf, size);
+		close(fd);
+		return MAX(num_read, 0);
+	}
+	return 0;
+}
+
+/*
+ * _update_stat_files() - Hold open the /proc/<pid>/stat files of the
+ *	container's processes, closing those of processes no longer in it
+ *
+ * IN:	pids - processes now in the container, sorted by pid in place
+ */
+static void _update_stat_files(pid_t *pids, int npids)
+{
+	stat_file_t *new_files;
+	int i = 0, j = 0, cnt = 0;
+
+	qsort(pids, npids, sizeof(pid_t), _cmp_pid);
+	new_files = xmalloc(sizeof(stat_file_t) * MAX(npids, 1));
+	while ((i < stat_file_cnt) || (j < npids)) {
+		if ((j > 0) && (j < npids) && (pids[j] == pids[j - 1])) {
+			j++;	/* duplicate pid */
+		} else if ((j >= npids) ||
+			   ((i < stat_file_cnt) &&
+			    (stat_files[i].pid < pids[j]))) {
+			_stat_file_close(&stat_files[i++]);
+		} else if ((i < stat_file_cnt) &&
+			   (stat_files[i].pid == pids[j])) {
+			new_files[cnt++] = stat_files[i++];
+			j++;
+		} else {
+			new_files[cnt].pid = pids[j++];
+			/* Is it a Light Weight Process (Thread POSIX)? */
+			new_files[cnt].lwp = (_is_a_lwp(new_files[cnt].pid) > 0);
+			if (new_files[cnt].lwp)
+				new_files[cnt].fd = -1;
+			else
+				_stat_file_open(&new_files[cnt]);
+			cnt++;
+		}
+	}
+	xfree(stat_files);
+	stat_files = new_files;
+	stat_file_cnt = cnt;
+}
+
+static void _close_stat_files(void)
+{
+	int i;
+
+	for (i = 0; i < stat_file_cnt; i++)
+		_stat_file_close(&stat_files[i]);
+	xfree(stat_files);
+	stat_file_cnt = 0;
 }
 
 /*
@@ -197,16 +363,15 @@ static void _get_process_data(void)
 
 	struct	dirent *slash_proc_entry;
 	char		*iptr = NULL, *optr = NULL;
-	FILE		*stat_fp = NULL;
 	char		proc_stat_file[256];	/* Allow ~20x extra length */
-	List prec_list = NULL;
+	char		sbuf[1024];
+	prec_t *precs = NULL, *totals = NULL, *prec;
+	int nprecs = 0, max_precs = 0;
 	pid_t *pids = NULL;
 	int npids = 0;
 	uint32_t total_job_mem = 0, total_job_vsize = 0;
-	int		i, fd;
+	int		i, fd, num_read;
 	ListIterator itr;
-	ListIterator itr2;
-	prec_t *prec = NULL;
 	struct jobacctinfo *jobacct = NULL;
 	static int processing = 0;
 	long		hertz;
@@ -221,13 +386,14 @@ static void _get_process_data(void)
 		return;
 	}
 	processing = 1;
-	prec_list = list_create(_destroy_prec);
 
 	hertz = sysconf(_SC_CLK_TCK);
 	if (hertz < 1) {
 		error ("_get_process_data: unable to get clock rate");
 		hertz = 100;	/* default on many systems */
 	}
+	if (page_kb == 0)
+		page_kb = getpagesize() / 1024;
 
 	if(!pgid_plugin) {
 		/* get only the processes in the proctrack container */
@@ -236,31 +402,21 @@ static void _get_process_data(void)
 			debug4("no pids in this container %"PRIu64"", cont_id);
 			goto finished;
 		}
-		for (i = 0; i < npids; i++) {
-			snprintf(proc_stat_file, 256,
-				 "/proc/%d/stat", pids[i]);
-			if ((stat_fp = fopen(proc_stat_file, "r"))==NULL)
-				continue;  /* Assume the process went away */
-			/*
-			 * Close the file on exec() of user tasks.
-			 *
-			 * NOTE: If we fork() slurmstepd after the
-			 * fopen() above and before the fcntl() below,
-			 * then the user task may have this extra file
-			 * open, which can cause problems for
-			 * checkpoint/restart, but this should be a very rare
-			 * problem in practice.
-			 */
-			fd = fileno(stat_fp);
-			fcntl(fd, F_SETFD, FD_CLOEXEC);
-
-			prec = xmalloc(sizeof(prec_t));
-			if (_get_process_data_line(fd, prec))
-				list_append(prec_list, prec);
-			else
-				xfree(prec);
-			fclose(stat_fp);
+		slurm_mutex_lock(&reading_mutex);
+		_update_stat_files(pids, npids);
+		precs = xmalloc(sizeof(prec_t) * stat_file_cnt);
+		for (i = 0; i < stat_file_cnt; i++) {
+			if (stat_files[i].lwp)
+				continue;
+			num_read = _stat_file_read(&stat_files[i], sbuf,
+						   (sizeof(sbuf) - 1));
+			if (num_read <= 0)
+				continue;
+			sbuf[num_read] = '\0';
+			if (_get_process_data_line(sbuf, &precs[nprecs]))
+				nprecs++;
 		}
+		slurm_mutex_unlock(&reading_mutex);
 	} else {
 		slurm_mutex_lock(&reading_mutex);
 
@@ -305,36 +461,36 @@ static void _get_process_data(void)
 			} while (*iptr);
 			*optr = 0;
 
-			if ((stat_fp = fopen(proc_stat_file,"r"))==NULL)
+			if ((fd = _proc_file_open(proc_stat_file)) == -1)
 				continue;  /* Assume the process went away */
-			/*
-			 * Close the file on exec() of user tasks.
-			 *
-			 * NOTE: If we fork() slurmstepd after the
-			 * fopen() above and before the fcntl() below,
-			 * then the user task may have this extra file
-			 * open, which can cause problems for
-			 * checkpoint/restart, but this should be a very rare
-			 * problem in practice.
-			 */
-			fd = fileno(stat_fp);
-			fcntl(fd, F_SETFD, FD_CLOEXEC);
-
-			prec = xmalloc(sizeof(prec_t));
-			if (_get_process_data_line(fd, prec))
-				list_append(prec_list, prec);
-			else
-				xfree(prec);
-			fclose(stat_fp);
+			num_read = read(fd, sbuf, (sizeof(sbuf) - 1));
+			close(fd);
+			if (num_read <= 0)
+				continue;
+			sbuf[num_read] = '\0';
+
+			if (nprecs >= max_precs) {
+				max_precs = MAX(max_precs * 2, 256);
+				xrealloc(precs, sizeof(prec_t) * max_precs);
+			}
+			/* readdir() of /proc lists no Light Weight
+			 * Processes, so there is no need to check */
+			if (_get_process_data_line(sbuf, &precs[nprecs]))
+				nprecs++;
 		}
 		slurm_mutex_unlock(&reading_mutex);
 
+		qsort(precs, nprecs, sizeof(prec_t), _cmp_prec_pid);
 	}
 
-	if (!list_count(prec_list)) {
+	if (!nprecs) {
 		goto finished;	/* We have no business being here! */
 	}
 
+	/* find all descendents of every process and tally their usage */
+	totals = xmalloc(sizeof(prec_t) * nprecs);
+	_get_offspring_data(precs, nprecs, totals);
+
 	slurm_mutex_lock(&jobacct_lock);
 	if(!task_list || !list_count(task_list)) {
 		slurm_mutex_unlock(&jobacct_lock);
@@ -343,37 +499,29 @@ static void _get_process_data(void)
 
 	itr = list_iterator_create(task_list);
 	while((jobacct = list_next(itr))) {
-		itr2 = list_iterator_create(prec_list);
-		while((prec = list_next(itr2))) {
-			if (prec->pid == jobacct->pid) {
+		if (!(prec = _find_prec(precs, nprecs, jobacct->pid)))
+			continue;
+		prec = &totals[prec - precs];
 #if _DEBUG
-				info("pid:%u ppid:%u rss:%d KB",
-				     prec->pid, prec->ppid, prec->rss);
+		info("pid:%u ppid:%u rss:%d KB",
+		     prec->pid, prec->ppid, prec->rss);
 #endif
-				/* find all my descendents */
-				_get_offspring_data(prec_list,
-						    prec, prec->pid);
-				/* tally their usage */
-				jobacct->max_rss = jobacct->tot_rss =
-					MAX(jobacct->max_rss, prec->rss);
-				total_job_mem += prec->rss;
-				jobacct->max_vsize = jobacct->tot_vsize =
-					MAX(jobacct->max_vsize, prec->vsize);
-				total_job_vsize += prec->vsize;
-				jobacct->max_pages = jobacct->tot_pages =
-					MAX(jobacct->max_pages, prec->pages);
-				jobacct->min_cpu = jobacct->tot_cpu =
-					MAX(jobacct->min_cpu,
-					    (prec->ssec / hertz +
-					     prec->usec / hertz));
-				debug2("%d mem size %u %u time %u(%u+%u)",
-				       jobacct->pid, jobacct->max_rss,
-				       jobacct->max_vsize, jobacct->tot_cpu,
-				       prec->usec, prec->ssec);
-				break;
-			}
-		}
-		list_iterator_destroy(itr2);
+		jobacct->max_rss = jobacct->tot_rss =
+			MAX(jobacct->max_rss, prec->rss);
+		total_job_mem += prec->rss;
+		jobacct->max_vsize = jobacct->tot_vsize =
+			MAX(jobacct->max_vsize, prec->vsize);
+		total_job_vsize += prec->vsize;
+		jobacct->max_pages = jobacct->tot_pages =
+			MAX(jobacct->max_pages, prec->pages);
+		jobacct->min_cpu = jobacct->tot_cpu =
+			MAX(jobacct->min_cpu,
+			    (prec->ssec / hertz +
+			     prec->usec / hertz));
+		debug2("%d mem size %u %u time %u(%u+%u)",
+		       jobacct->pid, jobacct->max_rss,
+		       jobacct->max_vsize, jobacct->tot_cpu,
+		       prec->usec, prec->ssec);
 	}
 	list_iterator_destroy(itr);
 	slurm_mutex_unlock(&jobacct_lock);
@@ -414,7 +562,9 @@ static void _get_process_data(void)
 	}
 
 finished:
-	list_destroy(prec_list);
+	xfree(pids);
+	xfree(precs);
+	xfree(totals);
 	processing = 0;
 	return;
 }
@@ -491,65 +641,79 @@ static int _is_a_lwp(uint32_t pid) {
 
 }
 
-/* _get_process_data_line() - get line of data from /proc/<pid>/stat
+/* _get_process_data_line() - parse a line of data from /proc/<pid>/stat
  *
- * IN:	in - input file descriptor
+ * IN:	sbuf - NUL terminated contents of the file
  * OUT:	prec - the destination for the data
  *
  * RETVAL:	==0 - no valid data
  * 		!=0 - data are valid
  *
- * Based upon stat2proc() from the ps command. It can handle arbitrary executable
- * file basenames for `cmd', i.e. those with embedded whitespace or embedded ')'s.
- * Such names confuse %s (see scanf(3)), so the string is split and %39c is used
- * instead. (except for embedded ')' "(%[^)]c)" would work.
+ * The line is "pid (cmd) state ppid ..." with one space between fields.
+ * The executable file basename `cmd' may hold whitespace and ')'s, so the
+ * remaining fields are counted from the last ')'. Only the fields slurm
+ * records are converted.
  */
-static int _get_process_data_line(int in, prec_t *prec) {
-	char sbuf[256], *tmp;
-	int num_read, nvals;
-	char cmd[40], state[1];
-	int ppid, pgrp, session, tty_nr, tpgid;
-	long unsigned flags, minflt, cminflt, majflt, cmajflt;
-	long unsigned utime, stime, starttime, vsize;
-	long int cutime, cstime, priority, nice, timeout, itrealvalue, rss;
-
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
-	if (num_read <= 0)
+static int _get_process_data_line(char *sbuf, prec_t *prec) {
+	char *ptr, *end;
+	unsigned long val, ppid = 0, majflt = 0, utime = 0, stime = 0;
+	unsigned long vsize = 0;
+	long rss = 0;
+	int field;
+
+	prec->pid = strtol(sbuf, &end, 10);
+	if ((end == sbuf) || (*end != ' '))
 		return 0;
-	sbuf[num_read] = '\0';
-
-	tmp = strrchr(sbuf, ')');	/* split into "PID (cmd" and "<rest>" */
-	*tmp = '\0';			/* replace trailing ')' with NUL */
-	/* parse these two strings separately, skipping the leading "(". */
-	nvals = sscanf(sbuf, "%d (%39c", &prec->pid, cmd);
-	if (nvals < 2)
+	if (!(ptr = strrchr(end, ')')) || (ptr[1] != ' '))
 		return 0;
-
-	nvals = sscanf(tmp + 2,		/* skip space after ')' too */
-		"%c %d %d %d %d %d "
-		"%lu %lu %lu %lu %lu "
-		"%lu %lu %ld %ld %ld %ld "
-		"%ld %ld %lu %lu %ld",
-		state, &ppid, &pgrp, &session, &tty_nr, &tpgid,
-		&flags, &minflt, &cminflt, &majflt, &cmajflt,
-		&utime, &stime, &cutime, &cstime, &priority, &nice,
-		&timeout, &itrealvalue, &starttime, &vsize, &rss);
+	ptr += 2;			/* skip space after ')' too */
+
+	/* fields counted from one, state is field three */
+	for (field = 3; field <= 24; field++) {
+		if (*ptr == '\0')
+			return 0;
+		switch (field) {
+		case 4:		/* ppid */
+		case 12:	/* majflt */
+		case 14:	/* utime */
+		case 15:	/* stime */
+		case 23:	/* vsize */
+			val = strtoul(ptr, &end, 10);
+			if (field == 4)
+				ppid = val;
+			else if (field == 12)
+				majflt = val;
+			else if (field == 14)
+				utime = val;
+			else if (field == 15)
+				stime = val;
+			else
+				vsize = val;
+			break;
+		case 24:	/* rss */
+			rss = strtol(ptr, &end, 10);
+			break;
+		default:
+			end = strchr(ptr, ' ');
+			if (end == NULL)
+				end = ptr + strlen(ptr);
+			break;
+		}
+		if ((end == ptr) || ((*end != ' ') && (field < 24)))
+			return 0;
+		ptr = end + 1;
+	}
 	/* There are some additional fields, which we do not scan or use */
-	if ((nvals < 22) || (rss < 0))
+	if (rss < 0)
 		return 0;
 
-	/* If current pid corresponds to a Light Weight Process (Thread POSIX) */
-	/* skip it, we will only account the original process (pid==tgid) */
-	if (_is_a_lwp(prec->pid) > 0)
-  		return 0;
-
 	/* Copy the values that slurm records into our data structure */
 	prec->ppid  = ppid;
 	prec->pages = majflt;
 	prec->usec  = utime;
 	prec->ssec  = stime;
 	prec->vsize = vsize / 1024;		 /* convert from bytes to KB */
-	prec->rss   = rss * getpagesize() / 1024;/* convert from pages to KB */
+	prec->rss   = rss * page_kb;		 /* convert from pages to KB */
 	return 1;
 }
 
@@ -583,13 +747,6 @@ static void *_watch_tasks(void *arg)
 }
 
 
-static void _destroy_prec(void *object)
-{
-	prec_t *prec = (prec_t *)object;
-	xfree(prec);
-	return;
-}
-
 /*
  * init() is called when the plugin is loaded, before any other functions
  * are called.  Put global initialization here.
@@ -597,6 +754,13 @@ static void _destroy_prec(void *object)
 extern int init ( void )
 {
 	char *temp = slurm_get_proctrack_type();
+	struct rlimit rlim;
+
+	if ((getrlimit(RLIMIT_NOFILE, &rlim) == 0) &&
+	    (rlim.rlim_cur != RLIM_INFINITY) &&
+	    ((rlim.rlim_cur / 4) < STAT_FILE_MAX_OPEN))
+		stat_file_max_open = rlim.rlim_cur / 4;
+
 	if(!strcasecmp(temp, "proctrack/pgid")) {
 		info("WARNING: We will use a much slower algorithm with "
 		     "proctrack/pgid, use Proctracktype=proctrack/linuxproc "
@@ -721,6 +885,9 @@ extern int jobacct_gather_p_endpoll()
 		(void) closedir(slash_proc);
 		slurm_mutex_unlock(&reading_mutex);
 	}
+	slurm_mutex_lock(&reading_mutex);
+	_close_stat_files();
+	slurm_mutex_unlock(&reading_mutex);
 
 
 	return SLURM_SUCCESS;
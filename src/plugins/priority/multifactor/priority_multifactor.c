@@ -66,6 +66,16 @@
 
 #define SECS_PER_DAY	(24 * 60 * 60)
 #define SECS_PER_WEEK	(7 * SECS_PER_DAY)
+
+/* Usage accrued by running jobs since the last decay pass, summed per
+ * association (or QOS) so it is added to each association and its
+ * parents once rather than once per job */
+typedef struct usage_batch {
+	void *rec;			/* association or QOS record */
+	double run_decay;		/* decayed wall time */
+	long double real_decay;		/* decayed cpu time */
+	struct usage_batch *next;	/* next record in hash bucket */
+} usage_batch_t;
 /* These are defined here so when we link with something other than
  * the slurmctld we will have these symbols defined.  They will get
  * overwritten when linking with the slurmctld.
@@ -360,10 +370,11 @@ static int _write_last_decay_ran(time_t last_ran, time_t last_reset)
 
 /* This should initially get the childern list from
  * assoc_mgr_root_assoc.  Since our algorythm goes from top down we
- * calculate all the non-user associations now.  When a user submits a
- * job, that norm_fairshare is calculated.  Here we will set the
- * usage_efctv to NO_VAL for users to not have to calculate a bunch
- * of things that will never be used.
+ * calculate all the non-user associations now.  A user's usage_efctv
+ * is calculated when a job first needs it (it is NO_VAL until then) so
+ * we don't calculate a bunch of things that will never be used, after
+ * that it is kept current here so its cached fs_factor survives passes
+ * in which its usage did not change.
  *
  * NOTE: acct_mgr_association_lock must be locked before this is called.
  */
@@ -378,7 +389,8 @@ static int _set_children_usage_efctv(List childern_list)
 	itr = list_iterator_create(childern_list);
 	while ((assoc = list_next(itr))) {
 		if (assoc->user) {
-			assoc->usage->usage_efctv = (long double)NO_VAL;
+			if (!fuzzy_equal(assoc->usage->usage_efctv, NO_VAL))
+				priority_p_set_assoc_usage(assoc);
 			continue;
 		}
 		priority_p_set_assoc_usage(assoc);
@@ -390,6 +402,8 @@ static int _set_children_usage_efctv(List childern_list)
 
 /* job_ptr should already have the partition priority and such added
  * here before had we will be adding to it
+ *
+ * NOTE: acct_mgr_association_lock must be locked before this is called.
  */
 static double _get_fairshare_priority( struct job_record *job_ptr)
 {
@@ -397,8 +411,6 @@ static double _get_fairshare_priority( struct job_record *job_ptr)
 		(slurmdb_association_rec_t *)job_ptr->assoc_ptr;
 	slurmdb_association_rec_t *fs_assoc = NULL;
 	double priority_fs = 0.0;
-	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK,
-				   NO_LOCK, NO_LOCK, NO_LOCK };
 
 	if (!calc_fairshare)
 		return 0;
@@ -411,8 +423,6 @@ static double _get_fairshare_priority( struct job_record *job_ptr)
 
 	fs_assoc = job_assoc;
 
-	assoc_mgr_lock(&locks);
-
 	/* Use values from parent when FairShare=SLURMDB_FS_USE_PARENT */
 	while ((fs_assoc->shares_raw == SLURMDB_FS_USE_PARENT)
 	       && fs_assoc->usage->parent_assoc_ptr
@@ -423,10 +433,14 @@ static double _get_fairshare_priority( struct job_record *job_ptr)
 	if (fuzzy_equal(fs_assoc->usage->usage_efctv, NO_VAL))
 		priority_p_set_assoc_usage(fs_assoc);
 
-	/* Priority is 0 -> 1 */
-	priority_fs = priority_p_calc_fs_factor(
-		fs_assoc->usage->usage_efctv,
-		(long double)fs_assoc->usage->shares_norm);
+	/* Priority is 0 -> 1, shared by all jobs of the association
+	 * until its usage_efctv or shares_norm change */
+	if (fuzzy_equal(fs_assoc->usage->fs_factor, NO_VAL)) {
+		fs_assoc->usage->fs_factor = priority_p_calc_fs_factor(
+			fs_assoc->usage->usage_efctv,
+			(long double)fs_assoc->usage->shares_norm);
+	}
+	priority_fs = fs_assoc->usage->fs_factor;
 	if (priority_debug) {
 		info("Fairshare priority of job %u for user %s in acct"
 		     " %s is 2**(-%Lf/%f) = %f",
@@ -435,8 +449,6 @@ static double _get_fairshare_priority( struct job_record *job_ptr)
 		     fs_assoc->usage->shares_norm, priority_fs);
 	}
 
-	assoc_mgr_unlock(&locks);
-
 	return priority_fs;
 }
 
@@ -662,10 +674,212 @@ static time_t _next_reset(uint16_t reset_period, time_t last_reset)
 	return mktime(&last_tm);
 }
 
-static void *_decay_thread(void *no_data)
+/* Find the batched usage of rec, adding a record if there is none yet */
+static usage_batch_t *_batch_find(usage_batch_t **batch_hash, int hash_size,
+				  void *rec)
+{
+	usage_batch_t *batch;
+	int inx = ((unsigned long) rec >> 4) % hash_size;
+
+	for (batch = batch_hash[inx]; batch; batch = batch->next) {
+		if (batch->rec == rec)
+			return batch;
+	}
+	batch = xmalloc(sizeof(usage_batch_t));
+	batch->rec = rec;
+	batch->next = batch_hash[inx];
+	batch_hash[inx] = batch;
+	return batch;
+}
+
+static void _batch_free(usage_batch_t **batch_hash, int hash_size)
+{
+	usage_batch_t *batch, *next;
+	int inx;
+
+	for (inx = 0; inx < hash_size; inx++) {
+		for (batch = batch_hash[inx]; batch; batch = next) {
+			next = batch->next;
+			xfree(batch);
+		}
+	}
+	xfree(batch_hash);
+}
+
+/*
+ * Add the usage of running jobs between last_ran and start_time to their
+ * associations and QOS. Jobs are only read, so a job read lock is held
+ * while their usage is summed per association, the sums are then added
+ * up the association tree without holding any job lock.
+ */
+static void _accrue_usage(time_t last_ran, time_t start_time,
+			  double decay_factor)
 {
 	struct job_record *job_ptr = NULL;
 	ListIterator itr;
+	slurmdb_qos_rec_t *qos;
+	slurmdb_association_rec_t *assoc;
+	usage_batch_t **assoc_hash, **qos_hash, *batch;
+	int assoc_hash_size, qos_hash_size, inx;
+	slurmctld_lock_t job_read_lock =
+		{ NO_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
+	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK,
+				   WRITE_LOCK, NO_LOCK, NO_LOCK };
+
+	lock_slurmctld(job_read_lock);
+	assoc_mgr_lock(&locks);
+	assoc_hash_size = list_count(assoc_mgr_association_list) + 1;
+	assoc_hash = xmalloc(sizeof(usage_batch_t *) * assoc_hash_size);
+	qos_hash_size = list_count(assoc_mgr_qos_list) + 1;
+	qos_hash = xmalloc(sizeof(usage_batch_t *) * qos_hash_size);
+
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		time_t start_period = last_ran;
+		time_t end_period = start_time;
+		double run_decay = 0, real_decay = 0;
+		int run_delta;
+
+		if (IS_JOB_PENDING(job_ptr) ||
+		    !job_ptr->start_time || !job_ptr->assoc_ptr)
+			continue;
+
+		/* If usage_factor is 0 just skip this
+		   since we don't add the usage.
+		*/
+		qos = (slurmdb_qos_rec_t *)job_ptr->qos_ptr;
+		if (qos && !qos->usage_factor)
+			continue;
+
+		if (job_ptr->start_time > start_period)
+			start_period = job_ptr->start_time;
+
+		if (job_ptr->end_time
+		    && (end_period > job_ptr->end_time))
+			end_period = job_ptr->end_time;
+
+		run_delta = (int)end_period - (int)start_period;
+
+		/* job already has been accounted for
+		   go to next */
+		if (run_delta < 1)
+			continue;
+
+		if (priority_debug)
+			info("job %u ran for %d seconds",
+			     job_ptr->job_id, run_delta);
+
+		/* get the time in decayed fashion */
+		run_decay = run_delta * pow(decay_factor, (double)run_delta);
+
+		real_decay = run_decay * (double)job_ptr->total_cpus;
+
+		/* now apply the usage factor for this qos */
+		if (qos) {
+			if (qos->usage_factor >= 0) {
+				real_decay *= qos->usage_factor;
+				run_decay *= qos->usage_factor;
+			}
+			batch = _batch_find(qos_hash, qos_hash_size, qos);
+			batch->run_decay += run_decay;
+			batch->real_decay += (long double)real_decay;
+		}
+
+		batch = _batch_find(assoc_hash, assoc_hash_size,
+				    job_ptr->assoc_ptr);
+		batch->run_decay += run_decay;
+		batch->real_decay += (long double)real_decay;
+	}
+	list_iterator_destroy(itr);
+	unlock_slurmctld(job_read_lock);
+
+	for (inx = 0; inx < qos_hash_size; inx++) {
+		for (batch = qos_hash[inx]; batch; batch = batch->next) {
+			qos = (slurmdb_qos_rec_t *)batch->rec;
+			qos->usage->grp_used_wall += batch->run_decay;
+			qos->usage->usage_raw += batch->real_decay;
+		}
+	}
+
+	/* We want to do this all the way up to and including root.
+	   This way we can keep track of how much usage has occured on
+	   the entire system and use that to normalize against.
+	*/
+	for (inx = 0; inx < assoc_hash_size; inx++) {
+		for (batch = assoc_hash[inx]; batch; batch = batch->next) {
+			assoc = (slurmdb_association_rec_t *)batch->rec;
+			while (assoc) {
+				assoc->usage->grp_used_wall +=
+					batch->run_decay;
+				assoc->usage->usage_raw += batch->real_decay;
+				if (priority_debug)
+					info("adding %Lf new usage to "
+					     "assoc %u (user='%s' "
+					     "acct='%s') raw usage "
+					     "is now %Lf.  Group wall "
+					     "added %f making it %f.",
+					     batch->real_decay, assoc->id,
+					     assoc->user, assoc->acct,
+					     assoc->usage->usage_raw,
+					     batch->run_decay,
+					     assoc->usage->grp_used_wall);
+				assoc = assoc->usage->parent_assoc_ptr;
+			}
+		}
+	}
+	assoc_mgr_unlock(&locks);
+
+	_batch_free(assoc_hash, assoc_hash_size);
+	_batch_free(qos_hash, qos_hash_size);
+}
+
+/*
+ * Recalculate the priority of pending jobs. Fairshare factors are cached
+ * per association, so this is arithmetic on each job's own fields, and
+ * only jobs whose priority changed are updated.
+ */
+static void _set_job_priorities(time_t start_time)
+{
+	struct job_record *job_ptr = NULL;
+	ListIterator itr;
+	uint32_t new_prio;
+	int upd_cnt = 0;
+	/* Write lock on jobs, read lock on nodes and partitions */
+	slurmctld_lock_t job_write_lock =
+		{ NO_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
+	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK,
+				   NO_LOCK, NO_LOCK, NO_LOCK };
+
+	lock_slurmctld(job_write_lock);
+	assoc_mgr_lock(&locks);
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		/*
+		 * This means the job is held, 0, or a system
+		 * hold, 1. Continue also if the job is not
+		 * pending.  There is no reason to set the
+		 * priority if the job isn't pending.
+		 */
+		if ((job_ptr->priority <= 1) || !IS_JOB_PENDING(job_ptr))
+			continue;
+
+		new_prio = _get_priority_internal(start_time, job_ptr);
+		if (new_prio == job_ptr->priority)
+			continue;
+		job_ptr->priority = new_prio;
+		upd_cnt++;
+		debug2("priority for job %u is now %u",
+		       job_ptr->job_id, job_ptr->priority);
+	}
+	list_iterator_destroy(itr);
+	assoc_mgr_unlock(&locks);
+	if (upd_cnt)
+		last_job_update = time(NULL);
+	unlock_slurmctld(job_write_lock);
+}
+
+static void *_decay_thread(void *no_data)
+{
 	time_t start_time = time(NULL);
 	time_t next_time;
 /* 	int sigarray[] = {SIGUSR1, 0}; */
@@ -676,12 +890,8 @@ static void *_decay_thread(void *no_data)
 	double decay_hl = (double)slurm_get_priority_decay_hl();
 	double decay_factor = 1;
 	uint16_t reset_period = slurm_get_priority_reset_period();
-
-	/* Write lock on jobs, read lock on nodes and partitions */
-	slurmctld_lock_t job_write_lock =
-		{ NO_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
 	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK,
-				   WRITE_LOCK, NO_LOCK, NO_LOCK };
+				   NO_LOCK, NO_LOCK, NO_LOCK };
 
 	if (decay_hl > 0)
 		decay_factor = 1 - (0.693 / decay_hl);
@@ -704,6 +914,7 @@ static void *_decay_thread(void *no_data)
 		time_t now = time(NULL);
 		int run_delta = 0;
 		double real_decay = 0.0;
+		bool calc_prio = false;
 
 		slurm_mutex_lock(&decay_lock);
 		running_decay = 1;
@@ -778,133 +989,20 @@ static void *_decay_thread(void *no_data)
 			slurm_mutex_unlock(&decay_lock);
 			break;
 		}
-		lock_slurmctld(job_write_lock);
-		itr = list_iterator_create(job_list);
-		while ((job_ptr = list_next(itr))) {
-			/* apply new usage */
-			if (!IS_JOB_PENDING(job_ptr) &&
-			    job_ptr->start_time && job_ptr->assoc_ptr) {
-				slurmdb_qos_rec_t *qos;
-				slurmdb_association_rec_t *assoc;
-				time_t start_period = last_ran;
-				time_t end_period = start_time;
-				double run_decay = 0;
-				assoc_mgr_lock_t qos_read_lock =
-					{ NO_LOCK, NO_LOCK,
-					  READ_LOCK, NO_LOCK, NO_LOCK };
-
-				/* If usage_factor is 0 just skip this
-				   since we don't add the usage.
-				*/
-				assoc_mgr_lock(&qos_read_lock);
-				qos = (slurmdb_qos_rec_t *)job_ptr->qos_ptr;
-				if (qos && !qos->usage_factor) {
-					assoc_mgr_unlock(&qos_read_lock);
-					continue;
-				}
-				assoc_mgr_unlock(&qos_read_lock);
-
-				if (job_ptr->start_time > start_period)
-					start_period = job_ptr->start_time;
-
-				if (job_ptr->end_time
-				    && (end_period > job_ptr->end_time))
-					end_period = job_ptr->end_time;
-
-				run_delta = (int)end_period - (int)start_period;
-
-				/* job already has been accounted for
-				   go to next */
-				if (run_delta < 1)
-					continue;
-
-				if (priority_debug)
-					info("job %u ran for %d seconds",
-					     job_ptr->job_id, run_delta);
-
-				/* get the time in decayed fashion */
-				run_decay = run_delta
-					* pow(decay_factor, (double)run_delta);
-
-				real_decay = run_decay
-					* (double)job_ptr->total_cpus;
-
-				assoc_mgr_lock(&locks);
-				/* Just to make sure we don't make a
-				   window where the qos_ptr could of
-				   changed make sure we get it again
-				   here.
-				*/
-				qos = (slurmdb_qos_rec_t *)job_ptr->qos_ptr;
-				assoc = (slurmdb_association_rec_t *)
-					job_ptr->assoc_ptr;
-				/* now apply the usage factor for this
-				   qos */
-				if (qos) {
-					if (qos->usage_factor >= 0) {
-						real_decay *= qos->usage_factor;
-						run_decay *= qos->usage_factor;
-					}
-					qos->usage->grp_used_wall += run_decay;
-					qos->usage->usage_raw +=
-						(long double)real_decay;
-				}
-
-				/* We want to do this all the way up
-				   to and including root.  This way we
-				   can keep track of how much usage
-				   has occured on the entire system
-				   and use that to normalize against.
-				*/
-				while (assoc) {
-					assoc->usage->grp_used_wall +=
-						run_decay;
-					assoc->usage->usage_raw +=
-						(long double)real_decay;
-					if (priority_debug)
-						info("adding %f new usage to "
-						     "assoc %u (user='%s' "
-						     "acct='%s') raw usage "
-						     "is now %Lf.  Group wall "
-						     "added %f making it %f.",
-						     real_decay, assoc->id,
-						     assoc->user, assoc->acct,
-						     assoc->usage->usage_raw,
-						     run_decay,
-						     assoc->usage->
-						     grp_used_wall);
-					assoc = assoc->usage->parent_assoc_ptr;
-				}
-				assoc_mgr_unlock(&locks);
-			}
-
-			/*
-			 * This means the job is held, 0, or a system
-			 * hold, 1. Continue also if the job is not
-			 * pending.  There is no reason to set the
-			 * priority if the job isn't pending.
-			 */
-			if ((job_ptr->priority <= 1)
-			    || !IS_JOB_PENDING(job_ptr))
-				continue;
-
-			job_ptr->priority =
-				_get_priority_internal(start_time, job_ptr);
-			last_job_update = time(NULL);
-			debug2("priority for job %u is now %u",
-			       job_ptr->job_id, job_ptr->priority);
-		}
-		list_iterator_destroy(itr);
-		unlock_slurmctld(job_write_lock);
+		/* then add the usage of running jobs */
+		_accrue_usage(last_ran, start_time, decay_factor);
+		calc_prio = true;
 
 	get_usage:
 		/* now calculate all the normalized usage here */
-		locks.qos = NO_LOCK;
 		assoc_mgr_lock(&locks);
 		_set_children_usage_efctv(
 			assoc_mgr_root_assoc->usage->childern_list);
 		assoc_mgr_unlock(&locks);
-		locks.qos = WRITE_LOCK;
+
+		/* and the priorities that depend upon it */
+		if (calc_prio)
+			_set_job_priorities(start_time);
 
 		last_ran = start_time;
 
@@ -1087,7 +1185,13 @@ int fini ( void )
 
 extern uint32_t priority_p_set(uint32_t last_prio, struct job_record *job_ptr)
 {
-	uint32_t priority = _get_priority_internal(time(NULL), job_ptr);
+	uint32_t priority;
+	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK,
+				   NO_LOCK, NO_LOCK, NO_LOCK };
+
+	assoc_mgr_lock(&locks);
+	priority = _get_priority_internal(time(NULL), job_ptr);
+	assoc_mgr_unlock(&locks);
 
 	debug2("initial priority for job %u is %u", job_ptr->job_id, priority);
 
@@ -1107,6 +1211,7 @@ extern void priority_p_set_assoc_usage(slurmdb_association_rec_t *assoc)
 {
 	char *child;
 	char *child_str;
+	long double old_usage_efctv;
 
 	xassert(assoc_mgr_root_assoc);
 	xassert(assoc);
@@ -1120,6 +1225,7 @@ extern void priority_p_set_assoc_usage(slurmdb_association_rec_t *assoc)
 		child = "account";
 		child_str = assoc->acct;
 	}
+	old_usage_efctv = assoc->usage->usage_efctv;
 
 	if (assoc_mgr_root_assoc->usage->usage_raw)
 		assoc->usage->usage_norm = assoc->usage->usage_raw
@@ -1172,6 +1278,10 @@ extern void priority_p_set_assoc_usage(slurmdb_association_rec_t *assoc)
 			     assoc->usage->usage_efctv);
 		}
 	}
+
+	/* The cached fairshare factor is only good for the old value */
+	if (!fuzzy_equal(assoc->usage->usage_efctv, old_usage_efctv))
+		assoc->usage->fs_factor = (double)NO_VAL;
 }
 
 extern double priority_p_calc_fs_factor(long double usage_efctv,
@@ -52,18 +52,25 @@
 #include <unistd.h>
 #include <string.h>
 #include <limits.h>
+#include <pthread.h>
+#include <time.h>
 
 #include "slurm/slurm.h"
 #include "slurm/slurm_errno.h"
 #include "src/common/log.h"
+#include "src/common/macros.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 #include "kill_tree.h"
 
 typedef struct xpid_s {
 	pid_t pid;
+	pid_t ppid;
+	unsigned long long starttime;
 	int is_usercmd;
 	char *cmd;
+	int verified;			/* 1 valid, -1 not, 0 not checked */
+	struct xpid_s *parent;		/* NULL for children of the top */
 	struct xpid_s *next;
 } xpid_t;
 
@@ -77,31 +84,64 @@ typedef struct xppid_s {
 
 #define GET_HASH_IDX(ppid) ((ppid)%HASH_LEN)
 
-static xpid_t *_alloc_pid(pid_t pid, int is_usercmd, char *cmd, xpid_t *next)
+/*
+ * Cached copy of the /proc process table, sorted by pid. Each refresh only
+ * reads the stat file of processes which are new, which are not yet known
+ * to be user commands (a freshly forked slurmstepd child before its exec),
+ * whose parent has exited (they have been re-parented) or whose entry is
+ * older than PROC_CACHE_TTL seconds. Before a process is signalled, it
+ * and each of its ancestors up to the top of the tree are re-read and must
+ * still have the pid, parent and start time recorded, so neither a stale
+ * entry nor a recycled parent pid can redirect a signal.
+ */
+typedef struct proc_rec {
+	pid_t pid;
+	pid_t ppid;
+	char state;
+	char *cmd;
+	unsigned long long starttime;	/* stat field 22, clock ticks */
+	time_t read_time;
+} proc_rec_t;
+
+#define PROC_CACHE_TTL 30
+
+static pthread_mutex_t proc_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static proc_rec_t *proc_cache = NULL;
+static int proc_cache_cnt = 0;
+static bool proc_cache_stale = false;
+static char *myname = NULL;
+
+static xpid_t *_alloc_pid(pid_t pid, pid_t ppid,
+			  unsigned long long starttime, int is_usercmd,
+			  char *cmd, xpid_t *next)
 {
 	xpid_t *new;
 
 	new = (xpid_t *)xmalloc(sizeof(*new));
 	new->pid = pid;
+	new->ppid = ppid;
+	new->starttime = starttime;
 	new->is_usercmd = is_usercmd;
 	new->cmd = xstrdup(cmd);
 	new->next = next;
 	return new;
 }
 
-static xppid_t *_alloc_ppid(pid_t ppid, pid_t pid, int is_usercmd, char *cmd,
-			    xppid_t *next)
+static xppid_t *_alloc_ppid(pid_t ppid, pid_t pid,
+			    unsigned long long starttime, int is_usercmd,
+			    char *cmd, xppid_t *next)
 {
 	xppid_t *new;
 
 	new = xmalloc(sizeof(*new));
 	new->ppid = ppid;
-	new->list = _alloc_pid(pid, is_usercmd, cmd, NULL);
+	new->list = _alloc_pid(pid, ppid, starttime, is_usercmd, cmd, NULL);
 	new->next = next;
 	return new;
 }
 
 static void _push_to_hashtbl(pid_t ppid, pid_t pid,
+			     unsigned long long starttime,
 			     int is_usercmd, char *cmd, xppid_t **hashtbl)
 {
 	int idx;
@@ -112,13 +152,15 @@ static void _push_to_hashtbl(pid_t ppid, pid_t pid,
 	ppids = hashtbl[idx];
 	while (ppids) {
 		if (ppids->ppid == ppid) {
-			newpid = _alloc_pid(pid, is_usercmd, cmd, ppids->list);
+			newpid = _alloc_pid(pid, ppid, starttime, is_usercmd,
+					    cmd, ppids->list);
 			ppids->list = newpid;
 			return;
 		}
 		ppids = ppids->next;
 	}
-	newppid = _alloc_ppid(ppid, pid, is_usercmd, cmd, hashtbl[idx]);
+	newppid = _alloc_ppid(ppid, pid, starttime, is_usercmd, cmd,
+			      hashtbl[idx]);
 	hashtbl[idx] = newppid;
 }
 
@@ -145,26 +187,69 @@ static int get_myname(char *s)
 	return 0;
 }
 
-static xppid_t **_build_hashtbl(void)
+/* Read /proc/<pid>/stat into rec, return -1 if the process is gone */
+static int _read_proc_stat(pid_t pid, proc_rec_t *rec)
+{
+	char path[PATH_MAX], rbuf[1024], cmd[1024], *tail;
+	char state;
+	int fd, len;
+	long rpid, ppid;
+	unsigned long long starttime;
+
+	sprintf(path, "/proc/%ld/stat", (long)pid);
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return -1;
+	len = read(fd, rbuf, sizeof(rbuf) - 1);
+	close(fd);
+	if (len <= 0)
+		return -1;
+	rbuf[len] = '\0';
+	if (sscanf(rbuf, "%ld %1023s", &rpid, cmd) != 2)
+		return -1;
+	/* The command may contain spaces, fields 3 on follow its last ')' */
+	if ((tail = strrchr(rbuf, ')')) == NULL)
+		return -1;
+	if (sscanf(tail + 1, " %c %ld %*s %*s %*s %*s %*s %*s %*s %*s %*s "
+		   "%*s %*s %*s %*s %*s %*s %*s %*s %llu",
+		   &state, &ppid, &starttime) != 3)
+		return -1;
+
+	rec->pid = (pid_t)rpid;
+	rec->ppid = (pid_t)ppid;
+	rec->state = state;
+	rec->starttime = starttime;
+	xfree(rec->cmd);
+	rec->cmd = xstrdup(cmd);
+	rec->read_time = time(NULL);
+	return 0;
+}
+
+static int _cmp_pid(const void *a, const void *b)
+{
+	pid_t pid1 = *(const pid_t *)a;
+	pid_t pid2 = *(const pid_t *)b;
+
+	if (pid1 < pid2)
+		return -1;
+	return (pid1 > pid2);
+}
+
+/* Return a sorted array of the pids now listed in /proc */
+static pid_t *_read_proc_pids(int *npids)
 {
 	DIR *dir;
 	struct dirent *de;
-	char path[PATH_MAX], *endptr, *num, rbuf[1024];
-	char myname[1024], cmd[1024];
-	char state;
-	int fd;
-	long pid, ppid, ret_l;
-	xppid_t **hashtbl;
+	char *endptr, *num;
+	long ret_l;
+	pid_t *pids;
+	int cnt = 0, len = 256;
 
 	if ((dir = opendir("/proc")) == NULL) {
 		error("opendir(/proc): %m");
 		return NULL;
 	}
-	if (get_myname(myname) < 0) return NULL;
-	debug3("Myname in build_hashtbl: %s", myname);
-
-	hashtbl = (xppid_t **)xmalloc(HASH_LEN * sizeof(xppid_t *));
 
+	pids = xmalloc(sizeof(pid_t) * len);
 	slurm_seterrno(0);
 	while ((de = readdir(dir)) != NULL) {
 		num = de->d_name;
@@ -178,31 +263,113 @@ static xppid_t **_build_hashtbl(void)
 		}
 		if (endptr == NULL || *endptr != 0)
 			continue;
-		sprintf(path, "/proc/%s/stat", num);
-		if ((fd = open(path, O_RDONLY)) < 0) {
-			continue;
+		if (cnt >= len) {
+			len *= 2;
+			xrealloc(pids, sizeof(pid_t) * len);
 		}
-		if (read(fd, rbuf, 1024) <= 0) {
-			close(fd);
-			continue;
+		pids[cnt++] = (pid_t)ret_l;
+	}
+	closedir(dir);
+
+	qsort(pids, cnt, sizeof(pid_t), _cmp_pid);
+	*npids = cnt;
+	return pids;
+}
+
+/*
+ * Bring proc_cache up to date with /proc, reading only the stat files
+ * which may have changed. Call with proc_cache_lock held.
+ */
+static int _refresh_proc_cache(void)
+{
+	proc_rec_t *recs;
+	pid_t *pids, *gone;
+	int npids, ngone = 0, i, j, k;
+	time_t now = time(NULL);
+	bool full = proc_cache_stale;
+
+	if ((pids = _read_proc_pids(&npids)) == NULL)
+		return -1;
+
+	/* Merge the sorted pid list with the sorted cache */
+	recs = xmalloc(sizeof(proc_rec_t) * (npids + 1));
+	gone = xmalloc(sizeof(pid_t) * (proc_cache_cnt + 1));
+	for (i = 0, j = 0; i < npids; i++) {
+		while ((j < proc_cache_cnt) && (proc_cache[j].pid < pids[i])) {
+			gone[ngone++] = proc_cache[j].pid;
+			xfree(proc_cache[j].cmd);
+			j++;
 		}
-		if (sscanf(rbuf, "%ld %s %c %ld", &pid, cmd, &state, &ppid)
-		    != 4) {
-			close(fd);
-			continue;
+		if ((j < proc_cache_cnt) && (proc_cache[j].pid == pids[i]))
+			recs[i] = proc_cache[j++];
+		else
+			recs[i].pid = pids[i];	/* read_time == 0, new */
+	}
+	for ( ; j < proc_cache_cnt; j++) {
+		gone[ngone++] = proc_cache[j].pid;
+		xfree(proc_cache[j].cmd);
+	}
+	xfree(proc_cache);
+	xfree(pids);
+
+	/* Read what may have changed, dropping processes already gone */
+	for (i = 0, k = 0; i < npids; i++) {
+		if (full || (recs[i].read_time == 0) ||
+		    (now - recs[i].read_time >= PROC_CACHE_TTL) ||
+		    (strcmp(myname, recs[i].cmd) == 0) ||
+		    (ngone && bsearch(&recs[i].ppid, gone, ngone,
+				      sizeof(pid_t), _cmp_pid))) {
+			if (_read_proc_stat(recs[i].pid, &recs[i]) < 0) {
+				xfree(recs[i].cmd);
+				continue;
+			}
 		}
-		close(fd);
-		if (state == 'Z') {
+		recs[k++] = recs[i];
+	}
+	xfree(gone);
+
+	proc_cache = recs;
+	proc_cache_cnt = k;
+	proc_cache_stale = false;
+	return 0;
+}
+
+static xppid_t **_build_hashtbl(void)
+{
+	char name[1024];
+	xppid_t **hashtbl;
+	proc_rec_t *rec;
+	int i;
+
+	slurm_mutex_lock(&proc_cache_lock);
+	if (myname == NULL) {
+		if (get_myname(name) < 0) {
+			slurm_mutex_unlock(&proc_cache_lock);
+			return NULL;
+		}
+		myname = xstrdup(name);
+		debug3("Myname in build_hashtbl: %s", myname);
+	}
+	if (_refresh_proc_cache() < 0) {
+		slurm_mutex_unlock(&proc_cache_lock);
+		return NULL;
+	}
+
+	hashtbl = (xppid_t **)xmalloc(HASH_LEN * sizeof(xppid_t *));
+	for (i = 0; i < proc_cache_cnt; i++) {
+		rec = &proc_cache[i];
+		if (rec->state == 'Z') {
 			debug3("Defunct process skipped: command=%s state=%c "
-			       "pid=%ld ppid=%ld", cmd, state, pid, ppid);
+			       "pid=%ld ppid=%ld", rec->cmd, rec->state,
+			       (long)rec->pid, (long)rec->ppid);
 			continue;	/* Defunct, don't try to kill */
 		}
 
 		/* Record cmd for debugging purpose */
-		_push_to_hashtbl((pid_t)ppid, (pid_t)pid,
-				 strcmp(myname, cmd), cmd, hashtbl);
+		_push_to_hashtbl(rec->ppid, rec->pid, rec->starttime,
+				 strcmp(myname, rec->cmd), rec->cmd, hashtbl);
 	}
-	closedir(dir);
+	slurm_mutex_unlock(&proc_cache_lock);
 	return hashtbl;
 }
 
@@ -236,10 +403,12 @@ static void _destroy_hashtbl(xppid_t **hashtbl)
 }
 
 
-static xpid_t *_get_list(int top, xpid_t *list, xppid_t **hashtbl)
+/* Add the descendants of top to list, each linked to its parent's entry */
+static xpid_t *_get_list(int top, xpid_t *parent, xpid_t *list,
+			 xppid_t **hashtbl)
 {
 	xppid_t *ppid;
-	xpid_t *children;
+	xpid_t *children, *added, *old = list;
 
 	ppid = hashtbl[GET_HASH_IDX(top)];
 	while (ppid) {
@@ -247,16 +416,17 @@ static xpid_t *_get_list(int top, xpid_t *list, xppid_t **hashtbl)
 			children = ppid->list;
 			while (children) {
 				list = _alloc_pid(children->pid,
+						  children->ppid,
+						  children->starttime,
 						  children->is_usercmd,
 						  children->cmd,
 						  list);
+				list->parent = parent;
 				children = children->next;
 			}
-			children = ppid->list;
-			while (children) {
-				list = _get_list(children->pid, list, hashtbl);
-				children = children->next;
-			}
+			for (added = list; added != old; added = added->next)
+				list = _get_list(added->pid, added, list,
+						 hashtbl);
 			break;
 		}
 		ppid = ppid->next;
@@ -264,6 +434,47 @@ static xpid_t *_get_list(int top, xpid_t *list, xppid_t **hashtbl)
 	return list;
 }
 
+/*
+ * Return true if the process is still a live user command with the parent
+ * and start time recorded in its (possibly cached) entry, and each of its
+ * ancestors up to the top of the tree is still the process recorded too.
+ * Otherwise it has exited, become defunct or been re-parented, or it was
+ * attached to the tree through a parent pid since recycled. Any difference
+ * marks the cache for a full re-read.
+ */
+static bool _verify_proc(xpid_t *proc)
+{
+	proc_rec_t rec;
+	bool valid, same;
+
+	if (proc->verified)
+		return (proc->verified > 0);
+
+	memset(&rec, 0, sizeof(rec));
+	if (_read_proc_stat(proc->pid, &rec) < 0) {
+		valid = same = false;
+	} else {
+		valid = ((rec.ppid == proc->ppid) &&
+			 (rec.starttime == proc->starttime));
+		same = (valid && (strcmp(rec.cmd, proc->cmd) == 0));
+		/* Ancestors need only still be there, not be user commands */
+		if (proc->is_usercmd)
+			valid = (valid && (rec.state != 'Z') &&
+				 (strcmp(rec.cmd, myname) != 0));
+		xfree(rec.cmd);
+	}
+	if (valid && proc->parent && !_verify_proc(proc->parent))
+		valid = false;
+	proc->verified = valid ? 1 : -1;
+
+	if (!same) {
+		slurm_mutex_lock(&proc_cache_lock);
+		proc_cache_stale = true;
+		slurm_mutex_unlock(&proc_cache_lock);
+	}
+	return valid;
+}
+
 static int _kill_proclist(xpid_t *list, int sig)
 {
 	int rc, rc0;
@@ -271,7 +482,11 @@ static int _kill_proclist(xpid_t *list, int sig)
 	rc = 0;
 	while (list) {
 		if (list->pid > 1) {
-			if (! list->is_usercmd) {
+			if (list->is_usercmd && !_verify_proc(list)) {
+				debug2("%ld %s changed since last scan.  "
+				       "Skipped sending signal %d",
+				       (long)list->pid, list->cmd, sig);
+			} else if (! list->is_usercmd) {
 				debug2("%ld %s is not a user command.  "
 				       "Skipped sending signal %d",
 				       (long)list->pid, list->cmd, sig);
@@ -303,7 +518,7 @@ extern int kill_proc_tree(pid_t top, int sig)
 	if ((hashtbl = _build_hashtbl()) == NULL)
 		return -1;
 
-	list = _get_list(top, NULL, hashtbl);
+	list = _get_list(top, NULL, NULL, hashtbl);
 	rc = _kill_proclist(list, sig);
 	_destroy_hashtbl(hashtbl);
 	_destroy_list(list);
@@ -366,7 +581,7 @@ extern int proctrack_linuxproc_get_pids(pid_t top, pid_t **pids, int *npids)
 	if ((hashtbl = _build_hashtbl()) == NULL)
 		return SLURM_ERROR;
 
-	list = _get_list(top, NULL, hashtbl);
+	list = _get_list(top, NULL, NULL, hashtbl);
 	if (list == NULL) {
 		*pids = NULL;
 		*npids = 0;
@@ -92,12 +92,29 @@
 
 #define SLURMCTLD_THREAD_LIMIT	5
 
+/* Initial number of records in the node space table, grown as needed */
+#define NODE_SPACE_INIT_SIZE	64
+
 typedef struct node_space_map {
 	time_t begin_time;
 	time_t end_time;
 	bitstr_t *avail_bitmap;
-	int next;	/* next record, by time, zero termination */
 } node_space_map_t;
+
+/* Node availability over time. Records are contiguous and kept sorted by
+ * time, each record's end_time being the next record's begin_time, so the
+ * record covering any time can be found with a binary search. */
+typedef struct node_space {
+	node_space_map_t *rec;
+	int rec_cnt;	/* records in use */
+	int rec_size;	/* records allocated */
+} node_space_t;
+
+/* Start time planned for a pending job, set once write locks are held */
+typedef struct plan_start {
+	uint32_t job_id;
+	time_t start_time;
+} plan_start_t;
 int backfilled_jobs = 0;
 
 /*********************** local variables *********************/
@@ -111,22 +128,36 @@ static int backfill_interval = BACKFILL_INTERVAL;
 static int backfill_window = BACKFILL_WINDOW;
 static int max_backfill_job_cnt = 50;
 
+/* Jobs are planned with read locks and started with write locks */
+static slurmctld_lock_t plan_locks = {
+	READ_LOCK, READ_LOCK, READ_LOCK, READ_LOCK };
+static slurmctld_lock_t start_locks = {
+	READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK };
+
 /*********************** local functions *********************/
 static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
-			     bitstr_t *res_bitmap,
-			     node_space_map_t *node_space,
-			     int *node_space_recs);
+			     bitstr_t *res_bitmap, node_space_t *node_space);
 static int  _attempt_backfill(void);
+static bool _upgrade_locks(void);
 static bool _job_is_completing(void);
 static void _load_config(void);
 static bool _many_pending_rpcs(void);
 static bool _more_work(time_t last_backfill_time);
 static void _my_sleep(int secs);
+static int  _node_space_find(node_space_t *node_space, time_t when);
+static void _node_space_split(node_space_t *node_space, int inx,
+			      time_t when);
 static int  _num_feature_count(struct job_record *job_ptr);
+static void _plan_job_copy(struct job_record *job_ptr,
+			   struct part_record *part_ptr,
+			   struct job_record *plan_job_ptr,
+			   struct job_details *plan_details_ptr);
+static void _plan_job_free(struct job_record *plan_job_ptr);
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
-				  node_space_map_t *node_space);
+				  node_space_t *node_space);
+static void _set_plan_start(plan_start_t *plan_start, int plan_start_cnt);
 static int  _start_job(struct job_record *job_ptr, bitstr_t *avail_bitmap);
-static bool _test_resv_overlap(node_space_map_t *node_space,
+static bool _test_resv_overlap(node_space_t *node_space,
 			       bitstr_t *use_bitmap, uint32_t start_time,
 			       uint32_t end_reserve);
 static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
@@ -134,27 +165,66 @@ static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 		       uint32_t req_nodes);
 
 /* Log resource allocate table */
-static void _dump_node_space_table(node_space_map_t *node_space_ptr)
+static void _dump_node_space_table(node_space_t *node_space)
 {
-	int i = 0;
+	node_space_map_t *node_space_ptr;
 	char begin_buf[32], end_buf[32], *node_list;
+	int i;
 
 	info("=========================================");
-	while (1) {
-		slurm_make_time_str(&node_space_ptr[i].begin_time,
+	for (i = 0; i < node_space->rec_cnt; i++) {
+		node_space_ptr = &node_space->rec[i];
+		slurm_make_time_str(&node_space_ptr->begin_time,
 				    begin_buf, sizeof(begin_buf));
-		slurm_make_time_str(&node_space_ptr[i].end_time,
+		slurm_make_time_str(&node_space_ptr->end_time,
 				    end_buf, sizeof(end_buf));
-		node_list = bitmap2node_name(node_space_ptr[i].avail_bitmap);
+		node_list = bitmap2node_name(node_space_ptr->avail_bitmap);
 		info("Begin:%s End:%s Nodes:%s",
 		     begin_buf, end_buf, node_list);
 		xfree(node_list);
-		if ((i = node_space_ptr[i].next) == 0)
-			break;
 	}
 	info("=========================================");
 }
 
+/* Return the index of the first record ending after the specified time,
+ * node_space->rec_cnt if none */
+static int _node_space_find(node_space_t *node_space, time_t when)
+{
+	int lo = 0, hi = node_space->rec_cnt, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (node_space->rec[mid].end_time > when)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+/* Split record inx at the specified time, which must fall within it.
+ * The new record, covering the later part of the time, is inx + 1. */
+static void _node_space_split(node_space_t *node_space, int inx,
+			      time_t when)
+{
+	node_space_map_t *node_space_ptr;
+
+	if (node_space->rec_cnt >= node_space->rec_size) {
+		node_space->rec_size *= 2;
+		xrealloc(node_space->rec,
+			 sizeof(node_space_map_t) * node_space->rec_size);
+	}
+	node_space_ptr = &node_space->rec[inx];
+	memmove(node_space_ptr + 2, node_space_ptr + 1,
+		sizeof(node_space_map_t) * (node_space->rec_cnt - inx - 1));
+	node_space_ptr[1].begin_time = when;
+	node_space_ptr[1].end_time = node_space_ptr->end_time;
+	node_space_ptr[1].avail_bitmap =
+		bit_copy(node_space_ptr->avail_bitmap);
+	node_space_ptr->end_time = when;
+	node_space->rec_cnt++;
+}
+
 /*
  * _job_is_completing - Determine if jobs are in the process of completing.
  *	This is a variant of job_is_completing in slurmctld/job_scheduler.c.
@@ -222,8 +292,79 @@ static int _num_feature_count(struct job_record *job_ptr)
 	return rc;
 }
 
+static void _feature_rec_free(void *x)
+{
+	xfree(x);
+}
+
+/* Copy a pending job's record to plan its start on, so that the job record
+ * itself is only read while planning with read locks held. The copy's
+ * details, feature records and select_jobinfo are its own, since the
+ * select plugin's will-run test, _try_sched() and find_job_feature() change
+ * them. It has no job_resrcs, which cons_res frees before a test and a
+ * requeued job may still hold. Free with _plan_job_free(). */
+static void _plan_job_copy(struct job_record *job_ptr,
+			   struct part_record *part_ptr,
+			   struct job_record *plan_job_ptr,
+			   struct job_details *plan_details_ptr)
+{
+	struct feature_record *feat_ptr, *plan_feat_ptr;
+	ListIterator feat_iter;
+
+	memcpy(plan_job_ptr, job_ptr, sizeof(struct job_record));
+	memcpy(plan_details_ptr, job_ptr->details,
+	       sizeof(struct job_details));
+	plan_job_ptr->details = plan_details_ptr;
+	plan_job_ptr->part_ptr = part_ptr;
+	plan_job_ptr->job_resrcs = NULL;
+	plan_job_ptr->select_jobinfo =
+		select_g_select_jobinfo_copy(job_ptr->select_jobinfo);
+	if (job_ptr->details->feature_list == NULL)
+		return;
+
+	plan_details_ptr->feature_list = list_create(_feature_rec_free);
+	feat_iter = list_iterator_create(job_ptr->details->feature_list);
+	if (feat_iter == NULL)
+		fatal("list_iterator_create: malloc failure");
+	while ((feat_ptr = (struct feature_record *) list_next(feat_iter))) {
+		plan_feat_ptr = xmalloc(sizeof(struct feature_record));
+		memcpy(plan_feat_ptr, feat_ptr,
+		       sizeof(struct feature_record));
+		list_append(plan_details_ptr->feature_list, plan_feat_ptr);
+	}
+	list_iterator_destroy(feat_iter);
+}
+
+/* Free what _plan_job_copy() allocated for a copy of a job record */
+static void _plan_job_free(struct job_record *plan_job_ptr)
+{
+	free_job_resources(&plan_job_ptr->job_resrcs);
+	if (plan_job_ptr->select_jobinfo) {
+		select_g_select_jobinfo_free(plan_job_ptr->select_jobinfo);
+		plan_job_ptr->select_jobinfo = NULL;
+	}
+	if (plan_job_ptr->details && plan_job_ptr->details->feature_list) {
+		list_destroy(plan_job_ptr->details->feature_list);
+		plan_job_ptr->details->feature_list = NULL;
+	}
+}
+
+/* Set the start times planned for pending jobs
+ * NOTE: Caller must hold a job write lock */
+static void _set_plan_start(plan_start_t *plan_start, int plan_start_cnt)
+{
+	struct job_record *job_ptr;
+	int i;
+
+	for (i = 0; i < plan_start_cnt; i++) {
+		job_ptr = find_job_record(plan_start[i].job_id);
+		if (job_ptr && IS_JOB_PENDING(job_ptr))
+			job_ptr->start_time = plan_start[i].start_time;
+	}
+}
+
 /* Attempt to schedule a specific job on specific available nodes
- * IN job_ptr - job to schedule
+ * IN job_ptr - copy of the job to schedule, see _plan_job_copy()
  * IN/OUT avail_bitmap - nodes available/selected to use
  * RET SLURM_SUCCESS on success, otherwise an error code
  */
@@ -380,9 +521,6 @@ extern void *backfill_agent(void *args)
 	time_t now;
 	double wait_time;
 	static time_t last_backfill_time = 0;
-	/* Read config and partitions; Write jobs and nodes */
-	slurmctld_lock_t all_locks = {
-		READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK };
 
 	_load_config();
 	last_backfill_time = time(NULL);
@@ -402,10 +540,8 @@ extern void *backfill_agent(void *args)
 			continue;
 
 		START_TIMER;
-		lock_slurmctld(all_locks);
 		while (_attempt_backfill()) ;
 		last_backfill_time = time(NULL);
-		unlock_slurmctld(all_locks);
 		END_TIMER;
 		if (debug_flags & DEBUG_FLAG_BACKFILL)
 			info("backfill: completed, %s", TIME_STR);
@@ -417,17 +553,15 @@ extern void *backfill_agent(void *args)
  * partition state or the backfill scheduler needs to be stopped. */
 static int _yield_locks(void)
 {
-	slurmctld_lock_t all_locks = {
-		READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK };
 	time_t job_update, node_update, part_update;
 
 	job_update  = last_job_update;
 	node_update = last_node_update;
 	part_update = last_part_update;
 
-	unlock_slurmctld(all_locks);
+	unlock_slurmctld(plan_locks);
 	_my_sleep(backfill_interval);
-	lock_slurmctld(all_locks);
+	lock_slurmctld(plan_locks);
 
 	if ((last_job_update  == job_update)  &&
 	    (last_node_update == node_update) &&
@@ -438,21 +572,59 @@ static int _yield_locks(void)
 		return 1;
 }
 
+/* Exchange the planning read locks for write locks. No locks are held in
+ * between, so job records may have been changed or purged.
+ * RET true if job, node or partition state changed in between */
+static bool _upgrade_locks(void)
+{
+	time_t job_update, node_update, part_update;
+
+	job_update  = last_job_update;
+	node_update = last_node_update;
+	part_update = last_part_update;
+
+	unlock_slurmctld(plan_locks);
+	lock_slurmctld(start_locks);
+
+	if ((last_job_update  == job_update)  &&
+	    (last_node_update == node_update) &&
+	    (last_part_update == part_update))
+		return false;
+	return true;
+}
+
+/*
+ * Plan the start of pending jobs and start those which can start now.
+ *
+ * The job queue is built with the job and node write locks held, which are
+ * then downgraded to read locks for planning, including the will-run tests
+ * of the select plugin, so that RPCs only reading state are not delayed.
+ * Each pending job is planned on a copy of its record, see
+ * _plan_job_copy(), so no job record is changed while planning. Write
+ * locks are taken again to start a job and, once planning ends, to set the
+ * planned start times of pending jobs. Planning stops if any job, node or
+ * partition state changes while the locks are exchanged.
+ * RET non-zero to repeat the attempt with a new job queue
+ */
 static int _attempt_backfill(void)
 {
-	bool filter_root = false;
+	bool filter_root = false, start_locked = false;
+	bool planned = false, job_update = false;
 	List job_queue;
 	job_queue_rec_t *job_queue_rec;
 	slurmdb_qos_rec_t *qos_ptr = NULL;
-	int i, j, node_space_recs;
-	struct job_record *job_ptr;
+	int i, j;
+	struct job_record *job_ptr, *orig_job_ptr, plan_job;
+	struct job_details plan_details;
 	struct part_record *part_ptr;
+	plan_start_t *plan_start;
+	int plan_start_cnt = 0;
 	uint32_t end_time, end_reserve;
 	uint32_t time_limit, comp_time_limit, orig_time_limit;
 	uint32_t min_nodes, max_nodes, req_nodes;
 	bitstr_t *avail_bitmap = NULL, *resv_bitmap = NULL;
 	time_t now = time(NULL), sched_start, later_start, start_res;
-	node_space_map_t *node_space;
+	node_space_t node_space;
 	static int sched_timeout = 0;
 	int this_sched_timeout = 0, rc = 0;
 
@@ -464,6 +636,7 @@ static int _attempt_backfill(void)
 	}
 	this_sched_timeout = sched_timeout;
 
+	lock_slurmctld(start_locks);
 #ifdef HAVE_CRAY
 	/*
 	 * Run a Basil Inventory immediately before setting up the schedule
@@ -472,6 +645,7 @@ static int _attempt_backfill(void)
 	 */
 	if (select_g_reconfigure()) {
 		debug4("backfill: not scheduling due to ALPS");
+		unlock_slurmctld(start_locks);
 		return SLURM_SUCCESS;
 	}
 #endif
@@ -482,28 +656,43 @@ static int _attempt_backfill(void)
 	job_queue = build_job_queue(true);
 	if (list_count(job_queue) <= 1) {
 		debug("backfill: no jobs to backfill");
+		unlock_slurmctld(start_locks);
 		list_destroy(job_queue);
 		return 0;
 	}
-
-	node_space = xmalloc(sizeof(node_space_map_t) *
-			     (max_backfill_job_cnt + 3));
-	node_space[0].begin_time = sched_start;
-	node_space[0].end_time = sched_start + backfill_window;
-	node_space[0].avail_bitmap = bit_copy(avail_node_bitmap);
-	node_space[0].next = 0;
-	node_space_recs = 1;
+	sort_job_queue(job_queue);
+	downgrade_slurmctld(start_locks);
+
+	plan_start = xmalloc(sizeof(plan_start_t) * list_count(job_queue));
+	memset(&plan_job, 0, sizeof(struct job_record));
+
+	node_space.rec_size = NODE_SPACE_INIT_SIZE;
+	node_space.rec = xmalloc(sizeof(node_space_map_t) *
+				 node_space.rec_size);
+	node_space.rec[0].begin_time = sched_start;
+	node_space.rec[0].end_time = sched_start + backfill_window;
+	node_space.rec[0].avail_bitmap = bit_copy(avail_node_bitmap);
+	node_space.rec_cnt = 1;
 	if (debug_flags & DEBUG_FLAG_BACKFILL)
-		_dump_node_space_table(node_space);
-
-	while ((job_queue_rec = (job_queue_rec_t *)
-				list_pop_bottom(job_queue, sort_job_queue2))) {
-		job_ptr  = job_queue_rec->job_ptr;
+		_dump_node_space_table(&node_space);
+
+	while ((job_queue_rec = (job_queue_rec_t *) list_pop(job_queue))) {
+		if (planned) {
+			plan_start[plan_start_cnt].job_id = plan_job.job_id;
+			plan_start[plan_start_cnt++].start_time =
+				plan_job.start_time;
+			planned = false;
+		}
+		orig_job_ptr = job_queue_rec->job_ptr;
 		part_ptr = job_queue_rec->part_ptr;
 		xfree(job_queue_rec);
-		if (!IS_JOB_PENDING(job_ptr))
+		if (!IS_JOB_PENDING(orig_job_ptr))
 			continue;	/* started in other partition */
-		job_ptr->part_ptr = part_ptr;
+		_plan_job_free(&plan_job);
+		_plan_job_copy(orig_job_ptr, part_ptr, &plan_job,
+			       &plan_details);
+		job_ptr = &plan_job;
+		planned = true;
 
 		if (debug_flags & DEBUG_FLAG_BACKFILL)
 			info("backfill test for job %u", job_ptr->job_id);
@@ -526,8 +715,9 @@ static int _attempt_backfill(void)
 		if ((part_ptr->flags & PART_FLAG_ROOT_ONLY) && filter_root)
 			continue;
 
-		if ((!job_independent(job_ptr, 0)) ||
-		    (license_job_test(job_ptr, time(NULL)) != SLURM_SUCCESS))
+		/* build_job_queue() tested job_independent(), which may
+		 * change the job and so is only called again to start it */
+		if (license_job_test(job_ptr, time(NULL)) != SLURM_SUCCESS)
 			continue;
 
 		/* Determine minimum and maximum node counts */
@@ -562,7 +752,7 @@ static int _attempt_backfill(void)
 						 part_ptr->max_time);
 		}
 		comp_time_limit = time_limit;
-		orig_time_limit = job_ptr->time_limit;
+		orig_time_limit = orig_job_ptr->time_limit;
 		if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE))
 			time_limit = job_ptr->time_limit = 1;
 		else if (job_ptr->time_min && (job_ptr->time_min < time_limit))
@@ -574,10 +764,8 @@ static int _attempt_backfill(void)
 		start_res   = later_start;
 		later_start = 0;
 		j = job_test_resv(job_ptr, &start_res, true, &avail_bitmap);
-		if (j != SLURM_SUCCESS) {
-			job_ptr->time_limit = orig_time_limit;
+		if (j != SLURM_SUCCESS)
 			continue;
-		}
 		if (start_res > now)
 			end_time = (time_limit * 60) + start_res;
 		else
@@ -586,26 +774,18 @@ static int _attempt_backfill(void)
 		/* Identify usable nodes for this job */
 		bit_and(avail_bitmap, part_ptr->node_bitmap);
 		bit_and(avail_bitmap, up_node_bitmap);
-		for (j=0; ; ) {
-			if ((node_space[j].end_time > start_res) &&
-			     node_space[j].next && (later_start == 0))
-				later_start = node_space[j].end_time;
-			if (node_space[j].end_time <= start_res)
-				;
-			else if (node_space[j].begin_time <= end_time) {
-				bit_and(avail_bitmap,
-					node_space[j].avail_bitmap);
-			} else
-				break;
-			if ((j = node_space[j].next) == 0)
+		for (j = _node_space_find(&node_space, start_res);
+		     j < node_space.rec_cnt; j++) {
+			if ((later_start == 0) && (j + 1 < node_space.rec_cnt))
+				later_start = node_space.rec[j].end_time;
+			if (node_space.rec[j].begin_time > end_time)
 				break;
+			bit_and(avail_bitmap, node_space.rec[j].avail_bitmap);
 		}
 
 		if (job_ptr->details->exc_node_bitmap) {
-			bit_not(job_ptr->details->exc_node_bitmap);
-			bit_and(avail_bitmap,
-				job_ptr->details->exc_node_bitmap);
-			bit_not(job_ptr->details->exc_node_bitmap);
+			bit_and_not(avail_bitmap,
+				    job_ptr->details->exc_node_bitmap);
 		}
 
 		/* Test if insufficient nodes remain OR
@@ -620,7 +800,6 @@ static int _attempt_backfill(void)
 				job_ptr->start_time = 0;	
 				goto TRY_LATER;
 			}
-			job_ptr->time_limit = orig_time_limit;
 			continue;
 		}
 
@@ -649,45 +828,78 @@ static int _attempt_backfill(void)
 		       job_ptr->job_id);
 		now = time(NULL);
 		if (j != SLURM_SUCCESS) {
-			job_ptr->time_limit = orig_time_limit;
 			job_ptr->start_time = 0;	
 			continue;	/* not runable */
 		}
 
 		if (start_res > job_ptr->start_time) {
 			job_ptr->start_time = start_res;
-			last_job_update = now;
+			job_update = true;
 		}
 		if (job_ptr->start_time <= now) {
-			int rc = _start_job(job_ptr, resv_bitmap);
+			uint32_t job_id = job_ptr->job_id;
+			time_t part_update = last_part_update;
+			bool state_changed;
+			int start_rc;
+
+			planned = false;
+			state_changed = _upgrade_locks();
+			/* If other state changed, still try to start this
+			 * job before building a new job queue so that
+			 * backfill progresses under a steady flow of RPCs */
+			if (state_changed &&
+			    ((last_part_update != part_update) ||
+			     (find_job_record(job_id) != orig_job_ptr) ||
+			     !IS_JOB_PENDING(orig_job_ptr))) {
+				debug("backfill: system state changed, "
+				      "breaking out");
+				start_locked = true;
+				rc = 1;
+				break;
+			}
+			job_ptr = orig_job_ptr;
+			job_ptr->part_ptr = part_ptr;
+			job_ptr->time_limit = plan_job.time_limit;
+			if (job_independent(job_ptr, 0))
+				start_rc = _start_job(job_ptr, resv_bitmap);
+			else	/* e.g. singleton job started by backfill */
+				start_rc = ESLURM_DEPENDENCY;
 			if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE))
 				job_ptr->time_limit = orig_time_limit;
-			else if ((rc == SLURM_SUCCESS) && job_ptr->time_min) {
+			else if ((start_rc == SLURM_SUCCESS) &&
+				 job_ptr->time_min) {
 				/* Set time limit as high as possible */
 				job_ptr->time_limit = comp_time_limit;
 				job_ptr->end_time = job_ptr->start_time +
 						    (comp_time_limit * 60);
 				_reset_job_time_limit(job_ptr, now,
-						      node_space);
+						      &node_space);
 				time_limit = job_ptr->time_limit;
 			} else {
 				job_ptr->time_limit = orig_time_limit;
 			}
-			if (rc == ESLURM_ACCOUNTING_POLICY) {
+			if (start_rc != SLURM_SUCCESS)
+				job_ptr->start_time = 0;
+			downgrade_slurmctld(start_locks);
+			if (state_changed) {
+				debug("backfill: system state changed, "
+				      "breaking out");
+				rc = 1;
+				break;
+			}
+			if ((start_rc == ESLURM_ACCOUNTING_POLICY) ||
+			    (start_rc == ESLURM_DEPENDENCY)) {
 				/* Unknown future start time, just skip job */
-				job_ptr->start_time = 0;	
 				continue;
-			} else if (rc != SLURM_SUCCESS) {
+			} else if (start_rc != SLURM_SUCCESS) {
 				/* Planned to start job, but something bad
 				 * happended. */
-				job_ptr->start_time = 0;	
 				break;
 			} else {
 				/* Started this job, move to next one */
 				continue;
 			}
-		} else
-			job_ptr->time_limit = orig_time_limit;
+		}
 
 		if (later_start && (job_ptr->start_time > later_start)) {
 			/* Try later when some nodes currently reserved for
@@ -701,13 +913,13 @@ static int _attempt_backfill(void)
 			continue;
 		}
 
-		if (node_space_recs >= max_backfill_job_cnt) {
+		if (node_space.rec_cnt >= max_backfill_job_cnt) {
 			/* Already have too many jobs to deal with */
 			break;
 		}
 
 		end_reserve = job_ptr->start_time + (time_limit * 60);
-		if (_test_resv_overlap(node_space, avail_bitmap,
+		if (_test_resv_overlap(&node_space, avail_bitmap,
 				       job_ptr->start_time, end_reserve)) {
 			/* This job overlaps with an existing reservation for
 			 * job to be backfill scheduled, which the sched
@@ -725,19 +937,28 @@ static int _attempt_backfill(void)
 			continue;
 		bit_not(avail_bitmap);
 		_add_reservation(job_ptr->start_time, end_reserve,
-				 avail_bitmap, node_space, &node_space_recs);
+				 avail_bitmap, &node_space);
 		if (debug_flags & DEBUG_FLAG_BACKFILL)
-			_dump_node_space_table(node_space);
+			_dump_node_space_table(&node_space);
+	}
+	if (planned) {
+		plan_start[plan_start_cnt].job_id = plan_job.job_id;
+		plan_start[plan_start_cnt++].start_time = plan_job.start_time;
 	}
+	_plan_job_free(&plan_job);
+	if (!start_locked)
+		(void) _upgrade_locks();
+	_set_plan_start(plan_start, plan_start_cnt);
+	if (job_update)
+		last_job_update = time(NULL);
+	unlock_slurmctld(start_locks);
+	xfree(plan_start);
 	FREE_NULL_BITMAP(avail_bitmap);
 	FREE_NULL_BITMAP(resv_bitmap);
 
-	for (i=0; ; ) {
-		FREE_NULL_BITMAP(node_space[i].avail_bitmap);
-		if ((i = node_space[i].next) == 0)
-			break;
-	}
-	xfree(node_space);
+	for (i = 0; i < node_space.rec_cnt; i++)
+		FREE_NULL_BITMAP(node_space.rec[i].avail_bitmap);
+	xfree(node_space.rec);
 	list_destroy(job_queue);
 	return rc;
 }
@@ -797,24 +1018,27 @@ static int _start_job(struct job_record *job_ptr, bitstr_t *resv_bitmap)
  *	Avoid using resources reserved for pending jobs or in resource
  *	reservations */
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
-				  node_space_map_t *node_space)
+				  node_space_t *node_space)
 {
 	int32_t j, resv_delay;
 	uint32_t orig_time_limit = job_ptr->time_limit;
+	node_space_map_t *node_space_ptr;
 
-	for (j=0; ; ) {
-		if ((node_space[j].begin_time != now) &&
-		    (node_space[j].begin_time < job_ptr->end_time) &&
+	for (j = 0; j < node_space->rec_cnt; j++) {
+		node_space_ptr = &node_space->rec[j];
+		if (node_space_ptr->begin_time >= job_ptr->end_time)
+			break;
+		if ((node_space_ptr->begin_time != now) &&
 		    (!bit_super_set(job_ptr->node_bitmap,
-				    node_space[j].avail_bitmap))) {
-			/* Job overlaps pending job's resource reservation */
-			resv_delay = difftime(node_space[j].begin_time, now);
+				    node_space_ptr->avail_bitmap))) {
+			/* Job overlaps pending job's resource reservation,
+			 * records are in time order so this is the first */
+			resv_delay = difftime(node_space_ptr->begin_time, now);
 			resv_delay /= 60;	/* seconds to minutes */
 			if (resv_delay < job_ptr->time_limit)
 				job_ptr->time_limit = resv_delay;
-		}
-		if ((j = node_space[j].next) == 0)
 			break;
+		}
 	}
 	job_ptr->time_limit = MAX(job_ptr->time_min, job_ptr->time_limit);
 	job_ptr->end_time = job_ptr->start_time + (job_ptr->time_limit * 60);
@@ -842,61 +1066,30 @@ static bool _more_work (time_t last_backfill_time)
 	return rc;
 }
 
-/* Create a reservation for a job in the future */
+/* Create a reservation for a job in the future. Records are split at the
+ * reservation's start and end times so that the reserved nodes are removed
+ * from exactly the records the reservation covers. */
 static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
-			     bitstr_t *res_bitmap,
-			     node_space_map_t *node_space,
-			     int *node_space_recs)
+			     bitstr_t *res_bitmap, node_space_t *node_space)
 {
-	bool placed = false;
-	int i, j;
+	int j;
 
-	for (j=0; ; ) {
-		if (node_space[j].end_time > start_time) {
-			/* insert start entry record */
-			i = *node_space_recs;
-			node_space[i].begin_time = start_time;
-			node_space[i].end_time = node_space[j].end_time;
-			node_space[j].end_time = start_time;
-			node_space[i].avail_bitmap =
-				bit_copy(node_space[j].avail_bitmap);
-			node_space[i].next = node_space[j].next;
-			node_space[j].next = i;
-			(*node_space_recs)++;
-			placed = true;
-		}
-		if (node_space[j].end_time == start_time) {
-			/* no need to insert new start entry record */
-			placed = true;
-		}
-		if (placed == true) {
-			j = node_space[j].next;
-			if (j && (end_reserve < node_space[j].end_time)) {
-				/* insert end entry record */
-				i = *node_space_recs;
-				node_space[i].begin_time = end_reserve;
-				node_space[i].end_time = node_space[j].
-							 end_time;
-				node_space[j].end_time = end_reserve;
-				node_space[i].avail_bitmap =
-					bit_copy(node_space[j].avail_bitmap);
-				node_space[i].next = node_space[j].next;
-				node_space[j].next = i;
-				(*node_space_recs)++;
-			}
-			break;
-		}
-		if ((j = node_space[j].next) == 0)
-			break;
+	j = _node_space_find(node_space, start_time);
+	if (j >= node_space->rec_cnt)
+		return;		/* beyond end of backfill window */
+	if (node_space->rec[j].begin_time < start_time) {
+		/* insert start entry record */
+		_node_space_split(node_space, j, start_time);
+		j++;
 	}
-
-	for (j=0; ; ) {
-		if ((node_space[j].begin_time >= start_time) &&
-		    (node_space[j].end_time <= end_reserve))
-			bit_and(node_space[j].avail_bitmap, res_bitmap);
-		if ((node_space[j].begin_time >= end_reserve) ||
-		    ((j = node_space[j].next) == 0))
+	for ( ; j < node_space->rec_cnt; j++) {
+		if (node_space->rec[j].begin_time >= end_reserve)
 			break;
+		if (node_space->rec[j].end_time > end_reserve) {
+			/* insert end entry record */
+			_node_space_split(node_space, j, end_reserve);
+		}
+		bit_and(node_space->rec[j].avail_bitmap, res_bitmap);
 	}
 }
 
@@ -908,22 +1101,22 @@ static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
  * IN start_time - start time of job
  * IN end_reserve - end time of job
  */
-static bool _test_resv_overlap(node_space_map_t *node_space,
+static bool _test_resv_overlap(node_space_t *node_space,
 			       bitstr_t *use_bitmap, uint32_t start_time,
 			       uint32_t end_reserve)
 {
 	bool overlap = false;
 	int j;
 
-	for (j=0; ; ) {
-		if ((node_space[j].end_time   > start_time) &&
-		    (node_space[j].begin_time < end_reserve) &&
-		    (!bit_super_set(use_bitmap, node_space[j].avail_bitmap))) {
+	for (j = _node_space_find(node_space, start_time);
+	     j < node_space->rec_cnt; j++) {
+		if (node_space->rec[j].begin_time >= end_reserve)
+			break;
+		if (!bit_super_set(use_bitmap,
+				   node_space->rec[j].avail_bitmap)) {
 			overlap = true;
 			break;
 		}
-		if ((j = node_space[j].next) == 0)
-			break;
 	}
 	return overlap;
 }
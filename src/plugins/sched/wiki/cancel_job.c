@@ -140,6 +140,7 @@ static int	_timeout_job(uint32_t jobid, int *err_code, char **err_msg)
 	}
 
 	job_ptr->end_time = time(NULL);
+	job_record_changed(job_ptr);
 	debug("wiki: set end time for job %u", jobid);
 
  fini:	unlock_slurmctld(job_write_lock);
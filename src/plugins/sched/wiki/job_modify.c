@@ -73,6 +73,7 @@ static int	_job_modify(uint32_t jobid, char *bank_ptr,
 		error("wiki: MODIFYJOB jobid %u is finished", jobid);
 		return ESLURM_DISABLED;
 	}
+	job_record_changed(job_ptr);
 
 	if (depend_ptr) {
 		int rc = update_job_dependency(job_ptr, depend_ptr);
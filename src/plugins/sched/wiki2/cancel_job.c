@@ -219,6 +219,7 @@ static int	_timeout_job(uint32_t jobid, char *comment_ptr,
 	}
 
 	job_ptr->end_time = time(NULL);
+	job_record_changed(job_ptr);
 	debug("wiki: set end time for job %u", jobid);
 
  fini:	unlock_slurmctld(job_write_lock);
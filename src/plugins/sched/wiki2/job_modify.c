@@ -80,6 +80,7 @@ static int	_job_modify(uint32_t jobid, char *bank_ptr,
 		info("wiki: MODIFYJOB jobid %u is finished", jobid);
 		return ESLURM_DISABLED;
 	}
+	job_record_changed(job_ptr);
 
 	if (comment_ptr) {
 		info("wiki: change job %u comment %s", jobid, comment_ptr);
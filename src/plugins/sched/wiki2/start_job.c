@@ -306,6 +306,7 @@ static int	_start_job(uint32_t jobid, int task_cnt, char *hostlist,
 	old_task_cnt = job_ptr->details->min_cpus;
 	job_ptr->details->min_cpus = MAX(task_cnt, old_task_cnt);
 	job_ptr->priority = 100000000;
+	job_record_changed(job_ptr);
 
  fini:	unlock_slurmctld(job_write_lock);
 	if (rc)
@@ -347,6 +348,7 @@ static int	_start_job(uint32_t jobid, int task_cnt, char *hostlist,
 		/* restore some of job state */
 		job_ptr->priority = 0;
 		job_ptr->details->min_cpus = old_task_cnt;
+		job_record_changed(job_ptr);
 		rc = -1;
 	}
 
@@ -1908,7 +1908,7 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	int error_code = SLURM_SUCCESS, ll; /* ll = layout array index */
 	uint16_t *layout_ptr = NULL;
 	bitstr_t *orig_map, *avail_cores, *free_cores;
-	bitstr_t *tmpcore = NULL, *reqmap = NULL;
+	bitstr_t *reqmap = NULL;
 	bool test_only;
 	uint32_t c, i, k, n, csize, total_cpus, save_mem = 0;
 	int32_t build_cnt;
@@ -2038,16 +2038,14 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	bit_copybits(free_cores, avail_cores);
 
 	/* remove all existing allocations from free_cores */
-	tmpcore = bit_copy(free_cores);
 	for (p_ptr = cr_part_ptr; p_ptr; p_ptr = p_ptr->next) {
 		if (!p_ptr->row)
 			continue;
 		for (i = 0; i < p_ptr->num_rows; i++) {
 			if (!p_ptr->row[i].row_bitmap)
 				continue;
-			bit_copybits(tmpcore, p_ptr->row[i].row_bitmap);
-			bit_not(tmpcore); /* set bits now "free" resources */
-			bit_and(free_cores, tmpcore);
+			/* clear cores in use by this row */
+			bit_and_not(free_cores, p_ptr->row[i].row_bitmap);
 		}
 	}
 	cpu_count = _select_nodes(job_ptr, min_nodes, max_nodes, req_nodes,
@@ -2102,9 +2100,8 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 		for (i = 0; i < p_ptr->num_rows; i++) {
 			if (!p_ptr->row[i].row_bitmap)
 				continue;
-			bit_copybits(tmpcore, p_ptr->row[i].row_bitmap);
-			bit_not(tmpcore); /* set bits now "free" resources */
-			bit_and(free_cores, tmpcore);
+			/* clear cores in use by this row */
+			bit_and_not(free_cores, p_ptr->row[i].row_bitmap);
 		}
 	}
 	/* make these changes permanent */
@@ -2141,9 +2138,8 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 		for (i = 0; i < p_ptr->num_rows; i++) {
 			if (!p_ptr->row[i].row_bitmap)
 				continue;
-			bit_copybits(tmpcore, p_ptr->row[i].row_bitmap);
-			bit_not(tmpcore); /* set bits now "free" resources */
-			bit_and(free_cores, tmpcore);
+			/* clear cores in use by this row */
+			bit_and_not(free_cores, p_ptr->row[i].row_bitmap);
 		}
 	}
 	cpu_count = _select_nodes(job_ptr, min_nodes, max_nodes, req_nodes,
@@ -2170,7 +2166,6 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	/*** Step 4 ***/
 	/* try to fit the job into an existing row
 	 *
-	 * tmpcore = worker core_bitmap
 	 * free_cores = core_bitmap to be built
 	 * avail_cores = static core_bitmap of all available cores
 	 */
@@ -2204,9 +2199,7 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 			break;
 		bit_copybits(bitmap, orig_map);
 		bit_copybits(free_cores, avail_cores);
-		bit_copybits(tmpcore, jp_ptr->row[i].row_bitmap);
-		bit_not(tmpcore);
-		bit_and(free_cores, tmpcore);
+		bit_and_not(free_cores, jp_ptr->row[i].row_bitmap);
 		cpu_count = _select_nodes(job_ptr, min_nodes, max_nodes,
 					  req_nodes, bitmap, cr_node_cnt,
 					  free_cores, node_usage, cr_type,
@@ -2266,7 +2259,6 @@ alloc_job:
 	 */
 	FREE_NULL_BITMAP(orig_map);
 	FREE_NULL_BITMAP(avail_cores);
-	FREE_NULL_BITMAP(tmpcore);
 	if (!cpu_count) {
 		/* we were sent here to cleanup and exit */
 		FREE_NULL_BITMAP(free_cores);
@@ -328,7 +328,7 @@ extern uint32_t cr_get_coremap_offset(uint32_t node_index)
 }
 
 
-/* Helper function for _dup_part_data: create a duplicate part_row_data array */
+/* Create a duplicate part_row_data array */
 static struct part_row_data *_dup_row_data(struct part_row_data *orig_row,
 					   uint16_t num_rows)
 {
@@ -358,57 +358,6 @@ static struct part_row_data *_dup_row_data(struct part_row_data *orig_row,
 }
 
 
-/* Create a duplicate part_res_record list */
-static struct part_res_record *_dup_part_data(struct part_res_record *orig_ptr)
-{
-	struct part_res_record *new_part_ptr, *new_ptr;
-
-	if (orig_ptr == NULL)
-		return NULL;
-
-	new_part_ptr = xmalloc(sizeof(struct part_res_record));
-	new_ptr = new_part_ptr;
-
-	while (orig_ptr) {
-		new_ptr->part_ptr = orig_ptr->part_ptr;
-		new_ptr->num_rows = orig_ptr->num_rows;
-		new_ptr->row = _dup_row_data(orig_ptr->row,
-					     orig_ptr->num_rows);
-		if (orig_ptr->next) {
-			new_ptr->next = xmalloc(sizeof(struct part_res_record));
-			new_ptr = new_ptr->next;
-		}
-		orig_ptr = orig_ptr->next;
-	}
-	return new_part_ptr;
-}
-
-
-/* Create a duplicate part_res_record list */
-static struct node_use_record *_dup_node_usage(struct node_use_record *orig_ptr)
-{
-	struct node_use_record *new_use_ptr, *new_ptr;
-	List gres_list;
-	uint32_t i;
-
-	if (orig_ptr == NULL)
-		return NULL;
-
-	new_use_ptr = xmalloc(select_node_cnt * sizeof(struct node_use_record));
-	new_ptr = new_use_ptr;
-
-	for (i = 0; i < select_node_cnt; i++) {
-		new_ptr[i].node_state   = orig_ptr[i].node_state;
-		new_ptr[i].alloc_memory = orig_ptr[i].alloc_memory;
-		if (orig_ptr[i].gres_list)
-			gres_list = orig_ptr[i].gres_list;
-		else
-			gres_list = node_record_table_ptr[i].gres_list;
-		new_ptr[i].gres_list = gres_plugin_node_state_dup(gres_list);
-	}
-	return new_use_ptr;
-}
-
 /* delete the given row data */
 static void _destroy_row_data(struct part_row_data *row, uint16_t num_rows) {
 	uint16_t i;
@@ -513,6 +462,90 @@ static void _destroy_node_data(struct node_use_record *node_usage,
 }
 
 
+/* Give an overlay its own copy of a partition's rows, unless it already
+ * has one */
+static void _overlay_copy_rows(struct cr_overlay *overlay,
+			       struct part_record *part_ptr)
+{
+	struct part_res_record *p_ptr;
+	int i;
+
+	for (p_ptr = overlay->part_record, i = 0; p_ptr;
+	     p_ptr = p_ptr->next, i++) {
+		if (p_ptr->part_ptr == part_ptr)
+			break;
+	}
+	if (p_ptr && p_ptr->row && !bit_test(overlay->part_copied, i)) {
+		p_ptr->row = _dup_row_data(p_ptr->row, p_ptr->num_rows);
+		bit_set(overlay->part_copied, i);
+	}
+}
+
+/*
+ * Create a copy-on-write view of select_part_record and select_node_usage
+ * for will-run and preemption tests of a job. The node usage array is
+ * copied, but it shares the live gres state and partition rows until
+ * _rm_job_from_overlay() changes them, so the cost of a test grows with
+ * the jobs it removes rather than with the size of the cluster. The rows
+ * of the tested job's partition are copied at once, since cr_job_test()
+ * sorts them.
+ */
+static struct cr_overlay *_create_overlay(struct job_record *job_ptr)
+{
+	struct cr_overlay *overlay;
+	struct part_res_record *orig_ptr, **new_ptr;
+	int part_cnt = 0;
+
+	overlay = xmalloc(sizeof(struct cr_overlay));
+	new_ptr = &overlay->part_record;
+	for (orig_ptr = select_part_record; orig_ptr;
+	     orig_ptr = orig_ptr->next) {
+		*new_ptr = xmalloc(sizeof(struct part_res_record));
+		(*new_ptr)->part_ptr = orig_ptr->part_ptr;
+		(*new_ptr)->num_rows = orig_ptr->num_rows;
+		(*new_ptr)->row      = orig_ptr->row;
+		new_ptr = &(*new_ptr)->next;
+		part_cnt++;
+	}
+	overlay->part_copied = bit_alloc(MAX(part_cnt, 1));
+
+	overlay->node_usage = xmalloc(select_node_cnt *
+				      sizeof(struct node_use_record));
+	memcpy(overlay->node_usage, select_node_usage,
+	       select_node_cnt * sizeof(struct node_use_record));
+	overlay->gres_copied = bit_alloc(MAX(select_node_cnt, 1));
+	if (!overlay->part_copied || !overlay->gres_copied)
+		fatal("bit_alloc: malloc failure");
+	if (job_ptr->part_ptr)
+		_overlay_copy_rows(overlay, job_ptr->part_ptr);
+
+	return overlay;
+}
+
+/* delete a view created by _create_overlay(), leaving the live state */
+static void _destroy_overlay(struct cr_overlay *overlay)
+{
+	struct part_res_record *this_ptr, *next_ptr;
+	int i;
+
+	for (this_ptr = overlay->part_record, i = 0; this_ptr;
+	     this_ptr = next_ptr, i++) {
+		next_ptr = this_ptr->next;
+		if (this_ptr->row && bit_test(overlay->part_copied, i))
+			_destroy_row_data(this_ptr->row, this_ptr->num_rows);
+		xfree(this_ptr);
+	}
+	for (i = 0; i < select_node_cnt; i++) {
+		if (overlay->node_usage[i].gres_list &&
+		    bit_test(overlay->gres_copied, i))
+			list_destroy(overlay->node_usage[i].gres_list);
+	}
+	xfree(overlay->node_usage);
+	FREE_NULL_BITMAP(overlay->part_copied);
+	FREE_NULL_BITMAP(overlay->gres_copied);
+	xfree(overlay);
+}
+
 static void _add_job_to_row(struct job_resources *job,
 			    struct part_row_data *r_ptr)
 {
@@ -1301,6 +1334,47 @@ static int _rm_job_from_res(struct part_res_record *part_record_ptr,
 	return SLURM_SUCCESS;
 }
 
+/* Remove a job from an overlay as _rm_job_from_res() does, first copying
+ * the rows of its partition and the gres state of its nodes unless an
+ * earlier removal already did */
+static int _rm_job_from_overlay(struct cr_overlay *overlay,
+				struct job_record *job_ptr, int action)
+{
+	struct job_resources *job = job_ptr->job_resrcs;
+	List gres_list;
+	int i, first_bit, last_bit;
+
+	if (select_state_initializing || !job || !job->core_bitmap)
+		return _rm_job_from_res(overlay->part_record,
+					overlay->node_usage, job_ptr, action);
+
+	if ((action != 1) && job_ptr->part_ptr)
+		_overlay_copy_rows(overlay, job_ptr->part_ptr);
+
+	if (action != 2) {
+		first_bit = bit_ffs(job->node_bitmap);
+		if (first_bit == -1)
+			last_bit = -2;
+		else
+			last_bit = bit_fls(job->node_bitmap);
+		for (i = first_bit; i <= last_bit; i++) {
+			if (!bit_test(job->node_bitmap, i) ||
+			    bit_test(overlay->gres_copied, i))
+				continue;
+			if (select_node_usage[i].gres_list)
+				gres_list = select_node_usage[i].gres_list;
+			else
+				gres_list = node_record_table_ptr[i].gres_list;
+			overlay->node_usage[i].gres_list =
+				gres_plugin_node_state_dup(gres_list);
+			bit_set(overlay->gres_copied, i);
+		}
+	}
+
+	return _rm_job_from_res(overlay->part_record, overlay->node_usage,
+				job_ptr, action);
+}
+
 static int _rm_job_from_one_node(struct job_record *job_ptr,
 				 struct node_record *node_ptr)
 {
@@ -1507,8 +1581,7 @@ static int _run_now(struct job_record *job_ptr, bitstr_t *bitmap,
 	bitstr_t *orig_map;
 	struct job_record *tmp_job_ptr;
 	ListIterator job_iterator, preemptee_iterator;
-	struct part_res_record *future_part;
-	struct node_use_record *future_usage;
+	struct cr_overlay *future;
 	bool remove_some_jobs = false;
 	uint16_t mode;
 
@@ -1523,17 +1596,7 @@ static int _run_now(struct job_record *job_ptr, bitstr_t *bitmap,
 
 	if ((rc != SLURM_SUCCESS) && preemptee_candidates) {
 		/* Remove preemptable jobs from simulated environment */
-		future_part = _dup_part_data(select_part_record);
-		if (future_part == NULL) {
-			FREE_NULL_BITMAP(orig_map);
-			return SLURM_ERROR;
-		}
-		future_usage = _dup_node_usage(select_node_usage);
-		if (future_usage == NULL) {
-			_destroy_part_data(future_part);
-			FREE_NULL_BITMAP(orig_map);
-			return SLURM_ERROR;
-		}
+		future = _create_overlay(job_ptr);
 
 		job_iterator = list_iterator_create(job_list);
 		if (job_iterator == NULL)
@@ -1551,15 +1614,15 @@ static int _run_now(struct job_record *job_ptr, bitstr_t *bitmap,
 			if (_is_preemptable(tmp_job_ptr,
 					    preemptee_candidates)) {
 				/* Remove preemptable job now */
-				_rm_job_from_res(future_part, future_usage,
-						 tmp_job_ptr, 0);
+				_rm_job_from_overlay(future, tmp_job_ptr, 0);
 				bit_or(bitmap, orig_map);
 				rc = cr_job_test(job_ptr, bitmap, min_nodes,
 						 max_nodes, req_nodes,
 						 SELECT_MODE_WILL_RUN,
 						 cr_type, job_node_req,
 						 select_node_cnt,
-						 future_part, future_usage);
+						 future->part_record,
+						 future->node_usage);
 				if (rc == SLURM_SUCCESS)
 					break;
 			}
@@ -1600,8 +1663,7 @@ static int _run_now(struct job_record *job_ptr, bitstr_t *bitmap,
 			}
 		}
 
-		_destroy_part_data(future_part);
-		_destroy_node_data(future_usage, NULL);
+		_destroy_overlay(future);
 	}
 	FREE_NULL_BITMAP(orig_map);
 
@@ -1616,8 +1678,7 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 			  uint32_t req_nodes, uint16_t job_node_req,
 			  List preemptee_candidates, List *preemptee_job_list)
 {
-	struct part_res_record *future_part;
-	struct node_use_record *future_usage;
+	struct cr_overlay *future;
 	struct job_record *tmp_job_ptr;
 	List cr_job_list;
 	ListIterator job_iterator, preemptee_iterator;
@@ -1629,12 +1690,17 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	if (!orig_map)
 		fatal("bit_copy: malloc failure");
 
+	/* Tests run on an overlay, even with no jobs removed, since
+	 * cr_job_test() reorders the partition's rows */
+	future = _create_overlay(job_ptr);
+
 	/* Try to run with currently available nodes */
 	rc = cr_job_test(job_ptr, bitmap, min_nodes, max_nodes, req_nodes,
 			 SELECT_MODE_WILL_RUN, cr_type, job_node_req,
-			 select_node_cnt, select_part_record,
-			 select_node_usage);
+			 select_node_cnt, future->part_record,
+			 future->node_usage);
 	if (rc == SLURM_SUCCESS) {
+		_destroy_overlay(future);
 		FREE_NULL_BITMAP(orig_map);
 		job_ptr->start_time = time(NULL);
 		return SLURM_SUCCESS;
@@ -1642,17 +1708,6 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 
 	/* Job is still pending. Simulate termination of jobs one at a time
 	 * to determine when and where the job can start. */
-	future_part = _dup_part_data(select_part_record);
-	if (future_part == NULL) {
-		FREE_NULL_BITMAP(orig_map);
-		return SLURM_ERROR;
-	}
-	future_usage = _dup_node_usage(select_node_usage);
-	if (future_usage == NULL) {
-		_destroy_part_data(future_part);
-		FREE_NULL_BITMAP(orig_map);
-		return SLURM_ERROR;
-	}
 
 	/* Build list of running and suspended jobs */
 	cr_job_list = list_create(NULL);
@@ -1678,8 +1733,7 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 			else
 				action = 0;	/* remove cores and memory */
 			/* Remove preemptable job now */
-			_rm_job_from_res(future_part, future_usage,
-					 tmp_job_ptr, action);
+			_rm_job_from_overlay(future, tmp_job_ptr, action);
 		} else
 			list_append(cr_job_list, tmp_job_ptr);
 	}
@@ -1690,8 +1744,8 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 		bit_or(bitmap, orig_map);
 		rc = cr_job_test(job_ptr, bitmap, min_nodes, max_nodes,
 				 req_nodes, SELECT_MODE_WILL_RUN, cr_type,
-				 job_node_req, select_node_cnt, future_part,
-				 future_usage);
+				 job_node_req, select_node_cnt,
+				 future->part_record, future->node_usage);
 		if (rc == SLURM_SUCCESS)
 			job_ptr->start_time = now + 1;
 	}
@@ -1711,13 +1765,12 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 				continue;	/* skip it */
 			debug2("cons_res: _will_run_test, job %u: overlap=%d",
 			       tmp_job_ptr->job_id, ovrlap);
-			_rm_job_from_res(future_part, future_usage,
-					 tmp_job_ptr, 0);
+			_rm_job_from_overlay(future, tmp_job_ptr, 0);
 			rc = cr_job_test(job_ptr, bitmap, min_nodes,
 					 max_nodes, req_nodes,
 					 SELECT_MODE_WILL_RUN, cr_type,
 					 job_node_req, select_node_cnt,
-					 future_part, future_usage);
+					 future->part_record, future->node_usage);
 			if (rc == SLURM_SUCCESS) {
 				if (tmp_job_ptr->end_time <= now)
 					job_ptr->start_time = now + 1;
@@ -1754,8 +1807,7 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	}
 
 	list_destroy(cr_job_list);
-	_destroy_part_data(future_part);
-	_destroy_node_data(future_usage, NULL);
+	_destroy_overlay(future);
 	FREE_NULL_BITMAP(orig_map);
 	return rc;
 }
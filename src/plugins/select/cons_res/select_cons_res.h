@@ -120,6 +120,18 @@ struct node_use_record {
 	uint16_t node_state;		/* see node_cr_state comments */
 };
 
+/* copy-on-write view of select_part_record and select_node_usage used to
+ * test jobs against simulated state */
+struct cr_overlay {
+	struct part_res_record *part_record;	/* rows shared until changed */
+	bitstr_t *part_copied;		/* part_record entries (by position)
+					 * whose rows are private copies */
+	struct node_use_record *node_usage;	/* gres_list shared until
+						 * changed */
+	bitstr_t *gres_copied;		/* nodes whose gres_list is a private
+					 * copy */
+};
+
 extern uint32_t select_debug_flags;
 extern uint16_t select_fast_schedule;
 
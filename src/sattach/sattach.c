@@ -53,6 +53,7 @@
 #include "src/common/fd.h"
 #include "src/common/forward.h"
 #include "src/common/hostlist.h"
+#include "src/common/io_hdr.h"
 #include "src/common/net.h"
 #include "src/common/slurm_auth.h"
 #include "src/common/slurm_cred.h"
@@ -395,6 +396,7 @@ static int _attach_to_tasks(uint32_t jobid,
 	reattach_msg.resp_port = resp_ports; /* array of response ports */
 	reattach_msg.num_io_port = num_io_ports;
 	reattach_msg.io_port = io_ports;
+	reattach_msg.io_frame_len = MAX_FRAME_LEN;
 	reattach_msg.cred = fake_cred;
 
 	msg.msg_type = REQUEST_REATTACH_TASKS;
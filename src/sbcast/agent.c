@@ -69,11 +69,16 @@ typedef struct thd {
 	slurm_msg_t msg;	/* message to send */
 	int rc;			/* highest return codes from RPC */
 	char *nodelist;
+	int *agent_cnt;		/* threads still sending this block */
 } thd_t;
 
 static pthread_mutex_t agent_cnt_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  agent_cnt_cond  = PTHREAD_COND_INITIALIZER;
-static int agent_cnt = 0;
+static int agent_cnt[SBCAST_MAX_BLOCKS];
+
+/* Message to each subtree of nodes for each block in flight */
+static thd_t thread_info[SBCAST_MAX_BLOCKS][MAX_THREADS];
+static int threads_used = 0;
 
 static void *_agent_thread(void *args);
 
@@ -111,70 +116,79 @@ static void *_agent_thread(void *args)
 	if (ret_list)
 		list_destroy(ret_list);
 	slurm_mutex_lock(&agent_cnt_mutex);
-	agent_cnt--;
+	(*thread_ptr->agent_cnt)--;
 	pthread_cond_broadcast(&agent_cnt_cond);
 	slurm_mutex_unlock(&agent_cnt_mutex);
 	return NULL;
 }
 
-/* Issue the RPC to transfer the file's data */
-extern void send_rpc(file_bcast_msg_t *bcast_msg,
-		     job_sbcast_cred_msg_t *sbcast_cred)
+/* Split the job's nodes into one subtree per thread */
+static void _split_nodes(job_sbcast_cred_msg_t *sbcast_cred)
 {
-	/* Preserve some data structures across calls for better performance */
-	static int threads_used = 0;
-	static thd_t thread_info[MAX_THREADS];
-
-	int i, fanout, rc = SLURM_SUCCESS;
-	int retries = 0;
-	pthread_attr_t attr;
-
-	if (threads_used == 0) {
-		hostlist_t hl;
-		hostlist_t new_hl;
-		int *span = NULL;
-		char *name = NULL;
-
-		if (params.fanout)
-			fanout = MIN(MAX_THREADS, params.fanout);
-		else
-			fanout = MAX_THREADS;
-
-		span = set_span(sbcast_cred->node_cnt, fanout);
-
-		hl = hostlist_create(sbcast_cred->node_list);
-
-		i = 0;
-		while (i < sbcast_cred->node_cnt) {
-			int j = 0;
+	hostlist_t hl;
+	hostlist_t new_hl;
+	int *span = NULL;
+	char *name = NULL, *nodelist;
+	int i, fanout, slot;
+
+	if (params.fanout)
+		fanout = MIN(MAX_THREADS, params.fanout);
+	else
+		fanout = MAX_THREADS;
+
+	span = set_span(sbcast_cred->node_cnt, fanout);
+
+	hl = hostlist_create(sbcast_cred->node_list);
+
+	i = 0;
+	while (i < sbcast_cred->node_cnt) {
+		int j = 0;
+		name = hostlist_shift(hl);
+		if(!name) {
+			debug3("no more nodes to send to");
+			break;
+		}
+		new_hl = hostlist_create(name);
+		free(name);
+		i++;
+		for(j = 0; j < span[threads_used]; j++) {
 			name = hostlist_shift(hl);
-			if(!name) {
-				debug3("no more nodes to send to");
+			if(!name)
 				break;
-			}
-			new_hl = hostlist_create(name);
+			hostlist_push(new_hl, name);
 			free(name);
 			i++;
-			for(j = 0; j < span[threads_used]; j++) {
-				name = hostlist_shift(hl);
-				if(!name)
-					break;
-				hostlist_push(new_hl, name);
-				free(name);
-				i++;
-			}
-			thread_info[threads_used].nodelist = 
-				hostlist_ranged_string_xmalloc(new_hl);
-			hostlist_destroy(new_hl);
-			slurm_msg_t_init(&thread_info[threads_used].msg);
-			thread_info[threads_used].msg.msg_type =
-				REQUEST_FILE_BCAST;
-			threads_used++;
 		}
-		xfree(span);
-		hostlist_destroy(hl);
-		debug("using %d threads", threads_used);
+		nodelist = hostlist_ranged_string_xmalloc(new_hl);
+		hostlist_destroy(new_hl);
+		for (slot = 0; slot < SBCAST_MAX_BLOCKS; slot++) {
+			thd_t *thd = &thread_info[slot][threads_used];
+			thd->nodelist = xstrdup(nodelist);
+			thd->agent_cnt = &agent_cnt[slot];
+			slurm_msg_t_init(&thd->msg);
+			thd->msg.msg_type = REQUEST_FILE_BCAST;
+		}
+		xfree(nodelist);
+		threads_used++;
 	}
+	xfree(span);
+	hostlist_destroy(hl);
+	debug("using %d threads", threads_used);
+}
+
+/* Issue the RPC to transfer the file's data. Up to SBCAST_MAX_BLOCKS
+ * blocks, each in its own slot, may be in flight at once. The message
+ * must be preserved until wait_rpc() for the same slot returns. */
+extern void send_rpc(int slot, file_bcast_msg_t *bcast_msg,
+		     job_sbcast_cred_msg_t *sbcast_cred)
+{
+	int i;
+	int retries = 0;
+	pthread_attr_t attr;
+
+	xassert((slot >= 0) && (slot < SBCAST_MAX_BLOCKS));
+	if (threads_used == 0)
+		_split_nodes(sbcast_cred);
 
 	slurm_attr_init(&attr);
 	if (pthread_attr_setstacksize(&attr, 3 * 1024*1024))
@@ -184,30 +198,37 @@ extern void send_rpc(file_bcast_msg_t *bcast_msg,
 		error("pthread_attr_setdetachstate error %m");
 
 	for (i=0; i<threads_used; i++) {
-		thread_info[i].msg.data = bcast_msg;
+		thread_info[slot][i].msg.data = bcast_msg;
+		thread_info[slot][i].rc = SLURM_SUCCESS;
 		slurm_mutex_lock(&agent_cnt_mutex);
-		agent_cnt++;
+		agent_cnt[slot]++;
 		slurm_mutex_unlock(&agent_cnt_mutex);
 
-		while (pthread_create(&thread_info[i].thread,
+		while (pthread_create(&thread_info[slot][i].thread,
 				      &attr, _agent_thread,
-				      (void *) &thread_info[i])) {
+				      (void *) &thread_info[slot][i])) {
 			error("pthread_create error %m");
 			if (++retries > MAX_RETRIES)
 				fatal("Can't create pthread");
 			sleep(1);	/* sleep and retry */
 		}
 	}
+	pthread_attr_destroy(&attr);
+}
+
+/* Wait for the block in a slot to reach every node, exit on failure */
+extern void wait_rpc(int slot)
+{
+	int i, rc = SLURM_SUCCESS;
 
 	/* wait until pthreads complete */
 	slurm_mutex_lock(&agent_cnt_mutex);
-	while (agent_cnt)
+	while (agent_cnt[slot])
 		pthread_cond_wait(&agent_cnt_cond, &agent_cnt_mutex);
 	slurm_mutex_unlock(&agent_cnt_mutex);
-	pthread_attr_destroy(&attr);
 
 	for (i=0; i<threads_used; i++)
-		 rc = MAX(rc, thread_info[i].rc);
+		 rc = MAX(rc, thread_info[slot][i].rc);
 
 	if (rc)
 		exit(1);
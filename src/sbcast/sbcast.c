@@ -179,52 +179,77 @@ static ssize_t _get_block(char *buffer, size_t buf_size)
 	return buf_used;
 }
 
-/* read and broadcast the file */
+/* read and broadcast the file
+ * Block one creates the file and carries the fully verified credential, so
+ * it must reach every node first. Later blocks are written by offset and
+ * may arrive in any order, up to SBCAST_MAX_BLOCKS of them are in flight.
+ * The last block sets the file's modes and times, so it is sent only once
+ * all other blocks have been written. */
 static void _bcast_file(void)
 {
-	int buf_size;
+	int buf_size, slot = 0;
 	ssize_t size_read = 0;
-	file_bcast_msg_t bcast_msg;
-	char *buffer;
+	file_bcast_msg_t bcast_msg[SBCAST_MAX_BLOCKS];
+	file_bcast_msg_t *msg;
+	uint16_t block_no = 1;
 
 	if (params.block_size)
 		buf_size = MIN(params.block_size, f_stat.st_size);
 	else
 		buf_size = MIN((512 * 1024), f_stat.st_size);
 
-	bcast_msg.fname		= params.dst_fname;
-	bcast_msg.block_no	= 1;
-	bcast_msg.last_block	= 0;
-	bcast_msg.force		= params.force;
-	bcast_msg.modes		= f_stat.st_mode;
-	bcast_msg.uid		= f_stat.st_uid;
-	bcast_msg.gid		= f_stat.st_gid;
-	buffer			= xmalloc(buf_size);
-	bcast_msg.block		= buffer;
-	bcast_msg.block_len	= 0;
-	bcast_msg.cred          = sbcast_cred->sbcast_cred;
-
-	if (params.preserve) {
-		bcast_msg.atime     = f_stat.st_atime;
-		bcast_msg.mtime     = f_stat.st_mtime;
-	} else {
-		bcast_msg.atime     = 0;
-		bcast_msg.mtime     = 0;
+	for (slot = 0; slot < SBCAST_MAX_BLOCKS; slot++) {
+		msg = &bcast_msg[slot];
+		msg->fname	= params.dst_fname;
+		msg->block_no	= 0;
+		msg->last_block	= 0;
+		msg->force	= params.force;
+		msg->modes	= f_stat.st_mode;
+		msg->uid	= f_stat.st_uid;
+		msg->gid	= f_stat.st_gid;
+		msg->block	= xmalloc(buf_size);
+		msg->block_len	= 0;
+		msg->block_offset = 0;
+		msg->cred	= sbcast_cred->sbcast_cred;
+
+		if (params.preserve) {
+			msg->atime     = f_stat.st_atime;
+			msg->mtime     = f_stat.st_mtime;
+		} else {
+			msg->atime     = 0;
+			msg->mtime     = 0;
+		}
 	}
 
 	while (1) {
-		bcast_msg.block_len = _get_block(buffer, buf_size);
-		debug("block %d, size %u", bcast_msg.block_no,
-		      bcast_msg.block_len);
-		size_read += bcast_msg.block_len;
+		slot = (block_no - 1) % SBCAST_MAX_BLOCKS;
+		msg = &bcast_msg[slot];
+		if (msg->block_no)
+			wait_rpc(slot);
+
+		msg->block_no = block_no;
+		msg->block_offset = size_read;
+		msg->block_len = _get_block(msg->block, buf_size);
+		debug("block %d, size %u", msg->block_no, msg->block_len);
+		size_read += msg->block_len;
 		if (size_read >= f_stat.st_size)
-			bcast_msg.last_block = 1;
-
-		send_rpc(&bcast_msg, sbcast_cred);
-		if (bcast_msg.last_block)
+			msg->last_block = 1;
+
+		if (msg->last_block) {
+			int i;
+			for (i = 0; i < SBCAST_MAX_BLOCKS; i++) {
+				if ((i != slot) && bcast_msg[i].block_no)
+					wait_rpc(i);
+			}
+		}
+		send_rpc(slot, msg, sbcast_cred);
+		if ((block_no == 1) || msg->last_block)
+			wait_rpc(slot);
+		if (msg->last_block)
 			break;	/* end of file */
-		bcast_msg.block_no++;
+		block_no++;
 	}
 
-	xfree(buffer);
+	for (slot = 0; slot < SBCAST_MAX_BLOCKS; slot++)
+		xfree(bcast_msg[slot].block);
 }
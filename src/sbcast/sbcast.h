@@ -48,6 +48,8 @@
 #include "src/common/macros.h"
 #include "src/common/slurm_protocol_defs.h"
 
+#define SBCAST_MAX_BLOCKS 4	/* file blocks in flight to each node */
+
 struct sbcast_parameters {
 	uint32_t block_size;
 	bool compress;
@@ -63,7 +65,8 @@ struct sbcast_parameters {
 extern struct sbcast_parameters params;
 
 extern void parse_command_line(int argc, char *argv[]);
-extern void send_rpc(file_bcast_msg_t *bcast_msg,
+extern void send_rpc(int slot, file_bcast_msg_t *bcast_msg,
 		     job_sbcast_cred_msg_t *sbcast_cred);
+extern void wait_rpc(int slot);
 
 #endif
@@ -163,13 +163,40 @@ _proc_cluster(void)
 	return rc;
 }
 
-/* _load_job_records - load all job information for filtering and verification */
+/* _load_job_records - load job information for filtering and verification.
+ * slurmctld returns only the jobs which _verify_job_ids() and
+ * _filter_job_records() could select. */
 static void
 _load_job_records (void)
 {
 	int error_code;
+	uint32_t user_id = (uint32_t) opt.user_id;
+	job_info_filter_t filter;
+
+	memset(&filter, 0, sizeof(job_info_filter_t));
+	if (opt.job_cnt) {
+		/* Explicit job IDs are verified in any state */
+		filter.job_id_cnt = opt.job_cnt;
+		filter.job_ids = opt.job_id;
+	} else {
+		filter.accounts = opt.account;
+		filter.name = opt.job_name;
+		filter.partitions = opt.partition;
+		if (opt.user_name) {
+			filter.user_id_cnt = 1;
+			filter.user_ids = &user_id;
+		}
+		if (opt.state != JOB_END)
+			filter.state_mask = JOB_FILTER_STATE(opt.state);
+		else {
+			filter.state_mask = JOB_FILTER_STATE(JOB_PENDING) |
+					    JOB_FILTER_STATE(JOB_RUNNING) |
+					    JOB_FILTER_STATE(JOB_SUSPENDED);
+		}
+	}
 
-	error_code = slurm_load_jobs ((time_t) NULL, &job_buffer_ptr, 1);
+	error_code = slurm_load_jobs_filter((time_t) NULL, &job_buffer_ptr, 1,
+					    &filter);
 
 	if (error_code) {
 		slurm_perror ("slurm_load_jobs error");
@@ -62,6 +62,7 @@ static void _cancel_job(struct job_record *job_ptr)
 	time_t now = time(NULL);
 
 	last_job_update = now;
+	job_record_changed(job_ptr);
 	job_ptr->job_state = JOB_FAILED;
 	job_ptr->exit_code = 1;
 	job_ptr->state_reason = FAIL_ACCOUNT;
@@ -98,6 +99,7 @@ static bool _valid_job_assoc(struct job_record *job_ptr)
 			return false;
 		}
 		job_ptr->assoc_id = assoc_rec.id;
+		job_record_changed(job_ptr);
 	}
 	return true;
 }
@@ -1414,6 +1416,7 @@ extern int acct_policy_update_pending_job(struct job_record *job_ptr)
 
 	if (update_accounting) {
 		last_job_update = time(NULL);
+		job_record_changed(job_ptr);
 		debug("limits changed for job %u: updating accounting",
 		      job_ptr->job_id);
 		if (details_ptr->begin_time) {
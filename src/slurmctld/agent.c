@@ -50,10 +50,15 @@
  *  be possible to execute the agent as an pthread, process, or even a daemon
  *  on some other computer.
  *
- *  The main agent thread creates a separate thread for each node to be
- *  communicated with up to AGENT_THREAD_COUNT. A special watchdog thread
- *  sends SIGLARM to any threads that have been active (in DSH_ACTIVE state)
- *  for more than COMMAND_TIMEOUT seconds.
+ *  When replies are expected, the main agent thread creates a separate
+ *  thread for each group of nodes to be communicated with up to
+ *  AGENT_THREAD_COUNT. A special watchdog thread sends SIGLARM to any
+ *  threads that have been active (in DSH_ACTIVE state) for more than
+ *  COMMAND_TIMEOUT seconds.
+ *  Messages which need no reply (SHUTDOWN, RECONFIGURE, SRUN_* notices,
+ *  etc.) are sent directly to every node by the main agent thread itself
+ *  using non-blocking sockets and poll(), with up to AGENT_CONN_COUNT
+ *  connections in progress at once, each given COMMAND_TIMEOUT seconds.
  *  The agent responds to slurmctld via a function call or an RPC as required.
  *  For example, informing slurmctld that some node is not responding.
  *
@@ -66,16 +71,21 @@
 #endif
 
 #include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
 #include <pthread.h>
 #include <pwd.h>
 #include <signal.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <stdlib.h>
 
+#include "src/common/fd.h"
 #include "src/common/forward.h"
 #include "src/common/list.h"
 #include "src/common/log.h"
@@ -84,6 +94,7 @@
 #include "src/common/parse_time.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_interface.h"
+#include "src/common/timers.h"
 #include "src/common/uid.h"
 #include "src/common/xsignal.h"
 #include "src/common/xassert.h"
@@ -141,6 +152,16 @@ typedef struct agent_info {
 	void **msg_args_pptr;		/* RPC data to be used */
 } agent_info_t;
 
+/* Connection of the main agent thread for a message needing no reply */
+typedef struct agent_conn {
+	int fd;				/* socket, -1 if slot unused */
+	thd_t *thread_ptr;		/* node(s) being sent to */
+	Buf buffer;			/* packed message */
+	uint32_t msg_len;		/* message size, network byte order */
+	uint32_t sent;			/* bytes sent, including msg_len */
+	struct timeval deadline;	/* time to give up on the node */
+} agent_conn_t;
+
 typedef struct task_info {
 	pthread_mutex_t *thread_mutex_ptr; /* pointer to agent specific
 					    * mutex */
@@ -166,8 +187,15 @@ typedef struct mail_info {
 } mail_info_t;
 
 static void _sig_handler(int dummy);
+static void _agent_complete(agent_info_t *agent_ptr, thd_complete_t *thd_comp);
 static int  _batch_launch_defer(queued_request_t *queued_req_ptr);
 static inline int _comm_err(char *node_name, slurm_msg_type_t msg_type);
+static void _conn_close(agent_conn_t *conn, state_t state,
+			slurm_msg_type_t msg_type);
+static int  _conn_open(agent_info_t *agent_ptr, thd_t *thread_ptr,
+		       agent_conn_t *conn);
+static int  _conn_write(agent_conn_t *conn);
+static bool _is_srun_agent(slurm_msg_type_t msg_type);
 static void _list_delete_retry(void *retry_entry);
 static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr);
 static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx);
@@ -178,8 +206,10 @@ static void _purge_agent_args(agent_arg_t *agent_arg_ptr);
 static void _queue_agent_retry(agent_info_t * agent_info_ptr, int count);
 static int _setup_requeue(agent_arg_t *agent_arg_ptr, thd_t *thread_ptr,
 			  int count, int *spot);
+static void _send_only_rpcs(agent_info_t *agent_ptr);
 static void _slurmctld_free_batch_job_launch_msg(batch_job_launch_msg_t * msg);
 static void _spawn_retry_agent(agent_arg_t * agent_arg_ptr);
+static void _thread_rpcs(agent_info_t *agent_ptr);
 static void *_thread_per_group_rpc(void *args);
 static int   _valid_agent_arg(agent_arg_t *agent_arg_ptr);
 static void *_wdog(void *args);
@@ -212,13 +242,9 @@ static bool wiki2_sched_test = false;
  */
 void *agent(void *args)
 {
-	int i, delay, rc, retries = 0;
-	pthread_attr_t attr_wdog;
-	pthread_t thread_wdog;
+	int delay;
 	agent_arg_t *agent_arg_ptr = args;
 	agent_info_t *agent_info_ptr = NULL;
-	thd_t *thread_ptr;
-	task_info_t *task_specific_ptr;
 	time_t begin_time;
 
 #if 0
@@ -254,7 +280,61 @@ void *agent(void *args)
 
 	/* initialize the agent data structures */
 	agent_info_ptr = _make_agent_info(agent_arg_ptr);
-	thread_ptr = agent_info_ptr->thread_struct;
+
+	if (agent_info_ptr->get_reply)
+		_thread_rpcs(agent_info_ptr);
+	else
+		_send_only_rpcs(agent_info_ptr);
+
+	delay = (int) difftime(time(NULL), begin_time);
+	if (delay > (slurm_get_msg_timeout() * 2)) {
+		info("agent msg_type=%u ran for %d seconds",
+			agent_arg_ptr->msg_type,  delay);
+	}
+	slurm_mutex_lock(&agent_info_ptr->thread_mutex);
+	while (agent_info_ptr->threads_active != 0) {
+		pthread_cond_wait(&agent_info_ptr->thread_cond,
+				&agent_info_ptr->thread_mutex);
+	}
+	slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+
+      cleanup:
+	_purge_agent_args(agent_arg_ptr);
+
+	if (agent_info_ptr) {
+		xfree(agent_info_ptr->thread_struct);
+		xfree(agent_info_ptr);
+	}
+	slurm_mutex_lock(&agent_cnt_mutex);
+
+	if (agent_cnt > 0)
+		agent_cnt--;
+	else {
+		error("agent_cnt underflow");
+		agent_cnt = 0;
+	}
+
+	if (agent_cnt && agent_cnt < MAX_AGENT_CNT)
+		agent_retry(RPC_RETRY_INTERVAL, true);
+
+	pthread_cond_broadcast(&agent_cnt_cond);
+	slurm_mutex_unlock(&agent_cnt_mutex);
+
+	return NULL;
+}
+
+/*
+ * _thread_rpcs - issue an agent's RPCs from a thread per group of nodes,
+ *	with a watchdog thread to time them out and process the results
+ * IN agent_ptr - agent's RPC and nodes
+ */
+static void _thread_rpcs(agent_info_t *agent_ptr)
+{
+	int i, rc, retries = 0;
+	pthread_attr_t attr_wdog;
+	pthread_t thread_wdog;
+	thd_t *thread_ptr = agent_ptr->thread_struct;
+	task_info_t *task_specific_ptr;
 
 	/* start the watchdog thread */
 	slurm_attr_init(&attr_wdog);
@@ -262,7 +342,7 @@ void *agent(void *args)
 	    (&attr_wdog, PTHREAD_CREATE_JOINABLE))
 		error("pthread_attr_setdetachstate error %m");
 	while (pthread_create(&thread_wdog, &attr_wdog, _wdog,
-				(void *) agent_info_ptr)) {
+				(void *) agent_ptr)) {
 		error("pthread_create error %m");
 		if (++retries > MAX_RETRIES)
 			fatal("Can't create pthread");
@@ -272,21 +352,21 @@ void *agent(void *args)
 #if 	AGENT_THREAD_COUNT < 1
 	fatal("AGENT_THREAD_COUNT value is invalid");
 #endif
-	debug2("got %d threads to send out",agent_info_ptr->thread_count);
+	debug2("got %d threads to send out",agent_ptr->thread_count);
 	/* start all the other threads (up to AGENT_THREAD_COUNT active) */
-	for (i = 0; i < agent_info_ptr->thread_count; i++) {
+	for (i = 0; i < agent_ptr->thread_count; i++) {
 
 		/* wait until "room" for another thread */
-		slurm_mutex_lock(&agent_info_ptr->thread_mutex);
-		while (agent_info_ptr->threads_active >=
+		slurm_mutex_lock(&agent_ptr->thread_mutex);
+		while (agent_ptr->threads_active >=
 		       AGENT_THREAD_COUNT) {
-			pthread_cond_wait(&agent_info_ptr->thread_cond,
-					  &agent_info_ptr->thread_mutex);
+			pthread_cond_wait(&agent_ptr->thread_cond,
+					  &agent_ptr->thread_mutex);
 		}
 
 		/* create thread specific data, NOTE: freed from
 		 *      _thread_per_group_rpc() */
-		task_specific_ptr = _make_task_data(agent_info_ptr, i);
+		task_specific_ptr = _make_task_data(agent_ptr, i);
 
 		slurm_attr_init(&thread_ptr[i].attr);
 		if (pthread_attr_setdetachstate(&thread_ptr[i].attr,
@@ -297,61 +377,26 @@ void *agent(void *args)
 					    _thread_per_group_rpc,
 					    (void *) task_specific_ptr))) {
 			error("pthread_create error %m");
-			if (agent_info_ptr->threads_active)
-				pthread_cond_wait(&agent_info_ptr->
+			if (agent_ptr->threads_active)
+				pthread_cond_wait(&agent_ptr->
 						  thread_cond,
-						  &agent_info_ptr->
+						  &agent_ptr->
 						  thread_mutex);
 			else {
-				slurm_mutex_unlock(&agent_info_ptr->
+				slurm_mutex_unlock(&agent_ptr->
 						     thread_mutex);
 				usleep(10000);	/* sleep and retry */
-				slurm_mutex_lock(&agent_info_ptr->
+				slurm_mutex_lock(&agent_ptr->
 						   thread_mutex);
 			}
 		}
 		slurm_attr_destroy(&thread_ptr[i].attr);
-		agent_info_ptr->threads_active++;
-		slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+		agent_ptr->threads_active++;
+		slurm_mutex_unlock(&agent_ptr->thread_mutex);
 	}
 
 	/* wait for termination of remaining threads */
 	pthread_join(thread_wdog, NULL);
-	delay = (int) difftime(time(NULL), begin_time);
-	if (delay > (slurm_get_msg_timeout() * 2)) {
-		info("agent msg_type=%u ran for %d seconds",
-			agent_arg_ptr->msg_type,  delay);
-	}
-	slurm_mutex_lock(&agent_info_ptr->thread_mutex);
-	while (agent_info_ptr->threads_active != 0) {
-		pthread_cond_wait(&agent_info_ptr->thread_cond,
-				&agent_info_ptr->thread_mutex);
-	}
-	slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
-
-      cleanup:
-	_purge_agent_args(agent_arg_ptr);
-
-	if (agent_info_ptr) {
-		xfree(agent_info_ptr->thread_struct);
-		xfree(agent_info_ptr);
-	}
-	slurm_mutex_lock(&agent_cnt_mutex);
-
-	if (agent_cnt > 0)
-		agent_cnt--;
-	else {
-		error("agent_cnt underflow");
-		agent_cnt = 0;
-	}
-
-	if (agent_cnt && agent_cnt < MAX_AGENT_CNT)
-		agent_retry(RPC_RETRY_INTERVAL, true);
-
-	pthread_cond_broadcast(&agent_cnt_cond);
-	slurm_mutex_unlock(&agent_cnt_mutex);
-
-	return NULL;
 }
 
 /* Basic validity test of agent argument */
@@ -519,7 +564,6 @@ static void _update_wdog_state(thd_t *thread_ptr,
  */
 static void *_wdog(void *args)
 {
-	bool srun_agent = false;
 	int i;
 	agent_info_t *agent_ptr = (agent_info_t *) args;
 	thd_t *thread_ptr = agent_ptr->thread_struct;
@@ -528,16 +572,6 @@ static void *_wdog(void *args)
 	thd_complete_t thd_comp;
 	ret_data_info_t *ret_data_info = NULL;
 
-	if ( (agent_ptr->msg_type == SRUN_JOB_COMPLETE)			||
-	     (agent_ptr->msg_type == SRUN_STEP_MISSING)			||
-	     (agent_ptr->msg_type == SRUN_EXEC)				||
-	     (agent_ptr->msg_type == SRUN_NODE_FAIL)			||
-	     (agent_ptr->msg_type == SRUN_PING)				||
-	     (agent_ptr->msg_type == SRUN_TIMEOUT)			||
-	     (agent_ptr->msg_type == SRUN_USER_MSG)			||
-	     (agent_ptr->msg_type == RESPONSE_RESOURCE_ALLOCATION) )
-		srun_agent = true;
-
 	thd_comp.max_delay = 0;
 
 	while (1) {
@@ -574,12 +608,43 @@ static void *_wdog(void *args)
 		slurm_mutex_unlock(&agent_ptr->thread_mutex);
 	}
 
-	if (srun_agent) {
+	_agent_complete(agent_ptr, &thd_comp);
+	slurm_mutex_unlock(&agent_ptr->thread_mutex);
+	return (void *) NULL;
+}
+
+/* Return true if the message is sent to srun rather than slurmd */
+static bool _is_srun_agent(slurm_msg_type_t msg_type)
+{
+	if ((msg_type == SRUN_JOB_COMPLETE)		||
+	    (msg_type == SRUN_STEP_MISSING)		||
+	    (msg_type == SRUN_EXEC)			||
+	    (msg_type == SRUN_NODE_FAIL)		||
+	    (msg_type == SRUN_PING)			||
+	    (msg_type == SRUN_TIMEOUT)			||
+	    (msg_type == SRUN_USER_MSG)			||
+	    (msg_type == RESPONSE_RESOURCE_ALLOCATION))
+		return true;
+	return false;
+}
+
+/*
+ * _agent_complete - report the outcome of an agent's RPCs to slurmctld
+ *	and release the per node state, once no RPC remains active
+ * IN agent_ptr - agent whose RPCs are done
+ * IN thd_comp - counts of RPC outcomes from _update_wdog_state()
+ */
+static void _agent_complete(agent_info_t *agent_ptr, thd_complete_t *thd_comp)
+{
+	thd_t *thread_ptr = agent_ptr->thread_struct;
+	int i;
+
+	if (_is_srun_agent(agent_ptr->msg_type)) {
 		_notify_slurmctld_jobs(agent_ptr);
 	} else {
 		_notify_slurmctld_nodes(agent_ptr,
-					thd_comp.no_resp_cnt,
-					thd_comp.retry_cnt);
+					thd_comp->no_resp_cnt,
+					thd_comp->retry_cnt);
 	}
 
 	for (i = 0; i < agent_ptr->thread_count; i++) {
@@ -588,11 +653,233 @@ static void *_wdog(void *args)
 		xfree(thread_ptr[i].nodelist);
 	}
 
-	if (thd_comp.max_delay)
-		debug2("agent maximum delay %d seconds", thd_comp.max_delay);
+	if (thd_comp->max_delay)
+		debug2("agent maximum delay %d seconds", thd_comp->max_delay);
+}
+
+/*
+ * _send_only_rpcs - send an agent's message to every node from this thread
+ *	when no reply is expected. Connections are made with non-blocking
+ *	sockets, up to AGENT_CONN_COUNT at a time, and driven by poll() until
+ *	the message is written or COMMAND_TIMEOUT expires.
+ * IN agent_ptr - agent's RPC and nodes, one node or srun per thread_struct
+ */
+static void _send_only_rpcs(agent_info_t *agent_ptr)
+{
+	thd_t *thread_ptr = agent_ptr->thread_struct;
+	agent_conn_t *conn;
+	struct pollfd *pfds;
+	thd_complete_t thd_comp;
+	int conn_cnt, active = 0, next = 0, i, rc, sent, timeout;
+	long remain, usec;
+	time_t now;
+	struct timeval tv_now;
+
+	conn_cnt = MIN(agent_ptr->thread_count, AGENT_CONN_COUNT);
+	conn = xmalloc(sizeof(agent_conn_t) * conn_cnt);
+	pfds = xmalloc(sizeof(struct pollfd) * conn_cnt);
+	for (i = 0; i < conn_cnt; i++)
+		conn[i].fd = -1;
+
+	while ((next < agent_ptr->thread_count) || active) {
+		now = time(NULL);
+		for (i = 0; (i < conn_cnt) &&
+			    (next < agent_ptr->thread_count); i++) {
+			if (conn[i].fd >= 0)
+				continue;
+			thread_ptr[next].start_time = now;
+			thread_ptr[next].state = DSH_ACTIVE;
+			if (_conn_open(agent_ptr, &thread_ptr[next], &conn[i])
+			    == SLURM_SUCCESS)
+				active++;
+			else
+				_conn_close(&conn[i], DSH_NO_RESP,
+					    agent_ptr->msg_type);
+			next++;
+		}
+		if (active == 0)
+			continue;
+
+		/* Wait until the earliest deadline, rounded up to a whole
+		 * millisecond so poll() does not return just short of it */
+		gettimeofday(&tv_now, NULL);
+		remain = -1;
+		for (i = 0; i < conn_cnt; i++) {
+			pfds[i].fd = conn[i].fd;
+			pfds[i].events = POLLOUT;
+			pfds[i].revents = 0;
+			if (conn[i].fd < 0)
+				continue;
+			usec = slurm_diff_tv(&tv_now, &conn[i].deadline);
+			if ((remain < 0) || (usec < remain))
+				remain = MAX(usec, 0);
+		}
+		timeout = (remain + 999) / 1000;
+		rc = poll(pfds, conn_cnt, timeout);
+		if ((rc < 0) && (errno != EINTR)) {
+			error("agent poll: %m");
+			for (i = 0; i < conn_cnt; i++)
+				conn[i].deadline = tv_now;
+		}
+
+		gettimeofday(&tv_now, NULL);
+		for (i = 0; i < conn_cnt; i++) {
+			if (conn[i].fd < 0)
+				continue;
+			if ((rc > 0) && pfds[i].revents)
+				sent = _conn_write(&conn[i]);
+			else if (slurm_diff_tv(&tv_now, &conn[i].deadline)
+				 <= 0) {
+				errno = ETIMEDOUT;
+				sent = -1;
+			} else
+				continue;
+			if (sent == 0)
+				continue;
+			_conn_close(&conn[i],
+				    (sent > 0) ? DSH_DONE : DSH_NO_RESP,
+				    agent_ptr->msg_type);
+			active--;
+		}
+	}
+	xfree(conn);
+	xfree(pfds);
 
+	memset(&thd_comp, 0, sizeof(thd_complete_t));
+	for (i = 0; i < agent_ptr->thread_count; i++) {
+		_update_wdog_state(&thread_ptr[i], &thread_ptr[i].state,
+				   &thd_comp);
+	}
+	slurm_mutex_lock(&agent_ptr->thread_mutex);
+	_agent_complete(agent_ptr, &thd_comp);
 	slurm_mutex_unlock(&agent_ptr->thread_mutex);
-	return (void *) NULL;
+}
+
+/*
+ * _conn_open - pack the agent's message for a node and start a
+ *	non-blocking connection to it
+ * IN agent_ptr - agent's RPC
+ * IN thread_ptr - node or srun to send to
+ * OUT conn - connection state, fd is -1 on error
+ * RET SLURM_SUCCESS or SLURM_ERROR
+ */
+static int _conn_open(agent_info_t *agent_ptr, thd_t *thread_ptr,
+		      agent_conn_t *conn)
+{
+	slurm_msg_t msg;
+
+	conn->fd = -1;
+	conn->thread_ptr = thread_ptr;
+	conn->buffer = NULL;
+	conn->sent = 0;
+	gettimeofday(&conn->deadline, NULL);
+	conn->deadline.tv_sec += COMMAND_TIMEOUT;
+
+	slurm_msg_t_init(&msg);
+	msg.msg_type = agent_ptr->msg_type;
+	msg.data     = *agent_ptr->msg_args_pptr;
+	if (thread_ptr->addr) {
+		msg.address = *thread_ptr->addr;
+	} else if (slurm_conf_get_addr(thread_ptr->nodelist, &msg.address)
+		   == SLURM_ERROR) {
+		error("_conn_open: can't find address for host %s, "
+		      "check slurm.conf", thread_ptr->nodelist);
+		return SLURM_ERROR;
+	}
+	conn->buffer = slurm_pack_node_msg(&msg);
+	destroy_forward(&msg.forward);
+	if (conn->buffer == NULL)
+		return SLURM_ERROR;
+	conn->msg_len = htonl(get_buf_offset(conn->buffer));
+
+	if ((conn->fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+		error("_conn_open: socket: %m");
+		return SLURM_ERROR;
+	}
+	fd_set_nonblocking(conn->fd);
+	fd_set_close_on_exec(conn->fd);
+	if ((connect(conn->fd, (struct sockaddr *) &msg.address,
+		     sizeof(msg.address)) < 0) && (errno != EINPROGRESS))
+		return SLURM_ERROR;
+	return SLURM_SUCCESS;
+}
+
+/*
+ * _conn_write - write as much of a message as the socket will take,
+ *	the message length first as with slurm_send_node_msg()
+ * RET 1 if the message is all sent, 0 if more remains, -1 on error
+ */
+static int _conn_write(agent_conn_t *conn)
+{
+	uint32_t size = get_buf_offset(conn->buffer);
+	uint32_t len_size = sizeof(conn->msg_len);
+	struct iovec iov[2];
+	int iovcnt, err = 0;
+	socklen_t err_len = sizeof(err);
+	ssize_t n;
+
+	if (conn->sent == 0) {
+		/* non-blocking connect() done, see if it worked */
+		if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR,
+			       &err, &err_len) < 0)
+			return -1;
+		if (err) {
+			errno = err;
+			return -1;
+		}
+	}
+
+	while (conn->sent < (len_size + size)) {
+		iovcnt = 0;
+		if (conn->sent < len_size) {
+			iov[iovcnt].iov_base = (char *) &conn->msg_len +
+					       conn->sent;
+			iov[iovcnt].iov_len  = len_size - conn->sent;
+			iovcnt++;
+			iov[iovcnt].iov_base = get_buf_data(conn->buffer);
+			iov[iovcnt].iov_len  = size;
+		} else {
+			iov[iovcnt].iov_base = get_buf_data(conn->buffer) +
+					       (conn->sent - len_size);
+			iov[iovcnt].iov_len  = size - (conn->sent - len_size);
+		}
+		iovcnt++;
+		n = writev(conn->fd, iov, iovcnt);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return 0;
+			return -1;
+		}
+		conn->sent += n;
+	}
+	return 1;
+}
+
+/*
+ * _conn_close - record the outcome of sending to a node and free the
+ *	connection for reuse. A node not reached is reported as not
+ *	responding unless the message was for srun, errno being logged.
+ */
+static void _conn_close(agent_conn_t *conn, state_t state,
+			slurm_msg_type_t msg_type)
+{
+	thd_t *thread_ptr = conn->thread_ptr;
+
+	if ((state != DSH_DONE) && !_is_srun_agent(msg_type))
+		_comm_err(thread_ptr->nodelist, msg_type);
+	if (conn->fd >= 0) {
+		(void) close(conn->fd);
+		conn->fd = -1;
+	}
+	if (conn->buffer) {
+		free_buf(conn->buffer);
+		conn->buffer = NULL;
+	}
+	thread_ptr->state = state;
+	thread_ptr->end_time = (time_t) difftime(time(NULL),
+						 thread_ptr->start_time);
 }
 
 static void _notify_slurmctld_jobs(agent_info_t *agent_ptr)
@@ -812,14 +1099,7 @@ static void *_thread_per_group_rpc(void *args)
 	xsignal_unblock(sig_array);
 	is_kill_msg = (	(msg_type == REQUEST_KILL_TIMELIMIT)	||
 			(msg_type == REQUEST_TERMINATE_JOB) );
-	srun_agent = (	(msg_type == SRUN_PING)			||
-			(msg_type == SRUN_EXEC)			||
-			(msg_type == SRUN_JOB_COMPLETE)		||
-			(msg_type == SRUN_STEP_MISSING)		||
-			(msg_type == SRUN_TIMEOUT)		||
-			(msg_type == SRUN_USER_MSG)		||
-			(msg_type == RESPONSE_RESOURCE_ALLOCATION) ||
-			(msg_type == SRUN_NODE_FAIL) );
+	srun_agent = _is_srun_agent(msg_type);
 
 	thread_ptr->start_time = time(NULL);
 
@@ -1579,6 +1859,7 @@ static int _batch_launch_defer(queued_request_t *queued_req_ptr)
 			     "updating end_time",
 			     launch_msg_ptr->job_id, delay_time);
 			job_ptr->end_time += delay_time;
+			job_record_changed(job_ptr);
 		}
 		queued_req_ptr->last_attempt = (time_t) 0;
 		return 0;
@@ -1597,6 +1878,7 @@ static int _batch_launch_defer(queued_request_t *queued_req_ptr)
 			     "updating end_time",
 			     launch_msg_ptr->job_id, delay_time);
 			job_ptr->end_time += delay_time;
+			job_record_changed(job_ptr);
 		}
 		queued_req_ptr->last_attempt = (time_t) 0;
 		return 0;
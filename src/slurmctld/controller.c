@@ -57,6 +57,7 @@
 #include <string.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 
 #include "slurm/slurm_errno.h"
 
@@ -88,6 +89,7 @@
 #include "src/slurmctld/acct_policy.h"
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/info_cache.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/job_submit.h"
 #include "src/slurmctld/licenses.h"
@@ -115,6 +117,12 @@
 #define MIN_CHECKIN_TIME  3	/* Nodes have this number of seconds to
 				 * check-in before we ping them */
 #define SHUTDOWN_WAIT     2	/* Time to wait for backup server shutdown */
+#define RPC_WORKER_MAX    64	/* Threads processing RPCs, created as needed */
+#define RPC_DAEMON_RESERVE 8	/* RPC worker threads which will not process
+				 * RPCs from user commands */
+#define RPC_RECV_TIMEOUT_DIV 4	/* A worker thread waits MessageTimeout divided
+				 * by this for a request to be read from an
+				 * accepted connection */
 
 #if (0)
 /* If defined and FastSchedule=0 in slurm.conf, then report the CPU count that a
@@ -201,7 +209,6 @@ static void         _remove_qos(slurmdb_qos_rec_t *rec);
 static void         _update_assoc(slurmdb_association_rec_t *rec);
 static void         _update_qos(slurmdb_qos_rec_t *rec);
 inline static int   _report_locks_set(void);
-static void *       _service_connection(void *arg);
 static int          _shutdown_backup_controller(int wait_time);
 static void *       _slurmctld_background(void *no_data);
 static void *       _slurmctld_rpc_mgr(void *no_data);
@@ -213,9 +220,57 @@ inline static void  _usage(char *prog_name);
 static bool         _valid_controller(void);
 static bool         _wait_for_server_thread(void);
 
-typedef struct connection_arg {
-	int newsockfd;
-} connection_arg_t;
+/*
+ * RPC worker pool. Accepted connections are queued for a worker thread to
+ * read the request, which is then queued by lane for processing. Requests
+ * from daemons (node registration, job and step completion, etc.) are
+ * processed before connections are read and those before requests from
+ * user commands, so daemon traffic is not delayed by bursts of user
+ * queries. Neither reading nor user requests are ever given the last
+ * RPC_DAEMON_RESERVE worker threads, or a quarter of the pool if that is
+ * smaller (but at least one). Of the rest, at most a quarter read
+ * requests, so slow or idle clients can not keep daemon requests from
+ * being read nor user requests from being processed.
+ */
+typedef enum {
+	RPC_LANE_RECV,		/* connections, request not yet read */
+	RPC_LANE_DAEMON,	/* requests from slurmd, slurmstepd, etc. */
+	RPC_LANE_USER,		/* requests from user commands */
+	RPC_LANE_CNT
+} rpc_lane_type_t;
+
+typedef struct rpc_work {
+	slurm_fd_t newsockfd;
+	slurm_msg_t *msg;	/* NULL until request read */
+	struct timeval queue_time;
+	struct rpc_work *next;
+} rpc_work_t;
+
+typedef struct rpc_lane {
+	rpc_work_t *head;
+	rpc_work_t *tail;
+	uint32_t depth;		/* entries queued */
+	uint32_t depth_max;
+	uint32_t active;	/* entries being processed */
+	uint32_t rpc_cnt;	/* entries dequeued */
+	uint64_t wait_usec;	/* total time entries were queued */
+	uint32_t wait_usec_max;
+} rpc_lane_t;
+
+static char *rpc_lane_str[RPC_LANE_CNT] = { "receive", "daemon", "user" };
+static pthread_mutex_t rpc_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  rpc_queue_cond  = PTHREAD_COND_INITIALIZER;
+static rpc_lane_t rpc_lane[RPC_LANE_CNT];
+static uint32_t rpc_worker_cnt = 0;	/* worker threads created */
+static uint32_t rpc_worker_idle = 0;	/* worker threads waiting for work */
+
+static rpc_lane_type_t _rpc_lane_type(slurm_msg_type_t msg_type);
+static rpc_work_t *_rpc_queue_next(rpc_lane_type_t *lane_type);
+static bool         _rpc_queue_work(rpc_lane_type_t lane_type,
+				    rpc_work_t *work);
+static void         _rpc_process(rpc_work_t *work);
+static bool         _rpc_recv(rpc_work_t *work);
+static void *       _rpc_worker(void *no_data);
 
 /* main - slurmctld main function, start various threads and process RPCs */
 int main(int argc, char *argv[])
@@ -583,6 +638,8 @@ int main(int argc, char *argv[])
 		pthread_join(slurmctld_config.thread_id_sig,  NULL);
 		pthread_join(slurmctld_config.thread_id_rpc,  NULL);
 		pthread_join(slurmctld_config.thread_id_save, NULL);
+		info_cache_fini();	/* no RPCs remain to use it */
+		rpc_queue_log_stats();
 
 		if (running_cache) {
 			/* break out and end the association cache
@@ -850,7 +907,8 @@ static void _sig_handler(int signal)
 {
 }
 
-/* _slurmctld_rpc_mgr - Read incoming RPCs and create pthread for each */
+/* _slurmctld_rpc_mgr - Accept incoming RPCs and queue them for the RPC
+ *	worker threads */
 static void *_slurmctld_rpc_mgr(void *no_data)
 {
 	slurm_fd_t newsockfd;
@@ -859,12 +917,9 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	slurm_addr_t cli_addr, srv_addr;
 	uint16_t port;
 	char ip[32];
-	pthread_t thread_id_rpc_req;
-	pthread_attr_t thread_attr_rpc_req;
-	int no_thread;
 	int fd_next = 0, i, nports;
 	fd_set rfds;
-	connection_arg_t *conn_arg = NULL;
+	rpc_work_t *work = NULL;
 	/* Locks: Read config */
 	slurmctld_lock_t config_read_lock = {
 		READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
@@ -875,12 +930,6 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	(void) pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 	debug3("_slurmctld_rpc_mgr pid = %u", getpid());
 
-	/* threads to process individual RPC's are detached */
-	slurm_attr_init(&thread_attr_rpc_req);
-	if (pthread_attr_setdetachstate
-	    (&thread_attr_rpc_req, PTHREAD_CREATE_DETACHED))
-		fatal("pthread_attr_setdetachstate %m");
-
 	/* set node_addr to bind to (NULL means any) */
 	if (slurmctld_conf.backup_controller && slurmctld_conf.backup_addr &&
 	    (strcmp(node_name, slurmctld_conf.backup_controller) == 0) &&
@@ -956,26 +1005,16 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 			_free_server_thread();
 			continue;
 		}
-		conn_arg = xmalloc(sizeof(connection_arg_t));
-		conn_arg->newsockfd = newsockfd;
-		if (slurmctld_config.shutdown_time)
-			no_thread = 1;
-		else if (pthread_create(&thread_id_rpc_req,
-					&thread_attr_rpc_req,
-					_service_connection,
-					(void *) conn_arg)) {
-			error("pthread_create: %m");
-			no_thread = 1;
-		} else
-			no_thread = 0;
-
-		if (no_thread) {
-			_service_connection((void *) conn_arg);
+		work = xmalloc(sizeof(rpc_work_t));
+		work->newsockfd = newsockfd;
+		if (slurmctld_config.shutdown_time ||
+		    !_rpc_queue_work(RPC_LANE_RECV, work)) {
+			if (_rpc_recv(work))
+				_rpc_process(work);
 		}
 	}
 
 	debug3("_slurmctld_rpc_mgr shutting down");
-	slurm_attr_destroy(&thread_attr_rpc_req);
 	for (i=0; i<nports; i++)
 		(void) slurm_shutdown_msg_engine(sockfd[i]);
 	xfree(sockfd);
@@ -984,30 +1023,174 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	return NULL;
 }
 
+/* Return the lane in which to queue a request of the given type */
+static rpc_lane_type_t _rpc_lane_type(slurm_msg_type_t msg_type)
+{
+	switch (msg_type) {
+	case MESSAGE_NODE_REGISTRATION_STATUS:
+	case MESSAGE_EPILOG_COMPLETE:
+	case REQUEST_COMPLETE_BATCH_SCRIPT:
+	case REQUEST_STEP_COMPLETE:
+	case REQUEST_CHECKPOINT_COMP:
+	case REQUEST_CHECKPOINT_TASK_COMP:
+	case REQUEST_PING:
+	case REQUEST_CONTROL:
+	case REQUEST_TAKEOVER:
+	case REQUEST_SHUTDOWN:
+	case REQUEST_SHUTDOWN_IMMEDIATE:
+		return RPC_LANE_DAEMON;
+	default:
+		return RPC_LANE_USER;
+	}
+}
+
+/* Queue work in the specified lane, creating a worker thread if none is
+ * idle and fewer than RPC_WORKER_MAX exist.
+ * RET false if no worker thread exists to process the work, which is not
+ *	queued in that case */
+static bool _rpc_queue_work(rpc_lane_type_t lane_type, rpc_work_t *work)
+{
+	rpc_lane_t *lane = &rpc_lane[lane_type];
+	pthread_attr_t thread_attr;
+	pthread_t thread_id;
+	bool rc = true;
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	if ((rpc_worker_idle == 0) &&
+	    (rpc_worker_cnt < MIN(RPC_WORKER_MAX, max_server_threads))) {
+		slurm_attr_init(&thread_attr);
+		if (pthread_attr_setdetachstate(&thread_attr,
+						PTHREAD_CREATE_DETACHED))
+			fatal("pthread_attr_setdetachstate %m");
+		if (pthread_create(&thread_id, &thread_attr, _rpc_worker,
+				   NULL))
+			error("pthread_create: %m");
+		else
+			rpc_worker_cnt++;
+		slurm_attr_destroy(&thread_attr);
+	}
+	if (rpc_worker_cnt == 0) {
+		rc = false;
+	} else {
+		gettimeofday(&work->queue_time, NULL);
+		work->next = NULL;
+		if (lane->tail)
+			lane->tail->next = work;
+		else
+			lane->head = work;
+		lane->tail = work;
+		lane->depth++;
+		lane->depth_max = MAX(lane->depth_max, lane->depth);
+		pthread_cond_broadcast(&rpc_queue_cond);
+	}
+	slurm_mutex_unlock(&rpc_queue_mutex);
+	return rc;
+}
+
+/* Wait for and dequeue the next work for an RPC worker thread, from the
+ * daemon lane first, then the receive lane, then the user lane */
+static rpc_work_t *_rpc_queue_next(rpc_lane_type_t *lane_type)
+{
+	uint32_t daemon_reserve, recv_max, user_max;
+	rpc_work_t *work;
+	rpc_lane_t *lane;
+	struct timeval now;
+	uint32_t wait_usec;
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	user_max = MIN(RPC_WORKER_MAX, max_server_threads);
+	daemon_reserve = MIN(RPC_DAEMON_RESERVE, MAX(user_max / 4, 1));
+	if (user_max > daemon_reserve)
+		user_max -= daemon_reserve;
+	recv_max = MAX(user_max / 4, 1);
+	if (user_max > recv_max)
+		user_max -= recv_max;
+	rpc_worker_idle++;
+	while (1) {
+		if (rpc_lane[RPC_LANE_DAEMON].head)
+			*lane_type = RPC_LANE_DAEMON;
+		else if (rpc_lane[RPC_LANE_RECV].head &&
+			 (rpc_lane[RPC_LANE_RECV].active < recv_max))
+			*lane_type = RPC_LANE_RECV;
+		else if (rpc_lane[RPC_LANE_USER].head &&
+			 (rpc_lane[RPC_LANE_USER].active < user_max))
+			*lane_type = RPC_LANE_USER;
+		else {
+			pthread_cond_wait(&rpc_queue_cond, &rpc_queue_mutex);
+			continue;
+		}
+		break;
+	}
+	rpc_worker_idle--;
+
+	lane = &rpc_lane[*lane_type];
+	work = lane->head;
+	lane->head = work->next;
+	if (lane->head == NULL)
+		lane->tail = NULL;
+	lane->depth--;
+	lane->active++;
+	lane->rpc_cnt++;
+	gettimeofday(&now, NULL);
+	wait_usec = (now.tv_sec  - work->queue_time.tv_sec) * 1000000 +
+		    (now.tv_usec - work->queue_time.tv_usec);
+	lane->wait_usec += wait_usec;
+	lane->wait_usec_max = MAX(lane->wait_usec_max, wait_usec);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+
+	return work;
+}
+
+/* _rpc_worker - RPC worker thread, reads and processes queued requests */
+static void *_rpc_worker(void *no_data)
+{
+	rpc_lane_type_t lane_type;
+	rpc_work_t *work;
+
+	while (1) {
+		work = _rpc_queue_next(&lane_type);
+		if (lane_type != RPC_LANE_RECV)
+			_rpc_process(work);
+		else if (_rpc_recv(work) &&
+			 !_rpc_queue_work(_rpc_lane_type(work->msg->msg_type),
+					  work))
+			_rpc_process(work);
+
+		slurm_mutex_lock(&rpc_queue_mutex);
+		rpc_lane[lane_type].active--;
+		if (lane_type != RPC_LANE_DAEMON)
+			pthread_cond_broadcast(&rpc_queue_cond);
+		slurm_mutex_unlock(&rpc_queue_mutex);
+	}
+	return NULL;
+}
+
 /*
- * _service_connection - service the RPC
- * IN/OUT arg - really just the connection's file descriptor, freed
- *	upon completion
- * RET - NULL
+ * _rpc_recv - read the request from an accepted connection
+ * IN/OUT work - the connection, freed on failure
+ * RET true if a request was read into work->msg
  */
-static void *_service_connection(void *arg)
+static bool _rpc_recv(rpc_work_t *work)
 {
-	connection_arg_t *conn = (connection_arg_t *) arg;
-	void *return_code = NULL;
 	slurm_msg_t *msg = xmalloc(sizeof(slurm_msg_t));
+	int recv_timeout;
 
+	/* Clients send their request as soon as they connect, so a fraction
+	 * of MessageTimeout keeps slow or idle ones from holding workers */
+	recv_timeout = MAX(slurm_get_msg_timeout() * 1000 /
+			   RPC_RECV_TIMEOUT_DIV, 1000);
 	slurm_msg_t_init(msg);
 	/*
 	 * slurm_receive_msg sets msg connection fd to accepted fd. This allows
 	 * possibility for slurmctld_req() to close accepted connection.
 	 */
-	if(slurm_receive_msg(conn->newsockfd, msg, 0) != 0) {
+	if(slurm_receive_msg(work->newsockfd, msg, recv_timeout) != 0) {
 		error("slurm_receive_msg: %m");
 		/* close should only be called when the socket implementation
 		 * is being used the following call will be a no-op in a
 		 * message/mongo implementation */
 		/* close the new socket */
-		slurm_close_accepted_conn(conn->newsockfd);
+		slurm_close_accepted_conn(work->newsockfd);
 		goto cleanup;
 	}
 
@@ -1015,20 +1198,57 @@ static void *_service_connection(void *arg)
 		if (errno == SLURM_PROTOCOL_VERSION_ERROR) {
 			slurm_send_rc_msg(msg, SLURM_PROTOCOL_VERSION_ERROR);
 		} else
-			info("_service_connection/slurm_receive_msg %m");
-	} else {
-		/* process the request */
-		slurmctld_req(msg);
+			info("_rpc_recv/slurm_receive_msg %m");
+		if (slurm_close_accepted_conn(work->newsockfd) < 0)
+			error ("close(%d): %m",  work->newsockfd);
+		goto cleanup;
 	}
-	if ((conn->newsockfd >= 0)
-	    && slurm_close_accepted_conn(conn->newsockfd) < 0)
-		error ("close(%d): %m",  conn->newsockfd);
+
+	work->msg = msg;
+	return true;
 
 cleanup:
 	slurm_free_msg(msg);
-	xfree(arg);
+	xfree(work);
+	_free_server_thread();
+	return false;
+}
+
+/*
+ * _rpc_process - process a request read by _rpc_recv()
+ * IN work - the connection and request, freed upon completion
+ */
+static void _rpc_process(rpc_work_t *work)
+{
+	slurmctld_req(work->msg);
+	if ((work->newsockfd >= 0)
+	    && slurm_close_accepted_conn(work->newsockfd) < 0)
+		error ("close(%d): %m",  work->newsockfd);
+
+	slurm_free_msg(work->msg);
+	xfree(work);
 	_free_server_thread();
-	return return_code;
+}
+
+/* rpc_queue_log_stats - Log request counts, queue depths and times queued
+ *	for each lane of the RPC worker pool */
+extern void rpc_queue_log_stats(void)
+{
+	rpc_lane_t *lane;
+	int i;
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	info("RPC worker threads: %u", rpc_worker_cnt);
+	for (i = 0; i < RPC_LANE_CNT; i++) {
+		lane = &rpc_lane[i];
+		info("RPC %s queue: count=%u depth=%u max_depth=%u "
+		     "avg_wait=%"PRIu64" usec max_wait=%u usec",
+		     rpc_lane_str[i], lane->rpc_cnt, lane->depth,
+		     lane->depth_max,
+		     lane->rpc_cnt ? (lane->wait_usec / lane->rpc_cnt) : 0,
+		     lane->wait_usec_max);
+	}
+	slurm_mutex_unlock(&rpc_queue_mutex);
 }
 
 /* Increment slurmctld_config.server_thread_count and don't return
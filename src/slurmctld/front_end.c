@@ -777,6 +777,7 @@ extern void sync_front_end_state(void)
 				      job_ptr->batch_host, job_ptr->job_id);
 				job_ptr->job_state = JOB_NODE_FAIL |
 						     JOB_COMPLETING;
+				job_record_changed(job_ptr);
 			} else if (job_ptr->front_end_ptr == NULL) {
 				info("front end node %s has vanished",
 				     job_ptr->batch_host);
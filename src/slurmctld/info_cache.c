@@ -0,0 +1,607 @@
+/*****************************************************************************\
+ *  info_cache.c - Cache of packed job, node and partition information
+ *	shared by all clients issuing the same type of request.
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/pack.h"
+#include "src/common/xmalloc.h"
+
+#include "src/slurmctld/info_cache.h"
+#include "src/slurmctld/slurmctld.h"
+
+/* Maximum number of removed job IDs remembered per cache entry. Clients
+ * whose previous response predates the oldest one get a full response. */
+#define INFO_TOMB_MAX	16384
+
+/* A job record's position in a snapshot, ordered by job ID */
+typedef struct info_rec_order {
+	uint32_t job_id;
+	uint32_t inx;
+} info_rec_order_t;
+
+/* Location and change time of each job record in a snapshot */
+struct info_rec_index {
+	pack_index_t pack;		/* records in packed order */
+	time_t   *rec_modified;		/* time record's content last changed */
+	info_rec_order_t *order;	/* records sorted by job ID */
+};
+
+/* A job which disappeared from a snapshot (purged or no longer visible) */
+typedef struct info_tomb {
+	uint32_t job_id;
+	time_t   time;		/* pack_time of first snapshot without it */
+} info_tomb_t;
+
+/* One cached response, packed for a specific request variant */
+typedef struct info_cache_entry {
+	uint16_t show_flags;
+	bool     all_view;	/* SHOW_ALL or super-user */
+	uint16_t protocol_version;
+	time_t   conf_update;	/* slurmctld_conf.last_update when packed */
+	time_t   data_update;	/* primary record update time when packed */
+	time_t   aux_update;	/* secondary record update time when packed */
+	time_t   pack_time;
+	info_snapshot_t *snapshot;
+	/* job entries only, for deltas */
+	time_t   epoch;		/* pack_time of entry's first snapshot */
+	time_t   tomb_horizon;	/* time of latest tombstone discarded */
+	uint32_t tomb_cnt;
+	info_tomb_t *tomb;	/* removed jobs, oldest first */
+} info_cache_entry_t;
+
+typedef struct info_cache_stats {
+	uint32_t hits;		/* requests served from the cache */
+	uint32_t rebuilds;	/* snapshots packed into the cache */
+	uint32_t bypass;	/* user-specific requests, packed uncached */
+	uint32_t deltas;	/* delta responses sent */
+} info_cache_stats_t;
+
+static char *cache_type_str[INFO_CACHE_TYPE_CNT] = {
+	"job", "node", "partition" };
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t build_mutex[INFO_CACHE_TYPE_CNT] = {
+	PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_MUTEX_INITIALIZER };
+static List cache_list[INFO_CACHE_TYPE_CNT];
+static info_cache_stats_t cache_stats[INFO_CACHE_TYPE_CNT];
+
+/* Release a snapshot reference, cache_mutex must be locked */
+static void _snapshot_unref(info_snapshot_t *snapshot)
+{
+	xassert(snapshot->ref_cnt > 0);
+	if (--snapshot->ref_cnt == 0) {
+		if (snapshot->index) {
+			xfree(snapshot->index->pack.rec_id);
+			xfree(snapshot->index->pack.rec_offset);
+			xfree(snapshot->index->rec_modified);
+			xfree(snapshot->index->order);
+			xfree(snapshot->index);
+		}
+		xfree(snapshot->data);
+		xfree(snapshot);
+	}
+}
+
+/* Free a cache entry, cache_mutex must be locked */
+static void _entry_free(void *x)
+{
+	info_cache_entry_t *entry = (info_cache_entry_t *) x;
+
+	if (entry) {
+		_snapshot_unref(entry->snapshot);
+		xfree(entry->tomb);
+		xfree(entry);
+	}
+}
+
+static int _order_cmp(const void *x, const void *y)
+{
+	const info_rec_order_t *rec1 = (const info_rec_order_t *) x;
+	const info_rec_order_t *rec2 = (const info_rec_order_t *) y;
+
+	if (rec1->job_id < rec2->job_id)
+		return -1;
+	if (rec1->job_id > rec2->job_id)
+		return 1;
+	return 0;
+}
+
+/* Pack a snapshot's records, indexing them by job ID for job snapshots.
+ * Caller must hold the locks required by the pack function. */
+static void _pack_snapshot(info_cache_type_t type, info_snapshot_t *snapshot,
+			   uint16_t show_flags, uid_t uid,
+			   uint16_t protocol_version)
+{
+	struct info_rec_index *index;
+	uint32_t i;
+
+	snapshot->pack_time = time(NULL);
+	switch (type) {
+	case INFO_CACHE_JOB:
+		index = xmalloc(sizeof(struct info_rec_index));
+		pack_filtered_jobs(&snapshot->data, &snapshot->size,
+				   show_flags, uid, protocol_version,
+				   NULL, &index->pack);
+		index->rec_modified = xmalloc(sizeof(time_t) *
+					      (index->pack.rec_cnt + 1));
+		index->order = xmalloc(sizeof(info_rec_order_t) *
+				       (index->pack.rec_cnt + 1));
+		for (i = 0; i < index->pack.rec_cnt; i++) {
+			index->order[i].job_id = index->pack.rec_id[i];
+			index->order[i].inx = i;
+		}
+		qsort(index->order, index->pack.rec_cnt,
+		      sizeof(info_rec_order_t), _order_cmp);
+		snapshot->index = index;
+		break;
+	case INFO_CACHE_NODE:
+		pack_all_node(&snapshot->data, &snapshot->size,
+			      show_flags, uid, protocol_version);
+		break;
+	default:
+		pack_all_part(&snapshot->data, &snapshot->size,
+			      show_flags, uid, protocol_version);
+		break;
+	}
+}
+
+/* Return the packed size of a snapshot's record */
+static uint32_t _rec_size(info_snapshot_t *snapshot, uint32_t inx)
+{
+	pack_index_t *pack = &snapshot->index->pack;
+
+	if ((inx + 1) < pack->rec_cnt)
+		return pack->rec_offset[inx + 1] - pack->rec_offset[inx];
+	return snapshot->size - pack->rec_offset[inx];
+}
+
+/* Set the modification time of each record in a new job snapshot by
+ * comparing its packed bytes with the previous snapshot. Records which are
+ * unchanged keep their old time, others get the new snapshot's pack_time.
+ * Job IDs present only in the old snapshot are returned in removed_ids.
+ * Neither snapshot can change while build_mutex is held. */
+static void _diff_snapshot(info_snapshot_t *old, info_snapshot_t *new,
+			   uint32_t **removed_ids, uint32_t *removed_cnt)
+{
+	struct info_rec_index *old_inx, *new_inx = new->index;
+	uint32_t i = 0, j = 0, old_cnt = 0, new_cnt = new_inx->pack.rec_cnt;
+	uint32_t new_rec, old_rec, size;
+
+	*removed_ids = NULL;
+	*removed_cnt = 0;
+	if (old && old->index) {
+		old_inx = old->index;
+		old_cnt = old_inx->pack.rec_cnt;
+		*removed_ids = xmalloc(sizeof(uint32_t) * (old_cnt + 1));
+	} else
+		old_inx = NULL;
+
+	while (j < new_cnt) {
+		new_rec = new_inx->order[j].inx;
+		if ((i < old_cnt) &&
+		    (old_inx->order[i].job_id < new_inx->order[j].job_id)) {
+			(*removed_ids)[(*removed_cnt)++] =
+				old_inx->order[i++].job_id;
+			continue;
+		}
+		new_inx->rec_modified[new_rec] = new->pack_time;
+		if ((i < old_cnt) &&
+		    (old_inx->order[i].job_id == new_inx->order[j].job_id)) {
+			old_rec = old_inx->order[i++].inx;
+			size = _rec_size(new, new_rec);
+			if ((size == _rec_size(old, old_rec)) &&
+			    !memcmp(new->data + new_inx->pack.rec_offset[new_rec],
+				    old->data + old_inx->pack.rec_offset[old_rec],
+				    size)) {
+				new_inx->rec_modified[new_rec] =
+					old_inx->rec_modified[old_rec];
+			}
+		}
+		j++;
+	}
+	while (i < old_cnt)
+		(*removed_ids)[(*removed_cnt)++] = old_inx->order[i++].job_id;
+}
+
+/* Record removed job IDs in an entry, cache_mutex must be locked */
+static void _add_tombs(info_cache_entry_t *entry, uint32_t *removed_ids,
+		       uint32_t removed_cnt, time_t pack_time)
+{
+	uint32_t i, drop;
+
+	if (removed_cnt == 0)
+		return;
+	if ((entry->tomb_cnt + removed_cnt) > INFO_TOMB_MAX) {
+		/* Discard the oldest half, or more if needed */
+		drop = MAX(entry->tomb_cnt / 2,
+			   entry->tomb_cnt + removed_cnt - INFO_TOMB_MAX);
+		if (drop >= entry->tomb_cnt) {
+			entry->tomb_horizon = pack_time;
+			entry->tomb_cnt = 0;
+			return;
+		}
+		entry->tomb_horizon = entry->tomb[drop - 1].time;
+		memmove(entry->tomb, entry->tomb + drop,
+			sizeof(info_tomb_t) * (entry->tomb_cnt - drop));
+		entry->tomb_cnt -= drop;
+	}
+	xrealloc(entry->tomb, sizeof(info_tomb_t) *
+		 (entry->tomb_cnt + removed_cnt));
+	for (i = 0; i < removed_cnt; i++) {
+		entry->tomb[entry->tomb_cnt].job_id = removed_ids[i];
+		entry->tomb[entry->tomb_cnt].time = pack_time;
+		entry->tomb_cnt++;
+	}
+}
+
+/* Get the update times of the records a cache type depends upon */
+static void _get_update_times(info_cache_type_t type,
+			      time_t *data_update, time_t *aux_update)
+{
+	switch (type) {
+	case INFO_CACHE_JOB:
+		*data_update = last_job_update;
+		*aux_update  = last_part_update;
+		break;
+	case INFO_CACHE_NODE:
+		*data_update = last_node_update;
+		*aux_update  = last_part_update;
+		break;
+	default:
+		*data_update = last_part_update;
+		*aux_update  = last_node_update;
+		break;
+	}
+}
+
+/* Return true if any partition restricts access by group. The visibility
+ * of such partitions (and their jobs and nodes) differs between users. */
+static bool _part_group_limits(void)
+{
+	ListIterator part_iterator;
+	struct part_record *part_ptr;
+	bool rc = false;
+
+	part_iterator = list_iterator_create(part_list);
+	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
+		if (part_ptr->allow_groups) {
+			rc = true;
+			break;
+		}
+	}
+	list_iterator_destroy(part_iterator);
+
+	return rc;
+}
+
+/* Return true if the packed output of this request is identical for every
+ * user with the same view (all or visible partitions only) */
+static bool _cacheable(info_cache_type_t type, uint16_t show_flags,
+		       uid_t uid)
+{
+	if ((type == INFO_CACHE_JOB) &&
+	    ((slurmctld_conf.private_data & PRIVATE_DATA_JOBS) ||
+	     (show_flags & SHOW_DETAIL)))
+		return false;
+	if ((show_flags & SHOW_ALL) || (uid == 0))
+		return true;
+	return !_part_group_limits();
+}
+
+/* Find the cache entry for a request variant, cache_mutex must be locked */
+static info_cache_entry_t *_find_entry(info_cache_type_t type,
+				       uint16_t show_flags, bool all_view,
+				       uint16_t protocol_version)
+{
+	ListIterator iter;
+	info_cache_entry_t *entry;
+
+	if (cache_list[type] == NULL)
+		return NULL;
+
+	iter = list_iterator_create(cache_list[type]);
+	while ((entry = (info_cache_entry_t *) list_next(iter))) {
+		if ((entry->show_flags == show_flags) &&
+		    (entry->all_view == all_view) &&
+		    (entry->protocol_version == protocol_version))
+			break;
+	}
+	list_iterator_destroy(iter);
+
+	return entry;
+}
+
+/* Return true if no records changed since the entry was packed.
+ * Update times have a one second resolution, so a snapshot packed in the
+ * same second as the last update may be missing later changes made within
+ * that second and is never reused. A job snapshot also expires once one of
+ * its finished jobs passes MinJobAge, as that job would no longer be
+ * packed even though no job record changed. */
+static bool _entry_current(info_cache_type_t type, info_cache_entry_t *entry)
+{
+	struct info_rec_index *index = entry->snapshot->index;
+	time_t data_update, aux_update;
+
+	_get_update_times(type, &data_update, &aux_update);
+	if ((entry->conf_update != slurmctld_conf.last_update) ||
+	    (entry->data_update != data_update) ||
+	    (entry->aux_update  != aux_update))
+		return false;
+	if ((entry->pack_time <= data_update) ||
+	    (entry->pack_time <= aux_update))
+		return false;
+	if (index && index->pack.expire_time &&
+	    (time(NULL) >= index->pack.expire_time))
+		return false;
+	return true;
+}
+
+/* Return a referenced snapshot if a current one is cached,
+ * cache_mutex must be locked */
+static info_snapshot_t *_lookup(info_cache_type_t type, uint16_t show_flags,
+				bool all_view, uint16_t protocol_version)
+{
+	info_cache_entry_t *entry;
+
+	entry = _find_entry(type, show_flags, all_view, protocol_version);
+	if (entry && _entry_current(type, entry)) {
+		entry->snapshot->ref_cnt++;
+		cache_stats[type].hits++;
+		return entry->snapshot;
+	}
+	return NULL;
+}
+
+extern info_snapshot_t *info_cache_lookup(info_cache_type_t type,
+					  uint16_t show_flags, uid_t uid,
+					  uint16_t protocol_version)
+{
+	info_snapshot_t *snapshot;
+	bool all_view = ((show_flags & SHOW_ALL) || (uid == 0));
+
+	xassert(type < INFO_CACHE_TYPE_CNT);
+	if (!_cacheable(type, show_flags, uid))
+		return NULL;
+
+	slurm_mutex_lock(&cache_mutex);
+	snapshot = _lookup(type, show_flags, all_view, protocol_version);
+	slurm_mutex_unlock(&cache_mutex);
+
+	return snapshot;
+}
+
+extern info_snapshot_t *info_cache_pack(info_cache_type_t type,
+					uint16_t show_flags, uid_t uid,
+					uint16_t protocol_version)
+{
+	info_cache_entry_t *entry;
+	info_snapshot_t *snapshot, *old = NULL;
+	bool all_view = ((show_flags & SHOW_ALL) || (uid == 0));
+	time_t data_update, aux_update;
+	uint32_t *removed_ids = NULL, removed_cnt = 0;
+
+	xassert(type < INFO_CACHE_TYPE_CNT);
+	snapshot = xmalloc(sizeof(info_snapshot_t));
+	snapshot->ref_cnt = 1;
+	if (!_cacheable(type, show_flags, uid)) {
+		_pack_snapshot(type, snapshot, show_flags, uid,
+			       protocol_version);
+		slurm_mutex_lock(&cache_mutex);
+		cache_stats[type].bypass++;
+		slurm_mutex_unlock(&cache_mutex);
+		return snapshot;
+	}
+
+	/* Only one thread rebuilds a given cache type at a time, others
+	 * wait here and then pick up the new snapshot */
+	slurm_mutex_lock(&build_mutex[type]);
+	slurm_mutex_lock(&cache_mutex);
+	if (cache_list[type] == NULL)
+		cache_list[type] = list_create(_entry_free);
+	else {
+		info_snapshot_t *cached = _lookup(type, show_flags, all_view,
+						  protocol_version);
+		if (cached) {
+			slurm_mutex_unlock(&cache_mutex);
+			slurm_mutex_unlock(&build_mutex[type]);
+			xfree(snapshot);
+			return cached;
+		}
+		entry = _find_entry(type, show_flags, all_view,
+				    protocol_version);
+		if (entry) {
+			old = entry->snapshot;
+			old->ref_cnt++;
+		}
+	}
+	slurm_mutex_unlock(&cache_mutex);
+
+	_get_update_times(type, &data_update, &aux_update);
+	_pack_snapshot(type, snapshot, show_flags, uid, protocol_version);
+	if (snapshot->index)
+		_diff_snapshot(old, snapshot, &removed_ids, &removed_cnt);
+
+	slurm_mutex_lock(&cache_mutex);
+	if (old)
+		_snapshot_unref(old);
+	entry = _find_entry(type, show_flags, all_view, protocol_version);
+	if (entry) {
+		_snapshot_unref(entry->snapshot);
+	} else {
+		entry = xmalloc(sizeof(info_cache_entry_t));
+		entry->show_flags = show_flags;
+		entry->all_view = all_view;
+		entry->protocol_version = protocol_version;
+		entry->epoch = snapshot->pack_time;
+		list_append(cache_list[type], entry);
+	}
+	_add_tombs(entry, removed_ids, removed_cnt, snapshot->pack_time);
+	entry->conf_update = slurmctld_conf.last_update;
+	entry->data_update = data_update;
+	entry->aux_update  = aux_update;
+	entry->pack_time   = snapshot->pack_time;
+	entry->snapshot    = snapshot;
+	snapshot->ref_cnt++;		/* one for the cache, one for caller */
+	cache_stats[type].rebuilds++;
+	debug3("info_cache: rebuilt %s snapshot, size=%d",
+	       cache_type_str[type], snapshot->size);
+	slurm_mutex_unlock(&cache_mutex);
+	slurm_mutex_unlock(&build_mutex[type]);
+	xfree(removed_ids);
+
+	return snapshot;
+}
+
+extern int info_cache_job_delta(info_snapshot_t *snapshot,
+				uint16_t show_flags, uid_t uid,
+				uint16_t protocol_version, time_t since,
+				char **buffer_ptr, int *buffer_size)
+{
+	info_cache_entry_t *entry;
+	struct info_rec_index *index;
+	bool found = false;
+	bool all_view = ((show_flags & SHOW_ALL) || (uid == 0));
+	uint32_t i, inx, rec_cnt = 0, removed_cnt = 0, *removed_ids = NULL;
+	Buf buffer;
+
+	buffer_ptr[0] = NULL;
+	*buffer_size = 0;
+
+	/* Changes made within the second of the client's response may not
+	 * be in it, so records modified in that second are sent again */
+	slurm_mutex_lock(&cache_mutex);
+	entry = _find_entry(INFO_CACHE_JOB, show_flags, all_view,
+			    protocol_version);
+	if (entry && (entry->snapshot == snapshot) && snapshot->index &&
+	    (since > entry->epoch) && (since > entry->tomb_horizon)) {
+		found = true;
+		for (i = entry->tomb_cnt; i > 0; i--) {
+			if (entry->tomb[i - 1].time < since)
+				break;
+		}
+		removed_cnt = entry->tomb_cnt - i;
+		if (removed_cnt) {
+			removed_ids = xmalloc(sizeof(uint32_t) * removed_cnt);
+			for (inx = 0; inx < removed_cnt; inx++)
+				removed_ids[inx] = entry->tomb[i + inx].job_id;
+		}
+	}
+	slurm_mutex_unlock(&cache_mutex);
+	if (!found)
+		return SLURM_ERROR;
+
+	index = snapshot->index;
+	for (i = 0; i < index->pack.rec_cnt; i++) {
+		if (index->rec_modified[i] >= since)
+			rec_cnt++;
+	}
+	if ((rec_cnt * 2) > index->pack.rec_cnt) {
+		/* a full response is about as small and cheaper to use */
+		xfree(removed_ids);
+		return SLURM_ERROR;
+	}
+
+	/* Same format as RESPONSE_JOB_INFO plus the removed job IDs */
+	buffer = init_buf(BUF_SIZE);
+	pack32(rec_cnt, buffer);
+	pack_time(snapshot->pack_time, buffer);
+	for (i = 0; i < index->pack.rec_cnt; i++) {
+		if (index->rec_modified[i] < since)
+			continue;
+		packmem_array(snapshot->data + index->pack.rec_offset[i],
+			      _rec_size(snapshot, i), buffer);
+	}
+	pack32_array(removed_ids, removed_cnt, buffer);
+	xfree(removed_ids);
+
+	slurm_mutex_lock(&cache_mutex);
+	cache_stats[INFO_CACHE_JOB].deltas++;
+	slurm_mutex_unlock(&cache_mutex);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+	return SLURM_SUCCESS;
+}
+
+extern void info_cache_release(info_snapshot_t *snapshot)
+{
+	if (snapshot == NULL)
+		return;
+
+	slurm_mutex_lock(&cache_mutex);
+	_snapshot_unref(snapshot);
+	slurm_mutex_unlock(&cache_mutex);
+}
+
+extern void info_cache_log_stats(void)
+{
+	int i;
+
+	slurm_mutex_lock(&cache_mutex);
+	for (i = 0; i < INFO_CACHE_TYPE_CNT; i++) {
+		info("Packed %s info cache: hits=%u rebuilds=%u uncached=%u "
+		     "deltas=%u", cache_type_str[i], cache_stats[i].hits,
+		     cache_stats[i].rebuilds, cache_stats[i].bypass,
+		     cache_stats[i].deltas);
+	}
+	slurm_mutex_unlock(&cache_mutex);
+}
+
+extern void info_cache_fini(void)
+{
+	int i;
+
+	info_cache_log_stats();
+
+	slurm_mutex_lock(&cache_mutex);
+	for (i = 0; i < INFO_CACHE_TYPE_CNT; i++) {
+		if (cache_list[i]) {
+			list_destroy(cache_list[i]);
+			cache_list[i] = NULL;
+		}
+	}
+	slurm_mutex_unlock(&cache_mutex);
+}
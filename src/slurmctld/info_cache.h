@@ -0,0 +1,119 @@
+/*****************************************************************************\
+ *  info_cache.h - Cache of packed job, node and partition information
+ *	shared by all clients issuing the same type of request.
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_INFO_CACHE_H
+#define _HAVE_INFO_CACHE_H
+
+#include "src/slurmctld/slurmctld.h"
+
+typedef enum {
+	INFO_CACHE_JOB,		/* pack_all_jobs() output */
+	INFO_CACHE_NODE,	/* pack_all_node() output */
+	INFO_CACHE_PART,	/* pack_all_part() output */
+	INFO_CACHE_TYPE_CNT
+} info_cache_type_t;
+
+/* A packed response. Read-only once built, it is shared by every RPC
+ * holding a reference and freed when the last reference is released. */
+typedef struct info_snapshot {
+	char    *data;		/* packed records */
+	int      size;		/* size of data in bytes */
+	uint32_t ref_cnt;	/* protected by the cache mutex */
+	time_t   pack_time;	/* time recorded in the response header */
+	struct info_rec_index *index;	/* job records only, for deltas */
+} info_snapshot_t;
+
+/*
+ * info_cache_lookup - Return a reference to the cached snapshot matching
+ *	this request if one exists and no relevant records changed since it
+ *	was packed.
+ * IN type - type of information requested
+ * IN show_flags - request's show_flags
+ * IN uid - uid of user making request
+ * IN protocol_version - protocol version of the response
+ * RET referenced snapshot or NULL. Release with info_cache_release().
+ * NOTE: Caller must hold at least read locks on the records being cached
+ *	and the configuration.
+ */
+extern info_snapshot_t *info_cache_lookup(info_cache_type_t type,
+					  uint16_t show_flags, uid_t uid,
+					  uint16_t protocol_version);
+
+/*
+ * info_cache_pack - Return a reference to a current snapshot for this
+ *	request, packing it if required. Concurrent requests for the same
+ *	stale snapshot rebuild it only once. Requests whose output depends
+ *	upon the user (private data, hidden partitions with group
+ *	restrictions, batch scripts) are packed but not cached.
+ * IN type, show_flags, uid, protocol_version - as info_cache_lookup()
+ * RET referenced snapshot. Release with info_cache_release().
+ * NOTE: Caller must hold the locks required by pack_all_jobs(),
+ *	pack_all_node() or pack_all_part() as appropriate.
+ */
+extern info_snapshot_t *info_cache_pack(info_cache_type_t type,
+					uint16_t show_flags, uid_t uid,
+					uint16_t protocol_version);
+
+/*
+ * info_cache_job_delta - Pack the records of a cached job snapshot which
+ *	changed since a client's previous response plus the IDs of jobs
+ *	removed since then, see RESPONSE_JOB_INFO_DELTA.
+ * IN snapshot - referenced job snapshot for this request
+ * IN show_flags, uid, protocol_version - as info_cache_lookup()
+ * IN since - last_update time from the client's previous response
+ * OUT buffer_ptr - the pointer is set to the allocated buffer
+ * OUT buffer_size - set to size of the buffer in bytes
+ * RET SLURM_SUCCESS or SLURM_ERROR if the client needs a full response
+ *	(snapshot not cached or superseded, no history that old, or most
+ *	records changed). No slurmctld locks are required.
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ */
+extern int info_cache_job_delta(info_snapshot_t *snapshot,
+				uint16_t show_flags, uid_t uid,
+				uint16_t protocol_version, time_t since,
+				char **buffer_ptr, int *buffer_size);
+
+/* info_cache_release - Release a reference obtained from info_cache_lookup()
+ *	or info_cache_pack(). No slurmctld locks are required. */
+extern void info_cache_release(info_snapshot_t *snapshot);
+
+/* info_cache_log_stats - Log hit and rebuild counts for each cache type */
+extern void info_cache_log_stats(void);
+
+/* info_cache_fini - Log statistics and free all cached snapshots */
+extern void info_cache_fini(void);
+
+#endif	/* !_HAVE_INFO_CACHE_H */
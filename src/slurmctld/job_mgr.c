@@ -87,6 +87,7 @@
 #include "src/slurmctld/preempt.h"
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/script_store.h"
 #include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/srun_comm.h"
@@ -99,6 +100,7 @@
 #define TOP_PRIORITY 0xffff0000	/* large, but leave headroom for higher */
 
 #define JOB_HASH_INX(_job_id)	(_job_id % hash_table_size)
+#define USER_HASH_INX(_user_id)	(_user_id % hash_table_size)
 
 /* Change JOB_STATE_VERSION value when changing the state save format */
 #define JOB_STATE_VERSION      "VER011"
@@ -106,6 +108,12 @@
 #define JOB_2_2_STATE_VERSION  "VER010"		/* SLURM version 2.2 */
 #define JOB_2_1_STATE_VERSION  "VER009"		/* SLURM version 2.1 */
 
+/* Record types of the job_state.journal file, see dump_all_job_state() */
+#define JOURNAL_JOB_ID_SEQ	1	/* new job_id_sequence */
+#define JOURNAL_JOB_SAVE	2	/* job record, as in job_state */
+#define JOURNAL_JOB_PURGE	3	/* job_id of record purged */
+#define JOURNAL_REC_HDR_SIZE	6	/* record type and size */
+
 #define JOB_CKPT_VERSION      "JOB_CKPT_002"
 #define JOB_2_2_CKPT_VERSION  "JOB_CKPT_002"	/* SLURM version 2.2 */
 #define JOB_2_1_CKPT_VERSION  "JOB_CKPT_001"	/* SLURM version 2.1 */
@@ -121,12 +129,32 @@ static int      hash_table_size = 0;
 static int      job_count = 0;		/* job's in the system */
 static uint32_t job_id_sequence = 0;	/* first job_id to assign new job */
 static struct   job_record **job_hash = NULL;
+static struct   job_record **user_hash = NULL;	/* jobs by user_id */
+static bool     user_hash_valid = false;	/* clear if user_id of some
+						 * job records not indexed */
 static bool     wiki_sched = false;
 static bool     wiki2_sched = false;
+static time_t   journal_time = 0;	/* time stamp of job_state snapshot
+					 * which job_state.journal follows,
+					 * zero to write a new snapshot */
+static uint32_t journal_size = 0;	/* bytes in job_state.journal */
+static uint32_t journal_job_id_seq = 0;	/* job_id_sequence last saved */
+static uint32_t *journal_purge_ids = NULL; /* jobs purged since last save */
+static int      journal_purge_cnt = 0, journal_purge_size = 0;
+static uint32_t *journal_change_ids = NULL; /* jobs changed since last save */
+static int      journal_change_cnt = 0, journal_change_size = 0;
+static pthread_mutex_t journal_change_mutex = PTHREAD_MUTEX_INITIALIZER;
+					/* protects journal_change_ids and
+					 * state_changed */
+static bool     journal_replay = false;	/* replaying job_state.journal,
+					 * records are replaced in memory
+					 * only */
+static uint32_t snapshot_size = 0;	/* bytes in job_state */
 static bool     wiki_sched_test = false;
 
 /* Local functions */
 static void _add_job_hash(struct job_record *job_ptr);
+static void _add_user_hash(struct job_record *job_ptr);
 static int  _checkpoint_job_record (struct job_record *job_ptr,
 				    char *image_dir);
 static int  _copy_job_desc_to_file(job_desc_msg_t * job_desc,
@@ -139,7 +167,10 @@ static job_desc_msg_t * _copy_job_record_to_job_desc(
 				struct job_record *job_ptr);
 static char *_copy_nodelist_no_dup(char *node_list);
 static void _del_batch_list_rec(void *x);
+static void _del_user_hash(struct job_record *job_ptr);
 static void _delete_job_desc_files(uint32_t job_id);
+static int  _dump_job_journal(void);
+static int  _dump_job_snapshot(void);
 static slurmdb_qos_rec_t *_determine_and_validate_qos(
 				slurmdb_association_rec_t *assoc_ptr,
 				slurmdb_qos_rec_t *qos_rec, int *error_code);
@@ -156,7 +187,11 @@ static int  _list_find_job_id(void *job_entry, void *key);
 static int  _list_find_job_old(void *job_entry, void *key);
 static int  _load_job_details(struct job_record *job_ptr, Buf buffer,
 			      uint16_t protocol_version);
+static int  _load_job_journal(time_t snapshot_time, bool id_only);
 static int  _load_job_state(Buf buffer,	uint16_t protocol_version);
+static void _journal_purge_add(uint32_t job_id);
+static void _journal_rec_end(uint32_t rec_offset, Buf buffer);
+static uint32_t _journal_rec_start(uint16_t rec_type, Buf buffer);
 static void _notify_srun_missing_step(struct job_record *job_ptr, int node_inx,
 				      time_t now, time_t node_boot_time);
 static int  _open_job_state_file(char **state_file);
@@ -168,10 +203,15 @@ static void _pack_pending_job_details(struct job_details *detail_ptr,
 				      Buf buffer,
 				      uint16_t protocol_version);
 static int  _purge_job_record(uint32_t job_id);
+static void _replay_purge_job_record(uint32_t job_id);
 static void _purge_missing_jobs(int node_inx, time_t now);
+static void _rebuild_job_hash(int new_size);
 static void _read_data_array_from_file(char *file_name, char ***data,
 				       uint32_t * size,
  				       struct job_record *job_ptr);
+static void _read_data_array(char *buffer, int pos, uint32_t rec_cnt,
+			     char *source, char ***data, uint32_t * size,
+			     struct job_record *job_ptr);
 static void _read_data_from_file(char *file_name, char **data);
 static char *_read_job_ckpt_file(char *ckpt_file, int *size_ptr);
 static void _remove_defunct_batch_dirs(List batch_dirs);
@@ -190,9 +230,7 @@ static int  _validate_job_create_req(job_desc_msg_t * job_desc);
 static int  _validate_job_desc(job_desc_msg_t * job_desc_msg, int allocate,
 			       uid_t submit_uid);
 static void _validate_job_files(List batch_dirs);
-static int  _write_data_to_file(char *file_name, char *data);
-static int  _write_data_array_to_file(char *file_name, char **data,
-				      uint32_t size);
+static int  _write_buf_to_fd(int fd, Buf buffer, char *file_name);
 static void _xmit_new_end_time(struct job_record *job_ptr);
 
 
@@ -256,7 +294,7 @@ void delete_job_details(struct job_record *job_entry)
 		return;
 
 	xassert (job_entry->details->magic == DETAILS_MAGIC);
-	if (IS_JOB_FINISHED(job_entry))
+	if (IS_JOB_FINISHED(job_entry) && !journal_replay)
 		_delete_job_desc_files(job_entry->job_id);
 
 	for (i=0; i<job_entry->details->argc; i++)
@@ -295,6 +333,9 @@ static void _delete_job_desc_files(uint32_t job_id)
 	char *dir_name, job_dir[20], *file_name;
 	struct stat sbuf;
 
+	script_store_remove(job_id);
+
+	/* Files of jobs saved before the script_store */
 	dir_name = slurm_get_state_save_location();
 
 	sprintf(job_dir, "/job.%d", job_id);
@@ -371,15 +412,196 @@ static slurmdb_qos_rec_t *_determine_and_validate_qos(
 
 /*
  * dump_all_job_state - save the state of all jobs to file for checkpoint
+ *	Only jobs changed since the last save are appended to the
+ *	job_state.journal file, until it grows to the size of the job_state
+ *	snapshot, which is then rewritten in full and the journal restarted.
  *	Changes here should be reflected in load_last_job_id() and
  *	load_all_job_state().
  * RET 0 or error code */
 int dump_all_job_state(void)
+{
+	if (journal_time && (journal_size < snapshot_size))
+		return _dump_job_journal();
+	return _dump_job_snapshot();
+}
+
+/* Start a job_state.journal record, its size is set by _journal_rec_end()
+ * RET offset of the record in buffer */
+static uint32_t _journal_rec_start(uint16_t rec_type, Buf buffer)
+{
+	uint32_t rec_offset = get_buf_offset(buffer);
+
+	pack16(rec_type, buffer);
+	pack32((uint32_t) 0, buffer);
+	return rec_offset;
+}
+
+static void _journal_rec_end(uint32_t rec_offset, Buf buffer)
+{
+	uint32_t end_offset = get_buf_offset(buffer);
+
+	set_buf_offset(buffer, rec_offset + sizeof(uint16_t));
+	pack32(end_offset - rec_offset - JOURNAL_REC_HDR_SIZE, buffer);
+	set_buf_offset(buffer, end_offset);
+}
+
+/* Note a purged job record for the next job_state.journal save.
+ * Called with job write lock set, the list is consumed by
+ * _dump_job_journal() and discarded by _dump_job_snapshot(). */
+static void _journal_purge_add(uint32_t job_id)
+{
+	if (journal_purge_cnt >= journal_purge_size) {
+		journal_purge_size = MAX(64, journal_purge_size * 2);
+		xrealloc(journal_purge_ids,
+			 sizeof(uint32_t) * journal_purge_size);
+	}
+	journal_purge_ids[journal_purge_cnt++] = job_id;
+}
+
+/*
+ * job_record_changed - note that a job record's saved state has changed, so
+ *	the next dump_all_job_state() writes it to job_state.journal.
+ *	The list is consumed by _dump_job_journal() and discarded by
+ *	_dump_job_snapshot(). journal_change_mutex serializes callers that
+ *	do not hold the job write lock, e.g. agent_retry().
+ * IN job_ptr - pointer to job changed
+ */
+extern void job_record_changed(struct job_record *job_ptr)
+{
+	if (journal_replay)
+		return;
+	slurm_mutex_lock(&journal_change_mutex);
+	if (!job_ptr->state_changed) {
+		job_ptr->state_changed = true;
+		if (journal_change_cnt >= journal_change_size) {
+			journal_change_size = MAX(64, journal_change_size * 2);
+			xrealloc(journal_change_ids,
+				 sizeof(uint32_t) * journal_change_size);
+		}
+		journal_change_ids[journal_change_cnt++] = job_ptr->job_id;
+	}
+	slurm_mutex_unlock(&journal_change_mutex);
+}
+
+/* Write a buffer's contents to a state save file
+ * RET 0 or error code */
+static int _write_buf_to_fd(int fd, Buf buffer, char *file_name)
+{
+	int pos = 0, nwrite = get_buf_offset(buffer), amount;
+	char *data = (char *)get_buf_data(buffer);
+
+	while (nwrite > 0) {
+		amount = write(fd, &data[pos], nwrite);
+		if (amount < 0) {
+			if (errno == EINTR)
+				continue;
+			error("Error writing file %s, %m", file_name);
+			return errno;
+		}
+		nwrite -= amount;
+		pos    += amount;
+	}
+	return 0;
+}
+
+/*
+ * _dump_job_journal - append the state of jobs changed since the last save,
+ *	jobs purged and any new job_id_sequence to job_state.journal.
+ *	Only jobs noted by job_record_changed() are packed.
+ * RET 0 or error code
+ */
+static int _dump_job_journal(void)
+{
+	int error_code = 0, log_fd, i, job_cnt = 0;
+	char *journal_file;
+	/* Locks: Read config and job */
+	slurmctld_lock_t job_read_lock =
+		{ READ_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
+	struct job_record *job_ptr;
+	Buf buffer = init_buf(BUF_SIZE);
+	uint32_t rec_offset;
+	DEF_TIMERS;
+
+	START_TIMER;
+	lock_slurmctld(job_read_lock);
+	/* Only this thread consumes journal_purge_ids, the job read lock
+	 * excludes all writers. journal_change_ids and state_changed may
+	 * also be set without the job write lock, see job_record_changed() */
+	for (i = 0; i < journal_purge_cnt; i++) {
+		rec_offset = _journal_rec_start(JOURNAL_JOB_PURGE, buffer);
+		pack32(journal_purge_ids[i], buffer);
+		_journal_rec_end(rec_offset, buffer);
+	}
+	journal_purge_cnt = 0;
+
+	if (journal_job_id_seq != job_id_sequence) {
+		journal_job_id_seq = job_id_sequence;
+		rec_offset = _journal_rec_start(JOURNAL_JOB_ID_SEQ, buffer);
+		pack32(journal_job_id_seq, buffer);
+		_journal_rec_end(rec_offset, buffer);
+	}
+
+	slurm_mutex_lock(&journal_change_mutex);
+	for (i = 0; i < journal_change_cnt; i++) {
+		job_ptr = find_job_record(journal_change_ids[i]);
+		if (!job_ptr || !job_ptr->state_changed)
+			continue;	/* purged since changed */
+		xassert (job_ptr->magic == JOB_MAGIC);
+		job_ptr->state_changed = false;
+		rec_offset = _journal_rec_start(JOURNAL_JOB_SAVE, buffer);
+		_dump_job_state(job_ptr, buffer);
+		_journal_rec_end(rec_offset, buffer);
+		job_cnt++;
+	}
+	journal_change_cnt = 0;
+	slurm_mutex_unlock(&journal_change_mutex);
+
+	journal_file = xstrdup(slurmctld_conf.state_save_location);
+	xstrcat(journal_file, "/job_state.journal");
+	unlock_slurmctld(job_read_lock);
+
+	if (get_buf_offset(buffer)) {
+		lock_state_files();
+		log_fd = open(journal_file, O_WRONLY | O_APPEND);
+		if (log_fd < 0) {
+			error("Can't save state, open file %s error %m",
+			      journal_file);
+			error_code = errno;
+		} else {
+			error_code = _write_buf_to_fd(log_fd, buffer,
+						      journal_file);
+			i = fsync_and_close(log_fd, "job journal");
+			if (i && !error_code)
+				error_code = i;
+		}
+		unlock_state_files();
+		if (error_code) {
+			/* Changes may be lost, save everything next time */
+			journal_time = 0;
+		} else
+			journal_size += get_buf_offset(buffer);
+	}
+	debug3("Journaled state of %d jobs, %u bytes", job_cnt,
+	       get_buf_offset(buffer));
+	xfree(journal_file);
+
+	free_buf(buffer);
+	END_TIMER2("dump_all_job_state");
+	return error_code;
+}
+
+/*
+ * _dump_job_snapshot - save the state of all jobs to the job_state file and
+ *	start an empty job_state.journal to follow it
+ * RET 0 or error code
+ */
+static int _dump_job_snapshot(void)
 {
 	/* Save high-water mark to avoid buffer growth with copies */
 	static int high_buffer_size = (1024 * 1024);
+	static time_t last_snapshot = (time_t) 0;
 	int error_code = 0, log_fd;
-	char *old_file, *new_file, *reg_file;
+	char *old_file, *new_file, *reg_file, *journal_file;
 	struct stat stat_buf;
 	/* Locks: Read config and job */
 	slurmctld_lock_t job_read_lock =
@@ -391,6 +613,11 @@ int dump_all_job_state(void)
 	DEF_TIMERS;
 
 	START_TIMER;
+	/* The time stamp identifies the snapshot to its journal */
+	if (now <= last_snapshot)
+		now = last_snapshot + 1;
+	last_snapshot = now;
+	journal_time = 0;
 	/* write header: version, time */
 	packstr(JOB_STATE_VERSION, buffer);
 	pack_time(now, buffer);
@@ -398,21 +625,26 @@ int dump_all_job_state(void)
 	if (slurmctld_conf.min_job_age > 0)
 		min_age = now  - slurmctld_conf.min_job_age;
 
+	lock_slurmctld(job_read_lock);
 	/*
 	 * write header: job id
 	 * This is needed so that the job id remains persistent even after
 	 * slurmctld is restarted.
 	 */
-	pack32( job_id_sequence, buffer);
+	journal_job_id_seq = job_id_sequence;
+	pack32(journal_job_id_seq, buffer);
 
 	debug3("Writing job id %u to header record of job_state file",
-	       job_id_sequence);
+	       journal_job_id_seq);
 
 	/* write individual job records */
-	lock_slurmctld(job_read_lock);
+	journal_purge_cnt = 0;
+	slurm_mutex_lock(&journal_change_mutex);
+	journal_change_cnt = 0;
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
+		job_ptr->state_changed = false;
 		if ((min_age > 0) && (job_ptr->end_time < min_age) &&
 		    (! IS_JOB_COMPLETING(job_ptr)) && IS_JOB_FINISHED(job_ptr))
 			continue;	/* job ready for purging, don't dump */
@@ -420,6 +652,7 @@ int dump_all_job_state(void)
 		_dump_job_state(job_ptr, buffer);
 	}
 	list_iterator_destroy(job_iterator);
+	slurm_mutex_unlock(&journal_change_mutex);
 
 	/* write the buffer to file */
 	old_file = xstrdup(slurmctld_conf.state_save_location);
@@ -428,6 +661,8 @@ int dump_all_job_state(void)
 	xstrcat(reg_file, "/job_state");
 	new_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(new_file, "/job_state.new");
+	journal_file = xstrdup(slurmctld_conf.state_save_location);
+	xstrcat(journal_file, "/job_state.journal");
 	unlock_slurmctld(job_read_lock);
 
 	if (stat(reg_file, &stat_buf) == 0) {
@@ -452,19 +687,10 @@ int dump_all_job_state(void)
 		      new_file);
 		error_code = errno;
 	} else {
-		int pos = 0, nwrite = get_buf_offset(buffer), amount, rc;
-		char *data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
-		while (nwrite > 0) {
-			amount = write(log_fd, &data[pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("Error writing file %s, %m", new_file);
-				error_code = errno;
-				break;
-			}
-			nwrite -= amount;
-			pos    += amount;
-		}
+		int rc;
+		high_buffer_size = MAX(get_buf_offset(buffer),
+				       high_buffer_size);
+		error_code = _write_buf_to_fd(log_fd, buffer, new_file);
 
 		rc = fsync_and_close(log_fd, "job");
 		if (rc && !error_code)
@@ -482,10 +708,29 @@ int dump_all_job_state(void)
 			debug4("unable to create link for %s -> %s: %m",
 			       new_file, reg_file);
 		(void) unlink(new_file);
+		snapshot_size = get_buf_offset(buffer);
+
+		/* Start a journal of changes to this snapshot */
+		set_buf_offset(buffer, 0);
+		packstr(JOB_STATE_VERSION, buffer);
+		pack_time(now, buffer);
+		log_fd = creat(journal_file, 0600);
+		if (log_fd < 0) {
+			error("Can't create file %s error %m", journal_file);
+		} else {
+			int rc = _write_buf_to_fd(log_fd, buffer,
+						  journal_file);
+			if ((fsync_and_close(log_fd, "job journal") == 0) &&
+			    (rc == 0)) {
+				journal_size = get_buf_offset(buffer);
+				journal_time = now;
+			}
+		}
 	}
 	xfree(old_file);
 	xfree(reg_file);
 	xfree(new_file);
+	xfree(journal_file);
 	unlock_state_files();
 
 	free_buf(buffer);
@@ -541,6 +786,9 @@ extern int load_all_job_state(void)
 	uint32_t ver_str_len;
 	uint16_t protocol_version = (uint16_t)NO_VAL;
 
+	/* scripts of jobs may have been saved by another slurmctld */
+	script_store_load();
+
 	/* read the file */
 	lock_state_files();
 	state_fd = _open_job_state_file(&state_file);
@@ -610,19 +858,127 @@ extern int load_all_job_state(void)
 			goto unpack_error;
 		job_cnt++;
 	}
+	if (protocol_version == SLURM_PROTOCOL_VERSION)
+		(void) _load_job_journal(buf_time, false);
 	debug3("Set job_id_sequence to %u", job_id_sequence);
 
 	free_buf(buffer);
-	info("Recovered information about %d jobs", job_cnt);
+	_rebuild_job_hash(hash_table_size);
+	info("Recovered information about %d jobs", list_count(job_list));
 	return error_code;
 
 unpack_error:
 	error("Incomplete job data checkpoint file");
 	info("Recovered information about %d jobs", job_cnt);
 	free_buf(buffer);
+	_rebuild_job_hash(hash_table_size);
 	return SLURM_FAILURE;
 }
 
+/*
+ * _load_job_journal - replay the job_state.journal records saved since
+ *	the job_state snapshot just loaded, records of a different snapshot
+ *	are ignored
+ * IN snapshot_time - time stamp from the job_state header
+ * IN id_only - only recover job_id_sequence, for load_last_job_id()
+ * RET count of records replayed
+ */
+static int _load_job_journal(time_t snapshot_time, bool id_only)
+{
+	int data_allocated, data_read = 0, state_fd, rec_cnt = 0;
+	uint32_t data_size = 0, rec_size, rec_end, assoc_id, job_id;
+	uint16_t rec_type;
+	char *data = NULL, *state_file, *ver_str = NULL;
+	uint32_t ver_str_len;
+	time_t buf_time;
+	Buf buffer;
+
+	state_file = slurm_get_state_save_location();
+	xstrcat(state_file, "/job_state.journal");
+	lock_state_files();
+	state_fd = open(state_file, O_RDONLY);
+	if (state_fd < 0) {
+		debug("No job state journal (%s) to recover", state_file);
+		xfree(state_file);
+		unlock_state_files();
+		return rec_cnt;
+	}
+	data_allocated = BUF_SIZE;
+	data = xmalloc(data_allocated);
+	while (1) {
+		data_read = read(state_fd, &data[data_size], BUF_SIZE);
+		if (data_read < 0) {
+			if (errno == EINTR)
+				continue;
+			else {
+				error("Read error on %s: %m", state_file);
+				break;
+			}
+		} else if (data_read == 0)	/* eof */
+			break;
+		data_size      += data_read;
+		data_allocated += data_read;
+		xrealloc(data, data_allocated);
+	}
+	close(state_fd);
+	xfree(state_file);
+	unlock_state_files();
+
+	buffer = create_buf(data, data_size);
+	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
+	safe_unpack_time(&buf_time, buffer);
+	if ((ver_str == NULL) || strcmp(ver_str, JOB_STATE_VERSION) ||
+	    (buf_time != snapshot_time)) {
+		info("Job state journal is not for this job_state, ignored");
+		goto fini;
+	}
+
+	while (remaining_buf(buffer) >= JOURNAL_REC_HDR_SIZE) {
+		safe_unpack16(&rec_type, buffer);
+		safe_unpack32(&rec_size, buffer);
+		if (rec_size > remaining_buf(buffer)) {
+			/* Partly written when slurmctld stopped */
+			error("Incomplete job state journal record ignored");
+			break;
+		}
+		rec_end = get_buf_offset(buffer) + rec_size;
+		if (rec_type == JOURNAL_JOB_ID_SEQ) {
+			safe_unpack32(&job_id, buffer);
+			job_id_sequence = MAX(job_id, job_id_sequence);
+		} else if (id_only) {
+			;	/* only want job_id_sequence */
+		} else if (rec_type == JOURNAL_JOB_PURGE) {
+			safe_unpack32(&job_id, buffer);
+			_replay_purge_job_record(job_id);
+		} else if (rec_type == JOURNAL_JOB_SAVE) {
+			/* Replace any older record of the job */
+			safe_unpack32(&assoc_id, buffer);
+			safe_unpack32(&job_id, buffer);
+			_replay_purge_job_record(job_id);
+			set_buf_offset(buffer, rec_end - rec_size);
+			if (_load_job_state(buffer, SLURM_PROTOCOL_VERSION)) {
+				error("Invalid job state journal record for "
+				      "job %u", job_id);
+				break;
+			}
+		} else {
+			error("Invalid job state journal record type %u",
+			      rec_type);
+		}
+		set_buf_offset(buffer, rec_end);
+		rec_cnt++;
+	}
+	info("Replayed %d job state journal records", rec_cnt);
+	goto fini;
+
+unpack_error:
+	error("Invalid job state journal");
+fini:
+	xfree(ver_str);
+	free_buf(buffer);
+	return rec_cnt;
+}
+
 /*
  * load_last_job_id - load only the last job ID from state save file.
  *	Changes here should be reflected in load_all_job_state().
@@ -692,6 +1048,7 @@ extern int load_last_job_id( void )
 	safe_unpack_time(&buf_time, buffer);
 	safe_unpack32( &job_id_sequence, buffer);
 	debug3("Job ID in job_state header is %u", job_id_sequence);
+	(void) _load_job_journal(buf_time, true);
 
 	/* Ignore the state for individual jobs stored here */
 
@@ -1346,6 +1703,8 @@ static int _load_job_state(Buf buffer, uint16_t protocol_version)
 	job_ptr->exit_code    = exit_code;
 	job_ptr->group_id     = group_id;
 	job_ptr->job_state    = job_state;
+	if (IS_JOB_PENDING(job_ptr))
+		pend_queue_add(job_ptr);
 	job_ptr->kill_on_node_fail = kill_on_node_fail;
 	xfree(job_ptr->licenses);
 	job_ptr->licenses     = licenses;
@@ -1410,6 +1769,7 @@ static int _load_job_state(Buf buffer, uint16_t protocol_version)
 	job_ptr->cpu_cnt      = cpu_cnt;
 	job_ptr->tot_sus_time = tot_sus_time;
 	job_ptr->preempt_time = preempt_time;
+	user_hash_valid = false;	/* rebuilt by load_all_job_state() */
 	job_ptr->user_id      = user_id;
 	job_ptr->wait_all_nodes = wait_all_nodes;
 	job_ptr->warn_signal  = warn_signal;
@@ -1874,6 +2234,108 @@ void _add_job_hash(struct job_record *job_ptr)
 	job_hash[inx] = job_ptr;
 }
 
+/* _add_user_hash - add a user hash entry for given job record, user_id must
+ *	already be set
+ * IN job_ptr - pointer to job record
+ * Globals: user hash table updated
+ */
+static void _add_user_hash(struct job_record *job_ptr)
+{
+	int inx;
+
+	inx = USER_HASH_INX(job_ptr->user_id);
+	job_ptr->user_prev = NULL;
+	job_ptr->user_next = user_hash[inx];
+	if (user_hash[inx])
+		user_hash[inx]->user_prev = job_ptr;
+	user_hash[inx] = job_ptr;
+}
+
+/* _del_user_hash - remove a job record from the user hash table
+ * IN job_ptr - pointer to job record
+ * Globals: user hash table updated
+ */
+static void _del_user_hash(struct job_record *job_ptr)
+{
+	int inx;
+
+	if (!user_hash_valid)
+		return;		/* rebuilt before next use */
+	inx = USER_HASH_INX(job_ptr->user_id);
+	if (job_ptr->user_prev)
+		job_ptr->user_prev->user_next = job_ptr->user_next;
+	else if (user_hash[inx] == job_ptr)
+		user_hash[inx] = job_ptr->user_next;
+	if (job_ptr->user_next)
+		job_ptr->user_next->user_prev = job_ptr->user_prev;
+	job_ptr->user_next = NULL;
+	job_ptr->user_prev = NULL;
+}
+
+/* _rebuild_job_hash - size the job and user hash tables and add every job
+ *	record to them
+ * IN new_size - number of hash table entries
+ * Globals: hash tables rebuilt
+ */
+static void _rebuild_job_hash(int new_size)
+{
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+
+	xfree(job_hash);
+	xfree(user_hash);
+	hash_table_size = MAX(new_size, 1);
+	job_hash = (struct job_record **)
+		xmalloc(hash_table_size * sizeof(struct job_record *));
+	user_hash = (struct job_record **)
+		xmalloc(hash_table_size * sizeof(struct job_record *));
+	user_hash_valid = true;
+	if (job_list == NULL)
+		return;
+
+	job_iterator = list_iterator_create(job_list);
+	if (job_iterator == NULL)
+		fatal("list_iterator_create memory allocation failure");
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		_add_job_hash(job_ptr);
+		_add_user_hash(job_ptr);
+	}
+	list_iterator_destroy(job_iterator);
+}
+
+/*
+ * find_first_user_job - return a pointer to the first job record of a user
+ *	found in the user index, use find_next_user_job() for the others
+ * IN user_id - user ID
+ * RET pointer to a job record, NULL if the user has no jobs
+ */
+extern struct job_record *find_first_user_job(uint32_t user_id)
+{
+	struct job_record *job_ptr;
+
+	xassert(user_hash_valid);
+	job_ptr = user_hash[USER_HASH_INX(user_id)];
+	while (job_ptr && (job_ptr->user_id != user_id))
+		job_ptr = job_ptr->user_next;
+	return job_ptr;
+}
+
+/*
+ * find_next_user_job - return a pointer to the next job record with the same
+ *	user as the given record, in no particular order
+ * IN job_ptr - job record from find_first_user_job() or find_next_user_job()
+ * RET pointer to a job record, NULL if the user has no more jobs
+ */
+extern struct job_record *find_next_user_job(struct job_record *job_ptr)
+{
+	uint32_t user_id = job_ptr->user_id;
+
+	job_ptr = job_ptr->user_next;
+	while (job_ptr && (job_ptr->user_id != user_id))
+		job_ptr = job_ptr->user_next;
+	return job_ptr;
+}
+
 /*
  * find_job_record - return a pointer to the job record with the given job_id
  * IN job_id - requested job's id
@@ -1927,6 +2389,7 @@ static void _rebuild_part_name_list(struct job_record  *job_ptr)
 		xstrcat(job_ptr->partition, part_ptr->name);
 	}
 	list_iterator_destroy(part_iterator);
+	job_record_changed(job_ptr);
 	last_job_update = time(NULL);
 }
 
@@ -2139,6 +2602,7 @@ extern int kill_job_by_front_end_name(char *node_name)
 				if (job_ptr->node_cnt)
 					job_ptr->job_state |= JOB_COMPLETING;
 				job_ptr->details->submit_time = now;
+				pend_queue_add(job_ptr);
 
 				/* restart from periodic checkpoint */
 				if (job_ptr->ckpt_interval &&
@@ -2372,6 +2836,7 @@ extern int kill_running_job_by_node_name(char *node_name)
 				if (job_ptr->node_cnt)
 					job_ptr->job_state |= JOB_COMPLETING;
 				job_ptr->details->submit_time = now;
+				pend_queue_add(job_ptr);
 
 				/* restart from periodic checkpoint */
 				if (job_ptr->ckpt_interval &&
@@ -2457,6 +2922,7 @@ extern void excise_node_from_job(struct job_record *job_ptr,
 	}
 
 	job_ptr->total_nodes = job_ptr->node_cnt = new_pos + 1;
+	job_record_changed(job_ptr);
 
 	FREE_NULL_BITMAP(orig_bitmap);
 	(void) select_g_job_resized(job_ptr, node_ptr);
@@ -2671,22 +3137,20 @@ int init_job_conf(void)
 }
 
 /*
- * rehash_jobs - Create or rebuild the job hash table.
+ * rehash_jobs - Create or rebuild the job hash table, growing it as needed
+ *	for MaxJobCount.
  * NOTE: run lock_slurmctld before entry: Read config, write job
  */
 extern void rehash_jobs(void)
 {
 	if (job_hash == NULL) {
-		hash_table_size = slurmctld_conf.max_job_cnt;
-		job_hash = (struct job_record **)
-			xmalloc(hash_table_size * sizeof(struct job_record *));
+		_rebuild_job_hash(slurmctld_conf.max_job_cnt);
 	} else if (hash_table_size < (slurmctld_conf.max_job_cnt / 2)) {
 		/* If the MaxJobCount grows by too much, the hash table will
-		 * be ineffective without rebuilding. We don't presently bother
-		 * to rebuild the hash table, but cut MaxJobCount back as
-		 * needed. */
-		error ("MaxJobCount reset too high, restart slurmctld");
-		slurmctld_conf.max_job_cnt = hash_table_size;
+		 * be ineffective without rebuilding */
+		info("MaxJobCount increased, job hash table size from %d to %u",
+		     hash_table_size, slurmctld_conf.max_job_cnt);
+		_rebuild_job_hash(slurmctld_conf.max_job_cnt);
 	}
 }
 
@@ -2995,6 +3459,7 @@ extern int job_signal(uint32_t job_id, uint16_t signal, uint16_t batch_flag,
 		if ((job_ptr->job_state & JOB_STATE_BASE) == JOB_PENDING) {
 			/* Prevent job requeue, otherwise preserve state */
 			job_ptr->job_state = JOB_CANCELLED | JOB_COMPLETING;
+			job_record_changed(job_ptr);
 		}
 		/* build_cg_bitmap() not needed, job already completing */
 		verbose("job_signal of requeuing job %u successful", job_id);
@@ -3175,6 +3640,7 @@ extern int job_complete(uint32_t job_id, uid_t uid, bool requeue,
 		job_ptr->batch_flag++;	/* only one retry */
 		job_ptr->restart_cnt++;
 		job_ptr->job_state = JOB_PENDING | job_comp_flag;
+		pend_queue_add(job_ptr);
 		/* Since the job completion logger removes the job submit
 		 * information, we need to add it again. */
 		acct_policy_add_job_submit(job_ptr);
@@ -4026,131 +4492,37 @@ static int _validate_job_create_req(job_desc_msg_t * job_desc)
 }
 
 /* _copy_job_desc_to_file - copy the job script and environment from the RPC
- *	structure into a file */
+ *	structure into the script_store. The environment is saved in the
+ *	format read by _read_data_array(), an element count followed by
+ *	NUL terminated strings. */
 static int
 _copy_job_desc_to_file(job_desc_msg_t * job_desc, uint32_t job_id)
 {
-	int error_code = 0;
-	char *dir_name, job_dir[20], *file_name;
+	int error_code, i;
+	char *env;
+	uint32_t env_len = sizeof(uint32_t), script_len = 0, len;
 	DEF_TIMERS;
 
 	START_TIMER;
-	/* Create state_save_location directory */
-	dir_name = slurm_get_state_save_location();
-
-	/* Create job_id specific directory */
-	sprintf(job_dir, "/job.%u", job_id);
-	xstrcat(dir_name, job_dir);
-	if (mkdir(dir_name, 0700)) {
-		error("mkdir(%s) error %m", dir_name);
-		xfree(dir_name);
-		return ESLURM_WRITING_TO_FILE;
-	}
-
-	/* Create environment file, and write data to it */
-	file_name = xstrdup(dir_name);
-	xstrcat(file_name, "/environment");
-	error_code = _write_data_array_to_file(file_name,
-					       job_desc->environment,
-					       job_desc->env_size);
-	xfree(file_name);
-
-	if (error_code == 0) {
-		/* Create script file */
-		file_name = xstrdup(dir_name);
-		xstrcat(file_name, "/script");
-		error_code = _write_data_to_file(file_name, job_desc->script);
-		xfree(file_name);
-	}
-
-	xfree(dir_name);
+	for (i = 0; i < job_desc->env_size; i++)
+		env_len += strlen(job_desc->environment[i]) + 1;
+	env = xmalloc(env_len);
+	memcpy(env, &job_desc->env_size, sizeof(uint32_t));
+	for (i = 0, env_len = sizeof(uint32_t); i < job_desc->env_size; i++) {
+		len = strlen(job_desc->environment[i]) + 1;
+		memcpy(&env[env_len], job_desc->environment[i], len);
+		env_len += len;
+	}
+	if (job_desc->script)
+		script_len = strlen(job_desc->script) + 1;
+
+	error_code = script_store_add(job_id, job_desc->script, script_len,
+				      env, env_len);
+	xfree(env);
 	END_TIMER2("_copy_job_desc_to_file");
 	return error_code;
 }
 
-/*
- * Create file with specified name and write the supplied data array to it
- * IN file_name - file to create and write to
- * IN data - array of pointers to strings (e.g. env)
- * IN size - number of elements in data
- */
-static int
-_write_data_array_to_file(char *file_name, char **data, uint32_t size)
-{
-	int fd, i, pos, nwrite, amount;
-
-	fd = creat(file_name, 0600);
-	if (fd < 0) {
-		error("Error creating file %s, %m", file_name);
-		return ESLURM_WRITING_TO_FILE;
-	}
-
-	amount = write(fd, &size, sizeof(uint32_t));
-	if (amount < sizeof(uint32_t)) {
-		error("Error writing file %s, %m", file_name);
-		close(fd);
-		return ESLURM_WRITING_TO_FILE;
-	}
-
-	if (data == NULL)
-		return SLURM_SUCCESS;
-
-	for (i = 0; i < size; i++) {
-		nwrite = strlen(data[i]) + 1;
-		pos = 0;
-		while (nwrite > 0) {
-			amount = write(fd, &data[i][pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("Error writing file %s, %m",
-				      file_name);
-				close(fd);
-				return ESLURM_WRITING_TO_FILE;
-			}
-			nwrite -= amount;
-			pos    += amount;
-		}
-	}
-
-	close(fd);
-	return SLURM_SUCCESS;
-}
-
-/*
- * Create file with specified name and write the supplied data array to it
- * IN file_name - file to create and write to
- * IN data - pointer to string
- */
-static int _write_data_to_file(char *file_name, char *data)
-{
-	int fd, pos, nwrite, amount;
-
-	if (data == NULL) {
-		(void) unlink(file_name);
-		return SLURM_SUCCESS;
-	}
-
-	fd = creat(file_name, 0700);
-	if (fd < 0) {
-		error("Error creating file %s, %m", file_name);
-		return ESLURM_WRITING_TO_FILE;
-	}
-
-	nwrite = strlen(data) + 1;
-	pos = 0;
-	while (nwrite > 0) {
-		amount = write(fd, &data[pos], nwrite);
-		if ((amount < 0) && (errno != EINTR)) {
-			error("Error writing file %s, %m", file_name);
-			close(fd);
-			return ESLURM_WRITING_TO_FILE;
-		}
-		nwrite -= amount;
-		pos    += amount;
-	}
-	close(fd);
-	return SLURM_SUCCESS;
-}
-
 /*
  * get_job_env - return the environment variables and their count for a
  *	given job
@@ -4160,8 +4532,31 @@ static int _write_data_to_file(char *file_name, char *data)
  */
 char **get_job_env(struct job_record *job_ptr, uint32_t * env_size)
 {
-	char job_dir[30], *file_name, **environment = NULL;
+	char job_dir[30], *file_name, **environment = NULL, *data;
+	uint32_t data_size, rec_cnt;
+
+	data = script_store_get(job_ptr->job_id, true, &data_size);
+	if (data) {
+		*env_size = 0;
+		if (data_size < sizeof(uint32_t)) {
+			error("Bad environment saved for job %u",
+			      job_ptr->job_id);
+			xfree(data);
+			return NULL;
+		}
+		memcpy(&rec_cnt, data, sizeof(uint32_t));
+		data_size -= sizeof(uint32_t);
+		memmove(data, &data[sizeof(uint32_t)], data_size);
+		if (rec_cnt == 0) {
+			xfree(data);
+			return NULL;
+		}
+		_read_data_array(data, data_size, rec_cnt, "script_store",
+				 &environment, env_size, job_ptr);
+		return environment;
+	}
 
+	/* Job saved before the script_store */
 	file_name = slurm_get_state_save_location();
 	sprintf(job_dir, "/job.%d/environment", job_ptr->job_id);
 	xstrcat(file_name, job_dir);
@@ -4182,9 +4577,16 @@ char *get_job_script(struct job_record *job_ptr)
 	char *script = NULL;
 
 	if (job_ptr->batch_flag) {
-		char *file_name = slurm_get_state_save_location();
+		char *file_name;
 		char job_dir[30];
+		uint32_t size;
+
+		script = script_store_get(job_ptr->job_id, false, &size);
+		if (script)
+			return script;
 
+		/* Job saved before the script_store */
+		file_name = slurm_get_state_save_location();
 		sprintf(job_dir, "/job.%d/script", job_ptr->job_id);
 		xstrcat(file_name, job_dir);
 
@@ -4208,8 +4610,8 @@ static void
 _read_data_array_from_file(char *file_name, char ***data, uint32_t * size,
 			   struct job_record *job_ptr)
 {
-	int fd, pos, buf_size, amount, i, j;
-	char *buffer, **array_ptr;
+	int fd, pos, buf_size, amount;
+	char *buffer;
 	uint32_t rec_cnt;
 
 	xassert(file_name);
@@ -4259,6 +4661,30 @@ _read_data_array_from_file(char *file_name, char ***data, uint32_t * size,
 	}
 	close(fd);
 
+	_read_data_array(buffer, pos, rec_cnt, file_name, data, size, job_ptr);
+}
+
+/*
+ * Build an array of strings from a buffer, adding any supplemental
+ *	environment variables of the job
+ * IN buffer - rec_cnt NUL terminated strings, its address is the
+ *	first element of the array returned and it is reallocated as needed
+ * IN pos - bytes of data in buffer
+ * IN rec_cnt - number of strings in buffer
+ * IN source - file name or store the data was read from, for logging
+ * OUT data - pointer to array of pointers to strings (e.g. env),
+ *	must be xfreed when no longer needed
+ * OUT size - number of elements in data
+ * IN job_ptr - job
+ * NOTE: The output format of this must be identical with _xduparray2()
+ */
+static void _read_data_array(char *buffer, int pos, uint32_t rec_cnt,
+			     char *source, char ***data, uint32_t * size,
+			     struct job_record *job_ptr)
+{
+	int buf_size = pos, i, j;
+	char **array_ptr;
+
 	/* Allocate extra space for supplemental environment variables
 	 * as set by Moab */
 	if (job_ptr->details->env_cnt) {
@@ -4274,7 +4700,7 @@ _read_data_array_from_file(char *file_name, char ***data, uint32_t * size,
 		array_ptr[i] = &buffer[pos];
 		pos += strlen(&buffer[pos]) + 1;
 		if ((pos > buf_size) && ((i + 1) < rec_cnt)) {
-			error("Bad environment file %s", file_name);
+			error("Bad environment file %s", source);
 			rec_cnt = i;
 			break;
 		}
@@ -4479,10 +4905,13 @@ _copy_job_desc_to_job_record(job_desc_msg_t * job_desc,
 		job_ptr->wckey = xstrdup(job_desc->wckey);
 
 	_add_job_hash(job_ptr);
+	job_record_changed(job_ptr);
 
 	job_ptr->user_id    = (uid_t) job_desc->user_id;
+	_add_user_hash(job_ptr);
 	job_ptr->group_id   = (gid_t) job_desc->group_id;
 	job_ptr->job_state  = JOB_PENDING;
+	pend_queue_add(job_ptr);
 	job_ptr->time_limit = job_desc->time_limit;
 	if (job_desc->time_min != NO_VAL)
 		job_ptr->time_min = job_desc->time_min;
@@ -4751,6 +5180,7 @@ void job_time_limit(void)
 				debug("Configuration for job %u is complete",
 				      job_ptr->job_id);
 				job_ptr->job_state &= (~JOB_CONFIGURING);
+				job_record_changed(job_ptr);
 			}
 		}
 
@@ -4808,6 +5238,7 @@ void job_time_limit(void)
 						  false);
 				job_ptr->warn_signal = 0;
 				job_ptr->warn_time = 0;
+				job_record_changed(job_ptr);
 			}
 		}
 
@@ -4969,6 +5400,7 @@ extern int job_update_cpu_cnt(struct job_record *job_ptr, int node_inx)
 	 * cpu count isn't set up on that system. */
 	return SLURM_SUCCESS;
 #endif
+	job_record_changed(job_ptr);
 	if ((offset = job_resources_node_inx_to_cpu_inx(
 		    job_ptr->job_resrcs, node_inx)) < 0) {
 		error("job_update_cpu_cnt: problem getting offset of job %u",
@@ -5123,6 +5555,7 @@ static void _list_delete_job(void *job_entry)
 	xassert(job_entry);
 	xassert (job_ptr->magic == JOB_MAGIC);
 	job_ptr->magic = 0;	/* make sure we don't delete record twice */
+	pend_queue_remove(job_ptr);
 
 	/* Remove the record from the hash table */
 	job_pptr = &job_hash[JOB_HASH_INX(job_ptr->job_id)];
@@ -5133,6 +5566,9 @@ static void _list_delete_job(void *job_entry)
 	if (job_pptr == NULL)
 		fatal("job hash error");
 	*job_pptr = job_ptr->job_next;
+	_del_user_hash(job_ptr);
+	if (!journal_replay)
+		_journal_purge_add(job_ptr->job_id);
 
 	delete_job_details(job_ptr);
 	xfree(job_ptr->account);
@@ -5230,6 +5666,136 @@ static int _list_find_job_old(void *job_entry, void *key)
 }
 
 
+/* Return true if name is one of the entries in a comma separated list */
+static bool _name_in_list(char *list, char *name, bool ignore_case)
+{
+	char *tmp_list, *tok, *last = NULL;
+	bool found = false;
+
+	if (name == NULL)
+		return false;
+
+	tmp_list = xstrdup(list);
+	tok = strtok_r(tmp_list, ",", &last);
+	while (tok) {
+		if ((ignore_case && !strcasecmp(tok, name)) ||
+		    (!ignore_case && !strcmp(tok, name))) {
+			found = true;
+			break;
+		}
+		tok = strtok_r(NULL, ",", &last);
+	}
+	xfree(tmp_list);
+
+	return found;
+}
+
+/* Return a list of the only job records which can satisfy a job filter,
+ * found using the job ID or user indexes, or NULL to test every job */
+static List _job_filter_candidates(job_info_filter_t *filter)
+{
+	List job_cands;
+	struct job_record *job_ptr;
+	uint32_t i, j;
+
+	if ((filter == NULL) ||
+	    ((filter->job_id_cnt == 0) && (filter->user_id_cnt == 0)))
+		return NULL;
+
+	job_cands = list_create(NULL);
+	if (job_cands == NULL)
+		fatal("list_create memory allocation failure");
+	if (filter->job_id_cnt) {
+		for (i = 0; i < filter->job_id_cnt; i++) {
+			for (j = 0; j < i; j++) {
+				if (filter->job_ids[j] == filter->job_ids[i])
+					break;
+			}
+			if ((j == i) &&
+			    (job_ptr = find_job_record(filter->job_ids[i])))
+				list_append(job_cands, job_ptr);
+		}
+		return job_cands;
+	}
+	for (i = 0; i < filter->user_id_cnt; i++) {
+		for (j = 0; j < i; j++) {
+			if (filter->user_ids[j] == filter->user_ids[i])
+				break;
+		}
+		if (j < i)
+			continue;	/* duplicate user */
+		for (job_ptr = find_first_user_job(filter->user_ids[i]);
+		     job_ptr; job_ptr = find_next_user_job(job_ptr))
+			list_append(job_cands, job_ptr);
+	}
+	return job_cands;
+}
+
+/* Return true if a job record satisfies every field set in a job filter */
+static bool _job_filter_match(struct job_record *job_ptr,
+			      job_info_filter_t *filter)
+{
+	uint32_t i;
+	uint16_t base_state;
+
+	if (filter->user_id_cnt) {
+		for (i = 0; i < filter->user_id_cnt; i++) {
+			if (filter->user_ids[i] == job_ptr->user_id)
+				break;
+		}
+		if (i >= filter->user_id_cnt)
+			return false;
+	}
+
+	if (filter->job_id_cnt) {
+		for (i = 0; i < filter->job_id_cnt; i++) {
+			if (filter->job_ids[i] == job_ptr->job_id)
+				break;
+		}
+		if (i >= filter->job_id_cnt)
+			return false;
+	}
+
+	if (filter->state_mask) {
+		base_state = job_ptr->job_state & JOB_STATE_BASE;
+		if (!(filter->state_mask & JOB_FILTER_STATE(base_state)) &&
+		    !((filter->state_mask & JOB_FILTER_COMPLETING) &&
+		      IS_JOB_COMPLETING(job_ptr)) &&
+		    !((filter->state_mask & JOB_FILTER_CONFIGURING) &&
+		      IS_JOB_CONFIGURING(job_ptr)))
+			return false;
+	}
+
+	if (filter->name &&
+	    ((job_ptr->name == NULL) || strcmp(filter->name, job_ptr->name)))
+		return false;
+
+	if (filter->accounts &&
+	    !_name_in_list(filter->accounts, job_ptr->account, true))
+		return false;
+
+	if (filter->partitions) {
+		char *tmp_parts, *tok, *last = NULL;
+		bool found = false;
+
+		/* Same partition name(s) as reported by pack_job() */
+		if (!IS_JOB_PENDING(job_ptr) && job_ptr->part_ptr)
+			tmp_parts = xstrdup(job_ptr->part_ptr->name);
+		else
+			tmp_parts = xstrdup(job_ptr->partition);
+		tok = strtok_r(tmp_parts, ",", &last);
+		while (tok && !found) {
+			found = _name_in_list(filter->partitions, tok, false);
+			tok = strtok_r(NULL, ",", &last);
+		}
+		xfree(tmp_parts);
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * pack_all_jobs - dump all job information for all jobs in
  *	machine independent form (for network transmission)
@@ -5246,11 +5812,35 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 			  uint16_t show_flags, uid_t uid,
 			  uint16_t protocol_version)
 {
+	pack_filtered_jobs(buffer_ptr, buffer_size, show_flags, uid,
+			   protocol_version, NULL, NULL);
+}
+
+/*
+ * pack_filtered_jobs - dump job information for jobs matching a filter in
+ *	machine independent form (for network transmission)
+ * OUT buffer_ptr - the pointer is set to the allocated buffer.
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN filter - jobs to pack, NULL to pack all jobs
+ * OUT index - if not NULL, set to the location of each job record packed,
+ *	free its arrays with xfree()
+ * global: job_list - global list of job records
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ */
+extern void pack_filtered_jobs(char **buffer_ptr, int *buffer_size,
+			       uint16_t show_flags, uid_t uid,
+			       uint16_t protocol_version,
+			       job_info_filter_t *filter,
+			       pack_index_t *index)
+{
+	List job_cands;
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
 	uint32_t jobs_packed = 0, tmp_offset;
 	Buf buffer;
-	time_t min_age = 0, now = time(NULL);
+	time_t min_age = 0, now = time(NULL), expire;
 
 	buffer_ptr[0] = NULL;
 	*buffer_size = 0;
@@ -5265,9 +5855,21 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 	if (slurmctld_conf.min_job_age > 0)
 		min_age = now  - slurmctld_conf.min_job_age;
 
+	if (index) {
+		int job_cnt = list_count(job_list) + 1;
+		index->rec_cnt = 0;
+		index->expire_time = 0;
+		index->rec_id = xmalloc(sizeof(uint32_t) * job_cnt);
+		index->rec_offset = xmalloc(sizeof(uint32_t) * job_cnt);
+	}
+
 	/* write individual job records */
 	part_filter_set(uid);
-	job_iterator = list_iterator_create(job_list);
+	job_cands = _job_filter_candidates(filter);
+	if (job_cands)
+		job_iterator = list_iterator_create(job_cands);
+	else
+		job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
 
@@ -5286,11 +5888,29 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 		    (! IS_JOB_COMPLETING(job_ptr)) && IS_JOB_FINISHED(job_ptr))
 			continue;	/* job ready for purging, don't dump */
 
+		if (filter && !_job_filter_match(job_ptr, filter))
+			continue;
+
+		if (index) {
+			if ((min_age > 0) && IS_JOB_FINISHED(job_ptr) &&
+			    !IS_JOB_COMPLETING(job_ptr)) {
+				expire = job_ptr->end_time +
+					 slurmctld_conf.min_job_age;
+				if ((index->expire_time == 0) ||
+				    (expire < index->expire_time))
+					index->expire_time = expire;
+			}
+			index->rec_id[index->rec_cnt] = job_ptr->job_id;
+			index->rec_offset[index->rec_cnt++] =
+				get_buf_offset(buffer);
+		}
 		pack_job(job_ptr, show_flags, buffer, protocol_version, uid);
 		jobs_packed++;
 	}
 	part_filter_clear();
 	list_iterator_destroy(job_iterator);
+	if (job_cands)
+		list_destroy(job_cands);
 
 	/* put the real record count in the message body header */
 	tmp_offset = get_buf_offset(buffer);
@@ -5917,6 +6537,20 @@ static int _purge_job_record(uint32_t job_id)
 	return list_delete_all(job_list, &_list_find_job_id, (void *) &job_id);
 }
 
+/*
+ * _replay_purge_job_record - remove a job record replaced or purged by a
+ *	job_state.journal record. Unlike _purge_job_record(), no purge
+ *	record is journaled and the job's script and environment are kept,
+ *	as the journal already reflects them.
+ * IN job_id - job_id of job record to be removed
+ */
+static void _replay_purge_job_record(uint32_t job_id)
+{
+	journal_replay = true;
+	(void) _purge_job_record(job_id);
+	journal_replay = false;
+}
+
 
 /*
  * reset_job_bitmaps - reestablish bitmaps for existing jobs.
@@ -5953,6 +6587,7 @@ void reset_job_bitmaps(void)
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
 		job_fail = false;
+		job_record_changed(job_ptr);	/* rebuilt below */
 
 		if (job_ptr->partition == NULL) {
 			error("No partition for job_id %u", job_ptr->job_id);
@@ -6182,6 +6817,7 @@ static void _set_job_prio(struct job_record *job_ptr)
 		return;
 	job_ptr->priority = slurm_sched_initial_priority(lowest_prio,
 							 job_ptr);
+	job_record_changed(job_ptr);
 	if ((job_ptr->priority <= 1) ||
 	    (job_ptr->direct_set_prio) ||
 	    (job_ptr->details && (job_ptr->details->nice != NICE_OFFSET)))
@@ -6205,8 +6841,10 @@ extern void sync_job_priorities(void)
 		return;
 
 	job_iterator = list_iterator_create(job_list);
-	while ((job_ptr = (struct job_record *) list_next(job_iterator)))
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		job_ptr->priority += prio_boost;
+		job_record_changed(job_ptr);
+	}
 	list_iterator_destroy(job_iterator);
 	lowest_prio += prio_boost;
 }
@@ -6443,6 +7081,7 @@ int update_job(job_desc_msg_t * job_specs, uid_t uid)
 	if (detail_ptr)
 		mc_ptr = detail_ptr->mc_ptr;
 	last_job_update = now;
+	job_record_changed(job_ptr);
 
 	if (job_specs->account) {
 		if (!IS_JOB_PENDING(job_ptr))
@@ -8286,6 +8925,7 @@ static void _get_batch_job_dir_ids(List batch_dirs)
 	}
 
 	closedir(f_dir);
+	script_store_get_job_ids(batch_dirs);
 }
 
 /* All pending batch jobs must have a batch_dir entry,
@@ -8494,6 +9134,7 @@ extern bool job_epilog_complete(uint32_t job_id, char *node_name,
 	step_epilog_complete(job_ptr, node_name);
 	/* nodes_completing is out of date, rebuild when next saved */
 	xfree(job_ptr->nodes_completing);
+	job_record_changed(job_ptr);
 	if (!IS_JOB_COMPLETING(job_ptr)) {	/* COMPLETED */
 		if (IS_JOB_PENDING(job_ptr) && (job_ptr->batch_flag)) {
 			info("requeue batch job %u", job_ptr->job_id);
@@ -8538,11 +9179,20 @@ extern bool job_epilog_complete(uint32_t job_id, char *node_name,
 /* job_fini - free all memory associated with job records */
 void job_fini (void)
 {
+	pend_queue_fini();
 	if (job_list) {
 		list_destroy(job_list);
 		job_list = NULL;
 	}
 	xfree(job_hash);
+	xfree(user_hash);
+	xfree(journal_purge_ids);
+	journal_purge_cnt = journal_purge_size = 0;
+	slurm_mutex_lock(&journal_change_mutex);
+	xfree(journal_change_ids);
+	journal_change_cnt = journal_change_size = 0;
+	slurm_mutex_unlock(&journal_change_mutex);
+	script_store_fini();
 }
 
 /* log the completion of the specified job */
@@ -8553,6 +9203,7 @@ extern void job_completion_logger(struct job_record  *job_ptr, bool requeue)
 
 	xassert(job_ptr);
 
+	job_record_changed(job_ptr);
 	acct_policy_remove_job_submit(job_ptr);
 
 	if (!IS_JOB_RESIZING(job_ptr)) {
@@ -8668,6 +9319,7 @@ extern bool job_independent(struct job_record *job_ptr, int will_run)
 	if ((detail_ptr && (detail_ptr->begin_time == 0) &&
 	    (job_ptr->priority != 0))) {
 		detail_ptr->begin_time = now;
+		job_record_changed(job_ptr);
 	} else if (job_ptr->state_reason == WAIT_TIME) {
 		job_ptr->state_reason = WAIT_NO_REASON;
 		xfree(job_ptr->state_desc);
@@ -9017,6 +9669,7 @@ extern int job_suspend(suspend_msg_t *sus_ptr, uid_t uid,
 
 	job_ptr->time_last_active = now;
 	job_ptr->suspend_time = now;
+	job_record_changed(job_ptr);
 	jobacct_storage_g_job_suspend(acct_db_conn, job_ptr);
 
     reply:
@@ -9128,6 +9781,7 @@ extern int job_requeue (uid_t uid, uint32_t job_id, slurm_fd_t conn_fd,
 	job_ptr->job_state = JOB_PENDING;
 	if (job_ptr->node_cnt)
 		job_ptr->job_state |= JOB_COMPLETING;
+	pend_queue_add(job_ptr);
 
 	job_ptr->details->submit_time = now;
 	job_ptr->pre_sus_time = (time_t) 0;
@@ -9217,6 +9871,7 @@ extern int job_cancel_by_assoc_id(uint32_t assoc_id)
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		if (job_ptr->assoc_id != assoc_id)
 			continue;
+		job_record_changed(job_ptr);
 
 		/* move up to the parent that should still exist */
 		if (job_ptr->assoc_ptr) {
@@ -9278,6 +9933,7 @@ extern int job_cancel_by_qos_id(uint32_t qos_id)
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		if (job_ptr->qos_id != qos_id)
 			continue;
+		job_record_changed(job_ptr);
 
 		/* move up to the parent that should still exist */
 		if(job_ptr->qos_ptr) {
@@ -9376,6 +10032,7 @@ extern int update_job_account(char *module, struct job_record *job_ptr,
 	}
 	job_ptr->assoc_id = assoc_rec.id;
 
+	job_record_changed(job_ptr);
 	last_job_update = time(NULL);
 
 	return SLURM_SUCCESS;
@@ -9440,6 +10097,7 @@ extern int update_job_wckey(char *module, struct job_record *job_ptr,
 		     module, job_ptr->job_id);
 	}
 
+	job_record_changed(job_ptr);
 	last_job_update = time(NULL);
 
 	return SLURM_SUCCESS;
@@ -9482,8 +10140,10 @@ extern int send_jobs_to_accounting(void)
 				job_ptr->end_time = now;
 				job_completion_logger(job_ptr, false);
 				continue;
-			} else
+			} else {
 				job_ptr->assoc_id = assoc_rec.id;
+				job_record_changed(job_ptr);
+			}
 		}
 
 		/* we only want active, un accounted for jobs */
@@ -9493,6 +10153,7 @@ extern int send_jobs_to_accounting(void)
 		debug("first reg: starting job %u in accounting",
 		      job_ptr->job_id);
 		jobacct_storage_g_job_start(acct_db_conn, job_ptr);
+		job_record_changed(job_ptr);	/* db_index */
 
 		if (IS_JOB_SUSPENDED(job_ptr))
 			jobacct_storage_g_job_suspend(acct_db_conn, job_ptr);
@@ -9572,6 +10233,7 @@ extern int job_checkpoint(checkpoint_msg_t *ckpt_ptr, uid_t uid,
 				   &resp_data.error_msg);
 		info("checkpoint_op %u of %u.%u complete, rc=%d",
 		     ckpt_ptr->op, ckpt_ptr->job_id, ckpt_ptr->step_id, rc);
+		job_record_changed(job_ptr);
 		last_job_update = time(NULL);
 	} else {		/* operate on all of a job's steps */
 		int update_rc = -2;
@@ -9603,8 +10265,10 @@ extern int job_checkpoint(checkpoint_msg_t *ckpt_ptr, uid_t uid,
 			rc = MAX(rc, update_rc);
 			xfree(image_dir);
 		}
-		if (update_rc != -2)	/* some work done */
+		if (update_rc != -2) {	/* some work done */
+			job_record_changed(job_ptr);
 			last_job_update = time(NULL);
+		}
 		list_iterator_destroy (step_iterator);
 	}
 
@@ -10084,6 +10748,7 @@ _read_job_ckpt_file(char *ckpt_file, int *size_ptr)
 /* Build a bitmap of nodes completing this job */
 extern void build_cg_bitmap(struct job_record *job_ptr)
 {
+	job_record_changed(job_ptr);
 	FREE_NULL_BITMAP(job_ptr->node_bitmap_cg);
 	if (job_ptr->node_bitmap) {
 		job_ptr->node_bitmap_cg = bit_copy(job_ptr->node_bitmap);
@@ -85,8 +85,13 @@ static void	_job_queue_rec_del(void *x);
 static void *	_run_epilog(void *arg);
 static void *	_run_prolog(void *arg);
 static bool	_scan_depend(List dependency_list, uint32_t job_id);
+static int	_list_find_feature(void *feature_entry, void *key);
 static int	_valid_feature_list(uint32_t job_id, List feature_list);
-static int	_valid_node_feature(char *feature);
+
+/* Index of jobs which may be pending, in order of creation or requeue.
+ * Building the job queue from it avoids walking every job in job_list,
+ * most of which are typically running or finished. */
+static List pend_list = NULL;
 
 
 /*
@@ -100,25 +105,19 @@ static int	_valid_node_feature(char *feature);
 static List _build_user_job_list(uint32_t user_id, char* job_name)
 {
 	List job_queue;
-	ListIterator job_iterator;
 	struct job_record *job_ptr = NULL;
 
 	job_queue = list_create(NULL);
 	if (job_queue == NULL)
 		fatal("list_create memory allocation failure");
-	job_iterator = list_iterator_create(job_list);
-	if (job_iterator == NULL)
-		fatal("list_iterator_create malloc failure");
-	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+	for (job_ptr = find_first_user_job(user_id); job_ptr;
+	     job_ptr = find_next_user_job(job_ptr)) {
 		xassert (job_ptr->magic == JOB_MAGIC);
-		if (job_ptr->user_id != user_id)
-			continue;
 		if (job_name && job_ptr->name &&
 		    strcmp(job_name, job_ptr->name))
 			continue;
 		list_append(job_queue, job_ptr);
 	}
-	list_iterator_destroy(job_iterator);
 
 	return job_queue;
 }
@@ -157,13 +156,21 @@ extern List build_job_queue(bool clear_start)
 	job_queue = list_create(_job_queue_rec_del);
 	if (job_queue == NULL)
 		fatal("list_create memory allocation failure");
-	job_iterator = list_iterator_create(job_list);
+	if (pend_list == NULL)
+		return job_queue;
+	job_iterator = list_iterator_create(pend_list);
 	if (job_iterator == NULL)
 		fatal("list_iterator_create memory allocation failure");
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
 		job_is_pending = IS_JOB_PENDING(job_ptr);
-		if (!job_is_pending || IS_JOB_COMPLETING(job_ptr))
+		if (!job_is_pending) {
+			/* started or ended since last pass */
+			list_remove(job_iterator);
+			job_ptr->pend_queued = false;
+			continue;
+		}
+		if (IS_JOB_COMPLETING(job_ptr))
 			continue;
 		/* ensure dependency shows current values behind a hold */
 		job_indepen = job_independent(job_ptr, 0);
@@ -225,6 +232,70 @@ extern List build_job_queue(bool clear_start)
 	return job_queue;
 }
 
+static int _pend_job_match(void *x, void *key)
+{
+	if (x == key)
+		return 1;
+	return 0;
+}
+
+/*
+ * pend_queue_add - add a job to the index of jobs which may be pending,
+ *	from which build_job_queue() builds the job queue. Call when a job
+ *	is created or requeued. Jobs no longer pending are removed from the
+ *	index by build_job_queue().
+ * IN job_ptr - pointer to job record
+ * NOTE: Caller must hold a job write lock
+ */
+extern void pend_queue_add(struct job_record *job_ptr)
+{
+	if (job_ptr->pend_queued)
+		return;
+	if (pend_list == NULL) {
+		pend_list = list_create(NULL);
+		if (pend_list == NULL)
+			fatal("list_create memory allocation failure");
+	}
+	if (list_append(pend_list, job_ptr) == NULL)
+		fatal("list_append memory allocation failure");
+	job_ptr->pend_queued = true;
+}
+
+/*
+ * pend_queue_remove - remove a job from the pending job index, call before
+ *	the job record is freed
+ * IN job_ptr - pointer to job record
+ * NOTE: Caller must hold a job write lock
+ */
+extern void pend_queue_remove(struct job_record *job_ptr)
+{
+	if (!job_ptr->pend_queued)
+		return;
+	list_delete_all(pend_list, _pend_job_match, job_ptr);
+	job_ptr->pend_queued = false;
+}
+
+/*
+ * pend_queue_fini - empty the pending job index, call before job records
+ *	are all freed
+ */
+extern void pend_queue_fini(void)
+{
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+
+	if (pend_list == NULL)
+		return;
+	job_iterator = list_iterator_create(pend_list);
+	if (job_iterator == NULL)
+		fatal("list_iterator_create memory allocation failure");
+	while ((job_ptr = (struct job_record *) list_next(job_iterator)))
+		job_ptr->pend_queued = false;
+	list_iterator_destroy(job_iterator);
+	list_destroy(pend_list);
+	pend_list = NULL;
+}
+
 /*
  * job_is_completing - Determine if jobs are in the process of completing.
  * RET - True of any job is in the process of completing AND
@@ -322,8 +393,9 @@ static bool _failed_partition(struct part_record *part_ptr,
  * RET count of jobs scheduled
  * Note: We re-build the queue every time. Jobs can not only be added
  *	or removed from the queue, but have their priority or partition
- *	changed with the update_job RPC. In general nodes will be in priority
- *	order (by submit time), so the sorting should be pretty fast.
+ *	changed with the update_job RPC. The queue is built from the pending
+ *	job index rather than all jobs, sorted once with an O(n log n) merge
+ *	sort and then popped in order.
  */
 extern int schedule(uint32_t job_limit)
 {
@@ -423,7 +495,8 @@ extern int schedule(uint32_t job_limit)
 
 	debug("sched: Running job scheduler");
 	job_queue = build_job_queue(false);
-	while ((job_queue_rec = list_pop_bottom(job_queue, sort_job_queue2))) {
+	sort_job_queue(job_queue);
+	while ((job_queue_rec = list_pop(job_queue))) {
 		job_ptr  = job_queue_rec->job_ptr;
 		part_ptr = job_queue_rec->part_ptr;
 		xfree(job_queue_rec);
@@ -690,6 +763,7 @@ extern void launch_job(struct job_record *job_ptr)
 		 * too deep into the job launch to gracefully clean up. */
 		job_ptr->end_time    = time(NULL);
 		job_ptr->time_limit = 0;
+		job_record_changed(job_ptr);
 		xfree(launch_msg_ptr->nodes);
 		xfree(launch_msg_ptr);
 		return;
@@ -936,6 +1010,7 @@ extern int test_job_dependency(struct job_record *job_ptr)
 				job_ptr->time_limit = dep_ptr->job_ptr->
 						      end_time - now;
 				job_ptr->time_limit /= 60;  /* sec to min */
+				job_record_changed(job_ptr);
 			}
 			if (job_ptr->details && dep_ptr->job_ptr->details) {
 				job_ptr->details->shared =
@@ -1601,6 +1676,9 @@ static void *_run_prolog(void *arg)
 	/* Locks: Read config, job; Write nodes */
 	slurmctld_lock_t config_read_lock = {
 		READ_LOCK, READ_LOCK, WRITE_LOCK, NO_LOCK };
+	/* Locks: Read config; Write job, nodes */
+	slurmctld_lock_t prolog_fini_lock = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
 	bitstr_t *node_bitmap = NULL;
 	static int last_job_requeue = 0;
 
@@ -1677,7 +1755,7 @@ static void *_run_prolog(void *arg)
 	for (i=0; my_env[i]; i++)
 		xfree(my_env[i]);
 	xfree(my_env);
-	lock_slurmctld(config_read_lock);
+	lock_slurmctld(prolog_fini_lock);
 	if (job_ptr->job_id != job_id) {
 		error("prolog_slurmctld job %u pointer invalid", job_id);
 		job_ptr = find_job_record(job_id);
@@ -1687,6 +1765,7 @@ static void *_run_prolog(void *arg)
 	if (job_ptr) {
 		if (job_ptr->details)
 			job_ptr->details->prolog_running = 0;
+		job_record_changed(job_ptr);
 		if (job_ptr->batch_flag &&
 		    (IS_JOB_RUNNING(job_ptr) || IS_JOB_SUSPENDED(job_ptr)))
 			launch_job(job_ptr);
@@ -1706,7 +1785,7 @@ static void *_run_prolog(void *arg)
 				(~NODE_STATE_POWER_UP);
 		}
 	}
-	unlock_slurmctld(config_read_lock);
+	unlock_slurmctld(prolog_fini_lock);
 	FREE_NULL_BITMAP(node_bitmap);
 
 	return NULL;
@@ -1854,8 +1933,8 @@ static int _valid_feature_list(uint32_t job_id, List feature_list)
 			bracket = 1;
 		}
 		xstrcat(buf, feat_ptr->name);
-		if (rc == SLURM_SUCCESS)
-			rc = _valid_node_feature(feat_ptr->name);
+		if ((rc == SLURM_SUCCESS) && !find_job_feature(feat_ptr))
+			rc = ESLURM_INVALID_FEATURE;
 		if (feat_ptr->count) {
 			snprintf(tmp, sizeof(tmp), "*%u", feat_ptr->count);
 			xstrcat(buf, tmp);
@@ -1879,27 +1958,34 @@ static int _valid_feature_list(uint32_t job_id, List feature_list)
 	return rc;
 }
 
-static int _valid_node_feature(char *feature)
+static int _list_find_feature(void *feature_entry, void *key)
 {
-	int rc = ESLURM_INVALID_FEATURE;
 	struct features_record *feature_ptr;
-	ListIterator feature_iter;
-
-	/* Clear these nodes from the feature_list record,
-	 * then restore as needed */
-	feature_iter = list_iterator_create(feature_list);
-	if (feature_iter == NULL)
-		fatal("list_inerator_create malloc failure");
-	while ((feature_ptr = (struct features_record *)
-			list_next(feature_iter))) {
-		if (strcmp(feature_ptr->name, feature))
-			continue;
-		rc = SLURM_SUCCESS;
-		break;
-	}
-	list_iterator_destroy(feature_iter);
 
-	return rc;
+	feature_ptr = (struct features_record *) feature_entry;
+	if (strcmp(feature_ptr->name, (char *) key) == 0)
+		return 1;
+	return 0;
+}
+
+/*
+ * find_job_feature - Return the feature_list record of the nodes with one
+ *	of a job's required features, NULL if no node has the feature.
+ *	The name lookup is made once and kept in the job's feature_record
+ *	until feature_list records are added or removed.
+ * IN feat_ptr - entry from a job's details->feature_list
+ * NOTE: Caller must hold a node read lock
+ */
+extern struct features_record *find_job_feature(
+				struct feature_record *feat_ptr)
+{
+	if (feat_ptr->feat_gen != feature_list_gen) {
+		feat_ptr->feat_rec = list_find_first(feature_list,
+						     _list_find_feature,
+						     (void *) feat_ptr->name);
+		feat_ptr->feat_gen = feature_list_gen;
+	}
+	return feat_ptr->feat_rec;
 }
 
 /* If a job can run in multiple partitions, make sure that the one
@@ -59,9 +59,11 @@ extern int build_feature_list(struct job_record *job_ptr);
 
 /*
  * build_job_queue - build (non-priority ordered) list of pending jobs
+ *	from the pending job index (see pend_queue_add())
  * IN clear_start - if set then clear the start_time for pending jobs
  * RET the job queue
  * NOTE: the caller must call list_destroy() on RET value to free memory
+ * NOTE: Caller must hold a job write lock
  */
 extern List build_job_queue(bool clear_start);
 
@@ -73,6 +75,17 @@ extern List build_job_queue(bool clear_start);
  */
 extern int epilog_slurmctld(struct job_record *job_ptr);
 
+/*
+ * find_job_feature - Return the feature_list record of the nodes with one
+ *	of a job's required features, NULL if no node has the feature.
+ *	The name lookup is made once and kept in the job's feature_record
+ *	until feature_list records are added or removed.
+ * IN feat_ptr - entry from a job's details->feature_list
+ * NOTE: Caller must hold a node read lock
+ */
+extern struct features_record *find_job_feature(
+				struct feature_record *feat_ptr);
+
 /*
  * job_is_completing - Determine if jobs are in the process of completing.
  * RET - True of any job is in the process of completing AND
@@ -108,6 +121,30 @@ extern int make_batch_job_cred(batch_job_launch_msg_t *launch_msg_ptr,
 /* Print a job's dependency information based upon job_ptr->depend_list */
 extern void print_job_dependency(struct job_record *job_ptr);
 
+/*
+ * pend_queue_add - add a job to the index of jobs which may be pending,
+ *	from which build_job_queue() builds the job queue. Call when a job
+ *	is created or requeued. Jobs no longer pending are removed from the
+ *	index by build_job_queue().
+ * IN job_ptr - pointer to job record
+ * NOTE: Caller must hold a job write lock
+ */
+extern void pend_queue_add(struct job_record *job_ptr);
+
+/*
+ * pend_queue_fini - empty the pending job index, call before job records
+ *	are all freed
+ */
+extern void pend_queue_fini(void);
+
+/*
+ * pend_queue_remove - remove a job from the pending job index, call before
+ *	the job record is freed
+ * IN job_ptr - pointer to job record
+ * NOTE: Caller must hold a job write lock
+ */
+extern void pend_queue_remove(struct job_record *job_ptr);
+
 /*
  * prolog_slurmctld - execute the prolog_slurmctld for a job that has just
  *	been allocated resources.
@@ -130,8 +167,9 @@ extern void rebuild_job_part_list(struct job_record *job_ptr);
  * RET count of jobs scheduled
  * Note: We re-build the queue every time. Jobs can not only be added
  *	or removed from the queue, but have their priority or partition
- *	changed with the update_job RPC. In general nodes will be in priority
- *	order (by submit time), so the sorting should be pretty fast.
+ *	changed with the update_job RPC. The queue is built from the pending
+ *	job index rather than all jobs, sorted once with an O(n log n) merge
+ *	sort and then popped in order.
  */
 extern int schedule(uint32_t job_limit);
 
@@ -59,6 +59,7 @@ static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
 static slurmctld_lock_flags_t slurmctld_locks;
 static int kill_thread = 0;
 
+static void _wr_downgrade(lock_datatype_t datatype);
 static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock);
 static void _wr_rdunlock(lock_datatype_t datatype);
 static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock);
@@ -185,6 +186,31 @@ extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
 		_wr_wrunlock(CONFIG_LOCK);
 }
 
+/* downgrade_slurmctld - Convert the write locks previously issued with
+ *	lock_levels into read locks without releasing them */
+extern void downgrade_slurmctld(slurmctld_lock_t lock_levels)
+{
+	if (lock_levels.config == WRITE_LOCK)
+		_wr_downgrade(CONFIG_LOCK);
+	if (lock_levels.job == WRITE_LOCK)
+		_wr_downgrade(JOB_LOCK);
+	if (lock_levels.node == WRITE_LOCK)
+		_wr_downgrade(NODE_LOCK);
+	if (lock_levels.partition == WRITE_LOCK)
+		_wr_downgrade(PART_LOCK);
+}
+
+/* _wr_downgrade - Convert a write lock on the specified data type into a
+ *	read lock */
+static void _wr_downgrade(lock_datatype_t datatype)
+{
+	slurm_mutex_lock(&locks_mutex);
+	slurmctld_locks.entity[write_lock(datatype)]--;
+	slurmctld_locks.entity[read_lock(datatype)]++;
+	pthread_cond_broadcast(&locks_cond);
+	slurm_mutex_unlock(&locks_mutex);
+}
+
 /* _wr_rdlock - Issue a read lock on the specified data type */
 static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
 {
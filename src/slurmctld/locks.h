@@ -147,6 +147,10 @@ extern int try_lock_slurmctld (slurmctld_lock_t lock_levels);
  *	defined order */
 extern void unlock_slurmctld (slurmctld_lock_t lock_levels);
 
+/* downgrade_slurmctld - Convert the write locks previously issued with
+ *	lock_levels into read locks without releasing them */
+extern void downgrade_slurmctld (slurmctld_lock_t lock_levels);
+
 /* un/lock semaphore used for saving state of slurmctld */
 inline extern void lock_state_files ( void );
 inline extern void unlock_state_files ( void );
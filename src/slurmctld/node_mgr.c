@@ -1884,6 +1884,7 @@ extern int validate_nodes_via_front_end(
 			error("Resetting NULL batch_host of job %u to %s",
 			      reg_msg->job_id[i], front_end_ptr->name);
 			job_ptr->batch_host = xstrdup(front_end_ptr->name);
+			job_record_changed(job_ptr);
 		}
 
 
@@ -2592,6 +2593,7 @@ void make_node_idle(struct node_record *node_ptr,
 		/* Not a replay */
 		last_job_update = now;
 		bit_clear(node_bitmap, inx);
+		job_record_changed(job_ptr);
 
 		job_update_cpu_cnt(job_ptr, inx);
 
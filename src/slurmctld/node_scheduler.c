@@ -101,8 +101,8 @@ static int  _build_node_list(struct job_record *job_ptr,
 			     int *node_set_size);
 static void _filter_nodes_in_set(struct node_set *node_set_ptr,
 				 struct job_details *detail_ptr);
-static int _list_find_feature(void *feature_entry, void *key);
-static int _match_feature(char *seek, struct node_set *node_set_ptr);
+static int _match_feature(struct feature_record *job_feat_ptr,
+			  struct node_set *node_set_ptr);
 static int _nodes_in_sets(bitstr_t *req_bitmap,
 			  struct node_set * node_set_ptr,
 			  int node_set_size);
@@ -178,6 +178,7 @@ extern void deallocate_nodes(struct job_record *job_ptr, bool timeout,
 	xassert(job_ptr);
 	xassert(job_ptr->details);
 
+	job_record_changed(job_ptr);
 	license_job_return(job_ptr);
 	acct_policy_job_fini(job_ptr);
 	if (slurm_sched_freealloc(job_ptr) != SLURM_SUCCESS)
@@ -309,19 +310,19 @@ extern void deallocate_nodes(struct job_record *job_ptr, bool timeout,
 
 /*
  * _match_feature - determine if the desired feature is one of those available
- * IN seek - desired feature
+ * IN job_feat_ptr - desired feature
  * IN node_set_ptr - Pointer to node_set being searched
  * RET 1 if found, 0 otherwise
  */
-static int _match_feature(char *seek, struct node_set *node_set_ptr)
+static int _match_feature(struct feature_record *job_feat_ptr,
+			  struct node_set *node_set_ptr)
 {
 	struct features_record *feat_ptr;
 
-	if (seek == NULL)
+	if (job_feat_ptr->name == NULL)
 		return 1;	/* nothing to look for */
 
-	feat_ptr = list_find_first(feature_list, _list_find_feature,
-				   (void *) seek);
+	feat_ptr = find_job_feature(job_feat_ptr);
 	if (feat_ptr == NULL)
 		return 0;	/* no such feature */
 
@@ -487,8 +488,7 @@ _get_req_features(struct node_set *node_set_ptr, int node_set_size,
 			 * data structure, so we need to make a copy and then
 			 * purge it */
 			for (i=0; i<node_set_size; i++) {
-				if (!_match_feature(feat_ptr->name,
-						    node_set_ptr+i))
+				if (!_match_feature(feat_ptr, node_set_ptr+i))
 					continue;
 				tmp_node_set_ptr[tmp_node_set_size].
 					cpus_per_node =
@@ -717,6 +717,8 @@ _pick_best_nodes(struct node_set *node_set_ptr, int node_set_size,
 
 	shared = _resolve_shared_status(job_ptr->details->shared,
 					part_ptr->max_share, cr_enabled);
+	if (job_ptr->details->shared != shared)
+		job_record_changed(job_ptr);
 	job_ptr->details->shared = shared;
 	if (cr_enabled)
 		job_ptr->cr_enabled = cr_enabled; /* CR enabled for this job */
@@ -1204,13 +1206,17 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 		}
 		job_ptr->state_reason = fail_reason;
 		job_ptr->priority = 1;	/* sys hold, move to end of queue */
+		job_record_changed(job_ptr);
 		return ESLURM_REQUESTED_PART_CONFIG_UNAVAILABLE;
 	}
 
 	/* build sets of usable nodes based upon their configuration */
 	error_code = _build_node_list(job_ptr, &node_set_ptr, &node_set_size);
-	if (error_code)
+	if (error_code) {
+		/* job_test_resv() may have held the job */
+		job_record_changed(job_ptr);
 		return error_code;
+	}
 
 	/* insure that selected nodes are in these node sets */
 	if (job_ptr->details->req_node_bitmap) {
@@ -1273,6 +1279,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 			xfree(job_ptr->state_desc);
 			if (job_ptr->priority != 0)  /* Move to end of queue */
 				job_ptr->priority = 1;
+			job_record_changed(job_ptr);
 			last_job_update = now;
 		} else if (error_code == ESLURM_NODE_NOT_AVAIL) {
 			/* Required nodes are down or drained */
@@ -1282,6 +1289,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 			xfree(job_ptr->state_desc);
 			if (job_ptr->priority != 0)  /* Move to end of queue */
 				job_ptr->priority = 1;
+			job_record_changed(job_ptr);
 			last_job_update = now;
 		} else if (error_code == ESLURM_RESERVATION_NOT_USABLE) {
 			job_ptr->state_reason = WAIT_RESERVATION;
@@ -1305,6 +1313,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 	 * memory. */
 	FREE_NULL_BITMAP(job_ptr->node_bitmap);
 	xfree(job_ptr->nodes);
+	job_record_changed(job_ptr);
 
 	job_ptr->node_bitmap = select_bitmap;
 
@@ -1396,25 +1405,6 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 	return error_code;
 }
 
-/*
- * _list_find_feature - find an entry in the feature list, see list.h for
- *	documentation
- * IN key - is feature name or NULL for all features
- * RET 1 if found, 0 otherwise
- */
-static int _list_find_feature(void *feature_entry, void *key)
-{
-	struct features_record *feature_ptr;
-
-	if (key == NULL)
-		return 1;
-
-	feature_ptr = (struct features_record *) feature_entry;
-	if (strcmp(feature_ptr->name, (char *) key) == 0)
-		return 1;
-	return 0;
-}
-
 /*
  * _valid_feature_counts - validate a job's features can be satisfied
  *	by the selected nodes (NOTE: does not process XOR operators)
@@ -1448,8 +1438,7 @@ static bool _valid_feature_counts(struct job_details *detail_ptr,
 		fatal("list_iterator_create malloc error");
 	while ((job_feat_ptr = (struct feature_record *)
 			list_next(job_feat_iter))) {
-		feat_ptr = list_find_first(feature_list, _list_find_feature,
-					   (void *) job_feat_ptr->name);
+		feat_ptr = find_job_feature(job_feat_ptr);
 		if (feat_ptr) {
 			if (last_op == FEATURE_OP_AND)
 				bit_and(feature_bitmap, feat_ptr->node_bitmap);
@@ -1479,9 +1468,7 @@ static bool _valid_feature_counts(struct job_details *detail_ptr,
 				list_next(job_feat_iter))) {
 			if (job_feat_ptr->count == 0)
 				continue;
-			feat_ptr = list_find_first(feature_list,
-						   _list_find_feature,
-						   (void *)job_feat_ptr->name);
+			feat_ptr = find_job_feature(job_feat_ptr);
 			if (!feat_ptr) {
 				rc = false;
 				break;
@@ -2007,9 +1994,7 @@ static bitstr_t *_valid_features(struct job_details *details_ptr,
 			list_next(feat_iter))) {
 		if ((job_feat_ptr->op_code == FEATURE_OP_XOR) ||
 		    (last_op == FEATURE_OP_XOR)) {
-			feat_ptr = list_find_first(feature_list,
-						   _list_find_feature,
-						   (void *)job_feat_ptr->name);
+			feat_ptr = find_job_feature(job_feat_ptr);
 			if (feat_ptr &&
 			    bit_super_set(config_ptr->node_bitmap,
 					  feat_ptr->node_bitmap)) {
@@ -198,6 +198,7 @@ static void _preempt_signal(struct job_record *job_ptr, uint32_t grace_time)
 
 	job_ptr->preempt_time = time(NULL);
 	job_ptr->end_time = job_ptr->preempt_time + (time_t)grace_time;
+	job_record_changed(job_ptr);
 }
 /* *********************************************************************** */
 /*  TAG(                    slurm_job_check_grace                       )  */
@@ -76,6 +76,7 @@
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
+#include "src/slurmctld/info_cache.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/proc_req.h"
@@ -918,13 +919,18 @@ static void _slurm_rpc_dump_conf(slurm_msg_t * msg)
 static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 {
 	DEF_TIMERS;
-	char *dump;
-	int dump_size;
+	char *dump = NULL;
+	int dump_size = 0;
+	info_snapshot_t *snapshot = NULL;
 	slurm_msg_t response_msg;
+	slurm_msg_type_t msg_type = RESPONSE_JOB_INFO;
 	job_info_request_msg_t *job_info_request_msg =
 		(job_info_request_msg_t *) msg->data;
-	/* Locks: Read config job, write node (for hiding) */
+	/* Locks: Read config job part (for cache lookup) */
 	slurmctld_lock_t job_read_lock = {
+		READ_LOCK, READ_LOCK, NO_LOCK, READ_LOCK };
+	/* Locks: Read config job, write part (for hiding) */
+	slurmctld_lock_t job_pack_lock = {
 		READ_LOCK, READ_LOCK, NO_LOCK, WRITE_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 
@@ -937,11 +943,40 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 		debug3("_slurm_rpc_dump_jobs, no change");
 		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
 	} else {
-		pack_all_jobs(&dump, &dump_size,
-			      job_info_request_msg->show_flags,
-			      g_slurm_auth_get_uid(msg->auth_cred, NULL),
-			      msg->protocol_version);
+		/* Filtered responses are specific to the request */
+		if (job_info_request_msg->filter == NULL) {
+			snapshot = info_cache_lookup(INFO_CACHE_JOB,
+					job_info_request_msg->show_flags,
+					uid, msg->protocol_version);
+		}
 		unlock_slurmctld(job_read_lock);
+		if (job_info_request_msg->filter) {
+			lock_slurmctld(job_pack_lock);
+			pack_filtered_jobs(&dump, &dump_size,
+					   job_info_request_msg->show_flags,
+					   uid, msg->protocol_version,
+					   job_info_request_msg->filter, NULL);
+			unlock_slurmctld(job_pack_lock);
+		} else if (snapshot == NULL) {
+			lock_slurmctld(job_pack_lock);
+			snapshot = info_cache_pack(INFO_CACHE_JOB,
+					job_info_request_msg->show_flags,
+					uid, msg->protocol_version);
+			unlock_slurmctld(job_pack_lock);
+		}
+		if (snapshot && job_info_request_msg->delta &&
+		    (info_cache_job_delta(snapshot,
+					  job_info_request_msg->show_flags,
+					  uid, msg->protocol_version,
+					  job_info_request_msg->last_update,
+					  &dump, &dump_size) == SLURM_SUCCESS)) {
+			info_cache_release(snapshot);
+			snapshot = NULL;
+			msg_type = RESPONSE_JOB_INFO_DELTA;
+		} else if (snapshot) {
+			dump = snapshot->data;
+			dump_size = snapshot->size;
+		}
 		END_TIMER2("_slurm_rpc_dump_jobs");
 /* 		info("_slurm_rpc_dump_jobs, size=%d %s", */
 /* 		     dump_size, TIME_STR); */
@@ -951,13 +986,16 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 		response_msg.flags = msg->flags;
 		response_msg.protocol_version = msg->protocol_version;
 		response_msg.address = msg->address;
-		response_msg.msg_type = RESPONSE_JOB_INFO;
+		response_msg.msg_type = msg_type;
 		response_msg.data = dump;
 		response_msg.data_size = dump_size;
 
 		/* send message */
 		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
+		if (snapshot)
+			info_cache_release(snapshot);
+		else
+			xfree(dump);
 	}
 }
 
@@ -1142,8 +1180,7 @@ static void _slurm_rpc_dump_front_end(slurm_msg_t * msg)
 static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 {
 	DEF_TIMERS;
-	char *dump;
-	int dump_size;
+	info_snapshot_t *snapshot;
 	slurm_msg_t response_msg;
 	node_info_request_msg_t *node_req_msg =
 		(node_info_request_msg_t *) msg->data;
@@ -1173,13 +1210,13 @@ static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 		debug3("_slurm_rpc_dump_nodes, no change");
 		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
 	} else {
-
-		pack_all_node(&dump, &dump_size, node_req_msg->show_flags,
-			      uid, msg->protocol_version);
+		snapshot = info_cache_pack(INFO_CACHE_NODE,
+					   node_req_msg->show_flags, uid,
+					   msg->protocol_version);
 		unlock_slurmctld(node_write_lock);
 		END_TIMER2("_slurm_rpc_dump_nodes");
 		debug3("_slurm_rpc_dump_nodes, size=%d %s",
-		       dump_size, TIME_STR);
+		       snapshot->size, TIME_STR);
 
 		/* init response_msg structure */
 		slurm_msg_t_init(&response_msg);
@@ -1187,12 +1224,12 @@ static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 		response_msg.protocol_version = msg->protocol_version;
 		response_msg.address = msg->address;
 		response_msg.msg_type = RESPONSE_NODE_INFO;
-		response_msg.data = dump;
-		response_msg.data_size = dump_size;
+		response_msg.data = snapshot->data;
+		response_msg.data_size = snapshot->size;
 
 		/* send message */
 		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
+		info_cache_release(snapshot);
 	}
 }
 
@@ -1200,8 +1237,7 @@ static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 static void _slurm_rpc_dump_partitions(slurm_msg_t * msg)
 {
 	DEF_TIMERS;
-	char *dump;
-	int dump_size;
+	info_snapshot_t *snapshot;
 	slurm_msg_t response_msg;
 	part_info_request_msg_t  *part_req_msg;
 
@@ -1226,12 +1262,13 @@ static void _slurm_rpc_dump_partitions(slurm_msg_t * msg)
 		debug2("_slurm_rpc_dump_partitions, no change");
 		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
 	} else {
-		pack_all_part(&dump, &dump_size, part_req_msg->show_flags,
-			      uid, msg->protocol_version);
+		snapshot = info_cache_pack(INFO_CACHE_PART,
+					   part_req_msg->show_flags, uid,
+					   msg->protocol_version);
 		unlock_slurmctld(part_read_lock);
 		END_TIMER2("_slurm_rpc_dump_partitions");
 		debug2("_slurm_rpc_dump_partitions, size=%d %s",
-		       dump_size, TIME_STR);
+		       snapshot->size, TIME_STR);
 
 		/* init response_msg structure */
 		slurm_msg_t_init(&response_msg);
@@ -1239,12 +1276,12 @@ static void _slurm_rpc_dump_partitions(slurm_msg_t * msg)
 		response_msg.protocol_version = msg->protocol_version;
 		response_msg.address = msg->address;
 		response_msg.msg_type = RESPONSE_PARTITION_INFO;
-		response_msg.data = dump;
-		response_msg.data_size = dump_size;
+		response_msg.data = snapshot->data;
+		response_msg.data_size = snapshot->size;
 
 		/* send message */
 		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
+		info_cache_release(snapshot);
 	}
 }
 
@@ -2207,6 +2244,8 @@ static void _slurm_rpc_reconfigure_controller(slurm_msg_t * msg)
 		info("_slurm_rpc_reconfigure_controller: completed %s",
 		     TIME_STR);
 		slurm_send_rc_msg(msg, SLURM_SUCCESS);
+		info_cache_log_stats();
+		rpc_queue_log_stats();
 		priority_g_reconfig();          /* notify priority plugin too */
 		schedule(0);			/* has its own locks */
 		save_all_state();
@@ -3034,9 +3073,9 @@ static void _slurm_rpc_resv_delete(slurm_msg_t * msg)
 	DEF_TIMERS;
 	reservation_name_msg_t *resv_desc_ptr = (reservation_name_msg_t *)
 		msg->data;
-	/* Locks: read job, write node */
+	/* Locks: write job, write node */
 	slurmctld_lock_t node_write_lock = {
-		NO_LOCK, READ_LOCK, WRITE_LOCK, NO_LOCK };
+		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 
 	START_TIMER;
@@ -1507,6 +1507,8 @@ static int _sync_nodes_to_active_job(struct job_record *job_ptr)
 					       node_flags;
 		}
 	}
+	if (cnt)
+		job_record_changed(job_ptr);
 	return cnt;
 }
 
@@ -1726,6 +1726,7 @@ static void _clear_job_resv(slurmctld_resv_t *resv_ptr)
 		job_ptr->resv_id = 0;
 		job_ptr->resv_ptr = NULL;
 		xfree(job_ptr->resv_name);
+		job_record_changed(job_ptr);
 	}
 	list_iterator_destroy(job_iterator);
 }
@@ -2050,6 +2051,7 @@ static void _validate_all_reservations(void)
 			       job_ptr->job_id, job_ptr->resv_name);
 			job_ptr->resv_id = 0;
 			xfree(job_ptr->resv_name);
+			job_record_changed(job_ptr);
 		}
 	}
 	list_iterator_destroy(iter);
@@ -0,0 +1,1012 @@
+/*****************************************************************************\
+ *  script_store.c - Deduplicated store of batch job scripts and environments
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "slurm/slurm_errno.h"
+
+#include "src/common/fd.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmctld/script_store.h"
+#include "src/slurmctld/state_save.h"
+
+#define STORE_SEG_MAX	(4 * 1024 * 1024) /* start new segment beyond this */
+#define STORE_HASH_MIN	1024		/* initial hash table size */
+#define STORE_COMPACT_PCT	25	/* copy out a sealed segment's records
+					 * once less of it than this is live */
+#define STORE_BLOB_MAGIC	0x53424c42
+#define STORE_INDEX_MAGIC	0x53494458
+#define STORE_INDEX_ADD		1	/* job's data saved */
+#define STORE_INDEX_DEL		2	/* job's data released */
+
+/* Precedes each record's data in a segment file */
+typedef struct store_blob_hdr {
+	uint32_t magic;
+	uint32_t size;			/* bytes of data */
+	uint64_t hash;			/* _hash_data() of data */
+} store_blob_hdr_t;
+
+/* Record of script_store.index, [0] for script and [1] for environment */
+typedef struct store_index_rec {
+	uint32_t magic;
+	uint32_t type;			/* STORE_INDEX_ADD or STORE_INDEX_DEL */
+	uint32_t job_id;
+	uint32_t seg_id[2];		/* zero if no data */
+	uint32_t offset[2];
+	uint32_t unused;
+	uint64_t hash[2];
+} store_index_rec_t;
+
+typedef struct store_seg {
+	uint32_t seg_id;
+	int fd;				/* open only while seg_active */
+	uint32_t size;			/* bytes in file */
+	uint32_t live_cnt;		/* records with references */
+	uint32_t live_size;		/* bytes of records with references */
+	bool compact;			/* sparse, see _seg_compact_all() */
+} store_seg_t;
+
+typedef struct store_blob {
+	uint64_t hash;
+	store_seg_t *seg;
+	uint32_t offset;		/* of header in segment */
+	uint32_t size;			/* bytes of data */
+	uint32_t ref_cnt;		/* jobs referencing the data */
+	struct store_blob *next;	/* next with same hash index */
+} store_blob_t;
+
+typedef struct store_job {
+	uint32_t job_id;
+	store_blob_t *blob[2];		/* script, environment */
+	bool lost;			/* data missing when loaded */
+	struct store_job *next;		/* next with same hash index */
+} store_job_t;
+
+static pthread_mutex_t store_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool          store_loaded = false;
+static char         *store_dir = NULL;
+static store_seg_t **seg_array = NULL;
+static int           seg_cnt = 0;
+static store_seg_t  *seg_active = NULL;	/* segment appended to */
+static uint32_t      seg_next_id = 1;
+static store_blob_t **blob_hash = NULL;
+static int           blob_hash_size = 0, blob_cnt = 0;
+static store_job_t **job_hash = NULL;
+static int           job_hash_size = 0, job_cnt = 0;
+static int           index_fd = -1;
+static uint32_t      index_rec_cnt = 0;	/* records in script_store.index */
+
+/* 64-bit FNV-1a hash of data */
+static uint64_t _hash_data(char *data, uint32_t size)
+{
+	unsigned char *ptr = (unsigned char *) data;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	uint32_t i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= ptr[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static char *_seg_file(uint32_t seg_id)
+{
+	return xstrdup_printf("%s/script_store.seg.%u", store_dir, seg_id);
+}
+
+/* Write all data at offset
+ * RET SLURM_SUCCESS or SLURM_ERROR */
+static int _pwrite_all(int fd, void *data, uint32_t size, off_t offset)
+{
+	char *ptr = (char *) data;
+	ssize_t amount;
+
+	while (size > 0) {
+		amount = pwrite(fd, ptr, size, offset);
+		if (amount < 0) {
+			if (errno == EINTR)
+				continue;
+			return SLURM_ERROR;
+		}
+		ptr    += amount;
+		size   -= amount;
+		offset += amount;
+	}
+	return SLURM_SUCCESS;
+}
+
+/* Read all data at offset
+ * RET SLURM_SUCCESS or SLURM_ERROR, including on end of file */
+static int _pread_all(int fd, void *data, uint32_t size, off_t offset)
+{
+	char *ptr = (char *) data;
+	ssize_t amount;
+
+	while (size > 0) {
+		amount = pread(fd, ptr, size, offset);
+		if (amount < 0) {
+			if (errno == EINTR)
+				continue;
+			return SLURM_ERROR;
+		}
+		if (amount == 0)
+			return SLURM_ERROR;
+		ptr    += amount;
+		size   -= amount;
+		offset += amount;
+	}
+	return SLURM_SUCCESS;
+}
+
+/* Double a hash table's size once it holds more records than that */
+static void _blob_hash_grow(void)
+{
+	store_blob_t **old_hash = blob_hash, *blob_ptr, *next_ptr;
+	int i, inx, old_size = blob_hash_size;
+
+	blob_hash_size = MAX(STORE_HASH_MIN, old_size * 2);
+	blob_hash = xmalloc(sizeof(store_blob_t *) * blob_hash_size);
+	for (i = 0; i < old_size; i++) {
+		for (blob_ptr = old_hash[i]; blob_ptr; blob_ptr = next_ptr) {
+			next_ptr = blob_ptr->next;
+			inx = blob_ptr->hash % blob_hash_size;
+			blob_ptr->next = blob_hash[inx];
+			blob_hash[inx] = blob_ptr;
+		}
+	}
+	xfree(old_hash);
+}
+
+static void _job_hash_grow(void)
+{
+	store_job_t **old_hash = job_hash, *job_ptr, *next_ptr;
+	int i, inx, old_size = job_hash_size;
+
+	job_hash_size = MAX(STORE_HASH_MIN, old_size * 2);
+	job_hash = xmalloc(sizeof(store_job_t *) * job_hash_size);
+	for (i = 0; i < old_size; i++) {
+		for (job_ptr = old_hash[i]; job_ptr; job_ptr = next_ptr) {
+			next_ptr = job_ptr->next;
+			inx = job_ptr->job_id % job_hash_size;
+			job_ptr->next = job_hash[inx];
+			job_hash[inx] = job_ptr;
+		}
+	}
+	xfree(old_hash);
+}
+
+static store_job_t *_job_find(uint32_t job_id)
+{
+	store_job_t *job_ptr;
+
+	if (job_hash_size == 0)
+		return NULL;
+	job_ptr = job_hash[job_id % job_hash_size];
+	while (job_ptr && (job_ptr->job_id != job_id))
+		job_ptr = job_ptr->next;
+	return job_ptr;
+}
+
+static store_job_t *_job_create(uint32_t job_id)
+{
+	store_job_t *job_ptr = xmalloc(sizeof(store_job_t));
+	int inx;
+
+	if (job_cnt >= job_hash_size)
+		_job_hash_grow();
+	job_ptr->job_id = job_id;
+	inx = job_id % job_hash_size;
+	job_ptr->next = job_hash[inx];
+	job_hash[inx] = job_ptr;
+	job_cnt++;
+	return job_ptr;
+}
+
+static void _job_delete(store_job_t *job_ptr)
+{
+	store_job_t **job_pptr = &job_hash[job_ptr->job_id % job_hash_size];
+
+	while (*job_pptr != job_ptr)
+		job_pptr = &(*job_pptr)->next;
+	*job_pptr = job_ptr->next;
+	job_cnt--;
+	xfree(job_ptr);
+}
+
+/* Close a segment and remove its file */
+static void _seg_remove(store_seg_t *seg)
+{
+	char *file_name = _seg_file(seg->seg_id);
+	int i;
+
+	debug3("script_store: removing segment %u", seg->seg_id);
+	if (seg->fd >= 0)
+		(void) close(seg->fd);
+	(void) unlink(file_name);
+	xfree(file_name);
+	for (i = 0; i < seg_cnt; i++) {
+		if (seg_array[i] == seg) {
+			seg_array[i] = seg_array[--seg_cnt];
+			break;
+		}
+	}
+	if (seg == seg_active)
+		seg_active = NULL;
+	xfree(seg);
+}
+
+static store_seg_t *_seg_add(uint32_t seg_id, int fd, uint32_t size)
+{
+	store_seg_t *seg = xmalloc(sizeof(store_seg_t));
+
+	seg->seg_id = seg_id;
+	seg->fd = fd;
+	seg->size = size;
+	xrealloc(seg_array, sizeof(store_seg_t *) * (seg_cnt + 1));
+	seg_array[seg_cnt++] = seg;
+	seg_next_id = MAX(seg_next_id, seg_id + 1);
+	return seg;
+}
+
+/* Note a sealed segment for compaction once mostly unreferenced */
+static void _seg_test_sparse(store_seg_t *seg)
+{
+	if ((seg != seg_active) && seg->live_cnt &&
+	    ((uint64_t) seg->live_size * 100 <
+	     (uint64_t) seg->size * STORE_COMPACT_PCT))
+		seg->compact = true;
+}
+
+/* Stop appending to the active segment, closing its file */
+static void _seg_seal(void)
+{
+	store_seg_t *seg = seg_active;
+
+	seg_active = NULL;
+	if (seg->live_cnt == 0) {
+		_seg_remove(seg);
+		return;
+	}
+	(void) fsync_and_close(seg->fd, "script store segment");
+	seg->fd = -1;
+	_seg_test_sparse(seg);
+}
+
+/* Return a descriptor to read a segment, release with _seg_read_close() */
+static int _seg_read_open(store_seg_t *seg)
+{
+	char *file_name;
+	int fd;
+
+	if (seg->fd >= 0)
+		return seg->fd;
+	file_name = _seg_file(seg->seg_id);
+	fd = open(file_name, O_RDONLY);
+	if (fd < 0)
+		error("script_store: open file %s error %m", file_name);
+	else
+		fd_set_close_on_exec(fd);
+	xfree(file_name);
+	return fd;
+}
+
+static void _seg_read_close(store_seg_t *seg, int fd)
+{
+	if ((fd >= 0) && (fd != seg->fd))
+		(void) close(fd);
+}
+
+/* Return a segment with room for a record of size bytes of data */
+static store_seg_t *_seg_for_append(uint32_t size)
+{
+	char *file_name;
+	int fd;
+
+	if (seg_active && seg_active->size &&
+	    ((seg_active->size + sizeof(store_blob_hdr_t) + size) >
+	     STORE_SEG_MAX))
+		_seg_seal();
+	if (seg_active)
+		return seg_active;
+
+	file_name = _seg_file(seg_next_id);
+	fd = open(file_name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		error("script_store: create file %s error %m", file_name);
+		xfree(file_name);
+		return NULL;
+	}
+	xfree(file_name);
+	fd_set_close_on_exec(fd);
+	seg_active = _seg_add(seg_next_id, fd, 0);
+	return seg_active;
+}
+
+static store_blob_t *_blob_link(uint64_t hash, store_seg_t *seg,
+				uint32_t offset, uint32_t size)
+{
+	store_blob_t *blob_ptr = xmalloc(sizeof(store_blob_t));
+	int inx;
+
+	if (blob_cnt >= blob_hash_size)
+		_blob_hash_grow();
+	blob_ptr->hash   = hash;
+	blob_ptr->seg    = seg;
+	blob_ptr->offset = offset;
+	blob_ptr->size   = size;
+	inx = hash % blob_hash_size;
+	blob_ptr->next = blob_hash[inx];
+	blob_hash[inx] = blob_ptr;
+	blob_cnt++;
+	return blob_ptr;
+}
+
+static void _blob_unlink(store_blob_t *blob_ptr)
+{
+	store_blob_t **blob_pptr = &blob_hash[blob_ptr->hash % blob_hash_size];
+
+	while (*blob_pptr != blob_ptr)
+		blob_pptr = &(*blob_pptr)->next;
+	*blob_pptr = blob_ptr->next;
+	blob_cnt--;
+	xfree(blob_ptr);
+}
+
+/* Read a blob's data from an open segment file
+ * RET data, xfree when done, or NULL on error */
+static char *_blob_read_fd(store_blob_t *blob_ptr, int fd)
+{
+	char *data;
+
+	if (fd < 0)
+		return NULL;
+	data = xmalloc(MAX(blob_ptr->size, 1));
+	if (_pread_all(fd, data, blob_ptr->size,
+		       blob_ptr->offset + sizeof(store_blob_hdr_t))) {
+		error("script_store: read segment %u error %m",
+		      blob_ptr->seg->seg_id);
+		xfree(data);
+	}
+	return data;
+}
+
+/* Return a blob's data, xfree when done, or NULL on error */
+static char *_blob_read(store_blob_t *blob_ptr)
+{
+	int fd = _seg_read_open(blob_ptr->seg);
+	char *data = _blob_read_fd(blob_ptr, fd);
+
+	_seg_read_close(blob_ptr->seg, fd);
+	return data;
+}
+
+static void _blob_ref(store_blob_t *blob_ptr)
+{
+	if (blob_ptr->ref_cnt++ == 0) {
+		blob_ptr->seg->live_cnt++;
+		blob_ptr->seg->live_size += sizeof(store_blob_hdr_t) +
+					    blob_ptr->size;
+	}
+}
+
+/* Drop a reference to a blob, removing it and then its segment when
+ * no longer referenced */
+static void _blob_release(store_blob_t *blob_ptr)
+{
+	store_seg_t *seg = blob_ptr->seg;
+
+	xassert(blob_ptr->ref_cnt);
+	if (--blob_ptr->ref_cnt)
+		return;
+	seg->live_size -= sizeof(store_blob_hdr_t) + blob_ptr->size;
+	_blob_unlink(blob_ptr);
+	if (--seg->live_cnt == 0 && (seg != seg_active))
+		_seg_remove(seg);
+	else
+		_seg_test_sparse(seg);
+}
+
+/* Append a record to the active segment
+ * OUT offset - of the record's header in the segment
+ * RET the segment or NULL on error */
+static store_seg_t *_data_append(char *data, uint32_t size, uint64_t hash,
+				 uint32_t *offset)
+{
+	store_blob_hdr_t hdr;
+	store_seg_t *seg;
+
+	if (!(seg = _seg_for_append(size)))
+		return NULL;
+	hdr.magic = STORE_BLOB_MAGIC;
+	hdr.size  = size;
+	hdr.hash  = hash;
+	if (_pwrite_all(seg->fd, &hdr, sizeof(hdr), seg->size) ||
+	    _pwrite_all(seg->fd, data, size, seg->size + sizeof(hdr))) {
+		error("script_store: write segment %u error %m",
+		      seg->seg_id);
+		(void) ftruncate(seg->fd, seg->size);
+		return NULL;
+	}
+	*offset = seg->size;
+	seg->size += sizeof(hdr) + size;
+	return seg;
+}
+
+/* Return a referenced blob holding data, writing the data to the active
+ * segment unless already stored. RET NULL on error */
+static store_blob_t *_blob_add(char *data, uint32_t size)
+{
+	uint64_t hash = _hash_data(data, size);
+	store_blob_t *blob_ptr;
+	store_seg_t *seg;
+	uint32_t offset;
+	char *old_data;
+
+	if (blob_hash_size) {
+		blob_ptr = blob_hash[hash % blob_hash_size];
+		for ( ; blob_ptr; blob_ptr = blob_ptr->next) {
+			if ((blob_ptr->hash != hash) ||
+			    (blob_ptr->size != size))
+				continue;
+			if (!(old_data = _blob_read(blob_ptr)))
+				continue;
+			if (memcmp(old_data, data, size) == 0) {
+				xfree(old_data);
+				_blob_ref(blob_ptr);
+				return blob_ptr;
+			}
+			xfree(old_data);
+		}
+	}
+
+	if (!(seg = _data_append(data, size, hash, &offset)))
+		return NULL;
+	blob_ptr = _blob_link(hash, seg, offset, size);
+	_blob_ref(blob_ptr);
+	return blob_ptr;
+}
+
+/* Find the blob at a segment offset with the given hash */
+static store_blob_t *_blob_find(uint32_t seg_id, uint32_t offset,
+				uint64_t hash)
+{
+	store_blob_t *blob_ptr;
+
+	if (blob_hash_size == 0)
+		return NULL;
+	blob_ptr = blob_hash[hash % blob_hash_size];
+	for ( ; blob_ptr; blob_ptr = blob_ptr->next) {
+		if ((blob_ptr->hash == hash) &&
+		    (blob_ptr->seg->seg_id == seg_id) &&
+		    (blob_ptr->offset == offset))
+			return blob_ptr;
+	}
+	return NULL;
+}
+
+static void _index_rec_init(store_index_rec_t *rec, uint32_t type,
+			    store_job_t *job_ptr)
+{
+	int i;
+
+	memset(rec, 0, sizeof(store_index_rec_t));
+	rec->magic  = STORE_INDEX_MAGIC;
+	rec->type   = type;
+	rec->job_id = job_ptr->job_id;
+	for (i = 0; (type == STORE_INDEX_ADD) && (i < 2); i++) {
+		if (!job_ptr->blob[i])
+			continue;
+		rec->seg_id[i] = job_ptr->blob[i]->seg->seg_id;
+		rec->offset[i] = job_ptr->blob[i]->offset;
+		rec->hash[i]   = job_ptr->blob[i]->hash;
+	}
+}
+
+/* Rewrite script_store.index with a record for each job
+ * RET SLURM_SUCCESS or SLURM_ERROR */
+static int _index_rewrite(void)
+{
+	char *file_name, *new_file;
+	store_index_rec_t *recs;
+	store_job_t *job_ptr;
+	int fd, i, rec_cnt = 0, rc = SLURM_SUCCESS;
+
+	recs = xmalloc(sizeof(store_index_rec_t) * MAX(job_cnt, 1));
+	for (i = 0; i < job_hash_size; i++) {
+		for (job_ptr = job_hash[i]; job_ptr; job_ptr = job_ptr->next)
+			_index_rec_init(&recs[rec_cnt++], STORE_INDEX_ADD,
+					job_ptr);
+	}
+
+	file_name = xstrdup_printf("%s/script_store.index", store_dir);
+	new_file  = xstrdup_printf("%s/script_store.index.new", store_dir);
+	fd = creat(new_file, 0600);
+	if (fd < 0) {
+		error("script_store: create file %s error %m", new_file);
+		rc = SLURM_ERROR;
+	} else {
+		if (_pwrite_all(fd, recs, sizeof(store_index_rec_t) * rec_cnt,
+				0)) {
+			error("script_store: write file %s error %m",
+			      new_file);
+			rc = SLURM_ERROR;
+		}
+		if (fsync_and_close(fd, "script store index"))
+			rc = SLURM_ERROR;
+	}
+	if ((rc == SLURM_SUCCESS) && rename(new_file, file_name)) {
+		error("script_store: rename %s error %m", new_file);
+		rc = SLURM_ERROR;
+	}
+	if (rc == SLURM_SUCCESS) {
+		if (index_fd >= 0)
+			(void) close(index_fd);
+		index_fd = open(file_name, O_WRONLY | O_APPEND);
+		if (index_fd < 0)
+			error("script_store: open file %s error %m",
+			      file_name);
+		else
+			fd_set_close_on_exec(index_fd);
+		index_rec_cnt = rec_cnt;
+	} else
+		(void) unlink(new_file);
+	xfree(file_name);
+	xfree(new_file);
+	xfree(recs);
+	return rc;
+}
+
+/* Append a job's record to script_store.index, compacting the file once
+ * mostly made of superseded records
+ * RET SLURM_SUCCESS or SLURM_ERROR */
+static int _index_append(uint32_t type, store_job_t *job_ptr)
+{
+	store_index_rec_t rec;
+	int rc = SLURM_SUCCESS;
+
+	if (index_rec_cnt > (2 * job_cnt + STORE_HASH_MIN))
+		(void) _index_rewrite();
+	if (index_fd < 0)
+		return SLURM_ERROR;
+
+	_index_rec_init(&rec, type, job_ptr);
+	while (write(index_fd, &rec, sizeof(rec)) != sizeof(rec)) {
+		if (errno == EINTR)
+			continue;
+		error("script_store: write index error %m");
+		rc = SLURM_ERROR;
+		break;
+	}
+	index_rec_cnt++;
+	return rc;
+}
+
+/* Copy the live records of a sparse sealed segment to the active segment
+ * and point the index at the copies, then remove the segment */
+static void _seg_compact(store_seg_t *seg)
+{
+	store_blob_t *blob_ptr;
+	store_seg_t *new_seg;
+	uint32_t offset, rec_size, move_cnt = 0;
+	char *data;
+	int fd, i;
+
+	debug3("script_store: compacting segment %u, %u of %u bytes live",
+	       seg->seg_id, seg->live_size, seg->size);
+	if ((fd = _seg_read_open(seg)) < 0)
+		return;
+	for (i = 0; i < blob_hash_size; i++) {
+		for (blob_ptr = blob_hash[i]; blob_ptr;
+		     blob_ptr = blob_ptr->next) {
+			if (blob_ptr->seg != seg)
+				continue;
+			if (!(data = _blob_read_fd(blob_ptr, fd)))
+				goto fini;
+			new_seg = _data_append(data, blob_ptr->size,
+					       blob_ptr->hash, &offset);
+			xfree(data);
+			if (!new_seg)
+				goto fini;
+			rec_size = sizeof(store_blob_hdr_t) + blob_ptr->size;
+			seg->live_cnt--;
+			seg->live_size -= rec_size;
+			new_seg->live_cnt++;
+			new_seg->live_size += rec_size;
+			blob_ptr->seg = new_seg;
+			blob_ptr->offset = offset;
+			move_cnt++;
+		}
+	}
+
+fini:
+	_seg_read_close(seg, fd);
+	if (move_cnt == 0)
+		return;
+	/* Copies must be on disk before the index refers to them. If the
+	 * index can not be rewritten, its old records still refer to this
+	 * segment, so keep its file until the next _load() */
+	if (seg_active && fsync(seg_active->fd))
+		error("script_store: sync segment %u error %m",
+		      seg_active->seg_id);
+	if ((_index_rewrite() == SLURM_SUCCESS) && (seg->live_cnt == 0))
+		_seg_remove(seg);
+}
+
+/* Compact the segments noted as sparse by _seg_test_sparse() */
+static void _seg_compact_all(void)
+{
+	store_seg_t *seg;
+	int i;
+
+	for (i = 0; i < seg_cnt; ) {
+		seg = seg_array[i];
+		if (!seg->compact || (seg == seg_active)) {
+			i++;
+			continue;
+		}
+		seg->compact = false;
+		_seg_compact(seg);	/* may move last segment to i */
+	}
+}
+
+/* Free all memory and close all files */
+static void _clear(void)
+{
+	store_blob_t *blob_ptr, *blob_next;
+	store_job_t *job_ptr, *job_next;
+	int i;
+
+	for (i = 0; i < blob_hash_size; i++) {
+		for (blob_ptr = blob_hash[i]; blob_ptr; blob_ptr = blob_next) {
+			blob_next = blob_ptr->next;
+			xfree(blob_ptr);
+		}
+	}
+	xfree(blob_hash);
+	blob_hash_size = blob_cnt = 0;
+	for (i = 0; i < job_hash_size; i++) {
+		for (job_ptr = job_hash[i]; job_ptr; job_ptr = job_next) {
+			job_next = job_ptr->next;
+			xfree(job_ptr);
+		}
+	}
+	xfree(job_hash);
+	job_hash_size = job_cnt = 0;
+	for (i = 0; i < seg_cnt; i++) {
+		if (seg_array[i]->fd >= 0)
+			(void) close(seg_array[i]->fd);
+		xfree(seg_array[i]);
+	}
+	xfree(seg_array);
+	seg_cnt = 0;
+	seg_active = NULL;
+	seg_next_id = 1;
+	if (index_fd >= 0) {
+		(void) close(index_fd);
+		index_fd = -1;
+	}
+	index_rec_cnt = 0;
+	xfree(store_dir);
+	store_loaded = false;
+}
+
+/* Add the records of a segment file to the blob table, dropping any
+ * partly written record at its end */
+static void _load_seg(uint32_t seg_id)
+{
+	char *file_name = _seg_file(seg_id);
+	store_blob_hdr_t hdr;
+	store_seg_t *seg;
+	struct stat stat_buf;
+	uint32_t offset = 0;
+	int fd;
+
+	fd = open(file_name, O_RDWR);
+	if ((fd < 0) || (fstat(fd, &stat_buf) < 0)) {
+		error("script_store: open file %s error %m", file_name);
+		if (fd >= 0)
+			(void) close(fd);
+		xfree(file_name);
+		return;
+	}
+	fd_set_close_on_exec(fd);
+	while ((offset + sizeof(hdr)) <= stat_buf.st_size) {
+		if (_pread_all(fd, &hdr, sizeof(hdr), offset) ||
+		    (hdr.magic != STORE_BLOB_MAGIC) ||
+		    ((offset + sizeof(hdr) + hdr.size) > stat_buf.st_size))
+			break;
+		offset += sizeof(hdr) + hdr.size;
+	}
+	if (offset != stat_buf.st_size) {
+		error("script_store: %s truncated to %u bytes", file_name,
+		      offset);
+		(void) ftruncate(fd, offset);
+	}
+	xfree(file_name);
+
+	seg = _seg_add(seg_id, -1, offset);
+	for (offset = 0; offset < seg->size;
+	     offset += sizeof(hdr) + hdr.size) {
+		(void) _pread_all(fd, &hdr, sizeof(hdr), offset);
+		(void) _blob_link(hdr.hash, seg, offset, hdr.size);
+	}
+	(void) close(fd);
+}
+
+/* Replay script_store.index to rebuild the jobs' references */
+static void _load_index(void)
+{
+	char *file_name = xstrdup_printf("%s/script_store.index", store_dir);
+	store_index_rec_t rec;
+	store_job_t *job_ptr;
+	store_blob_t *blob_ptr[2];
+	off_t offset = 0;
+	int fd, i;
+
+	fd = open(file_name, O_RDONLY);
+	if (fd < 0) {
+		debug("script_store: no index file %s", file_name);
+		xfree(file_name);
+		return;
+	}
+	while (_pread_all(fd, &rec, sizeof(rec), offset) == SLURM_SUCCESS) {
+		offset += sizeof(rec);
+		if (rec.magic != STORE_INDEX_MAGIC) {
+			error("script_store: %s is corrupted", file_name);
+			break;
+		}
+		job_ptr = _job_find(rec.job_id);
+		if (rec.type == STORE_INDEX_DEL) {
+			if (job_ptr)
+				_job_delete(job_ptr);
+			continue;
+		}
+		for (i = 0; i < 2; i++) {
+			blob_ptr[i] = NULL;
+			if (rec.seg_id[i] == 0)
+				continue;
+			blob_ptr[i] = _blob_find(rec.seg_id[i], rec.offset[i],
+						 rec.hash[i]);
+			if (blob_ptr[i] == NULL)
+				break;
+		}
+		if (job_ptr == NULL)
+			job_ptr = _job_create(rec.job_id);
+		/* Data is missing if released later in the index */
+		job_ptr->lost = (i < 2);
+		job_ptr->blob[0] = job_ptr->lost ? NULL : blob_ptr[0];
+		job_ptr->blob[1] = job_ptr->lost ? NULL : blob_ptr[1];
+	}
+	(void) close(fd);
+	xfree(file_name);
+}
+
+/* Build the store from its files, removing unreferenced data */
+static void _load(void)
+{
+	store_blob_t *blob_ptr, *blob_next;
+	store_job_t *job_ptr, *job_next;
+	struct dirent *dir_ent;
+	DIR *f_dir;
+	char *endptr;
+	unsigned long seg_id;
+	int i, j;
+
+	_clear();
+	store_loaded = true;
+	store_dir = slurm_get_state_save_location();
+
+	f_dir = opendir(store_dir);
+	if (!f_dir) {
+		error("script_store: opendir(%s): %m", store_dir);
+	} else {
+		while ((dir_ent = readdir(f_dir))) {
+			if (strncmp(dir_ent->d_name, "script_store.seg.", 17))
+				continue;
+			seg_id = strtoul(&dir_ent->d_name[17], &endptr, 10);
+			if ((seg_id == 0) || (endptr[0] != '\0'))
+				continue;
+			_load_seg(seg_id);
+		}
+		closedir(f_dir);
+	}
+
+	_load_index();
+	for (i = 0; i < job_hash_size; i++) {
+		for (job_ptr = job_hash[i]; job_ptr; job_ptr = job_next) {
+			job_next = job_ptr->next;
+			if (job_ptr->lost) {
+				error("script_store: data for job %u lost",
+				      job_ptr->job_id);
+				_job_delete(job_ptr);
+				continue;
+			}
+			for (j = 0; j < 2; j++) {
+				if (job_ptr->blob[j])
+					_blob_ref(job_ptr->blob[j]);
+			}
+		}
+	}
+	for (i = 0; i < blob_hash_size; i++) {
+		for (blob_ptr = blob_hash[i]; blob_ptr; blob_ptr = blob_next) {
+			blob_next = blob_ptr->next;
+			if (blob_ptr->ref_cnt == 0)
+				_blob_unlink(blob_ptr);
+		}
+	}
+	for (i = 0; i < seg_cnt; ) {
+		if (seg_array[i]->live_cnt == 0) {
+			_seg_remove(seg_array[i]);	/* moves last to i */
+		} else {
+			_seg_test_sparse(seg_array[i]);
+			i++;
+		}
+	}
+	(void) _index_rewrite();
+	_seg_compact_all();
+	debug("script_store: %d jobs, %d records in %d segments",
+	      job_cnt, blob_cnt, seg_cnt);
+}
+
+extern int script_store_add(uint32_t job_id, char *script,
+			    uint32_t script_size, char *env,
+			    uint32_t env_size)
+{
+	store_blob_t *blob_ptr[2] = { NULL, NULL };
+	store_job_t *job_ptr;
+	int i, rc = SLURM_SUCCESS;
+
+	slurm_mutex_lock(&store_mutex);
+	if (!store_loaded)
+		_load();
+	if (script && !(blob_ptr[0] = _blob_add(script, script_size)))
+		rc = ESLURM_WRITING_TO_FILE;
+	else if (env && !(blob_ptr[1] = _blob_add(env, env_size)))
+		rc = ESLURM_WRITING_TO_FILE;
+
+	if (rc == SLURM_SUCCESS) {
+		if (!(job_ptr = _job_find(job_id)))
+			job_ptr = _job_create(job_id);
+		for (i = 0; i < 2; i++) {
+			if (job_ptr->blob[i])
+				_blob_release(job_ptr->blob[i]);
+			job_ptr->blob[i] = blob_ptr[i];
+		}
+		if (_index_append(STORE_INDEX_ADD, job_ptr)) {
+			rc = ESLURM_WRITING_TO_FILE;
+			for (i = 0; i < 2; i++) {
+				job_ptr->blob[i] = NULL;
+				if (blob_ptr[i])
+					_blob_release(blob_ptr[i]);
+			}
+			_job_delete(job_ptr);
+		}
+	} else if (blob_ptr[0])
+		_blob_release(blob_ptr[0]);
+	_seg_compact_all();
+	slurm_mutex_unlock(&store_mutex);
+	return rc;
+}
+
+extern char *script_store_get(uint32_t job_id, bool env, uint32_t *size)
+{
+	store_job_t *job_ptr;
+	store_blob_t *blob_ptr;
+	char *data = NULL;
+
+	*size = 0;
+	slurm_mutex_lock(&store_mutex);
+	if (!store_loaded)
+		_load();
+	if ((job_ptr = _job_find(job_id)) &&
+	    (blob_ptr = job_ptr->blob[env ? 1 : 0]) &&
+	    (data = _blob_read(blob_ptr)))
+		*size = blob_ptr->size;
+	slurm_mutex_unlock(&store_mutex);
+	return data;
+}
+
+extern void script_store_get_job_ids(List job_ids)
+{
+	store_job_t *job_ptr;
+	uint32_t *job_id_ptr;
+	int i;
+
+	slurm_mutex_lock(&store_mutex);
+	if (!store_loaded)
+		_load();
+	for (i = 0; i < job_hash_size; i++) {
+		for (job_ptr = job_hash[i]; job_ptr; job_ptr = job_ptr->next) {
+			job_id_ptr = xmalloc(sizeof(uint32_t));
+			*job_id_ptr = job_ptr->job_id;
+			list_append(job_ids, job_id_ptr);
+		}
+	}
+	slurm_mutex_unlock(&store_mutex);
+}
+
+extern void script_store_load(void)
+{
+	slurm_mutex_lock(&store_mutex);
+	_load();
+	slurm_mutex_unlock(&store_mutex);
+}
+
+extern void script_store_remove(uint32_t job_id)
+{
+	store_job_t *job_ptr;
+	int i;
+
+	slurm_mutex_lock(&store_mutex);
+	if (!store_loaded)
+		_load();
+	if ((job_ptr = _job_find(job_id))) {
+		(void) _index_append(STORE_INDEX_DEL, job_ptr);
+		for (i = 0; i < 2; i++) {
+			if (job_ptr->blob[i])
+				_blob_release(job_ptr->blob[i]);
+		}
+		_job_delete(job_ptr);
+		_seg_compact_all();
+	}
+	slurm_mutex_unlock(&store_mutex);
+}
+
+extern void script_store_fini(void)
+{
+	slurm_mutex_lock(&store_mutex);
+	_clear();
+	slurm_mutex_unlock(&store_mutex);
+}
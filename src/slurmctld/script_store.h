@@ -0,0 +1,92 @@
+/*****************************************************************************\
+ *  script_store.h - Deduplicated store of batch job scripts and environments
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_SCRIPT_STORE_H
+#define _HAVE_SCRIPT_STORE_H
+
+#include "src/common/list.h"
+
+/*
+ * Batch job scripts and environments are kept in StateSaveLocation as
+ * records appended to "script_store.seg.#" segment files. Identical content
+ * is stored once, with a count of the jobs referencing it. The jobs'
+ * references are logged to "script_store.index". A segment file is removed
+ * once no job references any of its records, and the records still
+ * referenced in a mostly unreferenced segment are first copied to the
+ * segment being appended to. Only that segment's file is kept open.
+ */
+
+/*
+ * script_store_add - save a batch job's script and environment
+ * IN job_id - job to save the data for, replacing any saved before
+ * IN script - script, including its terminating NUL, or NULL if none
+ * IN script_size - bytes in script
+ * IN env - environment, as packed by _copy_job_desc_to_file() and read
+ *	by _read_data_array() in job_mgr.c
+ * IN env_size - bytes in env
+ * RET SLURM_SUCCESS or ESLURM_WRITING_TO_FILE
+ */
+extern int script_store_add(uint32_t job_id, char *script,
+			    uint32_t script_size, char *env,
+			    uint32_t env_size);
+
+/*
+ * script_store_get - read a batch job's saved script or environment
+ * IN job_id - job to read the data of
+ * IN env - true for the environment, false for the script
+ * OUT size - bytes of data returned
+ * RET data, xfree when no longer needed, or NULL if none saved
+ */
+extern char *script_store_get(uint32_t job_id, bool env, uint32_t *size);
+
+/*
+ * script_store_get_job_ids - append to a list the xmalloc'd uint32_t ID of
+ *	every job with data in the store, like _get_batch_job_dir_ids()
+ */
+extern void script_store_get_job_ids(List job_ids);
+
+/*
+ * script_store_load - (re)build the store from its files, as needed when
+ *	recovering state or taking over from another slurmctld
+ */
+extern void script_store_load(void);
+
+/* script_store_remove - release a job's saved script and environment */
+extern void script_store_remove(uint32_t job_id);
+
+/* script_store_fini - free all memory, leaving the files in place */
+extern void script_store_fini(void);
+
+#endif	/* !_HAVE_SCRIPT_STORE_H */
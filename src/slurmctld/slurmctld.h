@@ -338,6 +338,9 @@ struct feature_record {
 	char *name;			/* name of feature */
 	uint16_t count;			/* count of nodes with this feature */
 	uint8_t op_code;		/* separator, see FEATURE_OP_ above */
+	struct features_record *feat_rec; /* nodes with this feature, NULL
+					 * if none, see find_job_feature() */
+	uint32_t feat_gen;		/* feature_list_gen of feat_rec */
 };
 
 /* job_details - specification of a job's constraints,
@@ -500,6 +503,8 @@ struct job_record {
 	bool part_nodes_missing;	/* set if job's nodes removed from this
 					 * partition */
 	struct part_record *part_ptr;	/* pointer to the partition record */
+	bool pend_queued;		/* set while in the pending job index,
+					 * see pend_queue_add() */
 	time_t pre_sus_time;		/* time job ran prior to last suspend */
 	time_t preempt_time;		/* job preemption signal time */
 	uint32_t priority;		/* relative priority of the job,
@@ -529,6 +534,8 @@ struct job_record {
 	time_t start_time;		/* time execution begins,
 					 * actual or expected */
 	char *state_desc;		/* optional details for state_reason */
+	bool state_changed;		/* state changed since last saved to
+					 * file, see job_record_changed() */
 	uint16_t state_reason;		/* reason job still pending or failed
 					 * see slurm.h:enum job_wait_reason */
 	List step_list;			/* list of job's steps */
@@ -545,6 +552,10 @@ struct job_record {
 	uint32_t total_nodes;	        /* number of allocated nodes
 					 * for accounting */
 	uint32_t user_id;		/* user the job runs as */
+	struct job_record *user_next;	/* next entry with same user hash
+					 * index, see find_first_user_job() */
+	struct job_record *user_prev;	/* previous entry with same user
+					 * hash index */
 	uint16_t wait_all_nodes;	/* if set, wait for all nodes to boot
 					 * before starting the job */
 	uint16_t warn_signal;		/* signal to send before end_time */
@@ -765,6 +776,22 @@ extern void dump_step_desc(job_step_create_request_msg_t *step_spec);
 extern void excise_node_from_job(struct job_record *job_ptr,
                                  struct node_record *node_ptr);
 
+/*
+ * find_first_user_job - return a pointer to the first job record of a user
+ *	found in the user index, use find_next_user_job() for the others
+ * IN user_id - user ID
+ * RET pointer to a job record, NULL if the user has no jobs
+ */
+extern struct job_record *find_first_user_job(uint32_t user_id);
+
+/*
+ * find_next_user_job - return a pointer to the next job record with the same
+ *	user as the given record, in no particular order
+ * IN job_ptr - job record from find_first_user_job() or find_next_user_job()
+ * RET pointer to a job record, NULL if the user has no more jobs
+ */
+extern struct job_record *find_next_user_job(struct job_record *job_ptr);
+
 /*
  * find_job_record - return a pointer to the job record with the given job_id
  * IN job_id - requested job's id
@@ -982,6 +1009,17 @@ extern void job_pre_resize_acctg(struct job_record *job_ptr);
 /* Record accounting information for a job immediately after changing size */
 extern void job_post_resize_acctg(struct job_record *job_ptr);
 
+/*
+ * job_record_changed - note that a job record's saved state has changed, so
+ *	the next dump_all_job_state() writes it to job_state.journal.
+ *	Call from any function changing a field saved by _dump_job_state()
+ *	or one of the job's steps, normally with job write lock set. Expected
+ *	start times, CPU counts, pending reasons and priorities computed by
+ *	the schedulers are rebuilt after restart and need not be noted.
+ * IN job_ptr - pointer to job changed
+ */
+extern void job_record_changed(struct job_record *job_ptr);
+
 /*
  * job_restart - Restart a batch job from checkpointed state
  *
@@ -1333,6 +1371,35 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 			  uint16_t show_flags, uid_t uid,
 			  uint16_t protocol_version);
 
+/* Location of each record in a packed job information buffer */
+typedef struct pack_index {
+	uint32_t  rec_cnt;	/* number of records packed */
+	uint32_t *rec_id;	/* job ID of each record */
+	uint32_t *rec_offset;	/* buffer offset of each record */
+	time_t    expire_time;	/* when a packed record passes MinJobAge and
+				 * would no longer be packed, 0 if never */
+} pack_index_t;
+
+/*
+ * pack_filtered_jobs - dump job information for jobs matching a filter in
+ *	machine independent form (for network transmission)
+ * OUT buffer_ptr - the pointer is set to the allocated buffer.
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * IN filter - jobs to pack, NULL to pack all jobs
+ * OUT index - if not NULL, set to the location of each job record packed,
+ *	free its arrays with xfree()
+ * global: job_list - global list of job records
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ */
+extern void pack_filtered_jobs(char **buffer_ptr, int *buffer_size,
+			       uint16_t show_flags, uid_t uid,
+			       uint16_t protocol_version,
+			       job_info_filter_t *filter,
+			       pack_index_t *index);
+
 /*
  * pack_all_node - dump all configuration and node information for all nodes
  *	in machine independent form (for network transmission)
@@ -1453,7 +1520,8 @@ extern bool partition_in_use(char *part_name);
 void purge_old_job(void);
 
 /*
- * rehash_jobs - Create or rebuild the job hash table.
+ * rehash_jobs - Create or rebuild the job hash table, growing it as needed
+ *	for MaxJobCount.
  * NOTE: run lock_slurmctld before entry: Read config, write job
  */
 extern void rehash_jobs(void);
@@ -1501,6 +1569,10 @@ extern void run_backup(void);
 /* Spawn health check function for every node that is not DOWN */
 extern void run_health_check(void);
 
+/* rpc_queue_log_stats - Log request counts, queue depths and times queued
+ *	for each lane of the RPC worker pool */
+extern void rpc_queue_log_stats(void);
+
 /* save_all_state - save entire slurmctld state for later recovery */
 extern void save_all_state(void);
 
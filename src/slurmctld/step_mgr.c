@@ -141,6 +141,7 @@ static struct step_record * _create_step_record(struct job_record *job_ptr)
 
 	step_ptr = (struct step_record *) xmalloc(sizeof(struct step_record));
 
+	job_record_changed(job_ptr);
 	last_job_update = time(NULL);
 	step_ptr->job_ptr = job_ptr;
 	step_ptr->start_time = time(NULL);
@@ -166,6 +167,7 @@ extern void delete_step_records (struct job_record *job_ptr)
 	xassert(job_ptr);
 	step_iterator = list_iterator_create (job_ptr->step_list);
 
+	job_record_changed(job_ptr);
 	last_job_update = time(NULL);
 	while ((step_ptr = (struct step_record *) list_next (step_iterator))) {
 		list_remove (step_iterator);
@@ -225,6 +227,7 @@ delete_step_record (struct job_record *job_ptr, uint32_t step_id)
 	xassert(job_ptr);
 	error_code = ENOENT;
 	step_iterator = list_iterator_create (job_ptr->step_list);
+	job_record_changed(job_ptr);
 	last_job_update = time(NULL);
 	while ((step_ptr = (struct step_record *) list_next (step_iterator))) {
 		if (step_ptr->step_id == step_id) {
@@ -680,11 +683,13 @@ _pick_step_nodes (struct job_record  *job_ptr,
 				if (job_ptr->time_limit != INFINITE) {
 					job_ptr->end_time = time(NULL) +
 						(job_ptr->time_limit * 60);
+					job_record_changed(job_ptr);
 				}
 				return NULL;
 			}
 		}
 		job_ptr->job_state &= (~JOB_CONFIGURING);
+		job_record_changed(job_ptr);
 		debug("Configuration for job %u complete", job_ptr->job_id);
 	}
 
@@ -2401,6 +2406,7 @@ extern int job_step_checkpoint(checkpoint_msg_t *ckpt_ptr,
 				   ckpt_ptr->image_dir, &resp_data.event_time,
 				   &resp_data.error_code,
 				   &resp_data.error_msg);
+		job_record_changed(job_ptr);
 		last_job_update = time(NULL);
 	}
 
@@ -2467,6 +2473,7 @@ extern int job_step_checkpoint_comp(checkpoint_comp_msg_t *ckpt_ptr,
 	} else {
 		rc = checkpoint_comp((void *)step_ptr, ckpt_ptr->begin_time,
 			ckpt_ptr->error_code, ckpt_ptr->error_msg);
+		job_record_changed(job_ptr);
 		last_job_update = time(NULL);
 	}
 
@@ -2526,6 +2533,7 @@ extern int job_step_checkpoint_task_comp(checkpoint_task_comp_msg_t *ckpt_ptr,
 		rc = checkpoint_task_comp((void *)step_ptr,
 			ckpt_ptr->task_id, ckpt_ptr->begin_time,
 			ckpt_ptr->error_code, ckpt_ptr->error_msg);
+		job_record_changed(job_ptr);
 		last_job_update = time(NULL);
 	}
 
@@ -2578,6 +2586,7 @@ extern int step_partial_comp(step_complete_msg_t *req, uid_t uid,
 		     req->job_id, req->job_step_id);
 		return ESLURM_INVALID_JOB_ID;
 	}
+	job_record_changed(job_ptr);
 	if (step_ptr->batch_step) {
 		if (rem)
 			*rem = 0;
@@ -3252,6 +3261,7 @@ extern void step_checkpoint(void)
 			job_checkpoint(&ckpt_req, getuid(), -1,
 				       (uint16_t)NO_VAL);
 			job_ptr->ckpt_time = now;
+			job_record_changed(job_ptr);
 			last_job_update = now;
 			continue; /* ignore periodic step ckpt */
 		}
@@ -3276,6 +3286,7 @@ extern void step_checkpoint(void)
 				continue;
 
 			step_ptr->ckpt_time = now;
+			job_record_changed(job_ptr);
 			last_job_update = now;
 			image_dir = xstrdup(step_ptr->ckpt_dir);
 			xstrfmtcat(image_dir, "/%u.%u", job_ptr->job_id,
@@ -3444,8 +3455,10 @@ extern int update_step(step_update_request_msg_t *req, uid_t uid)
 		} else
 			return ESLURM_INVALID_JOB_ID;
 	}
-	if (mod_cnt)
+	if (mod_cnt) {
+		job_record_changed(job_ptr);
 		last_job_update = time(NULL);
+	}
 
 	return SLURM_SUCCESS;
 }
@@ -40,6 +40,7 @@
 #  include "config.h"
 #endif
 
+#include <dirent.h>
 #include <fcntl.h>
 #include <pthread.h>
 #include <sched.h>
@@ -50,6 +51,7 @@
 #include <stdlib.h>
 #include <sys/param.h>		/* MAXPATHLEN */
 #include <sys/poll.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -119,8 +121,34 @@ typedef struct {
 	pthread_mutex_t *timer_mutex;
 } timer_struct_t;
 
+/* File being written by sbcast. The first block of a file starts a
+ * receiver process running as the user, which keeps the file open and
+ * writes the later blocks by offset as slurmd passes them over a socket. */
+typedef struct {
+	uint32_t job_id;
+	uid_t    uid;
+	char    *fname;
+	pid_t    pid;		/* receiver process */
+	int      sock;		/* slurmd end of socket to the receiver */
+	pthread_mutex_t mutex;	/* one block on the socket at a time */
+	int      refcnt;	/* RPCs using this record */
+	bool     removed;	/* no longer in bcast_file_list */
+	time_t   last_use;
+} bcast_file_t;
+
+/* Block header passed from slurmd to an sbcast receiver */
+typedef struct {
+	uint64_t offset;
+	uint32_t len;
+	uint16_t last_block;
+} bcast_block_t;
+
+#define BCAST_FILE_TIMEOUT 300	/* seconds an idle receiver is kept */
+#define BCAST_REAP_INTERVAL 60	/* seconds between checks for idle receivers */
+
 static int  _abort_job(uint32_t job_id, uint32_t slurm_rc);
 static int  _abort_step(uint32_t job_id, uint32_t step_id);
+static void *_bcast_file_reaper(void *arg);
 static char **_build_env(uint32_t jobid, uid_t uid, char *resv_id,
 			 char **spank_job_env, uint32_t spank_job_env_size);
 static void _delay_rpc(int host_inx, int host_cnt, int usec_per_rpc);
@@ -169,7 +197,7 @@ static int  _waiter_complete (uint32_t jobid);
 
 static bool _steps_completed_now(uint32_t jobid);
 static int  _valid_sbcast_cred(file_bcast_msg_t *req, uid_t req_uid,
-			       uint16_t block_no);
+			       uint16_t block_no, uint32_t *job_id);
 static void _wait_state_completed(uint32_t jobid, int max_delay);
 static long _get_job_uid(uint32_t jobid);
 
@@ -199,6 +227,11 @@ static pthread_mutex_t job_limits_mutex = PTHREAD_MUTEX_INITIALIZER;
 static List job_limits_list = NULL;
 static bool job_limits_loaded = false;
 
+static pthread_mutex_t bcast_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+static List bcast_file_list = NULL;
+static List bcast_pid_list = NULL;	/* stopped receivers not yet reaped */
+static bool bcast_reaper_running = false;
+
 /* NUM_PARALLEL_SUSPEND controls the number of jobs suspended/resumed
  * at one time as well as the number of jobsteps per job that can be
  * suspended at one time */
@@ -544,6 +577,23 @@ rwfail:
 }
 
 
+/*
+ * Add a started slurmstepd to the step registry, which takes ownership
+ * of "fd", the read end of the pipe the slurmstepd holds until it exits.
+ */
+static void
+_register_step(slurmd_step_type_t type, void *req, int fd)
+{
+	if (type == LAUNCH_BATCH_JOB) {
+		batch_job_launch_msg_t *msg = (batch_job_launch_msg_t *) req;
+		stepd_registry_add(msg->job_id, msg->step_id, fd);
+	} else {
+		launch_tasks_request_msg_t *msg =
+			(launch_tasks_request_msg_t *) req;
+		stepd_registry_add(msg->job_id, msg->job_step_id, fd);
+	}
+}
+
 /*
  * Fork and exec the slurmstepd, then send the slurmstepd its
  * initialization data.  Then wait for slurmstepd to send an "ok"
@@ -568,6 +618,12 @@ _forkexec_slurmstepd(slurmd_step_type_t type, void *req,
 		error("_forkexec_slurmstepd pipe failed: %m");
 		return SLURM_FAILURE;
 	}
+	/* Other slurmstepds must not inherit these, the slurmstepd keeps
+	 * to_slurmd open to tell the step registry when it exits */
+	fd_set_close_on_exec(to_stepd[0]);
+	fd_set_close_on_exec(to_stepd[1]);
+	fd_set_close_on_exec(to_slurmd[0]);
+	fd_set_close_on_exec(to_slurmd[1]);
 
 	if (_add_starting_step(type, req)) {
 		error("_forkexec_slurmstepd failed in _add_starting_step: %m");
@@ -612,6 +668,10 @@ _forkexec_slurmstepd(slurmd_step_type_t type, void *req,
 				     "possible file system problem or full "
 				     "memory", delta_time);
 			}
+			if (rc == SLURM_SUCCESS) {
+				_register_step(type, req, to_slurmd[0]);
+				to_slurmd[0] = -1;
+			}
 		}
 
 	done:
@@ -623,7 +683,7 @@ _forkexec_slurmstepd(slurmd_step_type_t type, void *req,
 			error("Unable to reap slurmd child process");
 		if (close(to_stepd[1]) < 0)
 			error("close write to_stepd in parent: %m");
-		if (close(to_slurmd[0]) < 0)
+		if ((to_slurmd[0] >= 0) && (close(to_slurmd[0]) < 0))
 			error("close read to_slurmd in parent: %m");
 		return rc;
 	} else {
@@ -2384,15 +2444,15 @@ _init_groups(uid_t my_uid, gid_t my_gid)
  * Munge without generating a credential replay error
  * RET SLURM_SUCCESS or an error code */
 static int
-_valid_sbcast_cred(file_bcast_msg_t *req, uid_t req_uid, uint16_t block_no)
+_valid_sbcast_cred(file_bcast_msg_t *req, uid_t req_uid, uint16_t block_no,
+		   uint32_t *job_id)
 {
 	int rc = SLURM_SUCCESS;
-	uint32_t job_id;
 	char *nodes = NULL;
 	hostset_t hset = NULL;
 
 	rc = extract_sbcast_cred(conf->vctx, req->cred, block_no,
-				 &job_id, &nodes);
+				 job_id, &nodes);
 	if (rc != 0) {
 		error("Security violation: Invalid sbcast_cred from uid %d",
 		      req_uid);
@@ -2416,45 +2476,330 @@ _valid_sbcast_cred(file_bcast_msg_t *req, uid_t req_uid, uint16_t block_no)
 	return rc;
 }
 
-static int
-_rpc_file_bcast(slurm_msg_t *msg)
+/* Start _bcast_file_reaper() unless running, bcast_file_mutex must be
+ * locked */
+static void _bcast_reaper_start(void)
 {
-	file_bcast_msg_t *req = msg->data;
-	int fd, flags, offset, inx, rc;
-	uid_t req_uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
-	gid_t req_gid = g_slurm_auth_get_gid(msg->auth_cred, NULL);
-	pid_t child;
+	pthread_attr_t attr;
+	pthread_t id;
 
-#if 0
-	info("last_block=%u force=%u modes=%o",
-	     req->last_block, req->force, req->modes);
-	info("uid=%u gid=%u atime=%lu mtime=%lu block_len[0]=%u",
-	     req->uid, req->gid, req->atime, req->mtime, req->block_len);
-#if 0
-	/* when the file being transferred is binary, the following line
-	 * can break the terminal output for slurmd */
-	info("req->block[0]=%s, @ %lu", \
-	     req->block[0], (unsigned long) &req->block);
-#endif
-#endif
+	if (bcast_reaper_running)
+		return;
+	slurm_attr_init(&attr);
+	if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED))
+		error("pthread_attr_setdetachstate: %m");
+	if (pthread_create(&id, &attr, &_bcast_file_reaper, NULL))
+		error("sbcast: pthread_create: %m");
+	else
+		bcast_reaper_running = true;
+	slurm_attr_destroy(&attr);
+}
 
-	if ((rc = _valid_sbcast_cred(req, req_uid, req->block_no)) !=
-	    SLURM_SUCCESS)
-		return rc;
+/* Reap a stopped receiver without waiting, RET 1 if it has exited */
+static int _bcast_pid_reaped(void *x, void *key)
+{
+	pid_t pid = *(pid_t *) x;
 
-	info("sbcast req_uid=%u fname=%s block_no=%u",
-	     req_uid, req->fname, req->block_no);
-	child = fork();
-	if (child == -1) {
-		error("sbcast: fork failure");
-		return errno;
-	} else if (child > 0) {
-		waitpid(child, &rc, 0);
-		return WEXITSTATUS(rc);
+	return (waitpid(pid, NULL, WNOHANG) != 0);
+}
+
+/* Stop a receiver, leaving its process for _bcast_file_reaper() to reap
+ * as it may be blocked writing to the file.
+ * bcast_file_mutex must be locked */
+static void _bcast_file_free(bcast_file_t *bcast_file)
+{
+	pid_t *pid_ptr;
+
+	/* Receivers forked later hold copies of this socket, so shut it
+	 * down for this receiver to see end of file */
+	if (bcast_file->sock >= 0) {
+		shutdown(bcast_file->sock, SHUT_RDWR);
+		close(bcast_file->sock);
+	}
+	if (bcast_file->pid > 0) {
+		if (bcast_pid_list == NULL)
+			bcast_pid_list = list_create(slurm_destroy_uint32_ptr);
+		pid_ptr = xmalloc(sizeof(pid_t));
+		*pid_ptr = bcast_file->pid;
+		list_append(bcast_pid_list, pid_ptr);
+		_bcast_reaper_start();
+	}
+	slurm_mutex_destroy(&bcast_file->mutex);
+	xfree(bcast_file->fname);
+	xfree(bcast_file);
+}
+
+static int _bcast_file_find(void *x, void *key)
+{
+	return (x == key);
+}
+
+/* Unlink a record from bcast_file_list, bcast_file_mutex must be locked */
+static void _bcast_file_unlink(bcast_file_t *bcast_file)
+{
+	ListIterator iter;
+
+	if (bcast_file->removed)
+		return;
+	iter = list_iterator_create(bcast_file_list);
+	if (list_find(iter, _bcast_file_find, bcast_file))
+		list_remove(iter);
+	list_iterator_destroy(iter);
+	bcast_file->removed = true;
+}
+
+/* Stop the receivers of a job, or idle receivers if job_id is NO_VAL.
+ * A job's receivers are killed, others still in use are stopped when
+ * released. bcast_file_mutex must be locked */
+static void _bcast_file_purge(uint32_t job_id, time_t now)
+{
+	bcast_file_t *bcast_file;
+	ListIterator iter;
+
+	if (bcast_file_list == NULL)
+		return;
+	iter = list_iterator_create(bcast_file_list);
+	while ((bcast_file = list_next(iter))) {
+		if (job_id != NO_VAL) {
+			if (bcast_file->job_id != job_id)
+				continue;
+		} else if ((bcast_file->refcnt != 0) ||
+			   (difftime(now, bcast_file->last_use) <=
+			    BCAST_FILE_TIMEOUT))
+			continue;
+		debug("sbcast: stopping %s receiver for `%s`",
+		      (job_id == NO_VAL) ? "idle" : "terminated job's",
+		      bcast_file->fname);
+		list_remove(iter);
+		bcast_file->removed = true;
+		if ((job_id != NO_VAL) && (bcast_file->pid > 0))
+			kill(bcast_file->pid, SIGKILL);
+		if (bcast_file->refcnt == 0)
+			_bcast_file_free(bcast_file);
+	}
+	list_iterator_destroy(iter);
+}
+
+/* Stop all receivers of a job, as when it is terminated */
+static void _bcast_file_purge_job(uint32_t job_id)
+{
+	slurm_mutex_lock(&bcast_file_mutex);
+	_bcast_file_purge(job_id, time(NULL));
+	slurm_mutex_unlock(&bcast_file_mutex);
+}
+
+/* Stop idle receivers and reap stopped ones periodically, exits once
+ * none are left */
+static void *_bcast_file_reaper(void *arg)
+{
+	while (1) {
+		sleep(BCAST_REAP_INTERVAL);
+		slurm_mutex_lock(&bcast_file_mutex);
+		_bcast_file_purge(NO_VAL, time(NULL));
+		if (bcast_pid_list)
+			list_delete_all(bcast_pid_list, _bcast_pid_reaped, NULL);
+		if (((bcast_file_list == NULL) ||
+		     (list_count(bcast_file_list) == 0)) &&
+		    ((bcast_pid_list == NULL) ||
+		     (list_count(bcast_pid_list) == 0))) {
+			bcast_reaper_running = false;
+			slurm_mutex_unlock(&bcast_file_mutex);
+			break;
+		}
+		slurm_mutex_unlock(&bcast_file_mutex);
+	}
+	return NULL;
+}
+
+/* Return the receiver for a file, or NULL if none is running. Idle
+ * receivers are stopped first. Release with _bcast_file_put(). */
+static bcast_file_t *_bcast_file_get(uint32_t job_id, uid_t uid, char *fname)
+{
+	bcast_file_t *bcast_file, *match = NULL;
+	ListIterator iter;
+	time_t now = time(NULL);
+
+	slurm_mutex_lock(&bcast_file_mutex);
+	_bcast_file_purge(NO_VAL, now);
+	if (bcast_file_list == NULL) {
+		slurm_mutex_unlock(&bcast_file_mutex);
+		return NULL;
+	}
+	iter = list_iterator_create(bcast_file_list);
+	while ((bcast_file = list_next(iter))) {
+		if (!match && (bcast_file->job_id == job_id) &&
+		    (bcast_file->uid == uid) &&
+		    !strcmp(bcast_file->fname, fname))
+			match = bcast_file;
+	}
+	list_iterator_destroy(iter);
+	if (match) {
+		match->refcnt++;
+		match->last_use = now;
+	}
+	slurm_mutex_unlock(&bcast_file_mutex);
+	return match;
+}
+
+/* Release a receiver from _bcast_file_get(), stopping it if remove */
+static void _bcast_file_put(bcast_file_t *bcast_file, bool remove)
+{
+	slurm_mutex_lock(&bcast_file_mutex);
+	if (remove)
+		_bcast_file_unlink(bcast_file);
+	if ((--bcast_file->refcnt == 0) && bcast_file->removed)
+		_bcast_file_free(bcast_file);
+	slurm_mutex_unlock(&bcast_file_mutex);
+}
+
+static void _bcast_file_add(uint32_t job_id, uid_t uid, char *fname,
+			    pid_t pid, int sock)
+{
+	bcast_file_t *bcast_file = xmalloc(sizeof(bcast_file_t));
+
+	bcast_file->job_id   = job_id;
+	bcast_file->uid      = uid;
+	bcast_file->fname    = xstrdup(fname);
+	bcast_file->pid      = pid;
+	bcast_file->sock     = sock;
+	bcast_file->last_use = time(NULL);
+	slurm_mutex_init(&bcast_file->mutex);
+
+	slurm_mutex_lock(&bcast_file_mutex);
+	if (bcast_file_list == NULL)
+		bcast_file_list = list_create(NULL);
+	list_append(bcast_file_list, bcast_file);
+	_bcast_reaper_start();
+	slurm_mutex_unlock(&bcast_file_mutex);
+}
+
+/* Write a block at its offset, or append it for older sbcast versions */
+static int _file_bcast_write(int fd, char *block, uint32_t block_len,
+			     uint64_t block_offset, char *fname, uid_t req_uid)
+{
+	uint32_t offset = 0;
+	ssize_t inx;
+
+	while (block_len - offset) {
+		if (block_offset == FILE_BCAST_APPEND) {
+			inx = write(fd, &block[offset], (block_len - offset));
+		} else {
+			inx = pwrite(fd, &block[offset], (block_len - offset),
+				     (off_t) (block_offset + offset));
+		}
+		if (inx == -1) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			error("sbcast: uid:%u can't write `%s`: %s",
+			      req_uid, fname, strerror(errno));
+			return errno;
+		}
+		offset += inx;
+	}
+	return SLURM_SUCCESS;
+}
+
+/* Set the modes, owner and times of a file after its last block */
+static void _file_bcast_finish(int fd, file_bcast_msg_t *req, uid_t req_uid)
+{
+	if (fchmod(fd, (req->modes & 0777))) {
+		error("sbcast: uid:%u can't chmod `%s`: %s",
+		      req_uid, req->fname, strerror(errno));
+	}
+	if (fchown(fd, req->uid, req->gid)) {
+		error("sbcast: uid:%u can't chown `%s`: %s",
+		      req_uid, req->fname, strerror(errno));
+	}
+	if (req->atime) {
+		struct utimbuf time_buf;
+		time_buf.actime  = req->atime;
+		time_buf.modtime = req->mtime;
+		if (utime(req->fname, &time_buf)) {
+			error("sbcast: uid:%u can't utime `%s`: %s",
+			      req_uid, req->fname, strerror(errno));
+		}
+	}
+}
+
+/* Receive and write later blocks of a file until the last block arrives,
+ * slurmd closes the socket or no block arrives for twice the time slurmd
+ * keeps an idle receiver. Runs as the user, does not return! */
+static void _file_bcast_receiver(file_bcast_msg_t *req, uid_t req_uid,
+				 int fd, int sock)
+{
+	bcast_block_t block_hdr;
+	char *block = NULL;
+	uint32_t block_size = 0;
+	struct pollfd pfd;
+	int rc;
+
+	pfd.fd = sock;
+	pfd.events = POLLIN;
+	while (1) {
+		rc = poll(&pfd, 1, BCAST_FILE_TIMEOUT * 2 * 1000);
+		if ((rc < 0) && (errno == EINTR))
+			continue;
+		if (rc <= 0) {
+			error("sbcast: uid:%u no block for `%s`, stopping",
+			      req_uid, req->fname);
+			break;
+		}
+		safe_read(sock, &block_hdr, sizeof(bcast_block_t));
+		if (block_hdr.len > block_size) {
+			block_size = block_hdr.len;
+			xrealloc(block, block_size);
+		}
+		safe_read(sock, block, block_hdr.len);
+		rc = _file_bcast_write(fd, block, block_hdr.len,
+				       block_hdr.offset, req->fname, req_uid);
+		if ((rc == SLURM_SUCCESS) && block_hdr.last_block)
+			_file_bcast_finish(fd, req, req_uid);
+		safe_write(sock, &rc, sizeof(int));
+		if (rc || block_hdr.last_block)
+			break;
+	}
+
+rwfail:
+	close(fd);
+	exit(SLURM_SUCCESS);
+}
+
+/* Close every file descriptor above stderr except keep_fd1 and keep_fd2,
+ * so that a long lived child does not hold slurmd's sockets and pipes */
+static void _close_fds_except(int keep_fd1, int keep_fd2)
+{
+	DIR *dir;
+	struct dirent *ent;
+	int fd, fdlimit;
+
+	if ((dir = opendir("/proc/self/fd"))) {
+		while ((ent = readdir(dir))) {
+			if (ent->d_name[0] == '.')
+				continue;
+			fd = atoi(ent->d_name);
+			if ((fd > 2) && (fd != keep_fd1) &&
+			    (fd != keep_fd2) && (fd != dirfd(dir)))
+				close(fd);
+		}
+		closedir(dir);
+		return;
 	}
 
-	/* The child actually performs the I/O and exits with
-	 * a return code, do not return! */
+	fdlimit = sysconf(_SC_OPEN_MAX);
+	for (fd = 3; fd < fdlimit; fd++) {
+		if ((fd != keep_fd1) && (fd != keep_fd2))
+			close(fd);
+	}
+}
+
+/* Open the file and write one block as the user. If sock is valid, report
+ * success over it and stay on as the file's receiver. The child exits
+ * with a return code, does not return! */
+static void _file_bcast_child(file_bcast_msg_t *req, uid_t req_uid,
+			      gid_t req_gid, int sock)
+{
+	int fd, flags, rc;
+
 	if (_init_groups(req_uid, req_gid) < 0) {
 		error("sbcast: initgroups(%u): %m", req_uid);
 		exit(errno);
@@ -2476,7 +2821,7 @@ _rpc_file_bcast(slurm_msg_t *msg)
 			flags |= O_TRUNC;
 		else
 			flags |= O_EXCL;
-	} else
+	} else if (req->block_offset == FILE_BCAST_APPEND)
 		flags |= O_APPEND;
 
 	fd = open(req->fname, flags, 0700);
@@ -2486,40 +2831,147 @@ _rpc_file_bcast(slurm_msg_t *msg)
 		exit(errno);
 	}
 
-	offset = 0;
-	while (req->block_len - offset) {
-		inx = write(fd, &req->block[offset],
-			    (req->block_len - offset));
-		if (inx == -1) {
-			if ((errno == EINTR) || (errno == EAGAIN))
-				continue;
-			error("sbcast: uid:%u can't write `%s`: %s",
-			      req_uid, req->fname, strerror(errno));
-			close(fd);
-			exit(errno);
-		}
-		offset += inx;
-	}
-	if (req->last_block && fchmod(fd, (req->modes & 0777))) {
-		error("sbcast: uid:%u can't chmod `%s`: %s",
-		      req_uid, req->fname, strerror(errno));
+	rc = _file_bcast_write(fd, req->block, req->block_len,
+			       req->block_offset, req->fname, req_uid);
+	if (rc) {
+		close(fd);
+		exit(rc);
 	}
-	if (req->last_block && fchown(fd, req->uid, req->gid)) {
-		error("sbcast: uid:%u can't chown `%s`: %s",
-		      req_uid, req->fname, strerror(errno));
+	if (req->last_block)
+		_file_bcast_finish(fd, req, req_uid);
+	else if (sock >= 0) {
+		safe_write(sock, &rc, sizeof(int));
+		/* Later messages go to stderr */
+		log_fini();
+		_close_fds_except(fd, sock);
+		_file_bcast_receiver(req, req_uid, fd, sock);
 	}
+rwfail:
 	close(fd);
-	fd = 0;
-	if (req->last_block && req->atime) {
-		struct utimbuf time_buf;
-		time_buf.actime  = req->atime;
-		time_buf.modtime = req->mtime;
-		if (utime(req->fname, &time_buf)) {
-			error("sbcast: uid:%u can't utime `%s`: %s",
-			      req_uid, req->fname, strerror(errno));
+	exit(SLURM_SUCCESS);
+}
+
+/* Fork a child to write one block as the user. With start_receiver the
+ * child stays on to write the file's later blocks. */
+static int _file_bcast_fork(file_bcast_msg_t *req, uid_t req_uid,
+			    gid_t req_gid, uint32_t job_id, bool start_receiver)
+{
+	int sock[2] = { -1, -1 };
+	int rc;
+	pid_t child;
+
+	if (start_receiver && socketpair(AF_UNIX, SOCK_STREAM, 0, sock)) {
+		error("sbcast: socketpair: %m");
+		start_receiver = false;
+	}
+
+	child = fork();
+	if (child == -1) {
+		rc = errno;
+		error("sbcast: fork failure");
+		if (start_receiver) {
+			close(sock[0]);
+			close(sock[1]);
 		}
+		return rc;
+	} else if (child == 0) {
+		if (start_receiver)
+			close(sock[0]);
+		_file_bcast_child(req, req_uid, req_gid, sock[1]);
 	}
-	exit(SLURM_SUCCESS);
+
+	if (!start_receiver) {
+		waitpid(child, &rc, 0);
+		return WEXITSTATUS(rc);
+	}
+
+	close(sock[1]);
+	fd_set_close_on_exec(sock[0]);
+	safe_read(sock[0], &rc, sizeof(int));
+	_bcast_file_add(job_id, req_uid, req->fname, child, sock[0]);
+	return rc;
+
+rwfail:
+	/* The child failed before starting to receive */
+	close(sock[0]);
+	waitpid(child, &rc, 0);
+	rc = WEXITSTATUS(rc);
+	return (rc ? rc : SLURM_ERROR);
+}
+
+/* Pass one block to a file's receiver and return its result */
+static int _file_bcast_send(bcast_file_t *bcast_file, file_bcast_msg_t *req)
+{
+	bcast_block_t block_hdr;
+	int rc;
+
+	block_hdr.offset     = req->block_offset;
+	block_hdr.len        = req->block_len;
+	block_hdr.last_block = req->last_block;
+
+	slurm_mutex_lock(&bcast_file->mutex);
+	safe_write(bcast_file->sock, &block_hdr, sizeof(bcast_block_t));
+	safe_write(bcast_file->sock, req->block, req->block_len);
+	safe_read(bcast_file->sock, &rc, sizeof(int));
+	slurm_mutex_unlock(&bcast_file->mutex);
+	return rc;
+
+rwfail:
+	slurm_mutex_unlock(&bcast_file->mutex);
+	error("sbcast: receiver for `%s` failed", req->fname);
+	return SLURM_ERROR;
+}
+
+static int
+_rpc_file_bcast(slurm_msg_t *msg)
+{
+	file_bcast_msg_t *req = msg->data;
+	bcast_file_t *bcast_file;
+	int rc;
+	uint32_t job_id;
+	uid_t req_uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
+	gid_t req_gid = g_slurm_auth_get_gid(msg->auth_cred, NULL);
+
+#if 0
+	info("last_block=%u force=%u modes=%o",
+	     req->last_block, req->force, req->modes);
+	info("uid=%u gid=%u atime=%lu mtime=%lu block_len[0]=%u",
+	     req->uid, req->gid, req->atime, req->mtime, req->block_len);
+#if 0
+	/* when the file being transferred is binary, the following line
+	 * can break the terminal output for slurmd */
+	info("req->block[0]=%s, @ %lu", \
+	     req->block[0], (unsigned long) &req->block);
+#endif
+#endif
+
+	if ((rc = _valid_sbcast_cred(req, req_uid, req->block_no, &job_id)) !=
+	    SLURM_SUCCESS)
+		return rc;
+
+	info("sbcast req_uid=%u fname=%s block_no=%u",
+	     req_uid, req->fname, req->block_no);
+
+	/* Older sbcast sends blocks in order to be appended */
+	if (req->block_offset == FILE_BCAST_APPEND)
+		return _file_bcast_fork(req, req_uid, req_gid, job_id, false);
+
+	if (req->block_no == 1) {
+		/* Stop any receiver left from an earlier transfer */
+		if ((bcast_file = _bcast_file_get(job_id, req_uid,
+						  req->fname)))
+			_bcast_file_put(bcast_file, true);
+		return _file_bcast_fork(req, req_uid, req_gid, job_id,
+					!req->last_block);
+	}
+
+	if (!(bcast_file = _bcast_file_get(job_id, req_uid, req->fname))) {
+		/* No receiver, as after slurmd restarts */
+		return _file_bcast_fork(req, req_uid, req_gid, job_id, false);
+	}
+	rc = _file_bcast_send(bcast_file, req);
+	_bcast_file_put(bcast_file, (rc || req->last_block));
+	return rc;
 }
 
 static void
@@ -2603,7 +3055,23 @@ _rpc_reattach_tasks(slurm_msg_t *msg)
 	resp->gtids = NULL;
 	resp->local_pids = NULL;
 	/* Following call fills in gtids and local_pids when successful */
-	rc = stepd_attach(fd, &ioaddr, &resp_msg.address, job_cred_sig, resp);
+	rc = stepd_attach(fd, &ioaddr, &resp_msg.address, job_cred_sig,
+			  req->io_frame_len, resp);
+	if (rc == SLURM_PROTOCOL_VERSION_ERROR) {
+		/* slurmstepd predates REQUEST_ATTACH_FRAMED */
+		debug2("reattach to job %u.%u with 1KB stdio frames",
+		       req->job_id, req->job_step_id);
+		close(fd);
+		fd = stepd_connect(conf->spooldir, conf->node_name,
+				   req->job_id, req->job_step_id);
+		if (fd == -1) {
+			rc = ESLURM_INVALID_JOB_ID;
+			xfree(step);
+			goto done;
+		}
+		rc = stepd_attach(fd, &ioaddr, &resp_msg.address,
+				  job_cred_sig, 0, resp);
+	}
 	if (rc != SLURM_SUCCESS) {
 		debug2("stepd_attach call failed");
 		goto done3;
@@ -3289,6 +3757,7 @@ _rpc_terminate_job(slurm_msg_t *msg)
 	}
 
 	slurmd_release_resources(req->job_id);
+	_bcast_file_purge_job(req->job_id);
 
 	/*
 	 *  Initialize a "waiter" thread for this jobid. If another
@@ -1277,6 +1277,10 @@ _slurmd_init(void)
 		stepd_cleanup_sockets(conf->spooldir, conf->node_name);
 	}
 
+	/* From here on track our slurmstepds in memory, rather than
+	 * scanning the spool directory for their sockets */
+	stepd_registry_init(conf->spooldir, conf->node_name);
+
 	if (conf->daemonize) {
 		if (conf->logfile && (conf->logfile[0] == '/')) {
 			char *slash_ptr, *work_dir;
@@ -1399,6 +1403,7 @@ _slurmd_fini(void)
 	gres_plugin_fini();
 	slurm_topo_fini();
 	slurmd_req(NULL);	/* purge memory allocated by slurmd_req() */
+	stepd_registry_fini();
 	fini_setproctitle();
 	slurm_select_fini();
 	slurm_jobacct_gather_fini();
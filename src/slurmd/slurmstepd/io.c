@@ -129,6 +129,9 @@ struct client_io_info {
 
 	/* true if writing to a file, false if writing to a socket */
 	bool is_local_file;
+
+	/* largest output message body this client accepts */
+	uint32_t frame_len;
 };
 
 
@@ -280,11 +283,22 @@ _client_writable(eio_obj_t *obj)
 		ListIterator msgs;
 		struct io_buf *msg;
 		client->msg_queue = list_create(NULL); /* need destructor */
+
+		/* Older clients can not take our larger messages, build
+		 * smaller ones from now on and skip any cached */
+		if (client->frame_len < client->job->io_frame_len) {
+			debug("Reducing output messages to %u bytes",
+			      client->frame_len);
+			client->job->io_frame_len = client->frame_len;
+		}
 		msgs = list_iterator_create(client->job->outgoing_cache);
 		if (!msgs)
 			fatal("Could not allocate iterator");
 
 		while ((msg = list_next(msgs))) {
+			if (msg->length >
+			    (client->frame_len + io_hdr_packed_size()))
+				continue;
 			msg->ref_count++;
 			list_enqueue(client->msg_queue, msg);
 		}
@@ -725,7 +739,7 @@ _create_task_out_eio(int fd, uint16_t type,
 	out->gtaskid = task->gtid;
 	out->ltaskid = task->id;
 	out->job = job;
-	out->buf = cbuf_create(MAX_MSG_LEN, MAX_MSG_LEN*4);
+	out->buf = cbuf_create(MAX_MSG_LEN, job->io_frame_len * 4);
 	out->eof = false;
 	out->eof_msg_sent = false;
 	if (cbuf_opt_set(out->buf, CBUF_OPT_OVERWRITE, CBUF_NO_DROP) == -1)
@@ -1156,6 +1170,27 @@ io_thread_start(slurmd_job_t *job)
 }
 
 
+/*
+ * Output message buffers hold up to job->io_frame_len bytes. With the
+ * default small frames keep the fixed limit, with large ones allow a
+ * few per task so memory use grows with the number of local tasks.
+ */
+static int
+_outgoing_buf_max(slurmd_job_t *job)
+{
+	if (job->io_frame_len <= MAX_MSG_LEN)
+		return STDIO_MAX_FREE_BUF;
+	return MIN(STDIO_MAX_FREE_BUF,
+		   STDIO_MIN_FREE_BUF + STDIO_FREE_BUF_PER_TASK * job->node_tasks);
+}
+
+/* The message cache uses up free buffers, keep it to half of them */
+static int
+_msg_cache_max(slurmd_job_t *job)
+{
+	return MIN(STDIO_MAX_MSG_CACHE, _outgoing_buf_max(job) / 2);
+}
+
 void
 _shrink_msg_cache(List cache, slurmd_job_t *job)
 {
@@ -1165,8 +1200,8 @@ _shrink_msg_cache(List cache, slurmd_job_t *job)
 	int i;
 
 	count = list_count(cache);
-	if (count > STDIO_MAX_MSG_CACHE)
-		over = count - STDIO_MAX_MSG_CACHE;
+	if (count > _msg_cache_max(job))
+		over = count - _msg_cache_max(job);
 
 	for (i = 0; i < over; i++) {
 		msg = list_dequeue(cache);
@@ -1488,6 +1523,7 @@ io_create_local_client(const char *filename, int file_flags,
 	client->ltaskid_stderr = stderr_tasks;
 	client->labelio = labelio;
 	client->is_local_file = true;
+	client->frame_len = MAX_FRAME_LEN;
 
 	client->label_width = 1;
 	tmp = job->node_tasks-1;
@@ -1563,6 +1599,7 @@ io_initial_client_connect(srun_info_t *srun, slurmd_job_t *job,
 	client->labelio = false;
 	client->label_width = 0;
 	client->is_local_file = false;
+	client->frame_len = srun->io_frame_len;
 
 	obj = eio_obj_create(sock, &client_ops, (void *)client);
 	list_append(job->clients, (void *)obj);
@@ -1623,6 +1660,7 @@ io_client_connect(srun_info_t *srun, slurmd_job_t *job)
 	client->labelio = false;
 	client->label_width = 0;
 	client->is_local_file = false;
+	client->frame_len = srun->io_frame_len;
 
 	/* client object adds itself to job->clients in _client_writable */
 
@@ -1711,7 +1749,7 @@ _send_eof_msg(struct task_read_info *out)
 		   a poll returns POLLHUP on the incoming task pipe,
 		   put there are no outgoing message buffers available,
 		   the slurmstepd will start spinning. */
-		msg = alloc_io_buf();
+		msg = alloc_io_buf(out->job->io_frame_len);
 	}
 
 	header.type = out->type;
@@ -1778,10 +1816,10 @@ _task_build_message(struct task_read_info *out, slurmd_job_t *job, cbuf_t cbuf)
 	ptr = msg->data + io_hdr_packed_size();
 
 	if (job->buffered_stdio) {
-		avail = cbuf_peek_line(cbuf, ptr, MAX_MSG_LEN, 1);
-		if (avail >= MAX_MSG_LEN)
+		avail = cbuf_peek_line(cbuf, ptr, job->io_frame_len, 1);
+		if (avail >= job->io_frame_len)
 			must_truncate = true;
-		else if (avail == 0 && cbuf_used(cbuf) >= MAX_MSG_LEN)
+		else if (avail == 0 && cbuf_used(cbuf) >= job->io_frame_len)
 			must_truncate = true;
 	}
 
@@ -1794,9 +1832,9 @@ _task_build_message(struct task_read_info *out, slurmd_job_t *job, cbuf_t cbuf)
 	 * Hence the "|| out->eof".
 	 */
 	if (must_truncate || !job->buffered_stdio || out->eof) {
-		n = cbuf_read(cbuf, ptr, MAX_MSG_LEN);
+		n = cbuf_read(cbuf, ptr, job->io_frame_len);
 	} else {
-		n = cbuf_read_line(cbuf, ptr, MAX_MSG_LEN, -1);
+		n = cbuf_read_line(cbuf, ptr, job->io_frame_len, -1);
 		if (n == 0) {
 			debug5("  partial line in buffer, ignoring");
 			debug4("Leaving  _task_build_message");
@@ -1827,7 +1865,7 @@ _task_build_message(struct task_read_info *out, slurmd_job_t *job, cbuf_t cbuf)
 }
 
 struct io_buf *
-alloc_io_buf(void)
+alloc_io_buf(uint32_t len)
 {
 	struct io_buf *buf;
 
@@ -1838,7 +1876,7 @@ alloc_io_buf(void)
 	buf->length = 0;
 	/* The following "+ 1" is just temporary so I can stick a \0 at
 	   the end and do a printf of the data pointer */
-	buf->data = xmalloc(MAX_MSG_LEN + io_hdr_packed_size() + 1);
+	buf->data = xmalloc(len + io_hdr_packed_size() + 1);
 	if (!buf->data) {
 		xfree(buf);
 		return NULL;
@@ -1866,7 +1904,7 @@ _incoming_buf_free(slurmd_job_t *job)
 	if (list_count(job->free_incoming) > 0) {
 		return true;
 	} else if (job->incoming_count < STDIO_MAX_FREE_BUF) {
-		buf = alloc_io_buf();
+		buf = alloc_io_buf(MAX_MSG_LEN);
 		if (buf != NULL) {
 			list_enqueue(job->free_incoming, buf);
 			job->incoming_count++;
@@ -1884,8 +1922,8 @@ _outgoing_buf_free(slurmd_job_t *job)
 
 	if (list_count(job->free_outgoing) > 0) {
 		return true;
-	} else if (job->outgoing_count < STDIO_MAX_FREE_BUF) {
-		buf = alloc_io_buf();
+	} else if (job->outgoing_count < _outgoing_buf_max(job)) {
+		buf = alloc_io_buf(job->io_frame_len);
 		if (buf != NULL) {
 			list_enqueue(job->free_outgoing, buf);
 			job->outgoing_count++;
@@ -51,6 +51,14 @@
 #define STDIO_MAX_FREE_BUF 1024
 #define STDIO_MAX_MSG_CACHE 128
 
+/*
+ * Outgoing buffer limit when messages are larger than MAX_MSG_LEN:
+ * STDIO_MIN_FREE_BUF plus STDIO_FREE_BUF_PER_TASK for each local task,
+ * at most STDIO_MAX_FREE_BUF.
+ */
+#define STDIO_MIN_FREE_BUF 32
+#define STDIO_FREE_BUF_PER_TASK 4
+
 struct io_buf {
 	int ref_count;
 	uint32_t length;
@@ -74,7 +82,7 @@ typedef enum {
 } slurmd_filename_pattern_t;
 
 
-struct io_buf *alloc_io_buf(void);
+struct io_buf *alloc_io_buf(uint32_t len);
 void free_io_buf(struct io_buf *buf);
 
 /* 
@@ -76,7 +76,8 @@ static int _handle_signal_process_group(int fd, slurmd_job_t *job, uid_t uid);
 static int _handle_signal_task_local(int fd, slurmd_job_t *job, uid_t uid);
 static int _handle_signal_container(int fd, slurmd_job_t *job, uid_t uid);
 static int _handle_checkpoint_tasks(int fd, slurmd_job_t *job, uid_t uid);
-static int _handle_attach(int fd, slurmd_job_t *job, uid_t uid);
+static int _handle_attach(int fd, slurmd_job_t *job, uid_t uid,
+			  bool framed);
 static int _handle_pid_in_container(int fd, slurmd_job_t *job);
 static int _handle_daemon_pid(int fd, slurmd_job_t *job);
 static int _handle_notify_job(int fd, slurmd_job_t *job, uid_t uid);
@@ -493,7 +494,11 @@ _handle_request(int fd, slurmd_job_t *job, uid_t uid, gid_t gid)
 		break;
 	case REQUEST_ATTACH:
 		debug("Handling REQUEST_ATTACH");
-		rc = _handle_attach(fd, job, uid);
+		rc = _handle_attach(fd, job, uid, false);
+		break;
+	case REQUEST_ATTACH_FRAMED:
+		debug("Handling REQUEST_ATTACH_FRAMED");
+		rc = _handle_attach(fd, job, uid, true);
 		break;
 	case REQUEST_PID_IN_CONTAINER:
 		debug("Handling REQUEST_PID_IN_CONTAINER");
@@ -1032,7 +1037,7 @@ rwfail:
 }
 
 static int
-_handle_attach(int fd, slurmd_job_t *job, uid_t uid)
+_handle_attach(int fd, slurmd_job_t *job, uid_t uid, bool framed)
 {
 	srun_info_t *srun;
 	int rc = SLURM_SUCCESS;
@@ -1047,6 +1052,9 @@ _handle_attach(int fd, slurmd_job_t *job, uid_t uid)
 	safe_read(fd, &srun->ioaddr, sizeof(slurm_addr_t));
 	safe_read(fd, &srun->resp_addr, sizeof(slurm_addr_t));
 	safe_read(fd, srun->key, SLURM_IO_KEY_SIZE);
+	if (framed)	/* else 1KB frames, see io_frame_len() */
+		safe_read(fd, &srun->io_frame_len, sizeof(uint32_t));
+	srun->io_frame_len = io_frame_len(srun->io_frame_len);
 
 	/*
 	 * Check if jobstep is actually running.
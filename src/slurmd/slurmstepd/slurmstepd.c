@@ -47,6 +47,7 @@
 #include <stdlib.h>
 #include <signal.h>
 
+#include "src/common/fd.h"
 #include "src/common/gres.h"
 #include "src/common/slurm_jobacct_gather.h"
 #include "src/common/slurm_rlimits_info.h"
@@ -95,6 +96,7 @@ main (int argc, char *argv[])
 	int ngids;
 	gid_t *gids;
 	int rc = 0;
+	int alive_fd;
 
 	if ((argc == 2) && (strcmp(argv[1], "getenv") == 0)) {
 		print_rlimits();
@@ -142,6 +144,12 @@ main (int argc, char *argv[])
 
 	_send_ok_to_slurmd(STDOUT_FILENO);
 
+	/* Keep a copy of the pipe to the slurmd open until we exit, the
+	 * slurmd's step registry watches it for our exit. Tasks must not
+	 * inherit it. */
+	if ((alive_fd = dup(STDOUT_FILENO)) >= 0)
+		fd_set_close_on_exec(alive_fd);
+
 	/* Fancy way of closing stdout that keeps STDOUT_FILENO from being
 	 * allocated to any random file.  The slurmd already opened /dev/null
 	 * on STDERR_FILENO for us. */
@@ -267,6 +267,8 @@ job_create(launch_tasks_request_msg_t *msg)
 
 	job->buffered_stdio = msg->buffered_stdio;
 	job->labelio = msg->labelio;
+	job->io_frame_len = io_frame_len(msg->io_frame_len);
+	srun->io_frame_len = job->io_frame_len;
 
 	job->task_prolog = xstrdup(msg->task_prolog);
 	job->task_epilog = xstrdup(msg->task_epilog);
@@ -423,6 +425,9 @@ job_batch_job_create(batch_job_launch_msg_t *msg)
 
 	list_append(job->sruns, (void *) srun);
 
+	/* Batch output only goes to local files */
+	job->io_frame_len = MAX_FRAME_LEN;
+
 	if (msg->argc) {
 		job->argc    = msg->argc;
 		job->argv    = _array_copy(job->argc, msg->argv);
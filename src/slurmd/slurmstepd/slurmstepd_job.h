@@ -72,6 +72,7 @@ typedef struct srun_info {
 	slurm_addr_t ioaddr;       /* Address to connect on for normal I/O.
 				      Spawn IO uses messages to the normal
 				      resp_addr. */
+	uint32_t io_frame_len;	   /* largest output message body accepted */
 } srun_info_t;
 
 typedef enum task_state {
@@ -178,6 +179,8 @@ typedef struct slurmd_job {
 				 * 0 for no buffering
 				 */
 	uint8_t labelio;	/* 1 for labelling output with the task id */
+	uint32_t io_frame_len;	/* largest output message body to build,
+				 * lowered if a client needs smaller */
 
 	pthread_t      ioid;  /* pthread id of IO thread                    */
 	pthread_t      msgid; /* pthread id of message thread               */
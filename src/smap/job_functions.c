@@ -65,11 +65,11 @@ extern void get_job(void)
 	if (job_info_ptr) {
 		if (show_flags != last_flags)
 			job_info_ptr->last_update = 0;
-		error_code = slurm_load_jobs(job_info_ptr->last_update,
-					     &new_job_ptr, show_flags);
-		if (error_code == SLURM_SUCCESS)
-			slurm_free_job_info_msg(job_info_ptr);
-		else if (slurm_get_errno() == SLURM_NO_CHANGE_IN_DATA) {
+		/* job_info_ptr is consumed on success, kept on error */
+		error_code = slurm_load_jobs_delta(job_info_ptr,
+						   &new_job_ptr, show_flags);
+		if ((error_code != SLURM_SUCCESS) &&
+		    (slurm_get_errno() == SLURM_NO_CHANGE_IN_DATA)) {
 			error_code = SLURM_SUCCESS;
 			new_job_ptr = job_info_ptr;
 		}
@@ -61,6 +61,7 @@ int max_line_size;
 /************
  * Funtions *
  ************/
+static job_info_filter_t *_build_job_filter(void);
 static int  _get_info(bool clear_old);
 static int  _get_window_width( void );
 static void _print_date( void );
@@ -165,11 +166,105 @@ _get_window_width( void )
 }
 
 
+/* Copy a List of strings into a comma separated list */
+static char *_list_to_str(List str_list)
+{
+	ListIterator iterator;
+	char *str, *out = NULL;
+
+	iterator = list_iterator_create(str_list);
+	while ((str = list_next(iterator))) {
+		if (out)
+			xstrcat(out, ",");
+		xstrcat(out, str);
+	}
+	list_iterator_destroy(iterator);
+
+	return out;
+}
+
+/* Copy a List of uint32_t into an array, RET element count */
+static uint32_t _list_to_array(List id_list, uint32_t **id_array)
+{
+	ListIterator iterator;
+	uint32_t *id, cnt = 0;
+
+	*id_array = xmalloc(sizeof(uint32_t) * list_count(id_list));
+	iterator = list_iterator_create(id_list);
+	while ((id = list_next(iterator)))
+		(*id_array)[cnt++] = *id;
+	list_iterator_destroy(iterator);
+
+	return cnt;
+}
+
+/*
+ * _build_job_filter - Build a job filter for slurmctld from the user's
+ *	job, user, partition, account and state options so that it only
+ *	returns jobs which may be printed. Jobs are still filtered locally
+ *	by _filter_job(), which supports more options and applies the
+ *	default job states. Without any of these options no filter is used,
+ *	so that slurmctld can reply with the job information it has cached
+ *	for all clients.
+ * RET job filter or NULL, free using slurm_free_job_info_filter()
+ */
+static job_info_filter_t *_build_job_filter(void)
+{
+	job_info_filter_t *filter;
+	ListIterator iterator;
+	uint16_t *state_id;
+
+	if (!(params.account_list && list_count(params.account_list)) &&
+	    !(params.part_list && list_count(params.part_list)) &&
+	    !(params.job_list && list_count(params.job_list)) &&
+	    !(params.user_list && list_count(params.user_list)) &&
+	    !params.state_list)
+		return NULL;
+
+	filter = xmalloc(sizeof(job_info_filter_t));
+	if (params.account_list && list_count(params.account_list))
+		filter->accounts = _list_to_str(params.account_list);
+	if (params.part_list && list_count(params.part_list))
+		filter->partitions = _list_to_str(params.part_list);
+	if (params.job_list && list_count(params.job_list)) {
+		filter->job_id_cnt = _list_to_array(params.job_list,
+						    &filter->job_ids);
+	}
+	if (params.user_list && list_count(params.user_list)) {
+		filter->user_id_cnt = _list_to_array(params.user_list,
+						     &filter->user_ids);
+	}
+
+	if (params.state_list) {
+		iterator = list_iterator_create(params.state_list);
+		while ((state_id = list_next(iterator))) {
+			if (*state_id == JOB_COMPLETING)
+				filter->state_mask |= JOB_FILTER_COMPLETING;
+			else if (*state_id == JOB_CONFIGURING)
+				filter->state_mask |= JOB_FILTER_CONFIGURING;
+			else if (*state_id < JOB_END) {
+				filter->state_mask |=
+					JOB_FILTER_STATE(*state_id);
+			}
+		}
+		list_iterator_destroy(iterator);
+	} else {
+		filter->state_mask = JOB_FILTER_STATE(JOB_PENDING)   |
+				     JOB_FILTER_STATE(JOB_RUNNING)   |
+				     JOB_FILTER_STATE(JOB_SUSPENDED) |
+				     JOB_FILTER_COMPLETING;
+	}
+
+	return filter;
+}
+
 /* _print_job - print the specified job's information */
 static int
 _print_job ( bool clear_old )
 {
 	static job_info_msg_t * old_job_ptr = NULL, * new_job_ptr;
+	static job_info_filter_t *job_filter = NULL;
+	static bool job_filter_built = false;
 	int error_code;
 	uint16_t show_flags = 0;
 	uint32_t job_id = 0;
@@ -190,6 +285,11 @@ _print_job ( bool clear_old )
 		list_iterator_destroy(iterator);
 	}
 
+	if (!job_filter_built) {
+		job_filter = _build_job_filter();
+		job_filter_built = true;
+	}
+
 	if (old_job_ptr) {
 		if (clear_old)
 			old_job_ptr->last_update = 0;
@@ -198,9 +298,9 @@ _print_job ( bool clear_old )
 				&new_job_ptr, job_id,
 				show_flags);
 		} else {
-			error_code = slurm_load_jobs(
+			error_code = slurm_load_jobs_filter(
 				old_job_ptr->last_update,
-				&new_job_ptr, show_flags);
+				&new_job_ptr, show_flags, job_filter);
 		}
 		if (error_code ==  SLURM_SUCCESS)
 			slurm_free_job_info_msg( old_job_ptr );
@@ -211,8 +311,9 @@ _print_job ( bool clear_old )
 	} else if (job_id) {
 		error_code = slurm_load_job(&new_job_ptr, job_id, show_flags);
 	} else {
-		error_code = slurm_load_jobs((time_t) NULL, &new_job_ptr,
-					     show_flags);
+		error_code = slurm_load_jobs_filter((time_t) NULL,
+						    &new_job_ptr, show_flags,
+						    job_filter);
 	}
 
 	if (error_code) {
@@ -1,4 +1,7 @@
-/* Test of src/bitstring.c 
+/* Test of src/bitstring.c, plus a microbenchmark of the word kernels
+ * against the bit at a time code they replaced.
+ *
+ * Usage: bitstring-test [max_bits]
  */
 #include <stdlib.h>
 #include <src/common/bitstring.h>
@@ -14,10 +17,191 @@
 		pass( _msg );		\
 } while (0)
 
+/* Default largest bitmap timed, 500k cores */
+#define BENCH_BITS	500000
+
+/* Reference versions, one bit or one word at a time as bitstring.c did */
+static bitoff_t _ref_ffs(bitstr_t *b)
+{
+	bitoff_t bit;
+
+	for (bit = 0; bit < bit_size(b); bit++) {
+		if (bit_test(b, bit))
+			return bit;
+	}
+	return -1;
+}
+
+static bitoff_t _ref_ffc(bitstr_t *b)
+{
+	bitoff_t bit;
+
+	for (bit = 0; bit < bit_size(b); bit++) {
+		if (!bit_test(b, bit))
+			return bit;
+	}
+	return -1;
+}
+
+static bitoff_t _ref_fls(bitstr_t *b)
+{
+	bitoff_t bit;
+
+	for (bit = bit_size(b) - 1; bit >= 0; bit--) {
+		if (bit_test(b, bit))
+			return bit;
+	}
+	return -1;
+}
+
+static bitoff_t _ref_nff(bitstr_t *b, int n, int set)
+{
+	bitoff_t bit;
+	int cnt = 0;
+
+	for (bit = 0; bit < bit_size(b); bit++) {
+		if (bit_test(b, bit) != set) {
+			cnt = 0;
+		} else if (++cnt >= n) {
+			return bit - (cnt - 1);
+		}
+	}
+	return -1;
+}
+
+static int _ref_count(bitstr_t *b1, bitstr_t *b2, int and_not)
+{
+	bitoff_t bit;
+	int count = 0;
+
+	for (bit = 0; bit < bit_size(b1); bit++) {
+		if (!bit_test(b1, bit))
+			continue;
+		if (b2 && (bit_test(b2, bit) == and_not))
+			continue;
+		count++;
+	}
+	return count;
+}
+
+static int _ref_super_set(bitstr_t *b1, bitstr_t *b2)
+{
+	bitoff_t bit;
+
+	for (bit = 0; bit < bit_size(b1); bit++) {
+		if (bit_test(b1, bit) && !bit_test(b2, bit))
+			return 0;
+	}
+	return 1;
+}
+
+/* hweight() from bitstring.c before hardware population counts */
+static int _ref_hweight(uint32_t w)
+{
+	w = (w & 0x55555555) + ((w >> 1)  & 0x55555555);
+	w = (w & 0x33333333) + ((w >> 2)  & 0x33333333);
+	w = (w & 0x0F0F0F0F) + ((w >> 4)  & 0x0F0F0F0F);
+	w = (w & 0x00FF00FF) + ((w >> 8)  & 0x00FF00FF);
+	w = (w & 0x0000FFFF) + ((w >> 16) & 0x0000FFFF);
+	return w;
+}
+
+/* bit_overlap() as it was, whole words then a bit at a time */
+static int _old_overlap(bitstr_t *b1, bitstr_t *b2)
+{
+	int count = 0, word_size = sizeof(bitstr_t) * 8;
+	bitoff_t bit, bit_cnt = bit_size(b1);
+
+	for (bit = 0; bit + word_size - 1 < bit_cnt; bit += word_size) {
+		count += _ref_hweight((uint32_t) (b1[_bit_word(bit)] &
+						   b2[_bit_word(bit)]));
+	}
+	for ( ; bit < bit_cnt; bit++) {
+		if (bit_test(b1, bit) && bit_test(b2, bit))
+			count++;
+	}
+	return count;
+}
+
+/* Set bits at random with probability 1/density, density 0 sets none */
+static bitstr_t *_random_bitmap(bitoff_t nbits, int density)
+{
+	bitstr_t *b = bit_alloc(nbits);
+	bitoff_t bit;
+
+	for (bit = 0; density && (bit < nbits); bit++) {
+		if ((random() % density) == 0)
+			bit_set(b, bit);
+	}
+	return b;
+}
+
+static double _elapsed(struct timeval *start)
+{
+	struct timeval end;
+
+	gettimeofday(&end, NULL);
+	return (end.tv_sec - start->tv_sec) +
+	       (end.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+/* Time the free core computation of cons_res, cores in avail but in no
+ * row, using complement and and, then the fused bit_and_not() */
+static void _time_free_cores(bitoff_t nbits)
+{
+	bitstr_t *avail = _random_bitmap(nbits, 2);
+	bitstr_t *row = _random_bitmap(nbits, 3);
+	bitstr_t *tmp = bit_alloc(nbits), *free_cores = bit_alloc(nbits);
+	struct timeval start;
+	double old_secs, new_secs, ovl_old, ovl_new;
+	int i, reps = 20000000 / nbits + 1, cnt1 = 0, cnt2 = 0;
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < reps; i++) {
+		bit_copybits(free_cores, avail);
+		bit_copybits(tmp, row);
+		bit_not(tmp);
+		bit_and(free_cores, tmp);
+		cnt1 += bit_set_count(free_cores);
+	}
+	old_secs = _elapsed(&start);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < reps; i++)
+		cnt2 += bit_and_not_count(avail, row);
+	new_secs = _elapsed(&start);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < reps; i++)
+		cnt1 += _old_overlap(avail, row);
+	ovl_old = _elapsed(&start);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < reps; i++)
+		cnt2 += bit_overlap(avail, row);
+	ovl_new = _elapsed(&start);
+
+	TEST(cnt1 == cnt2, "benchmark counts agree");
+	note("bits %7d: free cores copy+not+and %8.2f  bit_and_not_count "
+	     "%8.2f  overlap old %8.2f  new %8.2f (usec per call)",
+	     (int) nbits, old_secs * 1000000 / reps,
+	     new_secs * 1000000 / reps, ovl_old * 1000000 / reps,
+	     ovl_new * 1000000 / reps);
+
+	bit_free(avail);
+	bit_free(row);
+	bit_free(tmp);
+	bit_free(free_cores);
+}
 
 int
 main(int argc, char *argv[])
 {
+	int max_bits = BENCH_BITS;
+
+	if (argc > 1)
+		max_bits = atoi(argv[1]);
+
 	note("Testing static decl");
 	{
 		bitstr_t bit_decl(bs, 65);
@@ -196,6 +380,69 @@ main(int argc, char *argv[])
 		TEST(bit_equal(bs, bs2), "bitstring");
 	}
 
+	note("Testing word kernels against bit at a time references");
+	{
+		static const int sizes[] = { 1, 2, 31, 32, 33, 63, 64, 65,
+					     100, 127, 128, 129, 1000, 1025 };
+		static const int densities[] = { 0, 1, 2, 7, 61 };
+		bitstr_t *b1, *b2, *b3;
+		int s, d, n, ok_find = 1, ok_count = 1, ok_nff = 1;
+		int ok_logic = 1, inv;
+
+		srandom(1);
+		for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+		for (d = 0; d < sizeof(densities) / sizeof(densities[0]); d++)
+		for (inv = 0; inv < 2; inv++) {
+			b1 = _random_bitmap(sizes[s], densities[d]);
+			b2 = _random_bitmap(sizes[s], 3);
+			/* bit_not() also sets the bits past the end */
+			if (inv)
+				bit_not(b1);
+
+			if ((bit_ffs(b1) != _ref_ffs(b1)) ||
+			    (bit_ffc(b1) != _ref_ffc(b1)) ||
+			    (bit_fls(b1) != _ref_fls(b1)))
+				ok_find = 0;
+			if ((bit_set_count(b1) != _ref_count(b1, NULL, 0)) ||
+			    (bit_overlap(b1, b2) != _ref_count(b1, b2, 0)) ||
+			    (bit_and_not_count(b1, b2) !=
+			     _ref_count(b1, b2, 1)))
+				ok_count = 0;
+			for (n = 1; n < sizes[s]; n = (n * 2) + 1) {
+				if ((bit_nffs(b1, n) != _ref_nff(b1, n, 1)) ||
+				    (bit_nffc(b1, n) != _ref_nff(b1, n, 0)))
+					ok_nff = 0;
+			}
+
+			b3 = bit_copy(b1);
+			bit_and_not(b3, b2);
+			if ((bit_set_count(b3) != _ref_count(b1, b2, 1)) ||
+			    bit_overlap(b3, b2) ||
+			    !bit_super_set(b3, b1) ||
+			    (bit_super_set(b1, b2) !=
+			     _ref_super_set(b1, b2)))
+				ok_logic = 0;
+			bit_or(b3, b2);
+			bit_and(b3, b1);
+			if (!bit_equal(b3, b1))
+				ok_logic = 0;
+
+			bit_free(b1);
+			bit_free(b2);
+			bit_free(b3);
+		}
+		TEST(ok_find, "bit_ffs bit_ffc bit_fls");
+		TEST(ok_count, "bit_set_count bit_overlap bit_and_not_count");
+		TEST(ok_nff, "bit_nffs bit_nffc");
+		TEST(ok_logic, "bit_and_not bit_and bit_or bit_super_set");
+	}
+
+	note("Counting time by bitmap size");
+	if (max_bits >= 10000)
+		_time_free_cores(10000);	/* 10k nodes */
+	if (max_bits > 10000)
+		_time_free_cores(max_bits);
+
 	totals();
 	return failed;
 }
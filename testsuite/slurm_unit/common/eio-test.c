@@ -0,0 +1,251 @@
+/* Test of src/common/eio.c with both its epoll and poll backends, plus a
+ * microbenchmark of one event among many idle objects.
+ *
+ * Usage: eio-test [max_objects]
+ */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <src/common/eio.h>
+#include <src/common/fd.h>
+#include <src/common/xmalloc.h>
+
+#include <testsuite/dejagnu.h>
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+/* Default largest object count timed */
+#define BENCH_OBJS	4096
+
+static eio_handle_t *handle;
+static int *ring_fds;		/* write ends of the ring's pipes */
+static int ring_size, ring_hops;
+static int file_writes, late_reads;
+
+static bool _readable(eio_obj_t *obj)
+{
+	if (obj->shutdown) {
+		if (obj->fd != -1) {
+			close(obj->fd);
+			obj->fd = -1;
+		}
+		return false;
+	}
+	return (obj->fd != -1);
+}
+
+/* Pass the token to an object far along the ring */
+static int _ring_read(eio_obj_t *obj, List objs)
+{
+	long i = (long) obj->arg;
+	char c;
+
+	if (read(obj->fd, &c, 1) != 1)
+		return 0;
+	if (--ring_hops <= 0) {
+		eio_signal_shutdown(handle);
+		return 0;
+	}
+	if (write(ring_fds[(i * 7919 + 1) % ring_size], &c, 1) != 1)
+		return -1;
+	return 0;
+}
+
+static struct io_operations ring_ops = {
+	readable:	&_readable,
+	handle_read:	&_ring_read,
+};
+
+/* Run ring_hops events through nobjs pipes, return seconds per event */
+static double _ring(int nobjs, int hops)
+{
+	struct timeval start, end;
+	int fds[2];
+	long i;
+
+	handle = eio_handle_create();
+	ring_fds = xmalloc(nobjs * sizeof(int));
+	ring_size = nobjs;
+	ring_hops = hops;
+	for (i = 0; i < nobjs; i++) {
+		if (pipe(fds) < 0)
+			return -1.0;
+		fd_set_nonblocking(fds[0]);
+		ring_fds[i] = fds[1];
+		eio_new_initial_obj(handle,
+				    eio_obj_create(fds[0], &ring_ops,
+						   (void *) i));
+	}
+	if (write(ring_fds[0], "x", 1) != 1)
+		return -1.0;
+
+	gettimeofday(&start, NULL);
+	if (eio_handle_mainloop(handle) < 0)
+		ring_hops = -1;
+	gettimeofday(&end, NULL);
+
+	for (i = 0; i < nobjs; i++)
+		close(ring_fds[i]);
+	xfree(ring_fds);
+	eio_handle_destroy(handle);
+	return ((end.tv_sec - start.tv_sec) +
+		(end.tv_usec - start.tv_usec) / 1000000.0) / hops;
+}
+
+static bool _file_writable(eio_obj_t *obj)
+{
+	return (obj->fd != -1);
+}
+
+static int _file_write(eio_obj_t *obj, List objs)
+{
+	if ((write(obj->fd, "x", 1) != 1) || (++file_writes == 3)) {
+		close(obj->fd);
+		obj->fd = -1;
+	}
+	return 0;
+}
+
+static struct io_operations file_ops = {
+	writable:	&_file_writable,
+	handle_write:	&_file_write,
+};
+
+static int _late_read(eio_obj_t *obj, List objs)
+{
+	char c;
+
+	if (read(obj->fd, &c, 1) == 1)
+		late_reads++;
+	close(obj->fd);
+	obj->fd = -1;
+	return 0;
+}
+
+static struct io_operations late_ops = {
+	readable:	&_readable,
+	handle_read:	&_late_read,
+};
+
+/* Close the fd on the first read, then make the pipe readable again
+ * while a child still holds it open */
+static int _stale_read(eio_obj_t *obj, List objs)
+{
+	int *fds = (int *) obj->arg;
+	char c;
+
+	if (read(obj->fd, &c, 1) != 1)
+		return 0;
+	close(obj->fd);
+	obj->fd = -1;
+	if (write(fds[1], "y", 1) != 1)
+		return -1;
+	if (write(fds[3], "z", 1) != 1)
+		return -1;
+	return 0;
+}
+
+static struct io_operations stale_ops = {
+	readable:	&_readable,
+	handle_read:	&_stale_read,
+};
+
+static void _test_backend(const char *name)
+{
+	char tmpl[] = "/tmp/eio-test.XXXXXX";
+	int fds[4], rc;
+	pid_t pid;
+
+	note("Testing %s backend", name);
+
+	TEST(_ring(64, 1000) > 0.0, "ring runs");
+	TEST(ring_hops == 0, "every ring event handled");
+
+	/* Regular files can't be polled, they are always ready */
+	handle = eio_handle_create();
+	file_writes = 0;
+	fds[0] = mkstemp(tmpl);
+	unlink(tmpl);
+	eio_new_initial_obj(handle, eio_obj_create(fds[0], &file_ops, NULL));
+	TEST(eio_handle_mainloop(handle) == 0, "mainloop ends");
+	TEST(file_writes == 3, "regular file written");
+	eio_handle_destroy(handle);
+
+	handle = eio_handle_create();
+	late_reads = 0;
+	if ((pipe(&fds[0]) < 0) || (pipe(&fds[2]) < 0)) {
+		fail("pipe");
+		return;
+	}
+	fd_set_nonblocking(fds[0]);
+	fd_set_nonblocking(fds[2]);
+	eio_new_initial_obj(handle, eio_obj_create(fds[0], &stale_ops, fds));
+	eio_new_initial_obj(handle, eio_obj_create(fds[2], &late_ops, NULL));
+	if ((pid = fork()) == 0) {
+		sleep(30);
+		_exit(0);
+	}
+	if (write(fds[1], "x", 1) != 1)
+		fail("write");
+	alarm(10);
+	rc = eio_handle_mainloop(handle);
+	alarm(0);
+	TEST(rc == 0, "closed fd open in child ignored");
+	TEST(late_reads == 1, "other object served after close");
+	kill(pid, SIGKILL);
+	close(fds[1]);
+	close(fds[3]);
+	eio_handle_destroy(handle);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int max_objs = BENCH_OBJS, nobjs;
+	double epoll_usec, poll_usec;
+	struct rlimit rlim;
+
+	if (argc > 1)
+		max_objs = atoi(argv[1]);
+	if (getrlimit(RLIMIT_NOFILE, &rlim) < 0)
+		rlim.rlim_cur = 1024;
+	else if (rlim.rlim_cur < rlim.rlim_max) {
+		rlim.rlim_cur = rlim.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rlim);
+	}
+
+	unsetenv("SLURM_EIO_POLL");
+	_test_backend("default");
+	setenv("SLURM_EIO_POLL", "1", 1);
+	_test_backend("poll");
+
+	note("Microseconds per event by object count");
+	for (nobjs = 64; nobjs <= max_objs; nobjs *= 4) {
+		if ((nobjs * 2 + 16) > rlim.rlim_cur)
+			break;
+		unsetenv("SLURM_EIO_POLL");
+		epoll_usec = _ring(nobjs, 20000) * 1000000.0;
+		setenv("SLURM_EIO_POLL", "1", 1);
+		poll_usec = _ring(nobjs, 20000) * 1000000.0;
+		note("objects %6d: default %8.2f  poll %8.2f",
+		     nobjs, epoll_usec, poll_usec);
+	}
+
+	totals();
+	return failed;
+}
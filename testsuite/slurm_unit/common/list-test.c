@@ -0,0 +1,214 @@
+/* Test of src/common/list.c sorting, plus a microbenchmark of taking a
+ * scheduler's job queue in priority order.
+ *
+ * Usage: list-test [max_queue_depth]
+ */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#if HAVE_INTTYPES_H
+#  include <inttypes.h>
+#else
+#  if HAVE_STDINT_H
+#    include <stdint.h>
+#  endif
+#endif
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <src/common/list.h>
+#include <src/common/xmalloc.h>
+
+#include <testsuite/dejagnu.h>
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+/* Default largest queue depth timed, list_pop_bottom() takes O(n^2) */
+#define BENCH_DEPTH	8192
+
+/* Modeled on job_queue_rec_t and sort_job_queue2() */
+typedef struct queue_rec {
+	uint32_t job_id;
+	uint32_t priority;
+	int has_resv;
+} queue_rec_t;
+
+/* Sort in order of decreasing priority, jobs with reservations first */
+static int _queue_rec_cmp(void *x, void *y)
+{
+	queue_rec_t *rec1 = (queue_rec_t *) x;
+	queue_rec_t *rec2 = (queue_rec_t *) y;
+
+	if (rec1->has_resv && !rec2->has_resv)
+		return -1;
+	if (!rec1->has_resv && rec2->has_resv)
+		return 1;
+	if (rec1->priority < rec2->priority)
+		return 1;
+	if (rec1->priority > rec2->priority)
+		return -1;
+	return 0;
+}
+
+static void _queue_rec_del(void *x)
+{
+	xfree(x);
+}
+
+/* Build a queue of depth records in job ID order. A small range of
+ * priorities makes many ties, which must be kept in job ID order. */
+static List _build_queue(int depth, uint32_t prio_range)
+{
+	List queue = list_create(_queue_rec_del);
+	queue_rec_t *rec;
+	int i;
+
+	for (i = 0; i < depth; i++) {
+		rec = xmalloc(sizeof(queue_rec_t));
+		rec->job_id = i + 1;
+		rec->priority = random() % prio_range;
+		rec->has_resv = ((random() % 50) == 0);
+		list_append(queue, rec);
+	}
+	return queue;
+}
+
+/* Return true if records are in priority order, ties by job ID */
+static int _queue_ordered(List queue)
+{
+	ListIterator iter = list_iterator_create(queue);
+	queue_rec_t *rec, *last = NULL;
+	int rc = 1;
+
+	while ((rec = list_next(iter))) {
+		if (last && ((_queue_rec_cmp(last, rec) > 0) ||
+			     ((_queue_rec_cmp(last, rec) == 0) &&
+			      (last->job_id > rec->job_id)))) {
+			rc = 0;
+			break;
+		}
+		last = rec;
+	}
+	list_iterator_destroy(iter);
+	return rc;
+}
+
+static queue_rec_t *_queue_last(List queue)
+{
+	ListIterator iter = list_iterator_create(queue);
+	queue_rec_t *rec, *last = NULL;
+
+	while ((rec = list_next(iter)))
+		last = rec;
+	list_iterator_destroy(iter);
+	return last;
+}
+
+static double _elapsed(struct timeval *start)
+{
+	struct timeval end;
+
+	gettimeofday(&end, NULL);
+	return (end.tv_sec - start->tv_sec) +
+	       (end.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+/* Time one scheduling pass over the queue, as schedule() and the backfill
+ * scheduler take it, with list_pop_bottom() or list_sort()+list_pop() */
+static double _time_pass(int depth, int use_sort)
+{
+	List queue;
+	queue_rec_t *rec;
+	struct timeval start;
+	double secs;
+
+	srandom(depth);
+	queue = _build_queue(depth, 1000000);
+	gettimeofday(&start, NULL);
+	if (use_sort) {
+		list_sort(queue, _queue_rec_cmp);
+		while ((rec = list_pop(queue)))
+			xfree(rec);
+	} else {
+		while ((rec = list_pop_bottom(queue, _queue_rec_cmp)))
+			xfree(rec);
+	}
+	secs = _elapsed(&start);
+	list_destroy(queue);
+	return secs;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int max_depth = BENCH_DEPTH, depth;
+
+	if (argc > 1)
+		max_depth = atoi(argv[1]);
+
+	note("Testing list_sort");
+	{
+		List queue;
+		queue_rec_t *rec;
+		int i;
+
+		queue = list_create(_queue_rec_del);
+		list_sort(queue, _queue_rec_cmp);
+		TEST(list_count(queue) == 0, "sort empty list");
+		list_destroy(queue);
+
+		for (i = 1; i <= 1000; i = (i * 3) + 1) {
+			srandom(i);
+			queue = _build_queue(i, 10);
+			list_sort(queue, _queue_rec_cmp);
+			TEST(list_count(queue) == i, "sort keeps records");
+			TEST(_queue_ordered(queue), "sorted and stable");
+			rec = xmalloc(sizeof(queue_rec_t));
+			rec->job_id = i + 1;
+			list_append(queue, rec);
+			TEST(_queue_last(queue) == rec, "append after sort");
+			list_destroy(queue);
+		}
+	}
+
+	note("Testing list_sort matches list_pop_bottom order");
+	{
+		List queue1, queue2;
+		queue_rec_t *rec1, *rec2;
+		int same = 1;
+
+		srandom(1);
+		queue1 = _build_queue(2000, 100);
+		srandom(1);
+		queue2 = _build_queue(2000, 100);
+		list_sort(queue1, _queue_rec_cmp);
+		while ((rec2 = list_pop_bottom(queue2, _queue_rec_cmp))) {
+			rec1 = list_pop(queue1);
+			if ((rec1 == NULL) || (rec1->job_id != rec2->job_id))
+				same = 0;
+			xfree(rec1);
+			xfree(rec2);
+		}
+		TEST(same && (list_count(queue1) == 0), "same pop order");
+		list_destroy(queue1);
+		list_destroy(queue2);
+	}
+
+	note("Scheduling pass time by queue depth (seconds)");
+	for (depth = 1024; depth <= max_depth; depth *= 2) {
+		note("depth %6d: list_pop_bottom %8.4f  "
+		     "list_sort+list_pop %8.4f",
+		     depth, _time_pass(depth, 0), _time_pass(depth, 1));
+	}
+
+	totals();
+	return failed;
+}
@@ -95,6 +95,62 @@ int main (int argc, char *argv[])
 	xfree(outstring);
 
 	free_buf(buffer);
+
+	/* Buffers grow geometrically, not by BUF_SIZE at a time */
+	buffer = init_buf(0);
+	for (out32 = 0; out32 <= (BUF_SIZE * 4); out32++)
+		pack32(out32, buffer);
+	TEST(size_buf(buffer) != (BUF_SIZE * 32), "geometric growth");
+	data_size = get_buf_offset(buffer);
+	data = xfer_buf_data(buffer);
+	buffer = create_buf(data, data_size);
+	byte_cnt = 0;
+	while (unpack32(&out32, buffer) == 0) {
+		if (out32 != byte_cnt++)
+			break;
+	}
+	TEST(byte_cnt != ((BUF_SIZE * 4) + 1), "un/pack32 after growth");
+	free_buf(buffer);
+
+	/* A chained buffer references large data, flattening it copies
+	 * the data in place */
+	{
+		char *big = xmalloc(BUF_SIZE * 2);
+		struct iovec *iov;
+		int iov_cnt;
+
+		memset(big, 'x', BUF_SIZE * 2);
+		buffer = init_chained_buf(0);
+		pack16(test16, buffer);
+		pack_buf_ref(big, BUF_SIZE * 2, buffer);
+		pack_buf_ref(testbytes, sizeof(testbytes), buffer);
+		pack32(test32, buffer);
+		TEST(buffer->ref_cnt != 1, "pack_buf_ref references");
+		TEST(buf_length(buffer) != (sizeof(test16) + (BUF_SIZE * 2) +
+					    sizeof(testbytes) +
+					    sizeof(test32)),
+		     "buf_length of chained buffer");
+		iov = buf_iovec(buffer, &iov_cnt);
+		TEST((iov_cnt != 3) || (iov[1].iov_base != big),
+		     "buf_iovec");
+		xfree(iov);
+
+		buf_flatten(buffer);
+		data_size = get_buf_offset(buffer);
+		TEST((buffer->ref_cnt != 0) ||
+		     (data_size != buf_length(buffer)), "buf_flatten");
+		data = xfer_buf_data(buffer);
+		buffer = create_buf(data, data_size);
+		unpack16(&out16, buffer);
+		TEST((out16 != test16) ||
+		     memcmp(big, &data[sizeof(test16)], BUF_SIZE * 2),
+		     "unpack referenced data");
+		set_buf_offset(buffer, data_size - sizeof(test32));
+		unpack32(&out32, buffer);
+		TEST(out32 != test32, "unpack after referenced data");
+		free_buf(buffer);
+		xfree(big);
+	}
 	totals();
 	return failed;
 